@@ -667,6 +667,15 @@ void prinbeed::finish_initialization()
     }
 
     f_context_manager = prinbee::context_manager::get_instance();
+
+    // delete expired rows in the background
+    //
+    f_reaper = std::make_shared<prinbee::reaper>();
+    for(auto const & name : f_context_manager->get_context_list())
+    {
+        f_reaper->add_context(f_context_manager->get_context(name));
+    }
+    f_reaper->start();
 }
 
 
@@ -1486,6 +1495,12 @@ void prinbeed::stop(bool quitting)
         f_ping_pong_timer.reset();
     }
 
+    if(f_reaper != nullptr)
+    {
+        f_reaper->stop();
+        f_reaper.reset();
+    }
+
 // TODO: also close all the node_client connections
 //
 // TODO: also stop the worker threads (that is, we need to stop adding more
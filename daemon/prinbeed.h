@@ -29,6 +29,7 @@
 // prinbee
 //
 #include    <prinbee/database/context_manager.h>
+#include    <prinbee/database/reaper.h>
 #include    <prinbee/names.h>
 #include    <prinbee/network/binary_server.h>
 
@@ -142,6 +143,7 @@ private:
     versiontheca::versiontheca::pointer_t   f_protocol_version = std::make_shared<versiontheca::versiontheca>(f_protocol_trait, prinbee::g_name_prinbee_protocol_version_node);
     worker_pool::pointer_t                  f_worker_pool = worker_pool::pointer_t();
     prinbee::context_manager::pointer_t     f_context_manager = prinbee::context_manager::pointer_t();
+    prinbee::reaper::pointer_t              f_reaper = prinbee::reaper::pointer_t();
     payload_t::map_t                        f_expected_acknowledgment = payload_t::map_t();
                     
 
@@ -33,13 +33,9 @@
 #include    "prinbee/data/structure.h"
 
 
-// snaplogger
-//
-#include    <snaplogger/message.h>
-
-
 // C++
 //
+#include    <cstring>
 #include    <iostream>
 
 
@@ -54,18 +50,6 @@ namespace prinbee
 
 
 
-namespace
-{
-
-
-constexpr char const * g_errmsg_table = "block::~block() called with an f_data pointer, but f_table == nullptr.";
-constexpr char const * g_errmsg_exception = "block::~block() tried to release the f_data by it threw an exception.";
-
-
-}
-
-
-
 block::block(struct_description_t const * descriptions, dbfile::pointer_t f, reference_t offset)
     : f_file(f)
     , f_offset(offset)
@@ -96,41 +80,12 @@ block::block(struct_description_t const * descriptions, dbfile::pointer_t f, ref
 }
 
 
+/** \brief Clean up the block.
+ *
+ * The page_ref of the block gets released which unpins its page.
+ */
 block::~block()
 {
-    if(f_data != nullptr)
-    {
-        if(f_table == nullptr)
-        {
-            SNAP_LOG_FATAL
-                << g_errmsg_table
-                << SNAP_LOG_SEND;
-            std::cerr << g_errmsg_table << std::endl;
-            std::terminate();
-        }
-
-        try
-        {
-            f_table->get_dbfile()->release_data(f_data);
-            //f_data = nullptr;
-        }
-        catch(page_not_found const & e)
-        {
-            SNAP_LOG_FATAL
-                << g_errmsg_exception
-                << " ("
-                << e.what()
-                << ")."
-                << SNAP_LOG_SEND;
-            std::cerr
-                << g_errmsg_exception
-                << " ("
-                << e.what()
-                << ")."
-                << std::endl;
-            std::terminate();
-        }
-    }
 }
 
 
@@ -219,6 +174,10 @@ void block::set_dbtype(dbtype_t type)
         memset(data(sizeof(dbtype_t))
              , 0
              , size - sizeof(dbtype_t));
+
+        // a new block uses the latest version of its structure
+        //
+        set_structure_version();
     }
 }
 
@@ -236,7 +195,31 @@ void block::set_structure_version()
     //       use the latest on a write... a read is a TODO at the moment
     //
     //f_structure->set_version("_structure_version", f_version);
-    f_structure->set_version(g_system_field_name_structure_version, version_t());
+    //
+    // the structure refuses updates of its version so we save the
+    // latest version as defined in the description directly
+    //
+    field_t::pointer_t f(f_structure->get_field(g_system_field_name_structure_version));
+    std::uint32_t const version(f->description()->f_min_version.to_binary());
+    memcpy(data(f->offset()), &version, sizeof(version));
+}
+
+
+/** \brief Get the structure version saved in the block.
+ *
+ * Contrary to get_structure_version(), this function reads the version
+ * from the block data. Blocks created by an older version of the library
+ * may lack fields appended to their structure since; this version tells
+ * whether such fields can be trusted.
+ *
+ * \return The version saved in the block.
+ */
+version_t block::get_saved_structure_version() const
+{
+    field_t::pointer_t f(f_structure->get_field(g_system_field_name_structure_version));
+    std::uint32_t version(0);
+    memcpy(&version, data(f->offset()), sizeof(version));
+    return version_t(version);
 }
 
 
@@ -246,43 +229,55 @@ reference_t block::get_offset() const
 }
 
 
-void block::set_data(data_t data)
+void block::set_page(page_ref const & page)
 {
-    // the table retrieves the data pointer because it needs to determine
-    // the block type (using the first 4 bytes) and so the data pointer
-    // is already locked once and we can immediately save it in the block
+    // the table retrieves the page because it needs to determine the
+    // block type (using the first 4 bytes) and so the page is already
+    // pinned once and we can immediately save it in the block
     //
-    f_data = data;
+    f_page = page;
+}
+
+
+/** \brief Get the page of this block.
+ *
+ * The block keeps its page pinned for its whole lifetime. Objects that
+ * need to access the data of the block directly can keep a copy of this
+ * reference.
+ *
+ * \return The reference to the page of this block.
+ */
+page_ref const & block::get_page() const
+{
+    return f_page;
 }
 
 
 data_t block::data(reference_t offset)
 {
-    if(f_data == nullptr)
+    if(!f_page)
     {
-        //f_data = get_table()->get_dbfile()->data(f_offset);
-        throw logic_error("block::data() called before set_data().");
+        throw logic_error("block::data() called before set_page().");
     }
 
-    return f_data + (offset % get_table()->get_page_size());
+    return f_page.data() + (offset % get_table()->get_page_size());
 }
 
 
 const_data_t block::data(reference_t offset) const
 {
-    if(f_data == nullptr)
+    if(!f_page)
     {
-        //f_data = get_table()->get_dbfile()->data(f_offset);
-        throw logic_error("block::data() called before set_data().");
+        throw logic_error("block::data() called before set_page().");
     }
 
-    return f_data + (offset % get_table()->get_page_size());
+    return f_page.data() + (offset % get_table()->get_page_size());
 }
 
 
 void block::sync(bool immediate)
 {
-    get_table()->get_dbfile()->sync(f_data, immediate);
+    get_table()->get_dbfile()->sync(f_page, immediate);
 }
 
 
@@ -72,13 +72,15 @@ public:
     void                        set_dbtype(dbtype_t type);
     version_t                   get_structure_version() const;
     void                        set_structure_version();
+    version_t                   get_saved_structure_version() const;
     reference_t                 get_offset() const;
-    void                        set_data(data_t data);
+    void                        set_page(page_ref const & page);
+    page_ref const &            get_page() const;
     data_t                      data(reference_t offset = 0);
     const_data_t                data(reference_t offset = 0) const;
     void                        sync(bool immediate);
 
-    void                        from_current_file_version();
+    virtual void                from_current_file_version();
 
 protected:
                                 block(struct_description_t const * structure_description, dbfile::pointer_t f, reference_t offset);
@@ -89,7 +91,7 @@ protected:
     //version_t                   f_structure_version = version_t(); -- at the moment, this creates a loop
     reference_t                 f_offset = reference_t();
 
-    mutable data_t              f_data = nullptr;
+    page_ref                    f_page = page_ref();
 };
 
 
@@ -0,0 +1,247 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Block cache implementation.
+ *
+ * The blocks are distributed between the shards using a multiplicative
+ * hash of their offset. Blocks are page aligned so the low bits of the
+ * offset are always zero; the multiplication mixes the other bits so
+ * consecutive blocks end up in different shards.
+ *
+ * The cache holds a strong reference to each block. The blocks are
+ * reclaimed by release_unused() which removes the blocks only referenced
+ * by the cache. This check is safe under the shard lock: the only way to
+ * get a new reference to a block is through the cache, so a block with
+ * a use count of one can't be acquired by another thread while we
+ * remove it.
+ */
+
+// self
+//
+#include    "prinbee/block/block_cache.h"
+
+#include    "prinbee/exception.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+namespace
+{
+
+
+std::size_t shard_bits(std::size_t shards)
+{
+    if(shards == 0
+    || shards > 65536)
+    {
+        throw invalid_parameter(
+                  "the number of block cache shards ("
+                + std::to_string(shards)
+                + ") must be between 1 and 65536.");
+    }
+
+    std::size_t bits(0);
+    while((1ULL << bits) < shards)
+    {
+        ++bits;
+    }
+    return bits;
+}
+
+
+}
+// no name namespace
+
+
+
+/** \brief Initialize the block cache.
+ *
+ * The number of shards gets rounded up to the next power of two.
+ *
+ * \exception invalid_parameter
+ * The number of shards must be between 1 and 65536.
+ *
+ * \param[in] shards  The number of shards to use.
+ */
+block_cache::block_cache(std::size_t shards)
+    : f_shift(64 - shard_bits(shards))
+    , f_shards(1ULL << (64 - f_shift))
+{
+}
+
+
+std::size_t block_cache::get_shard_count() const
+{
+    return f_shards.size();
+}
+
+
+/** \brief Search for a block.
+ *
+ * \param[in] offset  The offset of the block.
+ *
+ * \return The block or a nullptr if it is not in the cache.
+ */
+block::pointer_t block_cache::find(reference_t offset)
+{
+    shard_t & shard(get_shard(offset));
+    cppthread::guard lock(shard.f_mutex);
+
+    auto it(shard.f_blocks.find(offset));
+    if(it == shard.f_blocks.end())
+    {
+        ++shard.f_statistics.f_misses;
+        return block::pointer_t();
+    }
+
+    ++shard.f_statistics.f_hits;
+    return it->second;
+}
+
+
+/** \brief Add a block to the cache.
+ *
+ * If another thread already added a block at the same offset, that
+ * block is kept and returned instead of \p b. This way all the threads
+ * share the same block object.
+ *
+ * \param[in] offset  The offset of the block.
+ * \param[in] b  The block to add.
+ *
+ * \return The block now in the cache.
+ */
+block::pointer_t block_cache::insert(reference_t offset, block::pointer_t b)
+{
+    shard_t & shard(get_shard(offset));
+    cppthread::guard lock(shard.f_mutex);
+
+    return shard.f_blocks.emplace(offset, b).first->second;
+}
+
+
+/** \brief Remove a block from the cache.
+ *
+ * This is used when the type of a block changes (i.e. a FREE block
+ * gets reused as a DATA block).
+ *
+ * \param[in] offset  The offset of the block to remove.
+ */
+void block_cache::erase(reference_t offset)
+{
+    shard_t & shard(get_shard(offset));
+    cppthread::guard lock(shard.f_mutex);
+
+    shard.f_blocks.erase(offset);
+}
+
+
+/** \brief Remove the blocks nobody else references.
+ *
+ * The function goes through all the shards and removes the blocks which
+ * are only referenced by the cache. This releases their page_ref so the
+ * page cache can evict their pages.
+ *
+ * \return The number of blocks released.
+ */
+std::size_t block_cache::release_unused()
+{
+    std::size_t count(0);
+    for(auto & shard : f_shards)
+    {
+        cppthread::guard lock(shard.f_mutex);
+        for(auto it(shard.f_blocks.begin()); it != shard.f_blocks.end(); )
+        {
+            if(it->second.use_count() == 1)
+            {
+                it = shard.f_blocks.erase(it);
+                ++shard.f_statistics.f_released;
+                ++count;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    return count;
+}
+
+
+/** \brief Remove all the blocks from the cache.
+ */
+void block_cache::clear()
+{
+    for(auto & shard : f_shards)
+    {
+        cppthread::guard lock(shard.f_mutex);
+        shard.f_blocks.clear();
+    }
+}
+
+
+/** \brief Retrieve the statistics of all the shards.
+ *
+ * \return The sum of the statistics of each shard.
+ */
+block_cache_statistics_t block_cache::get_statistics() const
+{
+    block_cache_statistics_t result;
+    for(auto const & shard : f_shards)
+    {
+        cppthread::guard lock(shard.f_mutex);
+        result.f_hits += shard.f_statistics.f_hits;
+        result.f_misses += shard.f_statistics.f_misses;
+        result.f_released += shard.f_statistics.f_released;
+        result.f_block_count += shard.f_blocks.size();
+    }
+    return result;
+}
+
+
+block_cache::shard_t & block_cache::get_shard(reference_t offset)
+{
+    if(f_shift >= 64)
+    {
+        return f_shards[0];
+    }
+
+    // Fibonacci hashing
+    //
+    return f_shards[(offset * 0x9E3779B97F4A7C15ULL) >> f_shift];
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
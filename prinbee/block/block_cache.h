@@ -0,0 +1,100 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Cache of the block objects of a table.
+ *
+ * The table keeps the block objects it creates so that the same block
+ * is not loaded and parsed over and over again. The cache is divided in
+ * shards, each with its own mutex, so workers accessing the same table
+ * from different threads rarely wait on each other.
+ */
+
+// self
+//
+#include    "prinbee/block/block.h"
+
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <unordered_map>
+#include    <vector>
+
+
+
+namespace prinbee
+{
+
+
+
+constexpr std::size_t               DEFAULT_BLOCK_CACHE_SHARDS = 16;
+
+
+struct block_cache_statistics_t
+{
+    std::uint64_t                   f_hits = 0;
+    std::uint64_t                   f_misses = 0;
+    std::uint64_t                   f_released = 0;
+    std::size_t                     f_block_count = 0;
+};
+
+
+class block_cache
+{
+public:
+                                    block_cache(std::size_t shards = DEFAULT_BLOCK_CACHE_SHARDS);
+                                    block_cache(block_cache const & rhs) = delete;
+
+    block_cache &                   operator = (block_cache const & rhs) = delete;
+
+    std::size_t                     get_shard_count() const;
+    block::pointer_t                find(reference_t offset);
+    block::pointer_t                insert(reference_t offset, block::pointer_t b);
+    void                            erase(reference_t offset);
+    std::size_t                     release_unused();
+    void                            clear();
+    block_cache_statistics_t        get_statistics() const;
+
+private:
+    struct alignas(64) shard_t
+    {
+        typedef std::unordered_map<reference_t, block::pointer_t>
+                                    map_t;
+
+        mutable cppthread::mutex    f_mutex = cppthread::mutex();
+        map_t                       f_blocks = map_t();
+        block_cache_statistics_t    f_statistics = block_cache_statistics_t();
+    };
+
+    shard_t &                       get_shard(reference_t offset);
+
+    std::size_t                     f_shift = 0;
+    std::vector<shard_t>            f_shards = std::vector<shard_t>();
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -31,12 +31,14 @@
 #include    "prinbee/block/block_entry_index.h"
 
 #include    "prinbee/block/block_header.h"
+#include    "prinbee/data/prefix_keys.h"
 #include    "prinbee/database/table.h"
 
 
 // C++
 //
-#include    <iostream>
+#include    <cstring>
+#include    <vector>
 
 
 // last include
@@ -87,7 +89,7 @@ constexpr struct_description_t g_description[] =
     define_description(
           FieldName(g_system_field_name_structure_version)
         , FieldType(struct_type_t::STRUCT_TYPE_STRUCTURE_VERSION)
-        , FieldVersion(0, 1)
+        , FieldVersion(0, 2)
     ),
     define_description(
           FieldName("count")
@@ -97,6 +99,10 @@ constexpr struct_description_t g_description[] =
           FieldName("size")
         , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
     ),
+    define_description(
+          FieldName("flags=layout:4")
+        , FieldType(struct_type_t::STRUCT_TYPE_BITS32)
+    ),
     define_description(
           FieldName("next")
         , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
@@ -114,6 +120,40 @@ constexpr struct_description_t g_description[] =
 };
 
 
+// version 0.1 had no "flags", its entries are always sorted
+//
+constexpr struct_description_t g_description_0_1[] =
+{
+    define_description(
+          FieldName(g_system_field_name_magic)
+        , FieldType(struct_type_t::STRUCT_TYPE_MAGIC)
+        , FieldDefaultValue(to_string(dbtype_t::BLOCK_TYPE_ENTRY_INDEX))
+    ),
+    define_description(
+          FieldName(g_system_field_name_structure_version)
+        , FieldType(struct_type_t::STRUCT_TYPE_STRUCTURE_VERSION)
+        , FieldVersion(0, 1)
+    ),
+    define_description(
+          FieldName("count")
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
+    ),
+    define_description(
+          FieldName("size")
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
+    ),
+    define_description(
+          FieldName("next")
+        , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
+    ),
+    define_description(
+          FieldName("previous")
+        , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
+    ),
+    end_descriptions()
+};
+
+
 
 
 }
@@ -171,6 +211,123 @@ void block_entry_index::set_key_size(std::uint32_t size)
 }
 
 
+index_layout_t block_entry_index::get_layout() const
+{
+    if(!has_flags())
+    {
+        return index_layout_t::INDEX_LAYOUT_SORTED;
+    }
+
+    return static_cast<index_layout_t>(f_structure->get_uinteger("flags.layout"));
+}
+
+
+/** \brief Change the order in which the entries are saved in this block.
+ *
+ * By default, the entries are saved in a sorted array. With the
+ * Eytzinger layout, the entries are saved in the order of a breadth
+ * first walk of a balanced binary tree. This makes searches faster since
+ * the first levels of the tree share a few cache lines and the next
+ * levels can be prefetched. Inserting a new entry is slower since the
+ * entries get sorted and reordered each time.
+ *
+ * The existing entries are reordered as required. The size of the
+ * entries must be defined first. A version 0.1 block gets upgraded
+ * to version 0.2 first since it has no field to save the layout.
+ *
+ * \exception full
+ * The existing entries must fit in the block once converted.
+ *
+ * \param[in] layout  The new layout.
+ */
+void block_entry_index::set_layout(index_layout_t layout)
+{
+    index_layout_t const current(get_layout());
+    if(layout == current)
+    {
+        return;
+    }
+
+    if(!has_flags())
+    {
+        upgrade();
+    }
+
+    std::uint32_t const count(get_count());
+    std::vector<std::uint8_t> entries;
+    get_sorted_entries(entries);
+    if(layout == index_layout_t::INDEX_LAYOUT_PREFIX
+        ? get_prefix_keys().get_encoded_size(entries.data(), count) > get_entries_size()
+        : count > get_entries_size() / get_size())
+    {
+        throw full("the entries of this block EIDX do not fit in one block with the new layout.");
+    }
+
+    f_structure->set_uinteger("flags.layout", static_cast<std::uint64_t>(layout));
+    save_entries(entries.data(), count);
+}
+
+
+/** \brief Read version 0.1 blocks with their own description.
+ *
+ * Version 0.2 added the "flags" field, which moved the "next" and
+ * "previous" fields and the entries. Older blocks keep being read with
+ * the version 0.1 description. They get upgraded only when their layout
+ * changes.
+ */
+void block_entry_index::from_current_file_version()
+{
+    if(has_flags())
+    {
+        return;
+    }
+
+    f_structure = std::make_shared<structure>(g_description_0_1);
+    f_structure->set_block(shared_from_this(), 0, get_table()->get_page_size());
+}
+
+
+bool block_entry_index::has_flags() const
+{
+    return get_saved_structure_version() >= version_t(0, 2);
+}
+
+
+/** \brief Convert a version 0.1 block to version 0.2.
+ *
+ * The header gets rewritten with the "flags" field and the entries
+ * get moved after the larger header.
+ *
+ * \exception full
+ * The entries of a full version 0.1 block may not fit anymore.
+ */
+void block_entry_index::upgrade()
+{
+    std::uint32_t const count(get_count());
+    std::uint32_t const size(get_size());
+    reference_t const next(get_next());
+    reference_t const previous(get_previous());
+    std::vector<std::uint8_t> entries(count * size);
+    memcpy(entries.data(), data(f_structure->get_static_size()), entries.size());
+
+    structure::pointer_t s(std::make_shared<structure>(g_description));
+    s->set_block(shared_from_this(), 0, get_table()->get_page_size());
+    if(entries.size() > get_table()->get_page_size() - s->get_static_size())
+    {
+        throw full("the entries of this version 0.1 block EIDX do not fit in a version 0.2 block.");
+    }
+
+    f_structure = s;
+    set_structure_version();
+    set_count(count);
+    set_size(size);
+    f_structure->set_uinteger("flags", 0);
+    set_next(next);
+    set_previous(previous);
+    memcpy(data(f_structure->get_static_size()), entries.data(), entries.size());
+}
+
+
 reference_t block_entry_index::get_next() const
 {
     return static_cast<reference_t>(f_structure->get_uinteger("next"));
@@ -196,70 +353,69 @@ void block_entry_index::set_previous(reference_t offset)
 
 
 oid_t block_entry_index::find_entry(buffer_t const & key) const
+{
+    return find_entry(key, f_position);
+}
+
+
+/** \brief Search for \p key without changing the state of the block.
+ *
+ * This version of find_entry() returns the position in \p position
+ * instead of saving it in the block. It is used by the read paths since
+ * many threads may search the same block at the same time.
+ *
+ * \param[in] key  The key to search.
+ * \param[out] position  The position of the first key larger or equal.
+ *
+ * \return The OID attached to \p key or NULL_FILE_ADDR if not found.
+ */
+oid_t block_entry_index::find_entry(buffer_t const & key, std::uint32_t & position) const
 {
     // the start offset is just after the structure
     // no alignment requirements since we use memcmp() and memcpy()
     // and that way the size can be anything
     //
     std::uint32_t const count(get_count());
-    if(count == 0)
-    {
-std::cerr << "count == 0 -- entry block is empty?!\n";
-        f_position = 0;
-        return NULL_FILE_ADDR;
-    }
-std::cerr << "key being sought -> ";
-for(int k(0); k < 16; ++k)
-{
-std::cerr << " " << std::hex << static_cast<int>(key[k]) << std::dec;
-}
-std::cerr << "\n";
-
     std::uint8_t const * buffer(data(f_structure->get_static_size()));
     std::uint32_t const size(get_size());
     std::uint32_t const length(std::min(size - sizeof(std::uint8_t) - sizeof(reference_t), key.size()));
-    std::uint32_t i(0);
-    std::uint32_t j(count);
-std::cerr << "count = " << count << " -- if less than 3 we may fail our search?!\n";
-    while(i < j)
+    std::uint8_t const * keys(buffer + sizeof(std::uint8_t) + sizeof(reference_t));
+    std::uint8_t const * end(data(0) + get_table()->get_page_size());
+    std::uint32_t index(0);
+    std::vector<std::uint8_t> entry;
+    switch(get_layout())
     {
-        f_position = (j - i) / 2 + i;
-        std::uint8_t const * ptr(buffer + f_position * size);
-std::cerr << "   f_position = " << f_position << "\n";
-for(int k(0); k < 1 + 8 + 16; ++k)
-{
-std::cerr << " " << std::hex << static_cast<int>(ptr[k]) << std::dec;
-}
-std::cerr << "\n";
-for(int k(0); k < 16; ++k)
-{
-std::cerr << " " << std::hex << static_cast<int>(key[k]) << std::dec;
-}
-std::cerr << "\n";
-        int const r(memcmp(ptr + sizeof(std::uint8_t) + sizeof(reference_t), key.data(), length));
-std::cerr << " and r = " << r << " for size " << length << "\n";
-        if(r < 0)
-        {
-            ++f_position;
-            i = f_position;
-        }
-        else if(r > 0)
-        {
-            j = f_position;
-        }
-        else
-        {
-            reference_t aligned_reference(0);
-            memcpy(&aligned_reference, ptr + sizeof(std::uint8_t), sizeof(reference_t));
-std::cerr << "   found it -> " << aligned_reference << "\n";
-            return aligned_reference;
-        }
+    case index_layout_t::INDEX_LAYOUT_EYTZINGER:
+        index = key_eytzinger_lower_bound(keys, count, size, end, key.data(), length);
+        position = eytzinger_to_position(index, count);
+        break;
+
+    case index_layout_t::INDEX_LAYOUT_PREFIX:
+        entry.resize(size);
+        index = get_prefix_keys().lower_bound(buffer, get_entries_size(), count, key.data(), length, entry.data());
+        position = index;
+        break;
+
+    default:
+        index = key_lower_bound(keys, count, size, end, key.data(), length);
+        position = index;
+        break;
+
+    }
+    if(index >= count)
+    {
+        return NULL_FILE_ADDR;
     }
 
-    // TBD: save current position close to point where we can do an insertion
+    std::uint8_t const * ptr(entry.empty() ? buffer + index * size : entry.data());
+    if(memcmp(ptr + sizeof(std::uint8_t) + sizeof(reference_t), key.data(), length) != 0)
+    {
+        return NULL_FILE_ADDR;
+    }
 
-std::cerr << "--- NOT FOUND ---\n";
-    return NULL_FILE_ADDR;
+    reference_t aligned_reference(0);
+    memcpy(&aligned_reference, ptr + sizeof(std::uint8_t), sizeof(reference_t));
+    return aligned_reference;
 }
 
 
@@ -290,13 +446,10 @@ std::uint32_t block_entry_index::get_position() const
  */
 void block_entry_index::add_entry(buffer_t const & key, oid_t position_oid, std::int32_t close_position)
 {
-    // the start offset is just after the structure
     // no alignment requirements since we use memcmp() and memcpy()
     // and that way the size can be anything
     //
-    std::uint8_t * buffer(data(f_structure->get_static_size()));
     std::uint32_t const count(get_count());
-std::cerr << "add_entry() starting with count = " << count << "and OID=" << position_oid << "\n";
     std::uint32_t const size(get_size());
     std::uint32_t const length(get_size() - sizeof(std::uint8_t) - sizeof(reference_t));
     std::uint32_t const min_length(std::min(length, static_cast<std::uint32_t>(key.size())));
@@ -308,67 +461,39 @@ std::cerr << "add_entry() starting with count = " << count << "and OID=" << posi
 
     if(close_position < 0)
     {
-        close_position = 0;
-        std::uint32_t i(0);
-        std::uint32_t j(count);
-        while(i < j)
+        if(find_entry(key) != NULL_FILE_ADDR)
         {
-            close_position = (j - i) / 2 + i;
-            std::uint8_t const * ptr(buffer + close_position * size);
-std::cerr << "\n--- ptr = " << reinterpret_cast<void const *>(buffer)
-                    << " + " << sizeof(std::uint8_t)
-                    << " + " << sizeof(reference_t)
-                    << " + " << close_position * size
-
-                    << " data = " << reinterpret_cast<void const *>(key.data())
-                    << " len = " << min_length
-                    << " pos = " << close_position
-                    << " size = " << size
-                    << " ptr = " << reinterpret_cast<void const *>(ptr)
-                    << "\n";
-            int const r(memcmp(ptr + sizeof(std::uint8_t) + sizeof(reference_t), key.data(), min_length));
-            if(r < 0)
-            {
-                ++close_position;
-                i = close_position;
-            }
-            else if(r > 0)
-            {
-                j = close_position;
-            }
-            else
-            {
-                // in this case we add the OID to the existing entry which
-                // we have to convert to a PIDX if not already defined as
-                // such--
-                //
+            // in this case we add the OID to the existing entry which
+            // we have to convert to a PIDX if not already defined as
+            // such--
+            //
 throw not_yet_implemented("block EIDX non-unique case");
-                break;
-            }
         }
+        close_position = f_position;
     }
 
-    size_t const page_size(get_table()->get_page_size());
-    size_t const max_count((page_size - f_structure->get_static_size()) / size);
-    if(count >= max_count)
+    if(get_layout() != index_layout_t::INDEX_LAYOUT_PREFIX
+    && count >= get_max_count())
     {
-        // here the close_position value can't be negative
-        //
-        if(static_cast<std::uint32_t>(close_position) >= max_count)
-        {
-            // the new entry needs to be inserted in another block
-            // (the next block if enough room, otherwise add a new
-            // block "in between")
-            //
-throw not_yet_implemented("block EIDX overflow case 1");
-        }
-
-        // insert this new entry here, but last entry needs to be moved
-        // to another EIDX
+        // the index_tree splits the block before we reach this point
         //
-throw not_yet_implemented("block EIDX overflow case 2");
+        throw full("block EIDX is full, it needs to be split before adding another entry.");
+    }
+    if(static_cast<std::uint32_t>(close_position) > count)
+    {
+        throw out_of_range(
+                  "block EIDX insertion position "
+                + std::to_string(close_position)
+                + " is out of range (count: "
+                + std::to_string(count)
+                + ").");
     }
 
+    // the insertion is done in a sorted array
+    //
+    std::vector<std::uint8_t> work;
+    std::uint8_t * buffer(load_entries(work, 1));
+
     std::uint32_t entries_after(count - close_position);
     if(entries_after > 0)
     {
@@ -405,14 +530,430 @@ throw not_yet_implemented("block EIDX overflow case 2");
              , length - key.size());
     }
 
+    save_entries(buffer, count + 1);
+
     // in this case we added one entry
     //
     set_count(count + 1);
 }
 
 
+/** \brief Remove the entry at \p position.
+ *
+ * The \p position is the position of the entry in sorted order as
+ * returned by get_position() after a successful find_entry().
+ *
+ * \exception out_of_range
+ * The \p position must be smaller than the number of entries.
+ *
+ * \param[in] position  The position of the entry to remove.
+ */
+void block_entry_index::remove_entry(std::uint32_t position)
+{
+    std::uint32_t const count(get_count());
+    if(position >= count)
+    {
+        throw out_of_range(
+                  "block EIDX position "
+                + std::to_string(position)
+                + " is out of range (count: "
+                + std::to_string(count)
+                + ").");
+    }
+
+    // a front coded block is updated in place, which never needs more
+    // space
+    //
+    if(get_layout() == index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        get_prefix_keys().remove(data(f_structure->get_static_size()), get_entries_size(), count, position);
+        set_count(count - 1);
+        return;
+    }
+
+    std::vector<std::uint8_t> work;
+    std::uint8_t * buffer(load_entries(work, 0));
+    std::uint32_t const size(get_size());
+    memmove(buffer + position * size
+          , buffer + (position + 1) * size
+          , (count - position - 1) * size);
+    memset(buffer + (count - 1) * size, 0, size);
+
+    save_entries(buffer, count - 1);
+    set_count(count - 1);
+}
 
 
+/** \brief Get the maximum number of entries this block can hold.
+ *
+ * \return The number of entries that fit in one block.
+ */
+std::uint32_t block_entry_index::get_max_count() const
+{
+    std::uint32_t const max_count(get_entries_size() / get_size());
+    if(get_layout() != index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        return max_count;
+    }
+
+    // with front coded keys, this is an estimate based on the space used
+    // by the current entries; it is never less than the number of fixed
+    // size entries which fit in the block
+    //
+    std::uint32_t const count(get_count());
+    std::uint32_t const used(get_prefix_keys().get_used_size(data(f_structure->get_static_size()), get_entries_size(), count));
+    if(count == 0
+    || used == 0)
+    {
+        return max_count;
+    }
+    return std::max(max_count, static_cast<std::uint32_t>(static_cast<std::uint64_t>(get_entries_size()) * count / used));
+}
+
+
+/** \brief Check whether one more entry may not fit in this block.
+ *
+ * With fixed size entries, this is true when the block holds
+ * get_max_count() entries. With front coded keys, this is true when
+ * an entry which shares nothing with its neighbors would not fit.
+ *
+ * \return true if the block needs to be split before adding an entry.
+ */
+bool block_entry_index::is_full() const
+{
+    if(get_layout() != index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        return get_count() >= get_max_count();
+    }
+
+    prefix_keys const keys(get_prefix_keys());
+    return keys.get_used_size(data(f_structure->get_static_size()), get_entries_size(), get_count())
+                + keys.get_max_entry_size() > get_entries_size();
+}
+
+
+/** \brief Check whether the entries of \p right fit in this block.
+ *
+ * \param[in] right  The block to be merged in this block.
+ *
+ * \return true if merge() can be called with \p right.
+ */
+bool block_entry_index::can_merge(pointer_t right) const
+{
+    std::uint32_t const count(get_count() + right->get_count());
+    if(get_layout() != index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        return count <= get_max_count();
+    }
+
+    std::vector<std::uint8_t> entries;
+    get_sorted_entries(entries);
+    std::vector<std::uint8_t> right_entries;
+    right->get_sorted_entries(right_entries);
+    entries.insert(entries.end(), right_entries.begin(), right_entries.end());
+    return get_prefix_keys().get_encoded_size(entries.data(), count) <= get_entries_size();
+}
+
+
+/** \brief Retrieve the key of the entry at \p position.
+ *
+ * The key is returned as saved in the block, so it may be truncated.
+ *
+ * \exception out_of_range
+ * The \p position must be smaller than the number of entries.
+ *
+ * \param[in] position  The position of the entry in sorted order.
+ *
+ * \return A copy of the key.
+ */
+buffer_t block_entry_index::get_key(std::uint32_t position) const
+{
+    std::vector<std::uint8_t> work;
+    std::uint8_t const * ptr(get_entry(position, &work));
+    return buffer_t(ptr + sizeof(std::uint8_t) + sizeof(oid_t), ptr + get_size());
+}
+
+
+/** \brief Retrieve the reference of the entry at \p position.
+ *
+ * \exception out_of_range
+ * The \p position must be smaller than the number of entries.
+ *
+ * \param[in] position  The position of the entry in sorted order.
+ *
+ * \return The OID or `IDXP` reference of that entry.
+ */
+oid_t block_entry_index::get_oid(std::uint32_t position) const
+{
+    oid_t aligned_oid(0);
+    memcpy(&aligned_oid, get_entry(position, nullptr) + sizeof(std::uint8_t), sizeof(oid_t));
+    return aligned_oid;
+}
+
+
+/** \brief Move the entries starting at \p position to \p right.
+ *
+ * The \p right block must be a new, empty block. The entries from
+ * \p position to the end of this block are moved to \p right and the
+ * \p right block gets linked just after this one.
+ *
+ * \exception logic_error
+ * The \p right block must be empty.
+ *
+ * \param[in] right  The block receiving the larger entries.
+ * \param[in] position  The position of the first entry to move.
+ */
+void block_entry_index::split(pointer_t right, std::uint32_t position)
+{
+    std::uint32_t const count(get_count());
+    if(right->get_count() != 0)
+    {
+        throw logic_error("the block EIDX receiving the entries of a split must be empty.");
+    }
+    if(position > count)
+    {
+        throw out_of_range(
+                  "block EIDX split position "
+                + std::to_string(position)
+                + " is out of range (count: "
+                + std::to_string(count)
+                + ").");
+    }
+
+    std::uint32_t const size(get_size());
+    right->set_size(size);
+    right->set_layout(get_layout());
+
+    std::vector<std::uint8_t> entries;
+    get_sorted_entries(entries);
+
+    std::uint32_t const moved(count - position);
+    right->save_entries(entries.data() + position * size, moved);
+    right->set_count(moved);
+    save_entries(entries.data(), position);
+    set_count(position);
+
+    reference_t const next(get_next());
+    right->set_previous(get_offset());
+    right->set_next(next);
+    if(next != NULL_FILE_ADDR)
+    {
+        std::static_pointer_cast<block_entry_index>(get_table()->get_block(next))->set_previous(right->get_offset());
+    }
+    set_next(right->get_offset());
+}
+
+
+/** \brief Move all the entries of \p right at the end of this block.
+ *
+ * The \p right block must be the block linked just after this one. Once
+ * the function returns, \p right is empty and unlinked so it can be
+ * freed.
+ *
+ * \exception full
+ * The entries of both blocks must fit in this block.
+ *
+ * \param[in] right  The block to merge in this block.
+ */
+void block_entry_index::merge(pointer_t right)
+{
+    if(right->get_size() != get_size())
+    {
+        throw logic_error("the block EIDX to merge must have the same entry size.");
+    }
+    if(!can_merge(right))
+    {
+        throw full("the entries of both block EIDX do not fit in one block.");
+    }
+
+    std::uint32_t const count(get_count());
+    std::uint32_t const right_count(right->get_count());
+    std::vector<std::uint8_t> entries;
+    get_sorted_entries(entries);
+    std::vector<std::uint8_t> right_entries;
+    right->get_sorted_entries(right_entries);
+    entries.insert(entries.end(), right_entries.begin(), right_entries.end());
+
+    save_entries(entries.data(), count + right_count);
+    set_count(count + right_count);
+    right_entries.clear();
+    right->save_entries(right_entries.data(), 0);
+    right->set_count(0);
+
+    reference_t const next(right->get_next());
+    set_next(next);
+    if(next != NULL_FILE_ADDR)
+    {
+        std::static_pointer_cast<block_entry_index>(get_table()->get_block(next))->set_previous(get_offset());
+    }
+    right->set_next(NULL_FILE_ADDR);
+    right->set_previous(NULL_FILE_ADDR);
+}
+
+
+/** \brief Get a pointer to the entry at \p position.
+ *
+ * With front coded keys, the entry gets decoded in \p work. If \p work
+ * is nullptr, the function returns a pointer to the header of the
+ * entry in the block (flags and OID) and the key is not available.
+ *
+ * \param[in] position  The position of the entry in sorted order.
+ * \param[in,out] work  A buffer used to decode the entry or nullptr.
+ *
+ * \return A pointer to the entry.
+ */
+std::uint8_t const * block_entry_index::get_entry(std::uint32_t position, std::vector<std::uint8_t> * work) const
+{
+    std::uint32_t const count(get_count());
+    if(position >= count)
+    {
+        throw out_of_range(
+                  "block EIDX position "
+                + std::to_string(position)
+                + " is out of range (count: "
+                + std::to_string(count)
+                + ").");
+    }
+
+    std::uint8_t const * buffer(data(f_structure->get_static_size()));
+    switch(get_layout())
+    {
+    case index_layout_t::INDEX_LAYOUT_EYTZINGER:
+        return buffer + eytzinger_from_position(position, count) * get_size();
+
+    case index_layout_t::INDEX_LAYOUT_PREFIX:
+        if(work == nullptr)
+        {
+            return buffer + get_prefix_keys().get_entry(buffer, get_entries_size(), count, position, nullptr);
+        }
+        work->resize(get_size());
+        get_prefix_keys().get_entry(buffer, get_entries_size(), count, position, work->data());
+        return work->data();
+
+    default:
+        return buffer + position * get_size();
+
+    }
+}
+
+
+/** \brief Retrieve a copy of the entries in sorted order.
+ *
+ * \param[out] entries  The array of fixed size entries.
+ */
+void block_entry_index::get_sorted_entries(std::vector<std::uint8_t> & entries) const
+{
+    std::uint32_t const count(get_count());
+    std::uint32_t const size(get_size());
+    std::uint8_t const * buffer(data(f_structure->get_static_size()));
+    entries.resize(count * size);
+    if(count == 0)
+    {
+        return;
+    }
+    switch(get_layout())
+    {
+    case index_layout_t::INDEX_LAYOUT_PREFIX:
+        get_prefix_keys().decode(buffer, get_entries_size(), count, entries.data());
+        break;
+
+    default:
+        memcpy(entries.data(), buffer, count * size);
+        if(get_layout() == index_layout_t::INDEX_LAYOUT_EYTZINGER)
+        {
+            eytzinger_to_sorted(entries.data(), count, size);
+        }
+        break;
+
+    }
+}
+
+
+/** \brief Get the entries as a sorted array which can be modified.
+ *
+ * The functions modifying the entries work on a sorted array. With
+ * fixed size entries, this is the block itself. With front coded keys,
+ * the entries get decoded in \p work, which is made large enough for
+ * \p extra more entries.
+ *
+ * Once done, call save_entries() with the returned pointer.
+ *
+ * \param[in,out] work  The buffer used with front coded keys.
+ * \param[in] extra  The number of entries about to be added.
+ *
+ * \return A pointer to the sorted entries.
+ */
+std::uint8_t * block_entry_index::load_entries(std::vector<std::uint8_t> & work, std::uint32_t extra)
+{
+    std::uint8_t * buffer(data(f_structure->get_static_size()));
+    switch(get_layout())
+    {
+    case index_layout_t::INDEX_LAYOUT_EYTZINGER:
+        eytzinger_to_sorted(buffer, get_count(), get_size());
+        return buffer;
+
+    case index_layout_t::INDEX_LAYOUT_PREFIX:
+        work.resize((get_count() + extra) * get_size());
+        get_prefix_keys().decode(buffer, get_entries_size(), get_count(), work.data());
+        return work.data();
+
+    default:
+        return buffer;
+
+    }
+}
+
+
+/** \brief Save \p count sorted entries in this block.
+ *
+ * The entries get saved using the layout of this block.
+ *
+ * \exception full
+ * With front coded keys, the entries must fit in the block. In that
+ * case the block is left unchanged.
+ *
+ * \param[in] entries  The sorted array of fixed size entries.
+ * \param[in] count  The number of entries.
+ */
+void block_entry_index::save_entries(std::uint8_t const * entries, std::uint32_t count)
+{
+    std::uint8_t * buffer(data(f_structure->get_static_size()));
+    std::uint32_t const size(get_size());
+    if(get_layout() == index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        if(!get_prefix_keys().encode(entries, count, buffer, get_entries_size()))
+        {
+            throw full("block EIDX is full, it needs to be split before adding another entry.");
+        }
+        return;
+    }
+
+    if(entries != buffer)
+    {
+        if(count > 0)
+        {
+            memcpy(buffer, entries, count * size);
+        }
+        memset(buffer + count * size, 0, get_entries_size() - count * size);
+    }
+    if(get_layout() == index_layout_t::INDEX_LAYOUT_EYTZINGER)
+    {
+        eytzinger_from_sorted(buffer, count, size);
+    }
+}
+
+
+prefix_keys block_entry_index::get_prefix_keys() const
+{
+    return prefix_keys(get_size(), sizeof(std::uint8_t) + sizeof(oid_t));
+}
+
+
+std::uint32_t block_entry_index::get_entries_size() const
+{
+    return get_table()->get_page_size() - f_structure->get_static_size();
+}
+
 
 
 } // namespace prinbee
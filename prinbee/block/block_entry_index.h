@@ -25,9 +25,16 @@
 
 // self
 //
+#include    "prinbee/data/key_search.h"
+#include    "prinbee/data/prefix_keys.h"
 #include    "prinbee/data/structure.h"
 
 
+// C++
+//
+#include    <vector>
+
+
 
 namespace prinbee
 {
@@ -50,16 +57,38 @@ public:
     std::uint32_t               get_size() const;
     void                        set_size(std::uint32_t size);
     void                        set_key_size(std::uint32_t size);
+    index_layout_t              get_layout() const;
+    void                        set_layout(index_layout_t layout);
     reference_t                 get_next() const;
     void                        set_next(reference_t offset);
     reference_t                 get_previous() const;
     void                        set_previous(reference_t offset);
 
     oid_t                       find_entry(buffer_t const & key) const;
+    oid_t                       find_entry(buffer_t const & key, std::uint32_t & position) const;
     std::uint32_t               get_position() const;
     void                        add_entry(buffer_t const & key, oid_t position_oid, std::int32_t close_position = -1);
+    void                        remove_entry(std::uint32_t position);
+    std::uint32_t               get_max_count() const;
+    bool                        is_full() const;
+    bool                        can_merge(pointer_t right) const;
+    buffer_t                    get_key(std::uint32_t position) const;
+    oid_t                       get_oid(std::uint32_t position) const;
+    void                        split(pointer_t right, std::uint32_t position);
+    void                        merge(pointer_t right);
+
+    virtual void                from_current_file_version() override;
 
 private:
+    bool                        has_flags() const;
+    void                        upgrade();
+    std::uint8_t const *        get_entry(std::uint32_t position, std::vector<std::uint8_t> * work) const;
+    void                        get_sorted_entries(std::vector<std::uint8_t> & entries) const;
+    std::uint8_t *              load_entries(std::vector<std::uint8_t> & work, std::uint32_t extra);
+    void                        save_entries(std::uint8_t const * entries, std::uint32_t count);
+    prefix_keys                 get_prefix_keys() const;
+    std::uint32_t               get_entries_size() const;
+
     mutable std::uint32_t       f_position = 0;
 };
 
@@ -194,6 +194,8 @@ public:
 
     free_space_t                get_free_space(std::uint32_t minimum_size);
     void                        release_space(reference_t offset);
+    reference_t                 get_empty_data_block();
+    std::uint32_t               remove_data_block(reference_t offset);
 
 private:
     reference_t *               get_free_space_pointer(std::uint32_t size);
@@ -504,13 +506,17 @@ free_space_t block_free_space_impl::get_free_space(std::uint32_t minimum_size)
 
 void block_free_space_impl::release_space(reference_t offset)
 {
-    if(offset % sizeof(reference_t) != 0)
+    // the offset returned by get_free_space() is just after the meta data
+    //
+    if((offset - sizeof(free_space_meta_t)) % sizeof(reference_t) != 0)
     {
         throw logic_error(
                   "release_space() called with an invalid offset ("
                 + std::to_string(offset)
                 + "); it must be a multiple of "
                 + std::to_string(sizeof(reference_t))
+                + " plus "
+                + std::to_string(sizeof(free_space_meta_t))
                 + ".");
     }
 
@@ -522,69 +528,128 @@ void block_free_space_impl::release_space(reference_t offset)
     {
         // keep reseting the data when releasing it
         //
-        memset(reinterpret_cast<data_t>(link + 1), 0, link->f_meta.f_size - sizeof(link->f_meta));
+        memset(reinterpret_cast<data_t>(link) + sizeof(link->f_meta), 0, link->f_meta.f_size - sizeof(link->f_meta));
     }
 
-    uint32_t const next_pos(link->f_meta.f_size + offset % f_block.get_table()->get_page_size());
-    uint32_t const total_space(total_space_available_in_one_data_block());
-    if(next_pos + sizeof(free_space_link_t) < total_space)
+    // the MOVED and DELETED flags do not apply to free space
+    //
+    link->f_meta.f_flags = 0;
+
+    // agglomerate with the free space immediately after, if any
+    //
+    std::uint32_t const page_size(f_block.get_table()->get_page_size());
+    std::uint32_t const position(offset % page_size);
+    std::uint32_t const next_pos(position + link->f_meta.f_size);
+    if(next_pos + sizeof(free_space_link_t) <= page_size)
     {
         free_space_link_t * next_link(reinterpret_cast<free_space_link_t *>(b->data(next_pos)));
-        if((next_link->f_meta.f_flags & FREE_SPACE_FLAG_ALLOCATED) != 0)
+        if(next_link->f_meta.f_size != 0
+        && (next_link->f_meta.f_flags & FREE_SPACE_FLAG_ALLOCATED) == 0)
         {
-            // merge the next with this one
-            //
-            link->f_meta.f_size += next_link->f_meta.f_size;
             unlink_space(next_link);
+            link->f_meta.f_size += next_link->f_meta.f_size;
         }
     }
 
-    reference_t start(f_block.get_table()->get_page_size() - total_space);
-    if((link - reinterpret_cast<free_space_link_t *>(0)) % f_block.get_table()->get_page_size() > start)
+    // agglomerate with the free space immediately before, if any; the
+    // spaces do not know their predecessor so we have to walk the `DATA`
+    // block from its start
+    //
+    std::uint32_t const start(page_size - total_space_available_in_one_data_block());
+    for(std::uint32_t o(start); o < position;)
     {
-        free_space_link_t * previous_link(reinterpret_cast<free_space_link_t *>(b->data(start)));
-        for(reference_t o(start);;)
+        free_space_link_t * previous_link(reinterpret_cast<free_space_link_t *>(b->data(o)));
+        if(previous_link->f_meta.f_size == 0)
         {
-            free_space_link_t * link_after(reinterpret_cast<free_space_link_t *>(reinterpret_cast<data_t>(previous_link) + previous_link->f_meta.f_size));
-            if(link_after == link)
-            {
-                if((previous_link->f_meta.f_flags & FREE_SPACE_FLAG_ALLOCATED) == 0)
-                {
-                    unlink_space(previous_link);
-                    previous_link->f_meta.f_size += link->f_meta.f_size;
-                    link_space(o, previous_link);
-
-                    link = previous_link;
-                }
-                break;
-            }
-            else if(link_after > link)
+            break;
+        }
+        std::uint32_t const after(o + previous_link->f_meta.f_size);
+        if(after == position)
+        {
+            if((previous_link->f_meta.f_flags & FREE_SPACE_FLAG_ALLOCATED) == 0)
             {
-                break;
+                unlink_space(previous_link);
+                previous_link->f_meta.f_size += link->f_meta.f_size;
+                offset -= position - o;
+                link = previous_link;
             }
-            o += previous_link->f_meta.f_size;
-            previous_link = link_after;
+            break;
         }
+        o = after;
     }
 
-    // for the previous we need to start searching from the beginning of the
-    // block; the `DATA` is an array of 
-    //
-
     link_space(offset, link);
+}
 
-    // TODO: look into agglomerating multiple free spaces if immediately
-    //       possible; here are the 4 possible cases
-    //
-    //       1. nothing before, nothing after, done
-    //       2. something before, enlarge previous block
-    //       3. something after, enlarge & move next block
-    //       4. something before and after, enlarge previous block, drop next block
-    //
-    //       right now, though we do not have a good way of finding a
-    //       previous block; the next block, though, should be at this
-    //       block + size so that one is easy and the block header is
-    //       enough to find it in our FSPC table
+
+/** \brief Check for a `DATA` block without any allocated space.
+ *
+ * Once all the spaces of a `DATA` block were released, the block is
+ * represented by a single free space which covers the entire block.
+ * All such blocks are found in the same list. This function returns
+ * the offset of the first one of those blocks.
+ *
+ * The function does not modify the lists. To actually reuse the block,
+ * call remove_data_block() first and then free the block.
+ *
+ * \return The offset of an empty `DATA` block or NULL_FILE_ADDR.
+ */
+reference_t block_free_space_impl::get_empty_data_block()
+{
+    std::uint32_t const total_space(total_space_available_in_one_data_block());
+    reference_t const * d(get_free_space_pointer(total_space));
+    if(*d == NULL_FILE_ADDR)
+    {
+        return NULL_FILE_ADDR;
+    }
+
+    std::uint32_t const page_size(f_block.get_table()->get_page_size());
+    return *d - *d % page_size;
+}
+
+
+/** \brief Remove all the free spaces of a `DATA` block from the lists.
+ *
+ * The compactor calls this function before moving the rows out of a
+ * `DATA` block. Once removed, get_free_space() can't return space
+ * from that block anymore, which means the block can be freed once
+ * its rows were moved.
+ *
+ * \param[in] offset  The offset of the `DATA` block.
+ *
+ * \return The number of bytes of free space that were removed.
+ */
+std::uint32_t block_free_space_impl::remove_data_block(reference_t offset)
+{
+    std::uint32_t const page_size(f_block.get_table()->get_page_size());
+    offset -= offset % page_size;
+
+    block::pointer_t b(f_block.get_table()->get_block(offset));
+    if(b->get_dbtype() != dbtype_t::BLOCK_TYPE_DATA)
+    {
+        throw logic_error(
+                  "remove_data_block() called with a block of type \""
+                + std::string(to_name(b->get_dbtype()))
+                + "\" instead of a DATA block.");
+    }
+
+    std::uint32_t removed(0);
+    for(std::uint32_t o(page_size - total_space_available_in_one_data_block()); o + sizeof(free_space_meta_t) <= page_size;)
+    {
+        free_space_link_t * link(reinterpret_cast<free_space_link_t *>(b->data(o)));
+        if(link->f_meta.f_size == 0)
+        {
+            break;
+        }
+        if((link->f_meta.f_flags & FREE_SPACE_FLAG_ALLOCATED) == 0)
+        {
+            unlink_space(link);
+            removed += link->f_meta.f_size;
+        }
+        o += link->f_meta.f_size;
+    }
+
+    return removed;
 }
 
 
@@ -658,6 +723,18 @@ void block_free_space::release_space(reference_t offset)
 }
 
 
+reference_t block_free_space::get_empty_data_block()
+{
+    return f_impl->get_empty_data_block();
+}
+
+
+std::uint32_t block_free_space::remove_data_block(reference_t offset)
+{
+    return f_impl->remove_data_block(offset);
+}
+
+
 bool block_free_space::get_flag(const_data_t ptr, std::uint8_t flag)
 {
     detail::free_space_meta_t const * meta(reinterpret_cast<detail::free_space_meta_t const *>(ptr) - 1);
@@ -686,6 +763,23 @@ std::uint32_t block_free_space::get_size(const_data_t ptr)
 }
 
 
+/** \brief Get the number of bytes available to the user.
+ *
+ * The get_size() function returns the size of the allocated space
+ * including the meta data. This function returns the number of bytes
+ * which follow \p ptr, i.e. how many bytes can be copied when moving
+ * the data somewhere else.
+ *
+ * \param[in] ptr  The pointer returned by get_free_space().
+ *
+ * \return The number of bytes available at \p ptr.
+ */
+std::uint32_t block_free_space::get_data_size(const_data_t ptr)
+{
+    return get_size(ptr) - sizeof(detail::free_space_meta_t);
+}
+
+
 
 } // namespace prinbee
 // vim: ts=4 sw=4 et
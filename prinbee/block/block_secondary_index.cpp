@@ -57,7 +57,7 @@ constexpr struct_description_t g_description[] =
     define_description(
           FieldName(g_system_field_name_structure_version)
         , FieldType(struct_type_t::STRUCT_TYPE_STRUCTURE_VERSION)
-        , FieldVersion(0, 1)
+        , FieldVersion(0, 2)
     ),
     define_description(
           FieldName("id")
@@ -71,6 +71,10 @@ constexpr struct_description_t g_description[] =
           FieldName("top_index")
         , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
     ),
+    define_description(
+          FieldName("next_secondary_index")
+        , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
+    ),
     //define_description(
     //      FieldName("first_index_block_with_free_space")
     //    , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
@@ -132,6 +136,25 @@ void block_secondary_index::set_top_index(reference_t offset)
 }
 
 
+/** \brief Get the `SIDX` of the next secondary index.
+ *
+ * The table header references the `SIDX` of the first secondary index.
+ * The others are linked through this reference.
+ *
+ * \return The reference to the next `SIDX` or NULL_FILE_ADDR.
+ */
+reference_t block_secondary_index::get_next_secondary_index() const
+{
+    return static_cast<reference_t>(f_structure->get_uinteger("next_secondary_index"));
+}
+
+
+void block_secondary_index::set_next_secondary_index(reference_t offset)
+{
+    f_structure->set_uinteger("next_secondary_index", offset);
+}
+
+
 uint32_t block_secondary_index::get_bloom_filter_flags() const
 {
     return static_cast<reference_t>(f_structure->get_uinteger("bloom_filter_flags"));
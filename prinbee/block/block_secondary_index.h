@@ -47,6 +47,13 @@ namespace prinbee
 
 
 
+// the keys are truncated to 56 bytes followed by the OID of the row
+// which makes all the keys unique
+//
+constexpr std::uint32_t         SECONDARY_INDEX_KEY_SIZE = 64;
+constexpr std::uint32_t         SECONDARY_INDEX_KEY_PREFIX_SIZE = SECONDARY_INDEX_KEY_SIZE - sizeof(oid_t);
+
+
 class block_secondary_index
     : public block
 {
@@ -61,6 +68,8 @@ public:
     void                        set_number_of_rows(uint64_t count);
     reference_t                 get_top_index() const;
     void                        set_top_index(reference_t offset);
+    reference_t                 get_next_secondary_index() const;
+    void                        set_next_secondary_index(reference_t offset);
     uint32_t                    get_bloom_filter_flags() const;
     void                        set_bloom_filter_flags(uint32_t flags);
 
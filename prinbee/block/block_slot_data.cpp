@@ -0,0 +1,142 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Block holding rows in slots of one size.
+ *
+ * The block header includes the size of the slots and a reference to the
+ * next `SLOT` block of the table. The slots start right after the header
+ * and go up to the end of the block. The few bytes left at the end, if
+ * any, are not used.
+ */
+
+// self
+//
+#include    "prinbee/block/block_slot_data.h"
+
+#include    "prinbee/database/table.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+namespace
+{
+
+
+// 'SLOT'
+constexpr struct_description_t const g_description[] =
+{
+    define_description(
+          FieldName(g_system_field_name_magic)
+        , FieldType(struct_type_t::STRUCT_TYPE_MAGIC)
+        , FieldDefaultValue(to_string(dbtype_t::BLOCK_TYPE_SLOT_DATA))
+    ),
+    define_description(
+          FieldName(g_system_field_name_structure_version)
+        , FieldType(struct_type_t::STRUCT_TYPE_STRUCTURE_VERSION)
+        , FieldVersion(0, 1)
+    ),
+    define_description(
+          FieldName("slot_size")
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
+    ),
+    define_description(
+          FieldName("next_slot_block")
+        , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
+    ),
+    end_descriptions()
+};
+
+
+}
+// no name namespace
+
+
+
+block_slot_data::block_slot_data(dbfile::pointer_t f, reference_t offset)
+    : block(g_description, f, offset)
+{
+}
+
+
+std::uint32_t block_slot_data::get_slot_size() const
+{
+    return static_cast<std::uint32_t>(f_structure->get_uinteger("slot_size"));
+}
+
+
+void block_slot_data::set_slot_size(std::uint32_t size)
+{
+    if(size == 0
+    || size % sizeof(reference_t) != 0)
+    {
+        throw invalid_parameter(
+                  "the size of a slot ("
+                + std::to_string(size)
+                + ") must be a non-zero multiple of "
+                + std::to_string(sizeof(reference_t))
+                + ".");
+    }
+
+    f_structure->set_uinteger("slot_size", size);
+}
+
+
+/** \brief Get the next `SLOT` block.
+ *
+ * All the `SLOT` blocks of a table are linked together starting with
+ * the file_table::get_first_slot_block() reference.
+ *
+ * \return The offset of the next `SLOT` block or NULL_FILE_ADDR.
+ */
+reference_t block_slot_data::get_next_slot_block() const
+{
+    return static_cast<reference_t>(f_structure->get_uinteger("next_slot_block"));
+}
+
+
+void block_slot_data::set_next_slot_block(reference_t offset)
+{
+    f_structure->set_uinteger("next_slot_block", offset);
+}
+
+
+std::uint32_t block_slot_data::get_slot_count() const
+{
+    std::uint32_t const size(get_slot_size());
+    if(size == 0)
+    {
+        return 0;
+    }
+    return (get_table()->get_page_size() - HEADER_SIZE) / size;
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
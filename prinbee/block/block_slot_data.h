@@ -0,0 +1,63 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Block holding rows in slots of one size.
+ *
+ * A `SLOT` block is divided in slots which all have the same size. The
+ * slot_allocator uses these blocks to allocate space for rows in O(1).
+ * Each slot starts with the same meta data as the spaces managed by the
+ * block_free_space so the flag functions of that class work on both.
+ */
+
+// self
+//
+#include    "prinbee/utils.h"
+#include    "prinbee/data/structure.h"
+
+
+
+namespace prinbee
+{
+
+
+
+class block_slot_data
+    : public block
+{
+public:
+    typedef std::shared_ptr<block_slot_data>    pointer_t;
+
+    static constexpr std::uint32_t
+                                HEADER_SIZE = round_up(sizeof(std::uint32_t) + sizeof(version_t) + sizeof(std::uint32_t) + sizeof(reference_t), sizeof(reference_t));
+
+                                block_slot_data(dbfile::pointer_t f, reference_t offset);
+
+    std::uint32_t               get_slot_size() const;
+    void                        set_slot_size(std::uint32_t size);
+    reference_t                 get_next_slot_block() const;
+    void                        set_next_slot_block(reference_t offset);
+    std::uint32_t               get_slot_count() const;
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -28,6 +28,14 @@
 //
 #include    "prinbee/block/block_top_index.h"
 
+#include    "prinbee/data/prefix_keys.h"
+#include    "prinbee/database/table.h"
+
+
+// C++
+//
+#include    <cstring>
+#include    <vector>
 
 
 // last include
@@ -73,7 +81,7 @@ constexpr struct_description_t g_description[] =
     define_description(
           FieldName(g_system_field_name_structure_version)
         , FieldType(struct_type_t::STRUCT_TYPE_STRUCTURE_VERSION)
-        , FieldVersion(0, 1)
+        , FieldVersion(0, 2)
     ),
     define_description(
           FieldName("count")
@@ -83,6 +91,10 @@ constexpr struct_description_t g_description[] =
           FieldName("size")
         , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
     ),
+    define_description(
+          FieldName("flags=layout:4")
+        , FieldType(struct_type_t::STRUCT_TYPE_BITS32)
+    ),
     //define_description(
     //      FieldName("indexes")
     //    , FieldType(struct_type_t::STRUCT_TYPE_ARRAY32) -- we use "count" for the size
@@ -92,6 +104,32 @@ constexpr struct_description_t g_description[] =
 };
 
 
+// version 0.1 had no "flags", its indexes are always sorted
+//
+constexpr struct_description_t g_description_0_1[] =
+{
+    define_description(
+          FieldName(g_system_field_name_magic)
+        , FieldType(struct_type_t::STRUCT_TYPE_MAGIC)
+        , FieldDefaultValue(to_string(dbtype_t::BLOCK_TYPE_TOP_INDEX))
+    ),
+    define_description(
+          FieldName(g_system_field_name_structure_version)
+        , FieldType(struct_type_t::STRUCT_TYPE_STRUCTURE_VERSION)
+        , FieldVersion(0, 1)
+    ),
+    define_description(
+          FieldName("count")
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
+    ),
+    define_description(
+          FieldName("size")
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
+    ),
+    end_descriptions()
+};
+
+
 
 }
 // no name namespace
@@ -133,56 +171,602 @@ void block_top_index::set_size(std::uint32_t size)
 }
 
 
+index_layout_t block_top_index::get_layout() const
+{
+    if(!has_flags())
+    {
+        return index_layout_t::INDEX_LAYOUT_SORTED;
+    }
+
+    return static_cast<index_layout_t>(f_structure->get_uinteger("flags.layout"));
+}
+
+
+/** \brief Change the order in which the indexes are saved in this block.
+ *
+ * See block_entry_index::set_layout() for details. A version 0.1 block
+ * gets upgraded to version 0.2 first.
+ *
+ * \exception full
+ * The existing indexes must fit in the block once converted.
+ *
+ * \param[in] layout  The new layout.
+ */
+void block_top_index::set_layout(index_layout_t layout)
+{
+    index_layout_t const current(get_layout());
+    if(layout == current)
+    {
+        return;
+    }
+
+    if(!has_flags())
+    {
+        upgrade();
+    }
+
+    std::uint32_t const count(get_count());
+    std::vector<std::uint8_t> entries;
+    get_sorted_entries(entries);
+    if(layout == index_layout_t::INDEX_LAYOUT_PREFIX
+        ? get_prefix_keys().get_encoded_size(entries.data(), count) > get_entries_size()
+        : count > get_entries_size() / get_size())
+    {
+        throw full("the indexes of this block TIDX do not fit in one block with the new layout.");
+    }
+
+    f_structure->set_uinteger("flags.layout", static_cast<std::uint64_t>(layout));
+    save_entries(entries.data(), count);
+}
+
+
+/** \brief Search the child which may include \p key.
+ *
+ * The key of each index is the smallest key found in the child it
+ * references. The function returns the reference of the last index
+ * with a key smaller or equal to \p key. The key of the first index is
+ * ignored: keys smaller than all the others are found in the first
+ * child.
+ *
+ * The position of that index is available with get_position().
+ *
+ * \note
+ * The keys saved in a top index must be complete. With truncated keys,
+ * a key equal to the truncated key of an index may be found in the
+ * previous child.
+ *
+ * \param[in] key  The key to search.
+ *
+ * \return The reference of the child or NULL_FILE_ADDR if the block is
+ * empty.
+ */
+/** \brief Read version 0.1 blocks with their own description.
+ *
+ * Version 0.2 added the "flags" field which moved the indexes. See
+ * block_entry_index::from_current_file_version() for details.
+ */
+void block_top_index::from_current_file_version()
+{
+    if(has_flags())
+    {
+        return;
+    }
+
+    f_structure = std::make_shared<structure>(g_description_0_1);
+    f_structure->set_block(shared_from_this(), 0, get_table()->get_page_size());
+}
+
+
+bool block_top_index::has_flags() const
+{
+    return get_saved_structure_version() >= version_t(0, 2);
+}
+
+
+/** \brief Convert a version 0.1 block to version 0.2.
+ *
+ * \exception full
+ * The indexes of a full version 0.1 block may not fit anymore.
+ */
+void block_top_index::upgrade()
+{
+    std::uint32_t const count(get_count());
+    std::uint32_t const size(get_size());
+    std::vector<std::uint8_t> entries(count * size);
+    memcpy(entries.data(), data(f_structure->get_static_size()), entries.size());
+
+    structure::pointer_t s(std::make_shared<structure>(g_description));
+    s->set_block(shared_from_this(), 0, get_table()->get_page_size());
+    if(entries.size() > get_table()->get_page_size() - s->get_static_size())
+    {
+        throw full("the indexes of this version 0.1 block TIDX do not fit in a version 0.2 block.");
+    }
+
+    f_structure = s;
+    set_structure_version();
+    set_count(count);
+    set_size(size);
+    f_structure->set_uinteger("flags", 0);
+    memcpy(data(f_structure->get_static_size()), entries.data(), entries.size());
+}
+
+
 reference_t block_top_index::find_index(buffer_t key) const
+{
+    return find_index(key, f_position);
+}
+
+
+/** \brief Search for \p key without changing the state of the block.
+ *
+ * This version of find_index() returns the position in \p position
+ * instead of saving it in the block. It is used by the read paths since
+ * many threads may search the same block at the same time.
+ *
+ * \param[in] key  The key to search.
+ * \param[out] position  The position of the child which may include
+ * \p key.
+ *
+ * \return The reference of the child or NULL_FILE_ADDR if the block is
+ * empty.
+ */
+reference_t block_top_index::find_index(buffer_t const & key, std::uint32_t & position) const
 {
     // the start offset is just after the structure
     // no alignment requirements since we use memcmp() and memcpy()
     // and that way the size can be anything
     //
-    // WARNING: keep in mind that the number of bytes we save in the
-    //          top indexes may be shorter than the number of bytes
-    //          in the key and in that case
+    std::uint8_t const * buffer(data(f_structure->get_static_size()));
+    std::uint32_t const count(get_count());
+    if(count == 0)
+    {
+        position = 0;
+        return NULL_FILE_ADDR;
+    }
+    std::uint32_t const size(get_size());
+    std::uint32_t const length(std::min(key.size(), size - sizeof(reference_t)));
+    std::uint8_t const * keys(buffer + sizeof(reference_t));
+    std::uint8_t const * end(data(0) + get_table()->get_page_size());
+    std::uint32_t index(0);
+    std::vector<std::uint8_t> entry;
+    switch(get_layout())
+    {
+    case index_layout_t::INDEX_LAYOUT_EYTZINGER:
+        index = key_eytzinger_lower_bound(keys, count, size, end, key.data(), length);
+        position = eytzinger_to_position(index, count);
+        break;
+
+    case index_layout_t::INDEX_LAYOUT_PREFIX:
+        entry.resize(size);
+        index = get_prefix_keys().lower_bound(buffer, get_entries_size(), count, key.data(), length, entry.data());
+        position = index;
+        break;
+
+    default:
+        index = key_lower_bound(keys, count, size, end, key.data(), length);
+        position = index;
+        break;
+
+    }
+
+    // the lower bound is the first index with a key larger or equal, so
+    // unless equal, the key is in the previous child
     //
-    //          TBD -- this may be totally wrong, we should be between
-    //          this and the next top index entry really which could be
-    //          a lot more (?!?)
+    if(index >= count
+    || memcmp((entry.empty() ? buffer + index * size : entry.data()) + sizeof(reference_t), key.data(), length) != 0)
+    {
+        if(position > 0)
+        {
+            --position;
+        }
+    }
+
+    return get_reference(position);
+}
+
+
+std::uint32_t block_top_index::get_position() const
+{
+    return f_position;
+}
+
+
+/** \brief Get the maximum number of indexes this block can hold.
+ *
+ * \return The number of indexes that fit in one block.
+ */
+std::uint32_t block_top_index::get_max_count() const
+{
+    std::uint32_t const max_count(get_entries_size() / get_size());
+    if(get_layout() != index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        return max_count;
+    }
+
+    // with front coded keys, this is an estimate (see
+    // block_entry_index::get_max_count())
     //
+    std::uint32_t const count(get_count());
+    std::uint32_t const used(get_prefix_keys().get_used_size(data(f_structure->get_static_size()), get_entries_size(), count));
+    if(count == 0
+    || used == 0)
+    {
+        return max_count;
+    }
+    return std::max(max_count, static_cast<std::uint32_t>(static_cast<std::uint64_t>(get_entries_size()) * count / used));
+}
+
+
+/** \brief Check whether one more index may not fit in this block.
+ *
+ * \return true if the block needs to be split before adding an index.
+ */
+bool block_top_index::is_full() const
+{
+    if(get_layout() != index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        return get_count() >= get_max_count();
+    }
+
+    prefix_keys const keys(get_prefix_keys());
+    return keys.get_used_size(data(f_structure->get_static_size()), get_entries_size(), get_count())
+                + keys.get_max_entry_size() > get_entries_size();
+}
+
+
+/** \brief Check whether the indexes of \p right fit in this block.
+ *
+ * Before merging, the index_tree replaces the key of the first index
+ * of \p right with the separator found in the parent. With front coded
+ * keys, that index may then take more space so the function keeps
+ * enough room for an index which shares nothing with its neighbors.
+ *
+ * \param[in] right  The block to be merged in this block.
+ *
+ * \return true if merge() can be called with \p right.
+ */
+bool block_top_index::can_merge(pointer_t right) const
+{
+    std::uint32_t const count(get_count() + right->get_count());
+    if(get_layout() != index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        return count <= get_max_count();
+    }
+
+    std::vector<std::uint8_t> entries;
+    get_sorted_entries(entries);
+    std::vector<std::uint8_t> right_entries;
+    right->get_sorted_entries(right_entries);
+    entries.insert(entries.end(), right_entries.begin(), right_entries.end());
+    prefix_keys const keys(get_prefix_keys());
+    return keys.get_encoded_size(entries.data(), count) + keys.get_max_entry_size() <= get_entries_size();
+}
+
+
+buffer_t block_top_index::get_key(std::uint32_t position) const
+{
+    std::vector<std::uint8_t> work;
+    std::uint8_t const * ptr(get_entry(position, &work));
+    return buffer_t(ptr + sizeof(reference_t), ptr + get_size());
+}
+
+
+reference_t block_top_index::get_reference(std::uint32_t position) const
+{
+    reference_t aligned_reference(0);
+    memcpy(&aligned_reference, get_entry(position, nullptr), sizeof(reference_t));
+    return aligned_reference;
+}
+
+
+void block_top_index::set_reference(std::uint32_t position, reference_t reference)
+{
+    // the reference is not front coded so it can be updated in place
+    //
+    std::uint8_t * buffer(data(f_structure->get_static_size()));
+    std::uint32_t const offset(get_layout() == index_layout_t::INDEX_LAYOUT_PREFIX
+            ? get_prefix_keys().get_entry(buffer, get_entries_size(), get_count(), position, nullptr)
+            : get_index(position) * get_size());
+    memcpy(buffer + offset, &reference, sizeof(reference_t));
+}
+
+
+/** \brief Insert an index at \p position.
+ *
+ * The caller is responsible for choosing a \p position which keeps the
+ * keys sorted. In most cases, this is the position of the child which
+ * was just split plus one.
+ *
+ * \exception full
+ * The block must not already be full. With front coded keys, the
+ * block is left unchanged when the new index does not fit.
+ *
+ * \param[in] key  The smallest key found in the child.
+ * \param[in] reference  The reference to the child block.
+ * \param[in] position  The position of the new index in sorted order.
+ */
+void block_top_index::add_index(buffer_t const & key, reference_t reference, std::uint32_t position)
+{
+    std::uint32_t const count(get_count());
+    if(get_layout() != index_layout_t::INDEX_LAYOUT_PREFIX
+    && count >= get_max_count())
+    {
+        throw full("block TIDX is full, it needs to be split before adding another index.");
+    }
+    if(position > count)
+    {
+        throw out_of_range(
+                  "block TIDX insertion position "
+                + std::to_string(position)
+                + " is out of range (count: "
+                + std::to_string(count)
+                + ").");
+    }
+
+    std::vector<std::uint8_t> work;
+    std::uint8_t * buffer(load_entries(work, 1));
+    std::uint32_t const size(get_size());
+    std::uint32_t const length(size - sizeof(reference_t));
+    std::uint8_t * ptr(buffer + position * size);
+    memmove(ptr + size, ptr, (count - position) * size);
+    memcpy(ptr, &reference, sizeof(reference_t));
+    std::uint32_t const min_length(std::min(length, static_cast<std::uint32_t>(key.size())));
+    memcpy(ptr + sizeof(reference_t), key.data(), min_length);
+    memset(ptr + sizeof(reference_t) + min_length, 0, length - min_length);
+
+    save_entries(buffer, count + 1);
+    set_count(count + 1);
+}
+
+
+void block_top_index::remove_index(std::uint32_t position)
+{
+    std::uint32_t const count(get_count());
+    if(position >= count)
+    {
+        throw out_of_range(
+                  "block TIDX position "
+                + std::to_string(position)
+                + " is out of range (count: "
+                + std::to_string(count)
+                + ").");
+    }
+
+    // a front coded block is updated in place, which never needs more
+    // space
+    //
+    if(get_layout() == index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        get_prefix_keys().remove(data(f_structure->get_static_size()), get_entries_size(), count, position);
+        set_count(count - 1);
+        return;
+    }
+
+    std::vector<std::uint8_t> work;
+    std::uint8_t * buffer(load_entries(work, 0));
+    std::uint32_t const size(get_size());
+    memmove(buffer + position * size
+          , buffer + (position + 1) * size
+          , (count - position - 1) * size);
+    memset(buffer + (count - 1) * size, 0, size);
+
+    save_entries(buffer, count - 1);
+    set_count(count - 1);
+}
+
+
+/** \brief Move the indexes starting at \p position to \p right.
+ *
+ * The \p right block must be a new, empty block.
+ *
+ * \param[in] right  The block receiving the larger indexes.
+ * \param[in] position  The position of the first index to move.
+ */
+void block_top_index::split(pointer_t right, std::uint32_t position)
+{
+    std::uint32_t const count(get_count());
+    if(right->get_count() != 0)
+    {
+        throw logic_error("the block TIDX receiving the indexes of a split must be empty.");
+    }
+    if(position > count)
+    {
+        throw out_of_range(
+                  "block TIDX split position "
+                + std::to_string(position)
+                + " is out of range (count: "
+                + std::to_string(count)
+                + ").");
+    }
+
+    std::uint32_t const size(get_size());
+    right->set_size(size);
+    right->set_layout(get_layout());
+
+    std::vector<std::uint8_t> entries;
+    get_sorted_entries(entries);
+
+    std::uint32_t const moved(count - position);
+    right->save_entries(entries.data() + position * size, moved);
+    right->set_count(moved);
+    save_entries(entries.data(), position);
+    set_count(position);
+}
+
+
+/** \brief Move all the indexes of \p right at the end of this block.
+ *
+ * Once the function returns, \p right is empty and can be freed.
+ *
+ * \exception full
+ * The indexes of both blocks must fit in this block.
+ *
+ * \param[in] right  The block to merge in this block.
+ */
+void block_top_index::merge(pointer_t right)
+{
+    if(right->get_size() != get_size())
+    {
+        throw logic_error("the block TIDX to merge must have the same index size.");
+    }
+    if(!can_merge(right))
+    {
+        throw full("the indexes of both block TIDX do not fit in one block.");
+    }
+
+    std::uint32_t const count(get_count());
+    std::uint32_t const right_count(right->get_count());
+    std::vector<std::uint8_t> entries;
+    get_sorted_entries(entries);
+    std::vector<std::uint8_t> right_entries;
+    right->get_sorted_entries(right_entries);
+    entries.insert(entries.end(), right_entries.begin(), right_entries.end());
+
+    save_entries(entries.data(), count + right_count);
+    set_count(count + right_count);
+    right_entries.clear();
+    right->save_entries(right_entries.data(), 0);
+    right->set_count(0);
+}
+
+
+std::uint32_t block_top_index::get_index(std::uint32_t position) const
+{
+    std::uint32_t const count(get_count());
+    if(position >= count)
+    {
+        throw out_of_range(
+                  "block TIDX position "
+                + std::to_string(position)
+                + " is out of range (count: "
+                + std::to_string(count)
+                + ").");
+    }
+
+    if(get_layout() == index_layout_t::INDEX_LAYOUT_EYTZINGER)
+    {
+        return eytzinger_from_position(position, count);
+    }
+    return position;
+}
+
+
+/** \brief Get a pointer to the index at \p position.
+ *
+ * See block_entry_index::get_entry() for details.
+ *
+ * \param[in] position  The position of the index in sorted order.
+ * \param[in,out] work  A buffer used to decode the index or nullptr.
+ *
+ * \return A pointer to the index.
+ */
+std::uint8_t const * block_top_index::get_entry(std::uint32_t position, std::vector<std::uint8_t> * work) const
+{
     std::uint8_t const * buffer(data(f_structure->get_static_size()));
+    if(get_layout() != index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        return buffer + get_index(position) * get_size();
+    }
+
+    if(work == nullptr)
+    {
+        return buffer + get_prefix_keys().get_entry(buffer, get_entries_size(), get_count(), position, nullptr);
+    }
+    work->resize(get_size());
+    get_prefix_keys().get_entry(buffer, get_entries_size(), get_count(), position, work->data());
+    return work->data();
+}
+
+
+void block_top_index::get_sorted_entries(std::vector<std::uint8_t> & entries) const
+{
     std::uint32_t const count(get_count());
     std::uint32_t const size(get_size());
-    std::uint32_t const length(std::min(key.size(), size - sizeof(reference_t)));
-    std::uint32_t i(0);
-    std::uint32_t j(count);
-    while(i < j)
-    {
-        f_position = (j - i) / 2 + i;
-        std::uint8_t const * ptr(buffer + f_position * size);
-        int const r(memcmp(ptr + sizeof(reference_t), key.data(), length));
-        if(r < 0)
+    std::uint8_t const * buffer(data(f_structure->get_static_size()));
+    entries.resize(count * size);
+    if(count == 0)
+    {
+        return;
+    }
+    switch(get_layout())
+    {
+    case index_layout_t::INDEX_LAYOUT_PREFIX:
+        get_prefix_keys().decode(buffer, get_entries_size(), count, entries.data());
+        break;
+
+    default:
+        memcpy(entries.data(), buffer, count * size);
+        if(get_layout() == index_layout_t::INDEX_LAYOUT_EYTZINGER)
         {
-            i = f_position + 1;
+            eytzinger_to_sorted(entries.data(), count, size);
         }
-        else if(r > 0)
+        break;
+
+    }
+}
+
+
+// the functions modifying the indexes work on a sorted array, see
+// block_entry_index::load_entries() for details
+//
+std::uint8_t * block_top_index::load_entries(std::vector<std::uint8_t> & work, std::uint32_t extra)
+{
+    std::uint8_t * buffer(data(f_structure->get_static_size()));
+    switch(get_layout())
+    {
+    case index_layout_t::INDEX_LAYOUT_EYTZINGER:
+        eytzinger_to_sorted(buffer, get_count(), get_size());
+        return buffer;
+
+    case index_layout_t::INDEX_LAYOUT_PREFIX:
+        work.resize((get_count() + extra) * get_size());
+        get_prefix_keys().decode(buffer, get_entries_size(), get_count(), work.data());
+        return work.data();
+
+    default:
+        return buffer;
+
+    }
+}
+
+
+void block_top_index::save_entries(std::uint8_t const * entries, std::uint32_t count)
+{
+    std::uint8_t * buffer(data(f_structure->get_static_size()));
+    std::uint32_t const size(get_size());
+    if(get_layout() == index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        if(!get_prefix_keys().encode(entries, count, buffer, get_entries_size()))
         {
-            j = f_position;
+            throw full("block TIDX is full, it needs to be split before adding another index.");
         }
-        else
+        return;
+    }
+
+    if(entries != buffer)
+    {
+        if(count > 0)
         {
-            reference_t aligned_reference(0);
-            memcpy(&aligned_reference, ptr, sizeof(reference_t));
-            return aligned_reference;
+            memcpy(buffer, entries, count * size);
         }
+        memset(buffer + count * size, 0, get_entries_size() - count * size);
+    }
+    if(get_layout() == index_layout_t::INDEX_LAYOUT_EYTZINGER)
+    {
+        eytzinger_from_sorted(buffer, count, size);
     }
+}
 
-    // TBD: save current position close to point where we can do an insertion
 
-    return NULL_FILE_ADDR;
+prefix_keys block_top_index::get_prefix_keys() const
+{
+    return prefix_keys(get_size(), sizeof(reference_t));
 }
 
 
-std::uint32_t block_top_index::get_position() const
+std::uint32_t block_top_index::get_entries_size() const
 {
-    return f_position;
+    return get_table()->get_page_size() - f_structure->get_static_size();
 }
 
 
@@ -25,9 +25,16 @@
 
 // self
 //
+#include    "prinbee/data/key_search.h"
+#include    "prinbee/data/prefix_keys.h"
 #include    "prinbee/data/structure.h"
 
 
+// C++
+//
+#include    <vector>
+
+
 
 namespace prinbee
 {
@@ -46,11 +53,36 @@ public:
     void                        set_count(std::uint32_t id);
     std::uint32_t               get_size() const;
     void                        set_size(std::uint32_t size);
+    index_layout_t              get_layout() const;
+    void                        set_layout(index_layout_t layout);
 
     reference_t                 find_index(buffer_t key) const;
+    reference_t                 find_index(buffer_t const & key, std::uint32_t & position) const;
     std::uint32_t               get_position() const;
+    std::uint32_t               get_max_count() const;
+    bool                        is_full() const;
+    bool                        can_merge(pointer_t right) const;
+    buffer_t                    get_key(std::uint32_t position) const;
+    reference_t                 get_reference(std::uint32_t position) const;
+    void                        set_reference(std::uint32_t position, reference_t reference);
+    void                        add_index(buffer_t const & key, reference_t reference, std::uint32_t position);
+    void                        remove_index(std::uint32_t position);
+    void                        split(pointer_t right, std::uint32_t position);
+    void                        merge(pointer_t right);
+
+    virtual void                from_current_file_version() override;
 
 private:
+    bool                        has_flags() const;
+    void                        upgrade();
+    std::uint32_t               get_index(std::uint32_t position) const;
+    std::uint8_t const *        get_entry(std::uint32_t position, std::vector<std::uint8_t> * work) const;
+    void                        get_sorted_entries(std::vector<std::uint8_t> & entries) const;
+    std::uint8_t *              load_entries(std::vector<std::uint8_t> & work, std::uint32_t extra);
+    void                        save_entries(std::uint8_t const * entries, std::uint32_t count);
+    prefix_keys                 get_prefix_keys() const;
+    std::uint32_t               get_entries_size() const;
+
     mutable std::uint32_t       f_position = 0;
 };
 
@@ -70,8 +70,11 @@ public:
 private:
     std::uint64_t               get_position(oid_t & id, reference_t const * & refs) const;
 
-    mutable std::uint32_t       f_start_offset = 0;
-    mutable size_t              f_count = 0;
+    // computed on first use, possibly by several readers at once
+    //
+    mutable std::atomic<std::uint32_t>
+                                f_start_offset = 0;
+    mutable std::atomic<size_t> f_count = 0;
 };
 
 
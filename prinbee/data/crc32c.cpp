@@ -0,0 +1,324 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief CRC32C implementation.
+ *
+ * The CRC32C uses the Castagnoli polynomial (0x1EDC6F41, 0x82F63B78 in
+ * its reflected form). It is the CRC computed by the crc32 instruction
+ * available on x86 processors supporting SSE4.2.
+ *
+ * The crc32 instruction has a latency of 3 cycles and a throughput of
+ * one per cycle. To make full use of it, the hardware implementation
+ * computes the CRC of three consecutive chunks of the buffer in parallel
+ * and then combines the three results. Combining means shifting a CRC
+ * by the length of a chunk, which is done with four table lookups.
+ *
+ * When the processor does not support SSE4.2, a software version using
+ * the slicing-by-8 algorithm is used instead.
+ */
+
+// self
+//
+#include    "prinbee/data/crc32c.h"
+
+
+
+// C++
+//
+#include    <cstring>
+
+
+// C
+//
+#if defined(__x86_64__)
+#include    <nmmintrin.h>
+#endif
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+namespace
+{
+
+
+
+constexpr crc32c_t const        CRC32C_POLYNOMIAL = 0x82F63B78;
+
+// size of each one of the three chunks processed in parallel
+//
+constexpr std::size_t const     CRC32C_CHUNK_SIZE = 256;
+
+
+typedef crc32c_t (*crc32c_function_t)(std::uint8_t const * data, std::size_t size, crc32c_t crc);
+
+
+struct crc32c_tables_t
+{
+    crc32c_t        f_slice[8][256] = {};
+    crc32c_t        f_shift[4][256] = {};
+};
+
+
+/** \brief Multiply two polynomials modulo the CRC32C polynomial.
+ *
+ * Both polynomials use the reflected representation: the most significant
+ * bit represents x^0.
+ *
+ * \param[in] a  The first polynomial.
+ * \param[in] b  The second polynomial.
+ *
+ * \return a * b modulo the CRC32C polynomial.
+ */
+crc32c_t multiply_modulo(crc32c_t a, crc32c_t b)
+{
+    crc32c_t result(0);
+    for(crc32c_t m(1U << 31); m != 0; m >>= 1)
+    {
+        if((a & m) != 0)
+        {
+            result ^= b;
+        }
+        b = (b & 1) != 0 ? (b >> 1) ^ CRC32C_POLYNOMIAL : b >> 1;
+    }
+    return result;
+}
+
+
+/** \brief Compute x^(8 * n) modulo the CRC32C polynomial.
+ *
+ * Multiplying a CRC by this value is equivalent to running the CRC over
+ * \p n zero bytes.
+ *
+ * \param[in] n  The number of bytes to shift by.
+ *
+ * \return x^(8 * n) modulo the CRC32C polynomial.
+ */
+crc32c_t shift_operator(std::size_t n)
+{
+    crc32c_t result(1U << 31);     // x^0
+    crc32c_t square(1U << 23);     // x^8
+    for(; n != 0; n >>= 1)
+    {
+        if((n & 1) != 0)
+        {
+            result = multiply_modulo(square, result);
+        }
+        square = multiply_modulo(square, square);
+    }
+    return result;
+}
+
+
+crc32c_tables_t const & get_tables()
+{
+    static crc32c_tables_t const tables([]()
+        {
+            crc32c_tables_t t;
+            for(crc32c_t n(0); n < 256; ++n)
+            {
+                crc32c_t crc(n);
+                for(int k(0); k < 8; ++k)
+                {
+                    crc = (crc & 1) != 0 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+                }
+                t.f_slice[0][n] = crc;
+            }
+            for(crc32c_t n(0); n < 256; ++n)
+            {
+                for(int k(1); k < 8; ++k)
+                {
+                    crc32c_t const previous(t.f_slice[k - 1][n]);
+                    t.f_slice[k][n] = (previous >> 8) ^ t.f_slice[0][previous & 0xFF];
+                }
+            }
+
+            crc32c_t const op(shift_operator(CRC32C_CHUNK_SIZE));
+            for(crc32c_t n(0); n < 256; ++n)
+            {
+                for(int k(0); k < 4; ++k)
+                {
+                    t.f_shift[k][n] = multiply_modulo(op, n << (k * 8));
+                }
+            }
+            return t;
+        }());
+
+    return tables;
+}
+
+
+std::uint64_t load64(std::uint8_t const * data)
+{
+    std::uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+
+crc32c_t crc32c_software(std::uint8_t const * data, std::size_t size, crc32c_t crc)
+{
+    crc32c_tables_t const & t(get_tables());
+
+    for(; size >= 8; size -= 8, data += 8)
+    {
+        std::uint64_t const v(load64(data) ^ crc);
+        crc = t.f_slice[7][v & 0xFF]
+            ^ t.f_slice[6][(v >> 8) & 0xFF]
+            ^ t.f_slice[5][(v >> 16) & 0xFF]
+            ^ t.f_slice[4][(v >> 24) & 0xFF]
+            ^ t.f_slice[3][(v >> 32) & 0xFF]
+            ^ t.f_slice[2][(v >> 40) & 0xFF]
+            ^ t.f_slice[1][(v >> 48) & 0xFF]
+            ^ t.f_slice[0][v >> 56];
+    }
+    for(; size > 0; --size, ++data)
+    {
+        crc = (crc >> 8) ^ t.f_slice[0][(crc ^ *data) & 0xFF];
+    }
+
+    return crc;
+}
+
+
+#if defined(__x86_64__)
+std::uint64_t shift_chunk(crc32c_tables_t const & t, std::uint64_t crc)
+{
+    return t.f_shift[0][crc & 0xFF]
+         ^ t.f_shift[1][(crc >> 8) & 0xFF]
+         ^ t.f_shift[2][(crc >> 16) & 0xFF]
+         ^ t.f_shift[3][(crc >> 24) & 0xFF];
+}
+
+
+__attribute__((target("sse4.2")))
+crc32c_t crc32c_sse42(std::uint8_t const * data, std::size_t size, crc32c_t crc)
+{
+    std::uint64_t crc0(crc);
+
+    // align the data so the 8 byte loads do not cross cache lines
+    //
+    for(; size > 0 && (reinterpret_cast<std::uintptr_t>(data) & 7) != 0; --size, ++data)
+    {
+        crc0 = _mm_crc32_u8(static_cast<std::uint32_t>(crc0), *data);
+    }
+
+    if(size >= CRC32C_CHUNK_SIZE * 3)
+    {
+        crc32c_tables_t const & t(get_tables());
+        do
+        {
+            std::uint64_t crc1(0);
+            std::uint64_t crc2(0);
+            std::uint8_t const * end(data + CRC32C_CHUNK_SIZE);
+            do
+            {
+                crc0 = _mm_crc32_u64(crc0, load64(data));
+                crc1 = _mm_crc32_u64(crc1, load64(data + CRC32C_CHUNK_SIZE));
+                crc2 = _mm_crc32_u64(crc2, load64(data + CRC32C_CHUNK_SIZE * 2));
+                data += 8;
+            }
+            while(data < end);
+            crc0 = shift_chunk(t, crc0) ^ crc1;
+            crc0 = shift_chunk(t, crc0) ^ crc2;
+            data += CRC32C_CHUNK_SIZE * 2;
+            size -= CRC32C_CHUNK_SIZE * 3;
+        }
+        while(size >= CRC32C_CHUNK_SIZE * 3);
+    }
+
+    for(; size >= 8; size -= 8, data += 8)
+    {
+        crc0 = _mm_crc32_u64(crc0, load64(data));
+    }
+    for(; size > 0; --size, ++data)
+    {
+        crc0 = _mm_crc32_u8(static_cast<std::uint32_t>(crc0), *data);
+    }
+
+    return static_cast<crc32c_t>(crc0);
+}
+#endif
+
+
+crc32c_function_t select_implementation()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse4.2"))
+    {
+        return crc32c_sse42;
+    }
+#endif
+
+    return crc32c_software;
+}
+
+
+crc32c_function_t get_implementation()
+{
+    static crc32c_function_t const implementation(select_implementation());
+    return implementation;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Compute the CRC32C of a buffer.
+ *
+ * This function computes the CRC32C of the \p size bytes at \p data.
+ *
+ * To compute the CRC of data split in several buffers, pass the CRC
+ * returned for the previous buffer as the \p crc parameter. The first
+ * call must use 0.
+ *
+ * \param[in] data  The buffer to compute the CRC of.
+ * \param[in] size  The number of bytes in \p data.
+ * \param[in] crc  The CRC of the data preceeding \p data.
+ *
+ * \return The CRC32C of the data.
+ */
+crc32c_t crc32c_compute(std::uint8_t const * data, std::size_t size, crc32c_t crc)
+{
+    return ~get_implementation()(data, size, ~crc);
+}
+
+
+/** \brief Check whether the CRC32C is computed by the processor.
+ *
+ * \return true if the crc32 instruction is used.
+ */
+bool crc32c_is_hardware_accelerated()
+{
+    return get_implementation() != crc32c_software;
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,49 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Handling of CRC32C computations.
+ *
+ * The dbfile computes a CRC32C (Castagnoli) of each page to detect silent
+ * corruption of the data on disk. On x86 processors with SSE4.2, the
+ * computation uses the crc32 instruction and costs a fraction of a
+ * microsecond per 4 KiB page.
+ */
+
+// C++
+//
+#include    <cstdint>
+
+
+
+namespace prinbee
+{
+
+
+
+typedef std::uint32_t       crc32c_t;
+
+crc32c_t crc32c_compute(std::uint8_t const * data, std::size_t size, crc32c_t crc = 0);
+bool crc32c_is_hardware_accelerated();
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -29,24 +29,37 @@
 #include    "prinbee/data/dbfile.h"
 
 #include    "prinbee/exception.h"
+#include    "prinbee/data/io_uring_backend.h"
 #include    "prinbee/file/file_table.h"
 #include    "prinbee/database/table.h"
 
 
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/runner.h>
+
+
 // snapdev
 //
 #include    <snapdev/not_used.h>
 
 
-// C
+// C++
 //
-#include    <sys/mman.h>
-#include    <sys/stat.h>
+#include    <algorithm>
 
 
-// C++
+// C
 //
-#include    <iostream>
+#include    <fcntl.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
 
 
 // last include
@@ -65,6 +78,29 @@ namespace
 
 constexpr char const *          g_table_extension = ".snapdb";
 constexpr char const *          g_global_lock_filename = "global.lock";
+constexpr char const *          g_checksum_extension = ".crc";
+
+// the checksums get saved in chunks of this many entries (4 KiB)
+//
+constexpr std::size_t           CHECKSUMS_PER_CHUNK = 1024;
+
+
+/** \brief Compute the checksum of one page.
+ *
+ * A checksum of 0 in the checksum file means that the checksum of that
+ * page is not known. A page with a CRC32C of 0 is saved as 0xFFFFFFFF
+ * instead.
+ *
+ * \param[in] data  The pointer to the page.
+ * \param[in] page_size  The size of the page.
+ *
+ * \return The checksum to save for this page.
+ */
+crc32c_t page_checksum(const_data_t data, std::size_t page_size)
+{
+    crc32c_t const crc(crc32c_compute(data, page_size));
+    return crc == 0 ? ~crc : crc;
+}
 
 
 std::string generate_table_dir(std::string const & path, std::string const & table_name)
@@ -109,6 +145,78 @@ std::string generate_table_dir(std::string const & path, std::string const & tab
 
 
 
+namespace detail
+{
+
+
+
+/** \brief Background thread flushing the dirty pages.
+ *
+ * This runner wakes up at regular intervals and calls flush_all(false)
+ * on its dbfile. That starts the write back of the dirty pages without
+ * waiting for the I/O to complete.
+ */
+class dbfile_flusher
+    : public cppthread::runner
+{
+public:
+                            dbfile_flusher(dbfile * f, std::uint64_t interval);
+
+    virtual void            run() override;
+    void                    wakeup();
+
+private:
+    dbfile *                f_dbfile = nullptr;
+    std::uint64_t           f_interval = DEFAULT_FLUSH_INTERVAL;
+};
+
+
+dbfile_flusher::dbfile_flusher(dbfile * f, std::uint64_t interval)
+    : runner("dbfile_flusher")
+    , f_dbfile(f)
+    , f_interval(interval)
+{
+}
+
+
+void dbfile_flusher::run()
+{
+    while(continue_running())
+    {
+        {
+            cppthread::guard lock(f_mutex);
+            f_mutex.timed_wait(f_interval * 1000);
+        }
+
+        try
+        {
+            f_dbfile->flush_all(false);
+        }
+        catch(std::exception const & e)
+        {
+            SNAP_LOG_ERROR
+                << "background flush of \""
+                << f_dbfile->get_fullname()
+                << "\" failed: "
+                << e.what()
+                << SNAP_LOG_SEND;
+        }
+    }
+}
+
+
+void dbfile_flusher::wakeup()
+{
+    cppthread::guard lock(f_mutex);
+    f_mutex.signal();
+}
+
+
+
+} // namespace detail
+
+
+
 dbfile::dbfile(std::string const & path, std::string const & table_name, std::string const & filename)
     : f_path(path)
     , f_table_name(table_name)
@@ -117,6 +225,7 @@ dbfile::dbfile(std::string const & path, std::string const & table_name, std::st
     , f_fullname(f_dirname + "/" + f_filename + g_table_extension)
     , f_lock_filename(f_dirname + "/" + g_global_lock_filename)
     , f_pid(getpid())
+    , f_pages([this](reference_t offset, data_t data) { release_page(offset, data); })
 {
 }
 
@@ -147,6 +256,44 @@ table::pointer_t dbfile::get_table() const
 
 void dbfile::close()
 {
+    stop_flusher();
+
+    if(f_backend != nullptr)
+    {
+        f_backend->wait_all();
+        f_backend.reset();
+    }
+
+    // unmap all the pages before closing the file
+    //
+    // (when checksums are enabled, releasing the pages is what computes
+    // their final checksum)
+    //
+    f_pages.clear(f_checksum_fd != -1);
+    unmap_extents();
+    f_free_pages.clear();
+
+    if(f_checksum_fd != -1)
+    {
+        try
+        {
+            save_checksums();
+        }
+        catch(io_error const & e)
+        {
+            SNAP_LOG_ERROR
+                << "could not save the checksums of \""
+                << f_fullname
+                << "\": "
+                << e.what()
+                << SNAP_LOG_SEND;
+        }
+        ::close(f_checksum_fd);
+        f_checksum_fd = -1;
+    }
+    f_checksums.clear();
+    f_dirty_checksums.clear();
+
     if(f_fd != -1)
     {
         ::close(f_fd);
@@ -182,6 +329,7 @@ void dbfile::set_page_size(size_t page_size)
     {
         f_page_size = count * system_page_size;
     }
+    f_pages.set_page_size(f_page_size);
 }
 
 
@@ -229,6 +377,102 @@ dbtype_t dbfile::get_type() const
 }
 
 
+/** \brief Set the size of the extents used to map the file.
+ *
+ * The file gets mapped in memory in large extents instead of one page at
+ * a time. This reduces the number of mmap() calls and the number of
+ * virtual memory areas the kernel has to manage.
+ *
+ * The size must be a multiple of the page size. It can only be changed
+ * before any data gets mapped.
+ *
+ * \exception logic_error
+ * The function raises this exception if extents are already mapped.
+ *
+ * \exception invalid_parameter
+ * The size must be a non-zero multiple of the page size.
+ *
+ * \param[in] size  The size of one extent in bytes.
+ */
+void dbfile::set_extent_size(size_t size)
+{
+    if(!f_extents.empty())
+    {
+        throw logic_error("The extent size of a dbfile can't be changed once data was mapped.");
+    }
+
+    size_t const page_size(get_page_size());
+    if(size == 0
+    || size % page_size != 0)
+    {
+        throw invalid_parameter(
+                  "The extent size ("
+                + std::to_string(size)
+                + ") must be a non-zero multiple of the page size ("
+                + std::to_string(page_size)
+                + ").");
+    }
+
+    f_extent_size = size;
+}
+
+
+size_t dbfile::get_extent_size() const
+{
+    return f_extent_size;
+}
+
+
+/** \brief Set the amount of memory the page cache can use.
+ *
+ * The dbfile keeps the pages it maps in a page cache. Pages that are not
+ * in use anymore remain mapped until the cache reaches this budget. At
+ * that point, the least recently used pages get unmapped.
+ *
+ * The default is DEFAULT_PAGE_CACHE_BUDGET. A budget of 0 means the cache
+ * is not limited.
+ *
+ * \param[in] budget  The maximum number of bytes to keep mapped.
+ */
+void dbfile::set_cache_budget(size_t budget)
+{
+    f_pages.set_budget(budget);
+}
+
+
+size_t dbfile::get_cache_budget() const
+{
+    return f_pages.get_budget();
+}
+
+
+/** \brief Check whether the page cache is over budget.
+ *
+ * When all the pages in the cache are pinned, the cache can't evict any
+ * of them and it goes over budget. The table uses this function to know
+ * whether it should release some of its blocks.
+ *
+ * \return true if the cache uses more memory than its budget allows.
+ */
+bool dbfile::is_cache_over_budget() const
+{
+    return f_pages.is_over_budget();
+}
+
+
+/** \brief Retrieve the page cache statistics.
+ *
+ * This function returns the number of hits, misses, and evictions of
+ * the page cache. This is useful to tune the cache budget.
+ *
+ * \return The statistics of the page cache of this file.
+ */
+page_cache_statistics_t dbfile::get_cache_statistics() const
+{
+    return f_pages.get_statistics();
+}
+
+
 int dbfile::open_file()
 {
     // already open?
@@ -283,6 +527,8 @@ int dbfile::open_file()
                 + "\".");
         }
 
+        open_checksums(true);
+
         // in this one case we are in creation mode which means we
         // create the header block, which is important because it has
         // the special offset of 0 and we use that block to allocate
@@ -297,213 +543,994 @@ int dbfile::open_file()
         sdbt->set_block_size(page_size);
         sdbt->set_file_version(v);
         sdbt->set_last_oid(1);
+        sdbt->set_high_water_mark(get_high_water_mark());
         sdbt->sync(false);
     }
+    else
+    {
+        open_checksums(false);
+    }
+
+    start_flusher();
 
     return f_fd;
 }
 
 
-data_t dbfile::data(reference_t offset)
+void dbfile::start_flusher()
 {
-    int fd(open_file());
-
-    size_t const sz(get_page_size());
-
-    reference_t const page_offset(offset % sz);
-    reference_t const page_start(offset - page_offset);
-
-    auto it(f_pages.left.find(page_start));
-    if(it != f_pages.left.end())
+    if(f_flush_interval == 0
+    || f_flusher_thread != nullptr)
     {
-        return it->second;
+        return;
     }
 
-static int count(0);
-++count;
-std::cerr << ">>> data() calling mmap() for the " << count << " times\n";
+    f_flusher = std::make_shared<detail::dbfile_flusher>(this, f_flush_interval);
+    f_flusher_thread = std::make_shared<cppthread::thread>("dbfile_flusher", f_flusher);
+    f_flusher_thread->start();
+}
 
-    data_t ptr(reinterpret_cast<data_t>(mmap(
-          nullptr
-        , sz
-        , PROT_READ | PROT_WRITE
-        , MAP_SHARED
-        , fd
-        , page_start)));
 
-    if(ptr == nullptr)
+void dbfile::stop_flusher()
+{
+    if(f_flusher_thread == nullptr)
     {
-        throw io_error(
-                  "mmap() failed on \""
-                + f_filename
-                + "\" at offset "
-                + std::to_string(offset)
-                + ".");
+        return;
     }
 
-    f_pages.insert(page_bimap_t::value_type(page_start, ptr));
+    f_flusher_thread->stop([this](cppthread::thread *)
+        {
+            f_flusher->wakeup();
+        });
+    f_flusher_thread.reset();
+    f_flusher.reset();
 
-    return ptr + page_offset;
+    // make sure the last dirty pages get written
+    //
+    flush_all(false);
 }
 
 
-void dbfile::release_data(data_t data)
+/** \brief Get the page including \p offset.
+ *
+ * This function returns a reference to the page which includes \p offset.
+ * The page is pinned in the page cache and remains in memory as long as
+ * the returned page_ref or one of its copies exists.
+ *
+ * The pages are part of large extents mapped with map_extent() so
+ * the pointer is computed from the start of the extent.
+ *
+ * When a page enters the page cache, its checksum gets verified (see
+ * set_checksums()).
+ *
+ * This function can be called from any thread.
+ *
+ * \exception io_error
+ * If the page can't be mapped in memory, this exception is raised.
+ *
+ * \exception corrupted_data
+ * The checksum of the page does not match its data.
+ *
+ * \param[in] offset  The offset of the data to access.
+ *
+ * \return A reference to the page including \p offset.
+ */
+page_ref dbfile::get_page(reference_t offset)
 {
+    cppthread::guard lock(f_mutex);
+
+    open_file();
+
     size_t const sz(get_page_size());
 
-    intptr_t const data_ptr(reinterpret_cast<intptr_t>(data));
-    intptr_t const page_ptr(data_ptr - data_ptr % sz);
-    auto it(f_pages.right.find(reinterpret_cast<data_t>(page_ptr)));
-    if(it == f_pages.right.end())
+    reference_t const page_start(offset - offset % sz);
+
+    page_ref page(f_pages.pin(page_start));
+    if(page)
     {
-        throw page_not_found(
-                  "page "
-                + std::to_string(page_ptr)
-                + " not found. It cannot be unmapped.");
+        return page;
     }
-    f_pages.right.erase(it);
 
-    munmap(reinterpret_cast<data_t>(page_ptr), sz);
+    data_t const ptr(map_extent(page_start));
+    verify_checksum(page_start, ptr);
+    return f_pages.add(page_start, ptr);
 }
 
 
-void dbfile::sync(data_t data, bool immediate)
+/** \brief Ask the kernel to start reading pages ahead of time.
+ *
+ * This function is used by scans which know which pages they are going
+ * to read next. The pages which include one of the \p offsets and are
+ * not already in the page cache get advised with MADV_WILLNEED. The
+ * kernel then reads them asynchronously so the following get_page()
+ * calls do not block on a page fault.
+ *
+ * Consecutive pages of the same extent are advised with a single
+ * madvise() call. Offsets beyond the end of the file are ignored.
+ *
+ * This is only a hint, errors are ignored.
+ *
+ * \param[in] offsets  The offsets of the data to be read soon.
+ */
+void dbfile::prefetch(reference_vector_t const & offsets)
 {
-    size_t const sz(get_page_size());
+    if(offsets.empty())
+    {
+        return;
+    }
 
-    intptr_t const data_ptr(reinterpret_cast<intptr_t>(data));
-    intptr_t const page_ptr(data_ptr - data_ptr % sz);
+    cppthread::guard lock(f_mutex);
 
-#if 1
-    msync(reinterpret_cast<data_t>(page_ptr)
-        , sz
-        , (immediate ? MS_SYNC : MS_ASYNC) | MS_INVALIDATE);
-#else
-    snapdev::NOT_USED(page_ptr, immediate);
-#endif
-}
+    open_file();
 
+    size_t const sz(get_page_size());
+    size_t const file_size(get_size());
 
-size_t dbfile::get_size() const
-{
-    if(f_fd == -1)
+    reference_vector_t pages;
+    pages.reserve(offsets.size());
+    for(auto const & offset : offsets)
     {
-        throw file_not_opened(
-                  "file is not yet opened, get_size() can't be called.");
+        reference_t const page_start(offset - offset % sz);
+        if(page_start < file_size
+        && f_pages.find(page_start) == nullptr)
+        {
+            pages.push_back(page_start);
+        }
     }
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
 
-    struct stat s;
-    if(::fstat(f_fd, &s) == -1)
+    data_t start(nullptr);
+    size_t size(0);
+    for(auto const & page_start : pages)
     {
-        throw io_error(
-                  "stat() failed on \""
-                + f_filename
-                + "\".");
+        data_t const ptr(map_extent(page_start));
+        if(start != nullptr
+        && start + size == ptr)
+        {
+            size += sz;
+            continue;
+        }
+        if(start != nullptr)
+        {
+            madvise(start, size, MADV_WILLNEED);
+        }
+        start = ptr;
+        size = sz;
+    }
+    if(start != nullptr)
+    {
+        madvise(start, size, MADV_WILLNEED);
     }
-
-    return s.st_size;
 }
 
 
-reference_t dbfile::append_free_block(reference_t const previous_block_offset)
+/** \brief Mark \p page as dirty.
+ *
+ * The page gets added to the list of dirty pages. The background flusher
+ * thread sends the dirty pages to disk at regular intervals.
+ *
+ * When \p immediate is true, the page gets written to disk immediately
+ * and the function waits for the write to complete.
+ *
+ * \param[in] page  The page to sync.
+ * \param[in] immediate  Whether to write the page to disk immediately.
+ */
+void dbfile::sync(page_ref const & page, bool immediate)
 {
-    if(f_fd == -1)
-    {
-        throw file_not_opened(
-                  "file is not yet opened, append_free_block() can't be called.");
-    }
-
-    reference_t const p(lseek(f_fd, 0, SEEK_END));
-    if(p == static_cast<reference_t>(-1))
-    {
-        close();
-        throw io_error(
-                  "lseek() failed on \""
-                + f_filename
-                + "\".");
-    }
+    reference_t const offset(page.get_offset());
 
-    dbtype_t const magic(dbtype_t::BLOCK_TYPE_FREE_BLOCK);
-    write_data(&magic, sizeof(magic));
-    version_t const version(0, 1);
-    auto const v(version.to_binary());
-    write_data(&v, sizeof(v));
-    write_data(&previous_block_offset, sizeof(previous_block_offset));
-    if(!f_sparse_file)
-    {
-        // make sure to write the rest too so for sure it's not sparse
-        //
-        std::vector<uint8_t> zeroes(get_page_size() - sizeof(magic) - sizeof(previous_block_offset));
-        write_data(zeroes.data(), zeroes.size());
-    }
-    else
+    if(immediate)
     {
-        // this is what makes the file sparse
-        //
-        // (note that really happens only when
-        // `get_page_size() > get_system_page_size()`)
-        //
-        if(ftruncate(f_fd, p + get_page_size()) != 0)
         {
-            int const e(errno);
-            close();
-            throw io_error(
-                  "System could not properly truncate the file \""
-                + f_filename
-                + "\" ("
-                + std::to_string(e)
-                + ", "
-                + strerror(e)
-                + ").");
+            cppthread::guard lock(f_dirty_mutex);
+            f_dirty_pages.erase(offset);
+        }
+        msync(page.data(), get_page_size(), MS_SYNC);
+        if(f_checksum_fd != -1)
+        {
+            write_checksum(offset, page.data());
+            save_checksums();
         }
+        return;
     }
 
-    return p;
+    mark_dirty(offset);
+}
+
+
+/** \brief Mark the page at \p offset as dirty.
+ *
+ * \param[in] offset  The offset of a page that was modified.
+ */
+void dbfile::mark_dirty(reference_t offset)
+{
+    size_t const sz(get_page_size());
+
+    cppthread::guard lock(f_dirty_mutex);
+    f_dirty_pages.insert(offset - offset % sz);
+}
+
+
+/** \brief Get the number of pages waiting to be flushed.
+ *
+ * \return The number of dirty pages.
+ */
+size_t dbfile::get_dirty_count() const
+{
+    cppthread::guard lock(f_dirty_mutex);
+    return f_dirty_pages.size();
 }
 
 
-/** \brief Grow the file.
+/** \brief Enable or disable the page checksums.
  *
- * We use this function to grow the file with a full page of data.
+ * By default, the dbfile saves a CRC32C of each page in a file named
+ * after the database file with a ".crc" extension. The checksum of a page
+ * gets computed when the page leaves the page cache, when it gets written
+ * with sync(data, true), by each flush_all() including the ones of the
+ * background flusher, and when the block gets written by the storage
+ * backend (see get_backend()). It gets verified the first time the page enters the page cache. The cost
+ * is well under a microsecond per 4 KiB page on processors supporting
+ * SSE4.2.
  *
- * \exception io_error
- * On an error, the function raises this exception and closes the file.
+ * The checksums are kept in a separate file because most blocks make
+ * use of their entire page.
+ *
+ * A page with an unknown checksum (i.e. it was never released by a
+ * dbfile with checksums enabled) is not verified.
+ *
+ * This parameter must be defined before the file gets opened.
+ *
+ * \exception logic_error
+ * The file is already opened.
  *
- * \param[in] ptr  Pointer to the block of data to write to the file.
- * \param[in] size  The number of bytes in the block of data to write.
+ * \param[in] checksums  Whether to compute and verify the page checksums.
  */
-void dbfile::write_data(void const * ptr, size_t size)
+void dbfile::set_checksums(bool checksums)
 {
-    if(f_fd == -1)
+    if(f_fd != -1)
     {
-        throw file_not_opened(
-                  "file is not yet opened, write_data() can't be called.");
+        throw logic_error("The checksums of a dbfile can't be turned on or off once the file is opened.");
     }
 
-    int const sz(write(f_fd, ptr, size));
-    if(static_cast<size_t>(sz) != size)
-    {
-        close();
-        throw io_error(
-              "System could not properly write to file \""
-            + f_filename
-            + "\".");
-    }
+    f_checksums_enabled = checksums;
 }
 
 
-char const * to_name(dbtype_t type)
+bool dbfile::get_checksums() const
 {
-    switch(type)
-    {
-    case dbtype_t::DBTYPE_UNKNOWN:
-        return "Unknown";
+    return f_checksums_enabled;
+}
 
-    case dbtype_t::FILE_TYPE_CONTEXT:
-        return "Prinbee Context (CTXT)";
 
-    case dbtype_t::FILE_TYPE_TABLE:
-        return "Prinbee Table (PTBL)";
+/** \brief Set the interval between two background flushes.
+ *
+ * The background flusher thread wakes up every \p interval milliseconds
+ * and starts writing the dirty pages to disk. Setting the interval to 0
+ * prevents the thread from being started; in that case only flush_all()
+ * sends the dirty pages to disk.
+ *
+ * The interval must be defined before the file gets opened.
+ *
+ * \param[in] interval  The number of milliseconds between two flushes.
+ */
+void dbfile::set_flush_interval(std::uint64_t interval)
+{
+    f_flush_interval = interval;
+}
+
+
+std::uint64_t dbfile::get_flush_interval() const
+{
+    return f_flush_interval;
+}
+
+
+/** \brief Flush all the dirty pages.
+ *
+ * This function coalesces adjacent dirty pages in ranges and asks the
+ * kernel to start writing them with one sync_file_range() call per
+ * range.
+ *
+ * When \p durable is true, the function then waits until all the data
+ * of the file, including the metadata necessary to read it back (i.e.
+ * its size), is on disk. This is the barrier used at the end of a commit.
+ *
+ * In both cases, the checksums of the dirty pages still in the page cache
+ * get refreshed and saved first (the other pages got their checksum
+ * refreshed when they left the cache). The pages are pinned while their
+ * checksum gets computed so the background flusher can safely run this
+ * function while other threads use the dbfile.
+ *
+ * \exception io_error
+ * The function raises this exception if the file can't be synchronized.
+ *
+ * \param[in] durable  Whether to wait for the data to be on disk.
+ */
+void dbfile::flush_all(bool durable)
+{
+    if(f_fd == -1)
+    {
+        return;
+    }
+
+    std::set<reference_t> dirty;
+    {
+        cppthread::guard lock(f_dirty_mutex);
+        dirty.swap(f_dirty_pages);
+    }
+
+    size_t const sz(get_page_size());
+    if(f_checksum_fd != -1)
+    {
+        for(auto const & page_start : dirty)
+        {
+            page_ref const page(f_pages.pin(page_start));
+            if(page)
+            {
+                write_checksum(page_start, page.data());
+            }
+        }
+        save_checksums();
+    }
+
+    for(auto it(dirty.begin()); it != dirty.end(); )
+    {
+        reference_t const start(*it);
+        reference_t end(start + sz);
+        for(++it; it != dirty.end() && *it == end; ++it)
+        {
+            end += sz;
+        }
+        sync_file_range(f_fd, start, end - start, SYNC_FILE_RANGE_WRITE);
+    }
+
+    if(durable)
+    {
+        if(fdatasync(f_fd) != 0)
+        {
+            int const e(errno);
+            throw io_error(
+                  "fdatasync() failed on \""
+                + f_filename
+                + "\" ("
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+        }
+        if(f_checksum_fd != -1
+        && fdatasync(f_checksum_fd) != 0)
+        {
+            int const e(errno);
+            throw io_error(
+                  "fdatasync() failed on the checksums of \""
+                + f_filename
+                + "\" ("
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+        }
+    }
+}
+
+
+/** \brief Select the storage backend used for explicit block I/O.
+ *
+ * The pages of the file are accessed through mmap() by the blocks. For
+ * scans and multi-gets, it is possible to read many blocks at once
+ * using a storage backend instead. This function selects which backend
+ * get_backend() creates. By default, the io_uring backend is used when
+ * the kernel supports it.
+ *
+ * \exception logic_error
+ * The backend was already created.
+ *
+ * \param[in] backend  The type of backend to use.
+ * \param[in] buffer_count  The number of buffers in the buffer pool.
+ */
+void dbfile::set_backend(backend_t backend, std::size_t buffer_count)
+{
+    if(f_backend != nullptr)
+    {
+        throw logic_error("The storage backend of a dbfile can't be changed once created.");
+    }
+
+    f_backend_type = backend;
+    f_backend_buffer_count = buffer_count;
+}
+
+
+/** \brief Get the storage backend.
+ *
+ * This function creates the storage backend on the first call. If the
+ * io_uring backend was selected but the kernel does not support it, the
+ * synchronous backend is used instead.
+ *
+ * The backend reads and writes blocks directly in the file. The data is
+ * coherent with the mapped pages since both go through the kernel page
+ * cache. However, a write through the backend of a page that is also
+ * being modified through its mapping is undefined.
+ *
+ * \return The storage backend of this file.
+ */
+storage_backend::pointer_t dbfile::get_backend()
+{
+    if(f_backend == nullptr)
+    {
+        int const fd(open_file());
+        size_t const page_size(get_page_size());
+        if(f_backend_type == backend_t::BACKEND_IO_URING
+        && io_uring_backend::is_available())
+        {
+            f_backend = std::make_shared<io_uring_backend>(fd, page_size, f_backend_buffer_count);
+        }
+        else
+        {
+            if(f_backend_type == backend_t::BACKEND_IO_URING)
+            {
+                SNAP_LOG_NOTICE
+                    << "io_uring is not available, \""
+                    << f_fullname
+                    << "\" uses the synchronous storage backend."
+                    << SNAP_LOG_SEND;
+            }
+            f_backend = std::make_shared<sync_backend>(fd, page_size, f_backend_buffer_count);
+        }
+
+        // the blocks written by the backend do not go through the page
+        // cache so their checksum must be refreshed here
+        //
+        f_backend->set_write_hook([this](reference_t offset, const_data_t data)
+            {
+                write_checksum(offset, data);
+            });
+    }
+
+    return f_backend;
+}
+
+
+size_t dbfile::get_size() const
+{
+    if(f_fd == -1)
+    {
+        throw file_not_opened(
+                  "file is not yet opened, get_size() can't be called.");
+    }
+
+    struct stat s;
+    if(::fstat(f_fd, &s) == -1)
+    {
+        throw io_error(
+                  "stat() failed on \""
+                + f_filename
+                + "\".");
+    }
+
+    return s.st_size;
+}
+
+
+/** \brief Append a free block to the file.
+ *
+ * This function takes the next page from the list of preallocated pages
+ * and initializes it as a FREE block pointing to \p next_block_offset.
+ * When the list is empty, the file first grows by a whole chunk (see
+ * set_preallocation_size()) and the new pages are added to the list.
+ *
+ * Since the page is initialized through its mapping, allocating a block
+ * while preallocated pages are available does not require any system
+ * call.
+ *
+ * \exception file_not_opened
+ * The file must be opened before this function gets called.
+ *
+ * \param[in] next_block_offset  The offset of the next free block.
+ *
+ * \return The offset of the new free block.
+ */
+reference_t dbfile::append_free_block(reference_t const next_block_offset)
+{
+    if(f_fd == -1)
+    {
+        throw file_not_opened(
+                  "file is not yet opened, append_free_block() can't be called.");
+    }
+
+    if(f_free_pages.empty())
+    {
+        preallocate();
+    }
+
+    reference_t const p(f_free_pages.back());
+    f_free_pages.pop_back();
+
+    size_t const page_size(get_page_size());
+    f_high_water_mark = p + page_size;
+
+    page_ref const page(get_page(p));
+    data_t const d(page.data());
+    dbtype_t const magic(dbtype_t::BLOCK_TYPE_FREE_BLOCK);
+    memcpy(d, &magic, sizeof(magic));
+    version_t const version(0, 1);
+    std::uint32_t const v(version.to_binary());
+    memcpy(d + sizeof(magic), &v, sizeof(v));
+    memcpy(d + sizeof(magic) + sizeof(v), &next_block_offset, sizeof(next_block_offset));
+    memset(d + sizeof(magic) + sizeof(v) + sizeof(next_block_offset)
+         , 0
+         , page_size - sizeof(magic) - sizeof(v) - sizeof(next_block_offset));
+
+    return p;
+}
+
+
+/** \brief Define the number of bytes preallocated at once.
+ *
+ * When the file needs to grow, it grows by this many bytes at once
+ * using fallocate(). This reduces the number of system calls and the
+ * fragmentation of the file on disk. The size gets rounded up to a
+ * multiple of the page size.
+ *
+ * The default is DEFAULT_PREALLOCATION_SIZE.
+ *
+ * \param[in] size  The number of bytes to preallocate at once.
+ */
+void dbfile::set_preallocation_size(size_t size)
+{
+    size_t const page_size(get_page_size());
+    f_preallocation_size = std::max((size + page_size - 1) / page_size * page_size, page_size);
+}
+
+
+size_t dbfile::get_preallocation_size() const
+{
+    return f_preallocation_size;
+}
+
+
+/** \brief Set the high-water mark.
+ *
+ * The high-water mark is the end of the last page in use. Pages between
+ * that mark and the end of the file were preallocated and are still
+ * available. The table saves the mark in its header and restores it
+ * with this function when reopening the file.
+ *
+ * A mark of NULL_FILE_ADDR means that it is not known. In that case, the
+ * end of the file is used.
+ *
+ * \param[in] high_water_mark  The end of the last page in use.
+ */
+void dbfile::set_high_water_mark(reference_t high_water_mark)
+{
+    f_high_water_mark = high_water_mark;
+}
+
+
+reference_t dbfile::get_high_water_mark() const
+{
+    return f_high_water_mark;
+}
+
+
+/** \brief Grow the file by one chunk.
+ *
+ * If pages between the high-water mark and the end of the file exist,
+ * they get reused first. Otherwise, the file is extended with fallocate()
+ * by get_preallocation_size() bytes. Sparse files are extended with
+ * ftruncate() instead so the space does not get reserved on disk.
+ *
+ * The new pages are added to the list of free pages in such a way that
+ * the lowest offset gets used first.
+ *
+ * \exception io_error
+ * The file could not be grown (i.e. the disk is full). The file remains
+ * open and no pages get added to the list of free pages so the caller
+ * can try again later.
+ */
+void dbfile::preallocate()
+{
+    size_t const page_size(get_page_size());
+    size_t const file_size((get_size() + page_size - 1) / page_size * page_size);
+
+    reference_t start(file_size);
+    reference_t end(file_size);
+    if(f_high_water_mark != NULL_FILE_ADDR
+    && f_high_water_mark < file_size)
+    {
+        // reuse pages preallocated in a previous session
+        //
+        start = f_high_water_mark;
+    }
+    else
+    {
+        end = start + std::max(f_preallocation_size, page_size);
+        int r(-1);
+        if(!f_sparse_file)
+        {
+            r = fallocate(f_fd, 0, start, end - start);
+            if(r != 0
+            && errno == EOPNOTSUPP)
+            {
+                // the file system does not support fallocate(), try the
+                // POSIX version which writes zeroes as required
+                //
+                errno = posix_fallocate(f_fd, start, end - start);
+                r = errno == 0 ? 0 : -1;
+            }
+        }
+        else
+        {
+            // this is what makes the file sparse
+            //
+            // (note that really happens only when
+            // `get_page_size() > get_system_page_size()`)
+            //
+            r = ftruncate(f_fd, end);
+        }
+        if(r != 0)
+        {
+            int const e(errno);
+            throw io_error(
+                  "System could not grow the file \""
+                + f_filename
+                + "\" by "
+                + std::to_string(end - start)
+                + " bytes ("
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+        }
+    }
+
+    for(reference_t p(end); p > start; )
+    {
+        p -= page_size;
+        f_free_pages.push_back(p);
+    }
+}
+
+
+/** \brief Retrieve a pointer to a page from the mapped extents.
+ *
+ * The file is mapped in windows of f_extent_size bytes. Each window is
+ * mapped only up to the current end of the file since accessing a page
+ * beyond the end of the file would generate a SIGBUS. When the file
+ * grows, the extent covering the end of the file gets extended in place
+ * with mremap(). We never let mremap() move an extent since pointers to
+ * its pages are held by the blocks. If the extent can't grow in place,
+ * the remainder of the window gets mapped as a new extent.
+ *
+ * \exception page_not_found
+ * The \p page_start offset is beyond the end of the file.
+ *
+ * \exception io_error
+ * The mmap() or mremap() system call failed.
+ *
+ * \param[in] page_start  The offset of the page to retrieve.
+ *
+ * \return A pointer to the page at \p page_start.
+ */
+data_t dbfile::map_extent(reference_t page_start)
+{
+    auto it(f_extents.upper_bound(page_start));
+    if(it != f_extents.begin())
+    {
+        --it;
+        if(page_start < it->first + it->second.f_size)
+        {
+            return it->second.f_data + (page_start - it->first);
+        }
+    }
+    else
+    {
+        it = f_extents.end();
+    }
+
+    size_t const file_size(get_size());
+    if(page_start >= file_size)
+    {
+        throw page_not_found(
+                  "page at offset "
+                + std::to_string(page_start)
+                + " is beyond the end of file \""
+                + f_filename
+                + "\".");
+    }
+
+    size_t const page_size(get_page_size());
+    reference_t const window_start(page_start - page_start % f_extent_size);
+    reference_t const end(std::min(
+              window_start + f_extent_size
+            , (file_size + page_size - 1) / page_size * page_size));
+
+    reference_t start(window_start);
+    if(it != f_extents.end()
+    && it->first >= window_start)
+    {
+        // the extent before this page is in the same window, try to grow it
+        //
+        size_t const new_size(end - it->first);
+        void * const ptr(mremap(it->second.f_data, it->second.f_size, new_size, 0));
+        if(ptr != MAP_FAILED)
+        {
+            it->second.f_size = new_size;
+            return it->second.f_data + (page_start - it->first);
+        }
+        if(errno != ENOMEM)
+        {
+            int const e(errno);
+            throw io_error(
+                      "mremap() failed on \""
+                    + f_filename
+                    + "\" at offset "
+                    + std::to_string(it->first)
+                    + " (errno: "
+                    + std::to_string(e)
+                    + ", "
+                    + strerror(e)
+                    + ").");
+        }
+
+        // the next virtual addresses are in use, map a new extent
+        //
+        start = it->first + it->second.f_size;
+    }
+
+    void * const ptr(mmap(
+          nullptr
+        , end - start
+        , PROT_READ | PROT_WRITE
+        , MAP_SHARED
+        , f_fd
+        , start));
+    if(ptr == MAP_FAILED)
+    {
+        int const e(errno);
+        throw io_error(
+                  "mmap() failed on \""
+                + f_filename
+                + "\" at offset "
+                + std::to_string(start)
+                + " (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+    }
+
+    extent_t & extent(f_extents[start]);
+    extent.f_start = start;
+    extent.f_size = end - start;
+    extent.f_data = reinterpret_cast<data_t>(ptr);
+
+    return extent.f_data + (page_start - start);
+}
+
+
+/** \brief Unmap all the extents.
+ *
+ * This function is called when the file gets closed. It unmaps all the
+ * extents at once.
+ */
+void dbfile::unmap_extents()
+{
+    for(auto const & e : f_extents)
+    {
+        munmap(e.second.f_data, e.second.f_size);
+    }
+    f_extents.clear();
+}
+
+
+/** \brief Release a page evicted from the page cache.
+ *
+ * The page remains part of its extent. We only tell the kernel that we
+ * do not need it anymore so it can drop it from our resident memory.
+ * Since the extents are shared mappings, the data remains in the kernel
+ * page cache and gets written to disk as usual.
+ *
+ * Before that, the checksum of the page gets computed so it can be
+ * verified the next time the page enters the cache.
+ *
+ * \param[in] offset  The offset of the page in the file.
+ * \param[in] data  The pointer to the page.
+ */
+void dbfile::release_page(reference_t offset, data_t data)
+{
+    write_checksum(offset, data);
+
+    madvise(data, get_page_size(), MADV_DONTNEED);
+}
+
+
+/** \brief Open the checksum file and load the checksums.
+ *
+ * The checksums are small (4 bytes per page) so they all get loaded
+ * in memory. Only the chunks that change get written back.
+ *
+ * When \p create is true, the database file was just created so any
+ * existing checksum file is stale and gets truncated.
+ *
+ * \exception io_error
+ * The checksum file can't be opened or read.
+ *
+ * \param[in] create  Whether the database file was just created.
+ */
+void dbfile::open_checksums(bool create)
+{
+    if(!f_checksums_enabled)
+    {
+        return;
+    }
+
+    std::string const filename(f_dirname + "/" + f_filename + g_checksum_extension);
+    f_checksum_fd = open(
+              filename.c_str()
+            , O_RDWR | O_CLOEXEC | O_NOATIME | O_NOFOLLOW | O_CREAT | (create ? O_TRUNC : 0)
+            , S_IRUSR | S_IWUSR);
+    if(f_checksum_fd == -1)
+    {
+        int const e(errno);
+        throw io_error(
+              "System could not open checksum file \""
+            + filename
+            + "\" (errno: "
+            + std::to_string(e)
+            + ", "
+            + strerror(e)
+            + ").");
+    }
+
+    struct stat s;
+    if(::fstat(f_checksum_fd, &s) == -1)
+    {
+        throw io_error(
+                  "stat() failed on \""
+                + filename
+                + "\".");
+    }
+
+    f_checksums.resize(s.st_size / sizeof(crc32c_t));
+    std::size_t const size(f_checksums.size() * sizeof(crc32c_t));
+    if(size > 0
+    && pread(f_checksum_fd, f_checksums.data(), size, 0) != static_cast<ssize_t>(size))
+    {
+        throw io_error(
+                  "could not read the checksums from \""
+                + filename
+                + "\".");
+    }
+}
+
+
+/** \brief Compute and save in memory the checksum of a page.
+ *
+ * The checksum gets written to disk by save_checksums().
+ *
+ * \param[in] page_start  The offset of the page.
+ * \param[in] data  The pointer to the page.
+ */
+void dbfile::write_checksum(reference_t page_start, const_data_t data)
+{
+    if(f_checksum_fd == -1)
+    {
+        return;
+    }
+
+    size_t const page_size(get_page_size());
+    std::size_t const idx(page_start / page_size);
+    crc32c_t const crc(page_checksum(data, page_size));
+
+    cppthread::guard lock(f_checksum_mutex);
+    if(idx >= f_checksums.size())
+    {
+        f_checksums.resize(idx + 1);
+    }
+    if(f_checksums[idx] != crc)
+    {
+        f_checksums[idx] = crc;
+        f_dirty_checksums.insert(idx / CHECKSUMS_PER_CHUNK);
+    }
+}
+
+
+/** \brief Verify the checksum of a page.
+ *
+ * This function is called when a page enters the page cache. If the
+ * checksum of the page is known, it gets compared against the data.
+ *
+ * \exception corrupted_data
+ * The checksum does not match.
+ *
+ * \param[in] page_start  The offset of the page.
+ * \param[in] data  The pointer to the page.
+ */
+void dbfile::verify_checksum(reference_t page_start, const_data_t data) const
+{
+    if(f_checksum_fd == -1)
+    {
+        return;
+    }
+
+    size_t const page_size(get_page_size());
+    std::size_t const idx(page_start / page_size);
+    crc32c_t expected(0);
+    {
+        cppthread::guard lock(f_checksum_mutex);
+        if(idx < f_checksums.size())
+        {
+            expected = f_checksums[idx];
+        }
+    }
+    if(expected == 0)
+    {
+        return;
+    }
+
+    crc32c_t const crc(page_checksum(data, page_size));
+    if(crc != expected)
+    {
+        throw corrupted_data(
+                  "page at offset "
+                + std::to_string(page_start)
+                + " of \""
+                + f_filename
+                + "\" has an invalid checksum (expected "
+                + std::to_string(expected)
+                + ", found "
+                + std::to_string(crc)
+                + ").");
+    }
+}
+
+
+/** \brief Write the modified checksums to disk.
+ *
+ * \exception io_error
+ * The checksums could not be written.
+ */
+void dbfile::save_checksums()
+{
+    cppthread::guard lock(f_checksum_mutex);
+
+    for(auto const & chunk : f_dirty_checksums)
+    {
+        std::size_t const start(chunk * CHECKSUMS_PER_CHUNK);
+        std::size_t const count(std::min(CHECKSUMS_PER_CHUNK, f_checksums.size() - start));
+        std::size_t const size(count * sizeof(crc32c_t));
+        if(pwrite(f_checksum_fd, f_checksums.data() + start, size, start * sizeof(crc32c_t)) != static_cast<ssize_t>(size))
+        {
+            int const e(errno);
+            throw io_error(
+                  "could not write the checksums of \""
+                + f_filename
+                + "\" (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+        }
+    }
+    f_dirty_checksums.clear();
+}
+
+
+char const * to_name(dbtype_t type)
+{
+    switch(type)
+    {
+    case dbtype_t::DBTYPE_UNKNOWN:
+        return "Unknown";
+
+    case dbtype_t::FILE_TYPE_CONTEXT:
+        return "Prinbee Context (CTXT)";
+
+    case dbtype_t::FILE_TYPE_TABLE:
+        return "Prinbee Table (PTBL)";
 
     case dbtype_t::FILE_TYPE_INDEX_DESCRIPTION:
         return "Index Definition (IDXD)";
@@ -550,6 +1577,9 @@ char const * to_name(dbtype_t type)
     case dbtype_t::BLOCK_TYPE_SCHEMA_LIST:
         return "Schema List (SCHL)";
 
+    case dbtype_t::BLOCK_TYPE_SLOT_DATA:
+        return "Slot Data (SLOT)";
+
     case dbtype_t::BLOCK_TYPE_TOP_INDEX:
         return "Top Index (TIDX)";
 
@@ -27,7 +27,16 @@
 
 // self
 //
+#include    "prinbee/data/crc32c.h"
 #include    "prinbee/data/dbtype.h"
+#include    "prinbee/data/page_cache.h"
+#include    "prinbee/data/storage_backend.h"
+
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+#include    <cppthread/thread.h>
 
 
 // snapdev
@@ -35,9 +44,13 @@
 #include    <snapdev/lockfile.h>
 
 
-// boost
+// C++
 //
-#include    <boost/bimap.hpp>
+#include    <map>
+#include    <memory>
+#include    <set>
+#include    <string>
+#include    <vector>
 
 
 
@@ -53,11 +66,19 @@ typedef std::uint8_t *              data_t;
 typedef std::uint8_t const *        const_data_t;
 
 constexpr reference_t               NULL_FILE_ADDR = static_cast<reference_t>(0);
+constexpr std::size_t               DEFAULT_EXTENT_SIZE = 64ULL * 1024ULL * 1024ULL;
+constexpr std::size_t               DEFAULT_PREALLOCATION_SIZE = 1024ULL * 1024ULL;
+constexpr std::uint64_t             DEFAULT_FLUSH_INTERVAL = 1000;      // in milliseconds
 constexpr oid_t                     NULL_OID = static_cast<oid_t>(0);
 
 class table;
 typedef std::shared_ptr<table>      table_pointer_t;
 
+namespace detail
+{
+class dbfile_flusher;
+}
+
 
 static_assert(sizeof(reference_t) == sizeof(oid_t), "the OID and references must fit in each other's variables");
 
@@ -67,8 +88,14 @@ class dbfile
 {
 public:
     typedef std::shared_ptr<dbfile>             pointer_t;
-    //typedef std::map<reference_t, data_t>       page_map_t;
-    typedef boost::bimap<reference_t, data_t>   page_bimap_t;
+
+    struct extent_t
+    {
+        reference_t         f_start = NULL_FILE_ADDR;
+        size_t              f_size = 0;
+        data_t              f_data = nullptr;
+    };
+    typedef std::map<reference_t, extent_t>     extent_map_t;
 
                             dbfile(std::string const & path, std::string const & table_name, std::string const & filename);
                             dbfile(dbfile const & rhs) = delete;
@@ -87,15 +114,44 @@ public:
     bool                    get_sparse() const;
     void                    set_type(dbtype_t type);
     dbtype_t                get_type() const;
-    data_t                  data(reference_t offset);
-    void                    release_data(data_t data);
-    void                    sync(data_t data, bool immediate);
+    void                    set_extent_size(size_t size);
+    size_t                  get_extent_size() const;
+    void                    set_cache_budget(size_t budget);
+    size_t                  get_cache_budget() const;
+    bool                    is_cache_over_budget() const;
+    page_cache_statistics_t get_cache_statistics() const;
+    page_ref                get_page(reference_t offset);
+    void                    prefetch(reference_vector_t const & offsets);
+    void                    sync(page_ref const & page, bool immediate);
+    void                    mark_dirty(reference_t offset);
+    size_t                  get_dirty_count() const;
+    void                    set_checksums(bool checksums);
+    bool                    get_checksums() const;
+    void                    set_flush_interval(std::uint64_t interval);
+    std::uint64_t           get_flush_interval() const;
+    void                    flush_all(bool durable);
+    void                    set_backend(backend_t backend, std::size_t buffer_count = DEFAULT_BUFFER_POOL_SIZE);
+    storage_backend::pointer_t
+                            get_backend();
     size_t                  get_size() const;
-    reference_t             append_free_block(reference_t const previous_block_offset);
+    reference_t             append_free_block(reference_t const next_block_offset);
+    void                    set_preallocation_size(size_t size);
+    size_t                  get_preallocation_size() const;
+    void                    set_high_water_mark(reference_t high_water_mark);
+    reference_t             get_high_water_mark() const;
 
 private:
     int                     open_file();
-    void                    write_data(void const * ptr, size_t size);
+    data_t                  map_extent(reference_t page_start);
+    void                    unmap_extents();
+    void                    release_page(reference_t offset, data_t data);
+    void                    open_checksums(bool create);
+    void                    write_checksum(reference_t page_start, const_data_t data);
+    void                    verify_checksum(reference_t page_start, const_data_t data) const;
+    void                    save_checksums();
+    void                    preallocate();
+    void                    start_flusher();
+    void                    stop_flusher();
 
     table_pointer_t         f_table = table_pointer_t();
     std::string             f_path = std::string();
@@ -108,7 +164,32 @@ private:
     dbtype_t                f_type = dbtype_t::DBTYPE_UNKNOWN;
     pid_t                   f_pid = -1;
     int                     f_fd = -1;
-    page_bimap_t            f_pages = page_bimap_t();
+    size_t                  f_extent_size = DEFAULT_EXTENT_SIZE;
+    extent_map_t            f_extents = extent_map_t();
+    size_t                  f_preallocation_size = DEFAULT_PREALLOCATION_SIZE;
+    reference_vector_t      f_free_pages = reference_vector_t();
+    reference_t             f_high_water_mark = NULL_FILE_ADDR;
+    mutable cppthread::mutex
+                            f_mutex = cppthread::mutex();
+    mutable cppthread::mutex
+                            f_dirty_mutex = cppthread::mutex();
+    std::set<reference_t>   f_dirty_pages = std::set<reference_t>();
+    std::uint64_t           f_flush_interval = DEFAULT_FLUSH_INTERVAL;
+    std::shared_ptr<detail::dbfile_flusher>
+                            f_flusher = std::shared_ptr<detail::dbfile_flusher>();
+    cppthread::thread::pointer_t
+                            f_flusher_thread = cppthread::thread::pointer_t();
+    bool                    f_checksums_enabled = true;
+    int                     f_checksum_fd = -1;
+    mutable cppthread::mutex
+                            f_checksum_mutex = cppthread::mutex();
+    std::vector<crc32c_t>   f_checksums = std::vector<crc32c_t>();
+    std::set<std::size_t>   f_dirty_checksums = std::set<std::size_t>();
+    backend_t               f_backend_type = backend_t::BACKEND_IO_URING;
+    std::size_t             f_backend_buffer_count = DEFAULT_BUFFER_POOL_SIZE;
+    storage_backend::pointer_t
+                            f_backend = storage_backend::pointer_t();
+    page_cache              f_pages;
     bool                    f_sparse_file = false;
 };
 
@@ -69,6 +69,7 @@ enum class dbtype_t : std::uint32_t
     BLOCK_TYPE_INDIRECT_INDEX       = DBTYPE_NAME("INDR"),
     BLOCK_TYPE_SECONDARY_INDEX      = DBTYPE_NAME("SIDX"),
     BLOCK_TYPE_SCHEMA_LIST          = DBTYPE_NAME("SCHL"),
+    BLOCK_TYPE_SLOT_DATA            = DBTYPE_NAME("SLOT"),
     BLOCK_TYPE_TOP_INDEX            = DBTYPE_NAME("TIDX"),
     BLOCK_TYPE_TOP_INDIRECT_INDEX   = DBTYPE_NAME("TIND"),
 };
@@ -135,6 +136,9 @@ constexpr char const * to_string(dbtype_t type)
     case dbtype_t::BLOCK_TYPE_SCHEMA_LIST:
         return "SCHL";
 
+    case dbtype_t::BLOCK_TYPE_SLOT_DATA:
+        return "SLOT";
+
     case dbtype_t::BLOCK_TYPE_TOP_INDEX:
         return "TIDX";
 
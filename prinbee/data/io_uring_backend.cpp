@@ -0,0 +1,529 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief io_uring storage backend implementation.
+ *
+ * The implementation uses the io_uring system calls directly. The
+ * submission and completion rings are mapped in memory, new requests
+ * are added at the tail of the submission ring and the results are
+ * read from the head of the completion ring.
+ *
+ * The SQPOLL mode is not used so the kernel only looks at the new
+ * entries when io_uring_enter() gets called by submit() or wait().
+ */
+
+// self
+//
+#include    "prinbee/data/io_uring_backend.h"
+
+#include    "prinbee/exception.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// C
+//
+#include    <linux/io_uring.h>
+#include    <string.h>
+#include    <sys/mman.h>
+#include    <sys/syscall.h>
+#include    <sys/uio.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+namespace
+{
+
+
+
+int sys_io_uring_setup(std::uint32_t entries, io_uring_params * params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+
+int sys_io_uring_enter(int fd, std::uint32_t to_submit, std::uint32_t min_complete, std::uint32_t flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+
+int sys_io_uring_register(int fd, std::uint32_t opcode, void * arg, std::uint32_t nr_args)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+
+std::uint32_t load_acquire(std::uint32_t const * ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+}
+
+
+void store_release(std::uint32_t * ptr, std::uint32_t value)
+{
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+
+
+void * map_ring(int fd, std::size_t size, off_t offset)
+{
+    void * const ptr(mmap(
+              nullptr
+            , size
+            , PROT_READ | PROT_WRITE
+            , MAP_SHARED | MAP_POPULATE
+            , fd
+            , offset));
+    if(ptr == MAP_FAILED)
+    {
+        int const e(errno);
+        throw io_error(
+                  "could not map the io_uring ring (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+    }
+    return ptr;
+}
+
+
+
+}
+// no name namespace
+
+
+
+/** \brief Create an io_uring backend.
+ *
+ * This function creates the io_uring instance, maps its rings, and
+ * registers the buffer pool with the kernel. If the buffers can't be
+ * registered (i.e. the RLIMIT_MEMLOCK limit is too low), the backend
+ * still works but uses regular reads and writes instead of fixed ones.
+ *
+ * \exception io_error
+ * The io_uring instance could not be created. Use is_available() to
+ * know whether the running kernel supports io_uring.
+ *
+ * \param[in] fd  The file descriptor of the file to read and write.
+ * \param[in] block_size  The size of one block (the page size).
+ * \param[in] buffer_count  The number of buffers in the buffer pool.
+ * \param[in] queue_depth  The number of entries in the submission queue.
+ */
+io_uring_backend::io_uring_backend(
+          int fd
+        , std::size_t block_size
+        , std::size_t buffer_count
+        , std::uint32_t queue_depth)
+    : storage_backend(fd, block_size, buffer_count)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    f_ring_fd = sys_io_uring_setup(queue_depth, &params);
+    if(f_ring_fd < 0)
+    {
+        int const e(errno);
+        throw io_error(
+                  "io_uring_setup() failed (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+    }
+    f_queue_depth = params.sq_entries;
+
+    f_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+    f_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+    {
+        f_sq_ring_size = std::max(f_sq_ring_size, f_cq_ring_size);
+        f_cq_ring_size = 0;
+    }
+
+    try
+    {
+        f_sq_ring = map_ring(f_ring_fd, f_sq_ring_size, IORING_OFF_SQ_RING);
+        if(f_cq_ring_size == 0)
+        {
+            f_cq_ring = f_sq_ring;
+        }
+        else
+        {
+            f_cq_ring = map_ring(f_ring_fd, f_cq_ring_size, IORING_OFF_CQ_RING);
+        }
+        f_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        f_sqes = reinterpret_cast<io_uring_sqe *>(map_ring(f_ring_fd, f_sqes_size, IORING_OFF_SQES));
+    }
+    catch(...)
+    {
+        if(f_sq_ring != nullptr)
+        {
+            munmap(f_sq_ring, f_sq_ring_size);
+        }
+        if(f_cq_ring != nullptr
+        && f_cq_ring_size != 0)
+        {
+            munmap(f_cq_ring, f_cq_ring_size);
+        }
+        ::close(f_ring_fd);
+        throw;
+    }
+
+    std::uint8_t * const sq(reinterpret_cast<std::uint8_t *>(f_sq_ring));
+    f_sq_head = reinterpret_cast<std::uint32_t *>(sq + params.sq_off.head);
+    f_sq_tail = reinterpret_cast<std::uint32_t *>(sq + params.sq_off.tail);
+    f_sq_mask = reinterpret_cast<std::uint32_t *>(sq + params.sq_off.ring_mask);
+    f_sq_array = reinterpret_cast<std::uint32_t *>(sq + params.sq_off.array);
+
+    std::uint8_t * const cq(reinterpret_cast<std::uint8_t *>(f_cq_ring));
+    f_cq_head = reinterpret_cast<std::uint32_t *>(cq + params.cq_off.head);
+    f_cq_tail = reinterpret_cast<std::uint32_t *>(cq + params.cq_off.tail);
+    f_cq_mask = reinterpret_cast<std::uint32_t *>(cq + params.cq_off.ring_mask);
+    f_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    iovec iov;
+    iov.iov_base = f_buffer_pool->get_memory();
+    iov.iov_len = f_buffer_pool->get_memory_size();
+    f_registered = sys_io_uring_register(f_ring_fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+}
+
+
+io_uring_backend::~io_uring_backend()
+{
+    // the kernel may still be writing to our buffers, wait for all the
+    // requests before releasing anything
+    //
+    try
+    {
+        wait_all();
+    }
+    catch(std::exception const &)
+    {
+    }
+
+    munmap(f_sqes, f_sqes_size);
+    if(f_cq_ring != f_sq_ring)
+    {
+        munmap(f_cq_ring, f_cq_ring_size);
+    }
+    munmap(f_sq_ring, f_sq_ring_size);
+    ::close(f_ring_fd);
+}
+
+
+/** \brief Check whether io_uring can be used.
+ *
+ * The kernel may not support io_uring or it may have been disabled
+ * (i.e. with the kernel.io_uring_disabled sysctl or a seccomp filter).
+ * This function creates a small ring once to verify.
+ *
+ * \return true if io_uring is available.
+ */
+bool io_uring_backend::is_available()
+{
+    static int available(-1);
+
+    if(available == -1)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int const fd(sys_io_uring_setup(1, &params));
+        available = fd >= 0 ? 1 : 0;
+        if(fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+
+    return available == 1;
+}
+
+
+backend_t io_uring_backend::get_type() const
+{
+    return backend_t::BACKEND_IO_URING;
+}
+
+
+/** \brief Queue a block read.
+ *
+ * The block at \p offset is read in a buffer of the buffer pool. Once
+ * the read completes, wait() calls \p callback with the number of bytes
+ * read or -errno and the buffer. The buffer has to be released with
+ * release_buffer() once the caller is done with it.
+ *
+ * \exception full
+ * The buffer pool or the submission queue is full.
+ *
+ * \param[in] offset  The offset of the block to read.
+ * \param[in] callback  The function called once the read completed.
+ */
+void io_uring_backend::read_block(reference_t offset, completion_t callback)
+{
+    cppthread::guard lock(f_mutex);
+
+    data_t const buffer(f_buffer_pool->acquire());
+    io_uring_sqe * sqe(nullptr);
+    try
+    {
+        sqe = get_sqe();
+    }
+    catch(...)
+    {
+        f_buffer_pool->release(buffer);
+        throw;
+    }
+
+    std::uint64_t const id(f_next_id++);
+    sqe->opcode = f_registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = f_fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(buffer);
+    sqe->len = static_cast<std::uint32_t>(f_block_size);
+    sqe->buf_index = 0;
+    sqe->user_data = id;
+
+    request_t & r(f_requests[id]);
+    r.f_buffer = buffer;
+    r.f_callback = callback;
+}
+
+
+/** \brief Queue a block write.
+ *
+ * The \p data buffer must remain valid until the callback gets called.
+ * Writing from a buffer of the buffer pool is faster since the pool is
+ * registered with the kernel.
+ *
+ * \exception full
+ * The submission queue is full.
+ *
+ * \param[in] offset  The offset of the block to write.
+ * \param[in] data  The block_size bytes to write.
+ * \param[in] callback  The function called once the write completed.
+ */
+void io_uring_backend::write_block(reference_t offset, const_data_t data, completion_t callback)
+{
+    cppthread::guard lock(f_mutex);
+
+    io_uring_sqe * sqe(get_sqe());
+
+    call_write_hook(offset, data);
+
+    std::uint64_t const id(f_next_id++);
+    sqe->opcode = f_registered && f_buffer_pool->is_buffer(data)
+                        ? IORING_OP_WRITE_FIXED
+                        : IORING_OP_WRITE;
+    sqe->fd = f_fd;
+    sqe->off = offset;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(data);
+    sqe->len = static_cast<std::uint32_t>(f_block_size);
+    sqe->buf_index = 0;
+    sqe->user_data = id;
+
+    request_t & r(f_requests[id]);
+    r.f_callback = callback;
+}
+
+
+/** \brief Send the queued requests to the kernel.
+ *
+ * All the requests queued since the last call are sent with one single
+ * io_uring_enter() system call.
+ *
+ * \exception io_error
+ * The io_uring_enter() system call failed.
+ *
+ * \return The number of requests submitted.
+ */
+std::size_t io_uring_backend::submit()
+{
+    cppthread::guard lock(f_mutex);
+    return submit_locked();
+}
+
+
+/** \brief Wait for requests to complete.
+ *
+ * This function submits the queued requests and waits until at least
+ * \p min_complete requests completed. Then it calls the callbacks of
+ * all the completed requests. The callbacks are called without holding
+ * the backend lock so they can queue new requests.
+ *
+ * \exception io_error
+ * The io_uring_enter() system call failed.
+ *
+ * \param[in] min_complete  The minimum number of requests to wait for.
+ *
+ * \return The number of requests that completed.
+ */
+std::size_t io_uring_backend::wait(std::size_t min_complete)
+{
+    std::vector<std::pair<request_t, int>> completed;
+    {
+        cppthread::guard lock(f_mutex);
+
+        submit_locked();
+
+        min_complete = std::min(min_complete, f_requests.size());
+        reap(completed);
+        while(completed.size() < min_complete)
+        {
+            int const r(sys_io_uring_enter(
+                      f_ring_fd
+                    , 0
+                    , static_cast<std::uint32_t>(min_complete - completed.size())
+                    , IORING_ENTER_GETEVENTS));
+            if(r < 0
+            && errno != EINTR)
+            {
+                int const e(errno);
+                throw io_error(
+                          "io_uring_enter() failed while waiting (errno: "
+                        + std::to_string(e)
+                        + ", "
+                        + strerror(e)
+                        + ").");
+            }
+            reap(completed);
+        }
+    }
+
+    for(auto const & c : completed)
+    {
+        if(c.first.f_callback != nullptr)
+        {
+            c.first.f_callback(c.second, c.first.f_buffer);
+        }
+    }
+
+    return completed.size();
+}
+
+
+std::size_t io_uring_backend::get_pending() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_requests.size();
+}
+
+
+io_uring_sqe * io_uring_backend::get_sqe()
+{
+    // the completion queue is twice the size of the submission queue,
+    // never have more requests in flight than that
+    //
+    if(f_requests.size() >= f_queue_depth * 2)
+    {
+        throw full("too many io_uring requests in flight, call wait() first.");
+    }
+
+    std::uint32_t tail(*f_sq_tail);
+    if(tail - load_acquire(f_sq_head) >= f_queue_depth)
+    {
+        submit_locked();
+        if(tail - load_acquire(f_sq_head) >= f_queue_depth)
+        {
+            throw full("the io_uring submission queue is full.");
+        }
+    }
+
+    std::uint32_t const idx(tail & *f_sq_mask);
+    io_uring_sqe * sqe(f_sqes + idx);
+    memset(sqe, 0, sizeof(*sqe));
+    f_sq_array[idx] = idx;
+    store_release(f_sq_tail, tail + 1);
+    ++f_to_submit;
+
+    return sqe;
+}
+
+
+std::size_t io_uring_backend::submit_locked()
+{
+    std::size_t total(0);
+    while(f_to_submit > 0)
+    {
+        int const r(sys_io_uring_enter(f_ring_fd, f_to_submit, 0, 0));
+        if(r < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            int const e(errno);
+            throw io_error(
+                      "io_uring_enter() failed while submitting (errno: "
+                    + std::to_string(e)
+                    + ", "
+                    + strerror(e)
+                    + ").");
+        }
+        f_to_submit -= r;
+        total += r;
+    }
+    return total;
+}
+
+
+std::size_t io_uring_backend::reap(std::vector<std::pair<request_t, int>> & completed)
+{
+    std::size_t count(0);
+    std::uint32_t head(*f_cq_head);
+    std::uint32_t const tail(load_acquire(f_cq_tail));
+    for(; head != tail; ++head, ++count)
+    {
+        io_uring_cqe const * cqe(f_cqes + (head & *f_cq_mask));
+        auto it(f_requests.find(cqe->user_data));
+        if(it != f_requests.end())
+        {
+            completed.emplace_back(it->second, cqe->res);
+            f_requests.erase(it);
+        }
+    }
+    store_release(f_cq_head, head);
+
+    return count;
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
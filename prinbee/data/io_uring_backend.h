@@ -0,0 +1,120 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Storage backend using the Linux io_uring interface.
+ *
+ * This backend keeps many block reads and writes in flight at once. The
+ * requests are added to the submission queue and sent to the kernel in
+ * one system call by submit(). The buffer pool is registered with the
+ * kernel so reads and writes to pool buffers avoid the per-request page
+ * pinning done by the kernel.
+ */
+
+// self
+//
+#include    "prinbee/data/storage_backend.h"
+
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <map>
+
+
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+
+namespace prinbee
+{
+
+
+
+constexpr std::uint32_t             DEFAULT_IO_URING_QUEUE_DEPTH = 64;
+
+
+class io_uring_backend
+    : public storage_backend
+{
+public:
+                                io_uring_backend(
+                                      int fd
+                                    , std::size_t block_size
+                                    , std::size_t buffer_count
+                                    , std::uint32_t queue_depth = DEFAULT_IO_URING_QUEUE_DEPTH);
+    virtual                     ~io_uring_backend() override;
+
+    static bool                 is_available();
+
+    virtual backend_t           get_type() const override;
+    virtual void                read_block(reference_t offset, completion_t callback) override;
+    virtual void                write_block(reference_t offset, const_data_t data, completion_t callback) override;
+    virtual std::size_t         submit() override;
+    virtual std::size_t         wait(std::size_t min_complete = 1) override;
+    virtual std::size_t         get_pending() const override;
+
+private:
+    struct request_t
+    {
+        data_t                  f_buffer = nullptr;
+        completion_t            f_callback = completion_t();
+    };
+
+    io_uring_sqe *              get_sqe();
+    std::size_t                 submit_locked();
+    std::size_t                 reap(std::vector<std::pair<request_t, int>> & completed);
+
+    mutable cppthread::mutex    f_mutex = cppthread::mutex();
+    int                         f_ring_fd = -1;
+    std::uint32_t               f_queue_depth = 0;
+    bool                        f_registered = false;
+
+    void *                      f_sq_ring = nullptr;
+    std::size_t                 f_sq_ring_size = 0;
+    void *                      f_cq_ring = nullptr;
+    std::size_t                 f_cq_ring_size = 0;
+    io_uring_sqe *              f_sqes = nullptr;
+    std::size_t                 f_sqes_size = 0;
+
+    std::uint32_t *             f_sq_head = nullptr;
+    std::uint32_t *             f_sq_tail = nullptr;
+    std::uint32_t *             f_sq_mask = nullptr;
+    std::uint32_t *             f_sq_array = nullptr;
+    std::uint32_t *             f_cq_head = nullptr;
+    std::uint32_t *             f_cq_tail = nullptr;
+    std::uint32_t *             f_cq_mask = nullptr;
+    io_uring_cqe *              f_cqes = nullptr;
+
+    std::uint32_t               f_to_submit = 0;
+    std::uint64_t               f_next_id = 1;
+    std::map<std::uint64_t, request_t>
+                                f_requests = std::map<std::uint64_t, request_t>();
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
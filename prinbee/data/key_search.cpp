@@ -0,0 +1,650 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Search of fixed-width keys in a sorted array of entries.
+ *
+ * The search is a branchless lower bound: the range gets cut in half at
+ * each step and the new start of the range is selected with a
+ * conditional move instead of a branch. A key comparison is therefore
+ * never mispredicted. While the comparison is being computed, the two
+ * possible next probes get prefetched so the memory latency of the next
+ * step overlaps with the current one.
+ *
+ * The comparison itself is the one of memcmp() (i.e. the first byte
+ * which differs decides). With SSE2 and AVX2, the whole key gets loaded
+ * in one register and compared with the searched key at once. The
+ * instructions give us a mask of the bytes which differ and a mask of
+ * the bytes which are smaller. The lowest bit of the first mask gives
+ * us the first differing byte and the second mask whether that byte is
+ * smaller. This is equivalent to swapping the bytes of the keys and
+ * comparing them as large big endian integers.
+ *
+ * A register load may read a few bytes past the end of the key. This is
+ * not a problem except at the very end of the buffer, which is why the
+ * functions take an \p end pointer. The probes too close to the end use
+ * memcmp() instead.
+ *
+ * The Eytzinger search walks the implicit tree: entry `i` (1 based) has
+ * its children at `2i` and `2i + 1`. The four grandchildren are
+ * consecutive in the array so one prefetch of their cache lines hides
+ * the latency of the next two levels.
+ */
+
+// self
+//
+#include    "prinbee/data/key_search.h"
+
+#include    "prinbee/exception.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+#include    <vector>
+
+
+// C
+//
+#if defined(__x86_64__)
+#include    <immintrin.h>
+#endif
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+namespace
+{
+
+
+
+constexpr std::uint32_t const   SSE2_KEY_LENGTH = 16;
+constexpr std::uint32_t const   AVX2_KEY_LENGTH = 32;
+
+
+struct search_t
+{
+    std::uint8_t const *        f_keys = nullptr;
+    std::uint32_t               f_count = 0;
+    std::uint32_t               f_stride = 0;
+    std::uint8_t const *        f_end = nullptr;
+    std::uint8_t const *        f_key = nullptr;
+    std::uint32_t               f_length = 0;
+};
+
+
+bool less_scalar(search_t const & s, std::uint8_t const * p)
+{
+    return memcmp(p, s.f_key, s.f_length) < 0;
+}
+
+
+std::uint32_t lower_bound_scalar(search_t const & s)
+{
+    std::uint32_t base(0);
+    std::uint32_t n(s.f_count);
+    while(n > 1)
+    {
+        std::uint32_t const half(n / 2);
+        __builtin_prefetch(s.f_keys + (base + half / 2) * s.f_stride);
+        __builtin_prefetch(s.f_keys + (base + half + half / 2) * s.f_stride);
+        base += less_scalar(s, s.f_keys + (base + half) * s.f_stride) ? half : 0;
+        n -= half;
+    }
+    return base + (less_scalar(s, s.f_keys + base * s.f_stride) ? 1 : 0);
+}
+
+
+// prefetch the grandchildren of entry `i` (1 based)
+//
+// the function must be inlined, otherwise g++ sees a function without
+// side effects and removes the calls
+//
+inline __attribute__((always_inline))
+void prefetch_grandchildren(search_t const & s, std::uint32_t i)
+{
+    if(i * 4 <= s.f_count)
+    {
+        std::uint8_t const * p(s.f_keys + static_cast<std::size_t>(i * 4 - 1) * s.f_stride);
+        std::size_t const size(s.f_stride * 4);
+        for(std::size_t offset(0); offset < size; offset += 64)
+        {
+            __builtin_prefetch(p + offset);
+        }
+        __builtin_prefetch(p + size - 1);
+    }
+}
+
+
+std::uint32_t eytzinger_result(search_t const & s, std::uint32_t i)
+{
+    // remove the right turns and the last left turn to get the entry
+    // which was last found to be larger or equal
+    //
+    i >>= __builtin_ffs(~i);
+    return i == 0 ? s.f_count : i - 1;
+}
+
+
+std::uint32_t eytzinger_scalar(search_t const & s)
+{
+    std::uint32_t i(1);
+    while(i <= s.f_count)
+    {
+        prefetch_grandchildren(s, i);
+        i = i * 2 + (less_scalar(s, s.f_keys + static_cast<std::size_t>(i - 1) * s.f_stride) ? 1 : 0);
+    }
+    return eytzinger_result(s, i);
+}
+
+
+#if defined(__x86_64__)
+inline __attribute__((always_inline))
+bool less_sse2(search_t const & s, __m128i key, std::uint32_t mask, std::uint8_t const * p)
+{
+    if(p + SSE2_KEY_LENGTH > s.f_end)
+    {
+        return less_scalar(s, p);
+    }
+
+    __m128i const a(_mm_loadu_si128(reinterpret_cast<__m128i const *>(p)));
+    std::uint32_t const different(~_mm_movemask_epi8(_mm_cmpeq_epi8(a, key)) & mask);
+    std::uint32_t const smaller(~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(a, key), a)));
+    return ((different & -different) & smaller) != 0;
+}
+
+
+std::uint32_t lower_bound_sse2(search_t const & s)
+{
+    alignas(16) std::uint8_t padded[SSE2_KEY_LENGTH] = {};
+    memcpy(padded, s.f_key, s.f_length);
+    __m128i const key(_mm_load_si128(reinterpret_cast<__m128i const *>(padded)));
+    std::uint32_t const mask((1U << s.f_length) - 1);
+
+    std::uint32_t base(0);
+    std::uint32_t n(s.f_count);
+    while(n > 1)
+    {
+        std::uint32_t const half(n / 2);
+        __builtin_prefetch(s.f_keys + (base + half / 2) * s.f_stride);
+        __builtin_prefetch(s.f_keys + (base + half + half / 2) * s.f_stride);
+        base += less_sse2(s, key, mask, s.f_keys + (base + half) * s.f_stride) ? half : 0;
+        n -= half;
+    }
+    return base + (less_sse2(s, key, mask, s.f_keys + base * s.f_stride) ? 1 : 0);
+}
+
+
+std::uint32_t eytzinger_sse2(search_t const & s)
+{
+    alignas(16) std::uint8_t padded[SSE2_KEY_LENGTH] = {};
+    memcpy(padded, s.f_key, s.f_length);
+    __m128i const key(_mm_load_si128(reinterpret_cast<__m128i const *>(padded)));
+    std::uint32_t const mask((1U << s.f_length) - 1);
+
+    std::uint32_t i(1);
+    while(i <= s.f_count)
+    {
+        prefetch_grandchildren(s, i);
+        i = i * 2 + (less_sse2(s, key, mask, s.f_keys + static_cast<std::size_t>(i - 1) * s.f_stride) ? 1 : 0);
+    }
+    return eytzinger_result(s, i);
+}
+
+
+inline __attribute__((always_inline, target("avx2")))
+bool less_avx2(search_t const & s, __m256i key, std::uint32_t mask, std::uint8_t const * p)
+{
+    if(p + AVX2_KEY_LENGTH > s.f_end)
+    {
+        return less_scalar(s, p);
+    }
+
+    __m256i const a(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(p)));
+    std::uint32_t const different(~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, key))) & mask);
+    std::uint32_t const smaller(~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(a, key), a))));
+    return ((different & -different) & smaller) != 0;
+}
+
+
+__attribute__((target("avx2")))
+std::uint32_t lower_bound_avx2(search_t const & s)
+{
+    alignas(32) std::uint8_t padded[AVX2_KEY_LENGTH] = {};
+    memcpy(padded, s.f_key, s.f_length);
+    __m256i const key(_mm256_load_si256(reinterpret_cast<__m256i const *>(padded)));
+    std::uint32_t const mask(s.f_length == AVX2_KEY_LENGTH
+                                ? 0xFFFFFFFF
+                                : (1U << s.f_length) - 1);
+
+    std::uint32_t base(0);
+    std::uint32_t n(s.f_count);
+    while(n > 1)
+    {
+        std::uint32_t const half(n / 2);
+        __builtin_prefetch(s.f_keys + (base + half / 2) * s.f_stride);
+        __builtin_prefetch(s.f_keys + (base + half + half / 2) * s.f_stride);
+        base += less_avx2(s, key, mask, s.f_keys + (base + half) * s.f_stride) ? half : 0;
+        n -= half;
+    }
+    return base + (less_avx2(s, key, mask, s.f_keys + base * s.f_stride) ? 1 : 0);
+}
+
+
+__attribute__((target("avx2")))
+std::uint32_t eytzinger_avx2(search_t const & s)
+{
+    alignas(32) std::uint8_t padded[AVX2_KEY_LENGTH] = {};
+    memcpy(padded, s.f_key, s.f_length);
+    __m256i const key(_mm256_load_si256(reinterpret_cast<__m256i const *>(padded)));
+    std::uint32_t const mask(s.f_length == AVX2_KEY_LENGTH
+                                ? 0xFFFFFFFF
+                                : (1U << s.f_length) - 1);
+
+    std::uint32_t i(1);
+    while(i <= s.f_count)
+    {
+        prefetch_grandchildren(s, i);
+        i = i * 2 + (less_avx2(s, key, mask, s.f_keys + static_cast<std::size_t>(i - 1) * s.f_stride) ? 1 : 0);
+    }
+    return eytzinger_result(s, i);
+}
+
+
+bool has_avx2()
+{
+    static bool const avx2([]()
+        {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+        }());
+    return avx2;
+}
+#endif
+
+
+
+key_search_t select_implementation(key_search_t implementation, std::uint32_t length)
+{
+    if(implementation == key_search_t::KEY_SEARCH_DEFAULT)
+    {
+        return key_search_get_default(length);
+    }
+
+    if(!key_search_is_supported(implementation, length))
+    {
+        throw invalid_parameter(
+                  "key search implementation "
+                + std::to_string(static_cast<int>(implementation))
+                + " does not support keys of "
+                + std::to_string(length)
+                + " bytes on this computer.");
+    }
+
+    return implementation;
+}
+
+
+/** \brief Number of entries in the subtree starting at \p i.
+ *
+ * \param[in] i  The 1 based index of the root of the subtree.
+ * \param[in] count  The total number of entries.
+ *
+ * \return The number of entries in that subtree.
+ */
+std::uint32_t subtree_size(std::uint32_t i, std::uint32_t count)
+{
+    std::uint32_t size(0);
+    for(std::uint64_t first(i), width(1); first <= count; first *= 2, width *= 2)
+    {
+        size += std::min(first + width - 1, static_cast<std::uint64_t>(count)) - first + 1;
+    }
+    return size;
+}
+
+
+/** \brief Call \p f with each entry in sorted order.
+ *
+ * The function is called with the position of the entry in a sorted
+ * array and the position of the same entry in Eytzinger order. Both
+ * positions are 0 based.
+ *
+ * \param[in] count  The number of entries.
+ * \param[in] f  The function to call.
+ */
+template<typename F>
+void for_each_entry(std::uint32_t count, F f)
+{
+    if(count == 0)
+    {
+        return;
+    }
+
+    // go to the left most entry and then do an in-order walk
+    //
+    std::uint32_t i(1);
+    while(i * 2 <= count)
+    {
+        i *= 2;
+    }
+    for(std::uint32_t position(0); position < count; ++position)
+    {
+        f(position, i - 1);
+
+        if(i * 2 + 1 <= count)
+        {
+            i = i * 2 + 1;
+            while(i * 2 <= count)
+            {
+                i *= 2;
+            }
+        }
+        else
+        {
+            while((i & 1) != 0)
+            {
+                i >>= 1;
+            }
+            i >>= 1;
+        }
+    }
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Check whether an implementation can be used.
+ *
+ * The SSE2 implementation supports keys of up to 16 bytes and the AVX2
+ * implementation keys of up to 32 bytes. The AVX2 implementation also
+ * requires a processor supporting those instructions. The scalar
+ * implementation is always available.
+ *
+ * \param[in] implementation  The implementation to check.
+ * \param[in] length  The length of the keys.
+ *
+ * \return true if \p implementation can search keys of \p length bytes.
+ */
+bool key_search_is_supported(key_search_t implementation, std::uint32_t length)
+{
+    switch(implementation)
+    {
+    case key_search_t::KEY_SEARCH_DEFAULT:
+    case key_search_t::KEY_SEARCH_SCALAR:
+        return true;
+
+#if defined(__x86_64__)
+    case key_search_t::KEY_SEARCH_SSE2:
+        return length <= SSE2_KEY_LENGTH;
+
+    case key_search_t::KEY_SEARCH_AVX2:
+        return length <= AVX2_KEY_LENGTH && has_avx2();
+#endif
+
+    default:
+        return false;
+
+    }
+}
+
+
+/** \brief Get the best implementation for keys of \p length bytes.
+ *
+ * \param[in] length  The length of the keys.
+ *
+ * \return The implementation used by key_lower_bound() by default.
+ */
+key_search_t key_search_get_default(std::uint32_t length)
+{
+    if(key_search_is_supported(key_search_t::KEY_SEARCH_SSE2, length))
+    {
+        return key_search_t::KEY_SEARCH_SSE2;
+    }
+    if(key_search_is_supported(key_search_t::KEY_SEARCH_AVX2, length))
+    {
+        return key_search_t::KEY_SEARCH_AVX2;
+    }
+    return key_search_t::KEY_SEARCH_SCALAR;
+}
+
+
+/** \brief Search a key in a sorted array of entries.
+ *
+ * The \p keys pointer points to the key of the first entry. The key of
+ * entry `n` is at `keys + n * stride`. The keys are compared on
+ * \p length bytes as memcmp() would.
+ *
+ * The \p end pointer is the end of the memory which can be read. It is
+ * usually the end of the block. It must be at least the end of the key
+ * of the last entry.
+ *
+ * \exception invalid_parameter
+ * The \p implementation must support keys of \p length bytes.
+ *
+ * \param[in] keys  The key of the first entry.
+ * \param[in] count  The number of entries.
+ * \param[in] stride  The size of one entry.
+ * \param[in] end  The end of the readable memory.
+ * \param[in] key  The key to search.
+ * \param[in] length  The length of the keys.
+ * \param[in] implementation  The implementation to use.
+ *
+ * \return The position of the first entry with a key larger or equal to
+ * \p key, or \p count if all the keys are smaller.
+ */
+std::uint32_t key_lower_bound(
+          std::uint8_t const * keys
+        , std::uint32_t count
+        , std::uint32_t stride
+        , std::uint8_t const * end
+        , std::uint8_t const * key
+        , std::uint32_t length
+        , key_search_t implementation)
+{
+    if(count == 0)
+    {
+        return 0;
+    }
+
+    search_t const s{ keys, count, stride, end, key, length };
+    switch(select_implementation(implementation, length))
+    {
+#if defined(__x86_64__)
+    case key_search_t::KEY_SEARCH_SSE2:
+        return lower_bound_sse2(s);
+
+    case key_search_t::KEY_SEARCH_AVX2:
+        return lower_bound_avx2(s);
+#endif
+
+    default:
+        return lower_bound_scalar(s);
+
+    }
+}
+
+
+/** \brief Search a key in an array of entries in Eytzinger order.
+ *
+ * This function is similar to key_lower_bound() except that the entries
+ * are expected to be in Eytzinger order as generated by
+ * eytzinger_from_sorted().
+ *
+ * The function returns the index of the entry in the array. To get its
+ * position in sorted order, use eytzinger_to_position().
+ *
+ * \exception invalid_parameter
+ * The \p implementation must support keys of \p length bytes.
+ *
+ * \param[in] keys  The key of the first entry.
+ * \param[in] count  The number of entries.
+ * \param[in] stride  The size of one entry.
+ * \param[in] end  The end of the readable memory.
+ * \param[in] key  The key to search.
+ * \param[in] length  The length of the keys.
+ * \param[in] implementation  The implementation to use.
+ *
+ * \return The index of the smallest entry with a key larger or equal to
+ * \p key, or \p count if all the keys are smaller.
+ */
+std::uint32_t key_eytzinger_lower_bound(
+          std::uint8_t const * keys
+        , std::uint32_t count
+        , std::uint32_t stride
+        , std::uint8_t const * end
+        , std::uint8_t const * key
+        , std::uint32_t length
+        , key_search_t implementation)
+{
+    search_t const s{ keys, count, stride, end, key, length };
+    switch(select_implementation(implementation, length))
+    {
+#if defined(__x86_64__)
+    case key_search_t::KEY_SEARCH_SSE2:
+        return eytzinger_sse2(s);
+
+    case key_search_t::KEY_SEARCH_AVX2:
+        return eytzinger_avx2(s);
+#endif
+
+    default:
+        return eytzinger_scalar(s);
+
+    }
+}
+
+
+/** \brief Convert an index in Eytzinger order to a sorted position.
+ *
+ * \param[in] index  The 0 based index of an entry in Eytzinger order.
+ * \param[in] count  The number of entries.
+ *
+ * \return The position of that entry in a sorted array, or \p count if
+ * \p index is out of bounds.
+ */
+std::uint32_t eytzinger_to_position(std::uint32_t index, std::uint32_t count)
+{
+    if(index >= count)
+    {
+        return count;
+    }
+
+    // all the entries of the left subtree are smaller and each time we
+    // are the right child, the parent and its left subtree are smaller
+    //
+    std::uint32_t i(index + 1);
+    std::uint32_t position(subtree_size(i * 2, count));
+    for(; i > 1; i >>= 1)
+    {
+        if((i & 1) != 0)
+        {
+            position += subtree_size(i - 1, count) + 1;
+        }
+    }
+    return position;
+}
+
+
+/** \brief Convert a sorted position to an index in Eytzinger order.
+ *
+ * This function is the inverse of eytzinger_to_position().
+ *
+ * \param[in] position  The 0 based position of an entry in sorted order.
+ * \param[in] count  The number of entries.
+ *
+ * \return The index of that entry in Eytzinger order, or \p count if
+ * \p position is out of bounds.
+ */
+std::uint32_t eytzinger_from_position(std::uint32_t position, std::uint32_t count)
+{
+    if(position >= count)
+    {
+        return count;
+    }
+
+    std::uint32_t i(1);
+    for(;;)
+    {
+        std::uint32_t const left(subtree_size(i * 2, count));
+        if(position == left)
+        {
+            return i - 1;
+        }
+        if(position < left)
+        {
+            i *= 2;
+        }
+        else
+        {
+            position -= left + 1;
+            i = i * 2 + 1;
+        }
+    }
+}
+
+
+/** \brief Reorder a sorted array of entries in Eytzinger order.
+ *
+ * \param[in,out] entries  The entries to reorder.
+ * \param[in] count  The number of entries.
+ * \param[in] stride  The size of one entry.
+ */
+void eytzinger_from_sorted(std::uint8_t * entries, std::uint32_t count, std::uint32_t stride)
+{
+    std::vector<std::uint8_t> sorted(entries, entries + static_cast<std::size_t>(count) * stride);
+    for_each_entry(count, [&](std::uint32_t position, std::uint32_t index)
+        {
+            memcpy(entries + static_cast<std::size_t>(index) * stride
+                 , sorted.data() + static_cast<std::size_t>(position) * stride
+                 , stride);
+        });
+}
+
+
+/** \brief Reorder an array of entries in Eytzinger order in sorted order.
+ *
+ * \param[in,out] entries  The entries to reorder.
+ * \param[in] count  The number of entries.
+ * \param[in] stride  The size of one entry.
+ */
+void eytzinger_to_sorted(std::uint8_t * entries, std::uint32_t count, std::uint32_t stride)
+{
+    std::vector<std::uint8_t> tree(entries, entries + static_cast<std::size_t>(count) * stride);
+    for_each_entry(count, [&](std::uint32_t position, std::uint32_t index)
+        {
+            memcpy(entries + static_cast<std::size_t>(position) * stride
+                 , tree.data() + static_cast<std::size_t>(index) * stride
+                 , stride);
+        });
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,91 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Search of fixed-width keys in a sorted array of entries.
+ *
+ * The index blocks save their entries in a sorted array. Each entry has
+ * the same size and the key is found at the same offset within each
+ * entry. The key_lower_bound() function searches such an array with a
+ * branchless binary search and compares the keys with SSE2 or AVX2
+ * instructions when the processor supports them.
+ *
+ * The entries can also be saved in Eytzinger order (the order of a
+ * breadth first walk of a balanced binary tree). In that order, the
+ * first few levels of the search are all found in the first few cache
+ * lines of the array and the children of an entry are next to each
+ * other so they can be prefetched together.
+ */
+
+// C++
+//
+#include    <cstdint>
+
+
+
+namespace prinbee
+{
+
+
+
+enum class key_search_t
+{
+    KEY_SEARCH_DEFAULT,             // best available for the key length
+    KEY_SEARCH_SCALAR,              // memcmp()
+    KEY_SEARCH_SSE2,                // keys of up to 16 bytes
+    KEY_SEARCH_AVX2,                // keys of up to 32 bytes
+};
+
+
+enum class index_layout_t
+{
+    INDEX_LAYOUT_SORTED,            // sorted array
+    INDEX_LAYOUT_EYTZINGER,         // breadth first binary tree
+    INDEX_LAYOUT_PREFIX,            // front coded keys with restart points (see prefix_keys)
+};
+
+
+bool key_search_is_supported(key_search_t implementation, std::uint32_t length);
+key_search_t key_search_get_default(std::uint32_t length);
+std::uint32_t key_lower_bound(
+          std::uint8_t const * keys
+        , std::uint32_t count
+        , std::uint32_t stride
+        , std::uint8_t const * end
+        , std::uint8_t const * key
+        , std::uint32_t length
+        , key_search_t implementation = key_search_t::KEY_SEARCH_DEFAULT);
+std::uint32_t key_eytzinger_lower_bound(
+          std::uint8_t const * keys
+        , std::uint32_t count
+        , std::uint32_t stride
+        , std::uint8_t const * end
+        , std::uint8_t const * key
+        , std::uint32_t length
+        , key_search_t implementation = key_search_t::KEY_SEARCH_DEFAULT);
+std::uint32_t eytzinger_to_position(std::uint32_t index, std::uint32_t count);
+std::uint32_t eytzinger_from_position(std::uint32_t position, std::uint32_t count);
+void eytzinger_from_sorted(std::uint8_t * entries, std::uint32_t count, std::uint32_t stride);
+void eytzinger_to_sorted(std::uint8_t * entries, std::uint32_t count, std::uint32_t stride);
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
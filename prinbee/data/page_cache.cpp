@@ -0,0 +1,457 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Page cache implementation.
+ *
+ * The page cache is a small buffer pool manager. It does not allocate
+ * the pages itself; the dbfile gives it pages it just mapped and the
+ * cache calls the release callback once it decides to evict one of them.
+ *
+ * Each page has a pin count. A page with a pin count larger than zero
+ * is in use (i.e. a block object holds a page_ref to it) and can't be
+ * evicted. The pin count is atomic and the cache structures are
+ * protected by a mutex so page references can be used from any thread.
+ * Pages with a pin count of zero stay in the cache until the memory
+ * budget is reached. At that point, the CLOCK algorithm is used to
+ * select the victims: the hand goes around the pages, a page which was
+ * referenced since the last pass gets a second chance, the others get
+ * released.
+ */
+
+// self
+//
+#include    "prinbee/data/page_cache.h"
+
+#include    "prinbee/exception.h"
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <limits>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+/** \brief Initialize the page cache.
+ *
+ * The \p callback is called whenever a page gets evicted from the cache.
+ * It is expected to release the memory (i.e. call munmap()).
+ *
+ * \param[in] callback  The function used to release an evicted page.
+ */
+page_cache::page_cache(release_callback_t callback)
+    : f_release_callback(callback)
+{
+}
+
+
+/** \brief Release all the pages still in the cache.
+ *
+ * The destructor makes sure that all the pages get released. No page_ref
+ * to one of the pages of this cache can survive the cache.
+ */
+page_cache::~page_cache()
+{
+    clear();
+}
+
+
+/** \brief Define the size of one page.
+ *
+ * The budget is defined in bytes. The size of a page is used to
+ * determine the number of pages the cache can hold.
+ *
+ * \param[in] page_size  The size of one page in bytes.
+ */
+void page_cache::set_page_size(std::size_t page_size)
+{
+    cppthread::guard lock(f_mutex);
+    f_page_size = page_size;
+}
+
+
+std::size_t page_cache::get_page_size() const
+{
+    return f_page_size;
+}
+
+
+/** \brief Change the memory budget of this cache.
+ *
+ * The budget is the maximum number of bytes the cache is expected to
+ * hold. Pinned pages can't be evicted so the budget can temporarily be
+ * exceeded when too many pages are in use.
+ *
+ * If the new budget is smaller than the current amount of memory used,
+ * the function immediately evicts pages.
+ *
+ * A budget of zero means that the cache is not limited.
+ *
+ * \param[in] budget  The new memory budget in bytes.
+ */
+void page_cache::set_budget(std::size_t budget)
+{
+    cppthread::guard lock(f_mutex);
+    f_budget = budget;
+    evict_pages();
+}
+
+
+std::size_t page_cache::get_budget() const
+{
+    return f_budget;
+}
+
+
+/** \brief Check whether the cache holds more pages than its budget allows.
+ *
+ * \return true if the number of pages is larger than the budget.
+ */
+bool page_cache::is_over_budget() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_by_offset.size() > get_max_pages();
+}
+
+
+/** \brief Search for a page and pin it.
+ *
+ * This function searches the cache for the page at \p offset. If present,
+ * a page_ref to it is returned. The page remains pinned until that
+ * reference and all of its copies are gone.
+ *
+ * If the page is not present, the function returns an empty reference.
+ * The caller is then expected to load the page and call add().
+ *
+ * \param[in] offset  The offset of the start of the page.
+ *
+ * \return A reference to the page or an empty reference.
+ */
+page_ref page_cache::pin(reference_t offset)
+{
+    cppthread::guard lock(f_mutex);
+
+    auto it(f_by_offset.find(offset));
+    if(it == f_by_offset.end())
+    {
+        ++f_statistics.f_misses;
+        return page_ref();
+    }
+
+    ++f_statistics.f_hits;
+    detail::cached_page_t & p(f_pages[it->second]);
+    if(p.f_pin_count.fetch_add(1, std::memory_order_relaxed) == 0)
+    {
+        ++f_pinned_count;
+    }
+    p.f_referenced.store(true, std::memory_order_relaxed);
+    return page_ref(&p);
+}
+
+
+/** \brief Search for a page without pinning it.
+ *
+ * This function searches the cache for the page at \p offset. Contrary
+ * to pin(), it does not change the pin count, the referenced flag, or
+ * the statistics. The returned pointer must not be used once the page
+ * may have been evicted.
+ *
+ * \param[in] offset  The offset of the start of the page.
+ *
+ * \return The pointer to the page data or nullptr.
+ */
+data_t page_cache::find(reference_t offset) const
+{
+    cppthread::guard lock(f_mutex);
+
+    auto it(f_by_offset.find(offset));
+    if(it == f_by_offset.end())
+    {
+        return nullptr;
+    }
+
+    return f_pages[it->second].f_data;
+}
+
+
+/** \brief Add a page to the cache.
+ *
+ * After a miss, the caller loads the page and adds it to the cache with
+ * this function. The returned reference holds the first pin.
+ *
+ * If the cache is over budget, unpinned pages get evicted.
+ *
+ * \exception logic_error
+ * The page must not already be present in the cache.
+ *
+ * \param[in] offset  The offset of the start of the page.
+ * \param[in] data  The pointer to the page data.
+ *
+ * \return A reference to the new page.
+ */
+page_ref page_cache::add(reference_t offset, data_t data)
+{
+    cppthread::guard lock(f_mutex);
+
+    if(f_by_offset.find(offset) != f_by_offset.end())
+    {
+        throw logic_error(
+                  "page at offset "
+                + std::to_string(offset)
+                + " is already defined in the page cache.");
+    }
+
+    std::size_t idx(0);
+    if(f_free_slots.empty())
+    {
+        idx = f_pages.size();
+        f_pages.emplace_back();
+    }
+    else
+    {
+        idx = f_free_slots.back();
+        f_free_slots.pop_back();
+    }
+
+    detail::cached_page_t & p(f_pages[idx]);
+    p.f_cache = this;
+    p.f_slot = idx;
+    p.f_offset = offset;
+    p.f_data = data;
+    p.f_pin_count.store(1, std::memory_order_relaxed);
+    p.f_referenced.store(true, std::memory_order_relaxed);
+    ++f_pinned_count;
+
+    f_by_offset[offset] = idx;
+
+    // the new page is pinned so it can't be the victim
+    //
+    evict_pages();
+
+    return page_ref(&p);
+}
+
+
+/** \brief Evict pages until the cache is back within budget.
+ *
+ * This function runs the CLOCK algorithm. Pages which are pinned are
+ * ignored. Pages which were referenced since the last pass get their
+ * referenced flag cleared and are skipped. Other pages are released.
+ *
+ * If all the pages are pinned, the cache remains over budget. This gets
+ * counted in the statistics.
+ */
+void page_cache::evict()
+{
+    cppthread::guard lock(f_mutex);
+    evict_pages();
+}
+
+
+/** \brief Release all the pages.
+ *
+ * This function releases all the pages, whether pinned or not. It is
+ * expected to be called when the file gets closed. Pages that are still
+ * referenced by a page_ref get detached: they are not part of the cache
+ * anymore and their slot gets reused once the last reference is gone.
+ *
+ * When \p release is false, the release callback does not get called.
+ * This is useful when the owner of the pages releases all of them at
+ * once (i.e. it unmaps the whole file).
+ *
+ * \param[in] release  Whether to call the release callback on each page.
+ */
+void page_cache::clear(bool release)
+{
+    cppthread::guard lock(f_mutex);
+
+    f_free_slots.clear();
+    for(auto & p : f_pages)
+    {
+        if(p.f_data != nullptr)
+        {
+            if(release
+            && f_release_callback != nullptr)
+            {
+                f_release_callback(p.f_offset, p.f_data);
+            }
+            p.f_data = nullptr;
+            p.f_referenced.store(false, std::memory_order_relaxed);
+        }
+        if(p.f_pin_count.load(std::memory_order_acquire) == 0)
+        {
+            f_free_slots.push_back(p.f_slot);
+        }
+    }
+    f_by_offset.clear();
+    f_hand = 0;
+    f_pinned_count = 0;
+}
+
+
+/** \brief Retrieve the cache statistics.
+ *
+ * The statistics include the number of hits, misses, evictions, and the
+ * current number of pages present and pinned.
+ *
+ * \return A copy of the current statistics.
+ */
+page_cache_statistics_t page_cache::get_statistics() const
+{
+    cppthread::guard lock(f_mutex);
+
+    page_cache_statistics_t result(f_statistics);
+    result.f_page_count = f_by_offset.size();
+    result.f_pinned_count = f_pinned_count;
+    return result;
+}
+
+
+std::size_t page_cache::get_max_pages() const
+{
+    if(f_budget == 0
+    || f_page_size == 0)
+    {
+        return std::numeric_limits<std::size_t>::max();
+    }
+
+    // always allow at least one page
+    //
+    return std::max(f_budget / f_page_size, static_cast<std::size_t>(1));
+}
+
+
+/** \brief Release what is likely the last pin of a page.
+ *
+ * This function is called by page_ref when it holds what looks like the
+ * last pin of \p page. The counter is decremented under the page cache
+ * lock. This way evict_pages() and release_page(), which also run under
+ * that lock, can't see a pin count of zero and reuse the slot before the
+ * cache is done with the page.
+ *
+ * If another thread copied a reference in between, the counter does not
+ * reach zero and the page remains pinned.
+ *
+ * \param[in] page  The page to unpin.
+ */
+void page_cache::unpin(detail::cached_page_t * page)
+{
+    cppthread::guard lock(f_mutex);
+
+    if(page->f_pin_count.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    {
+        return;
+    }
+
+    if(page->f_data == nullptr)
+    {
+        // the page was detached by clear(), we can now reuse its slot
+        //
+        f_free_slots.push_back(page->f_slot);
+        return;
+    }
+
+    --f_pinned_count;
+    evict_pages();
+}
+
+
+void page_cache::evict_pages()
+{
+    std::size_t const max_pages(get_max_pages());
+    if(f_by_offset.size() <= max_pages)
+    {
+        return;
+    }
+
+    if(f_pinned_count >= f_by_offset.size())
+    {
+        ++f_statistics.f_over_budget;
+        return;
+    }
+
+    // two full turns are enough: the first pass may only clear the
+    // referenced flags, the second finds the victims
+    //
+    std::size_t const size(f_pages.size());
+    for(std::size_t count(size * 2); count > 0 && f_by_offset.size() > max_pages; --count)
+    {
+        if(f_hand >= size)
+        {
+            f_hand = 0;
+        }
+        detail::cached_page_t & p(f_pages[f_hand]);
+        if(p.f_data != nullptr
+        && p.f_pin_count.load(std::memory_order_acquire) == 0)
+        {
+            // a referenced page gets a second chance
+            //
+            if(!p.f_referenced.exchange(false, std::memory_order_relaxed))
+            {
+                release_page(p);
+                ++f_statistics.f_evictions;
+            }
+        }
+        ++f_hand;
+    }
+
+    if(f_by_offset.size() > max_pages)
+    {
+        ++f_statistics.f_over_budget;
+    }
+}
+
+
+void page_cache::release_page(detail::cached_page_t & page)
+{
+    f_by_offset.erase(page.f_offset);
+
+    reference_t const offset(page.f_offset);
+    data_t const data(page.f_data);
+
+    page.f_data = nullptr;
+    page.f_referenced.store(false, std::memory_order_relaxed);
+    f_free_slots.push_back(page.f_slot);
+
+    if(f_release_callback != nullptr)
+    {
+        f_release_callback(offset, data);
+    }
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,125 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Page cache used by the dbfile.
+ *
+ * The dbfile maps pages of the database file in memory. Without a limit,
+ * a process reading a large table would end up with the entire file
+ * mapped. The page cache keeps track of those pages, counts how many
+ * users have each page pinned (see page_ref), and evicts unpinned pages
+ * using the CLOCK algorithm whenever the memory budget is exceeded.
+ */
+
+// self
+//
+#include    "prinbee/data/page_ref.h"
+
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+
+
+// C++
+//
+#include    <cstdint>
+#include    <deque>
+#include    <functional>
+#include    <unordered_map>
+#include    <vector>
+
+
+
+namespace prinbee
+{
+
+
+
+constexpr std::size_t               DEFAULT_PAGE_CACHE_BUDGET = 64ULL * 1024ULL * 1024ULL;
+
+
+struct page_cache_statistics_t
+{
+    std::uint64_t                   f_hits = 0;
+    std::uint64_t                   f_misses = 0;
+    std::uint64_t                   f_evictions = 0;
+    std::uint64_t                   f_over_budget = 0;      // number of times all the pages were pinned
+    std::size_t                     f_page_count = 0;
+    std::size_t                     f_pinned_count = 0;
+};
+
+
+class page_cache
+{
+public:
+    typedef std::function<void(reference_t offset, data_t data)>
+                                    release_callback_t;
+
+                                    page_cache(release_callback_t callback);
+                                    page_cache(page_cache const & rhs) = delete;
+                                    ~page_cache();
+
+    page_cache &                    operator = (page_cache const & rhs) = delete;
+
+    void                            set_page_size(std::size_t page_size);
+    std::size_t                     get_page_size() const;
+    void                            set_budget(std::size_t budget);
+    std::size_t                     get_budget() const;
+    bool                            is_over_budget() const;
+
+    page_ref                        pin(reference_t offset);
+    data_t                          find(reference_t offset) const;
+    page_ref                        add(reference_t offset, data_t data);
+    void                            evict();
+    void                            clear(bool release = true);
+
+    page_cache_statistics_t         get_statistics() const;
+
+private:
+    friend class page_ref;
+
+    // a deque so the pages referenced by a page_ref never move
+    //
+    typedef std::deque<detail::cached_page_t>
+                                    page_deque_t;
+
+    std::size_t                     get_max_pages() const;
+    void                            unpin(detail::cached_page_t * page);
+    void                            evict_pages();
+    void                            release_page(detail::cached_page_t & page);
+
+    mutable cppthread::mutex        f_mutex = cppthread::mutex();
+    release_callback_t              f_release_callback = release_callback_t();
+    std::size_t                     f_page_size = 0;
+    std::size_t                     f_budget = DEFAULT_PAGE_CACHE_BUDGET;
+    page_deque_t                    f_pages = page_deque_t();
+    std::vector<std::size_t>        f_free_slots = std::vector<std::size_t>();
+    std::unordered_map<reference_t, std::size_t>
+                                    f_by_offset = std::unordered_map<reference_t, std::size_t>();
+    std::size_t                     f_hand = 0;
+    std::size_t                     f_pinned_count = 0;
+    page_cache_statistics_t         f_statistics = page_cache_statistics_t();
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
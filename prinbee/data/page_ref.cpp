@@ -0,0 +1,241 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Page reference implementation.
+ *
+ * A page_ref is an intrusive reference counted handle: the counter is
+ * the pin count of the page in the page cache. Incrementing the counter
+ * never requires the page cache lock since a page which is already
+ * pinned can't be evicted. Only the release of the last pin goes back
+ * to the page cache: it is done under the page cache lock so a page can
+ * never be evicted between the time its counter reaches zero and the
+ * time the cache updates its statistics.
+ */
+
+// self
+//
+#include    "prinbee/data/page_ref.h"
+
+#include    "prinbee/data/page_cache.h"
+#include    "prinbee/exception.h"
+
+
+// C++
+//
+#include    <utility>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+/** \brief Adopt a pin of a page.
+ *
+ * This constructor is used by the page cache. The pin count of \p page
+ * was already incremented for this reference.
+ *
+ * \param[in] page  The page to reference.
+ */
+page_ref::page_ref(detail::cached_page_t * page)
+    : f_page(page)
+{
+}
+
+
+/** \brief Pin the page of \p rhs one more time.
+ *
+ * \param[in] rhs  The reference to copy.
+ */
+page_ref::page_ref(page_ref const & rhs)
+    : f_page(rhs.f_page)
+{
+    if(f_page != nullptr)
+    {
+        f_page->f_pin_count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+/** \brief Move the pin of \p rhs to this reference.
+ *
+ * The \p rhs reference becomes empty.
+ *
+ * \param[in] rhs  The reference to move.
+ */
+page_ref::page_ref(page_ref && rhs) noexcept
+    : f_page(std::exchange(rhs.f_page, nullptr))
+{
+}
+
+
+/** \brief Unpin the page.
+ *
+ * The destructor releases the pin held by this reference.
+ */
+page_ref::~page_ref()
+{
+    reset();
+}
+
+
+page_ref & page_ref::operator = (page_ref const & rhs)
+{
+    if(f_page != rhs.f_page)
+    {
+        page_ref copy(rhs);
+        std::swap(f_page, copy.f_page);
+    }
+    return *this;
+}
+
+
+page_ref & page_ref::operator = (page_ref && rhs) noexcept
+{
+    if(this != &rhs)
+    {
+        reset();
+        f_page = std::exchange(rhs.f_page, nullptr);
+    }
+    return *this;
+}
+
+
+/** \brief Check whether this reference points to a page.
+ *
+ * \return true if the reference is not empty.
+ */
+page_ref::operator bool () const
+{
+    return f_page != nullptr;
+}
+
+
+bool page_ref::operator == (page_ref const & rhs) const
+{
+    return f_page == rhs.f_page;
+}
+
+
+bool page_ref::operator != (page_ref const & rhs) const
+{
+    return f_page != rhs.f_page;
+}
+
+
+/** \brief Get a pointer to the start of the page.
+ *
+ * The pointer remains valid as long as this reference (or a copy of it)
+ * exists.
+ *
+ * \exception logic_error
+ * The reference is empty.
+ *
+ * \return The pointer to the page data.
+ */
+data_t page_ref::data() const
+{
+    if(f_page == nullptr)
+    {
+        throw logic_error("page_ref::data() called on an empty page reference.");
+    }
+
+    return f_page->f_data;
+}
+
+
+/** \brief Get the offset of the page in its file.
+ *
+ * \exception logic_error
+ * The reference is empty.
+ *
+ * \return The offset of the start of the page.
+ */
+reference_t page_ref::get_offset() const
+{
+    if(f_page == nullptr)
+    {
+        throw logic_error("page_ref::get_offset() called on an empty page reference.");
+    }
+
+    return f_page->f_offset;
+}
+
+
+/** \brief Get the number of times the page is currently pinned.
+ *
+ * This is mainly for debug purposes since other threads may change
+ * the counter at any time.
+ *
+ * \return The pin count of the page or 0 if the reference is empty.
+ */
+std::uint32_t page_ref::get_pin_count() const
+{
+    if(f_page == nullptr)
+    {
+        return 0;
+    }
+
+    return f_page->f_pin_count.load(std::memory_order_relaxed);
+}
+
+
+/** \brief Release the pin and make this reference empty.
+ *
+ * When this was the last pin, the page cache gets notified so it can
+ * evict the page if it is over budget.
+ */
+void page_ref::reset()
+{
+    detail::cached_page_t * page(std::exchange(f_page, nullptr));
+    if(page == nullptr)
+    {
+        return;
+    }
+
+    // as long as other references exist, the page can't be evicted so
+    // the counter can be decremented without the page cache lock
+    //
+    std::uint32_t count(page->f_pin_count.load(std::memory_order_relaxed));
+    while(count > 1)
+    {
+        if(page->f_pin_count.compare_exchange_weak(
+                      count
+                    , count - 1
+                    , std::memory_order_acq_rel
+                    , std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+
+    page->f_cache->unpin(page);
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,99 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Handle used to keep a page of a dbfile pinned in memory.
+ *
+ * The dbfile returns its pages wrapped in a page_ref. As long as at
+ * least one page_ref references a page, that page remains pinned in the
+ * page cache and can't be evicted. Copying a page_ref only increments
+ * an atomic counter so handles can be shared between objects and
+ * threads cheaply.
+ */
+
+// C++
+//
+#include    <atomic>
+#include    <cstdint>
+
+
+
+namespace prinbee
+{
+
+
+
+typedef std::uint64_t               reference_t;
+typedef std::uint8_t *              data_t;
+
+class page_cache;
+
+
+namespace detail
+{
+
+
+struct cached_page_t
+{
+    page_cache *                    f_cache = nullptr;
+    std::size_t                     f_slot = 0;
+    reference_t                     f_offset = 0;
+    data_t                          f_data = nullptr;
+    std::atomic<std::uint32_t>      f_pin_count = 0;
+    std::atomic<bool>               f_referenced = false;
+};
+
+
+} // namespace detail
+
+
+
+class page_ref
+{
+public:
+                                    page_ref() = default;
+                                    page_ref(page_ref const & rhs);
+                                    page_ref(page_ref && rhs) noexcept;
+                                    ~page_ref();
+
+    page_ref &                      operator = (page_ref const & rhs);
+    page_ref &                      operator = (page_ref && rhs) noexcept;
+
+    explicit                        operator bool () const;
+    bool                            operator == (page_ref const & rhs) const;
+    bool                            operator != (page_ref const & rhs) const;
+
+    data_t                          data() const;
+    reference_t                     get_offset() const;
+    std::uint32_t                   get_pin_count() const;
+    void                            reset();
+
+private:
+    friend class page_cache;
+
+                                    page_ref(detail::cached_page_t * page);
+
+    detail::cached_page_t *         f_page = nullptr;
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
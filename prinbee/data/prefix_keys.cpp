@@ -0,0 +1,687 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Front coding of the keys of an index block.
+ *
+ * The encoder compares each key with the previous one and only saves
+ * the bytes which differ. The decoder does the opposite and needs the
+ * previous key, which is why a search starts at a restart point where
+ * the key is saved in full.
+ *
+ * All the functions work on a buffer of \p size bytes. The entries are
+ * saved at the start of the buffer and the restart points at the end.
+ * The space in between is kept cleared. A buffer full of zeroes is a
+ * valid empty buffer.
+ */
+
+// self
+//
+#include    "prinbee/data/prefix_keys.h"
+
+#include    "prinbee/exception.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+namespace
+{
+
+
+
+constexpr std::uint32_t const       ENTRY_PREFIX_SIZE = sizeof(std::uint16_t) * 2;
+constexpr std::uint32_t const       RESTART_SIZE = sizeof(std::uint32_t) * 2;
+constexpr std::uint32_t const       TAIL_SIZE = sizeof(std::uint32_t);
+
+
+std::uint32_t key_end(std::uint8_t const * key, std::uint32_t length)
+{
+    while(length > 0 && key[length - 1] == 0)
+    {
+        --length;
+    }
+    return length;
+}
+
+
+/** \brief Calculate the shared and suffix sizes of a key.
+ *
+ * The shared bytes are limited to the non-zero part of \p previous. This
+ * is what guarantees that a removal never makes the next entry larger
+ * than the two entries it replaces.
+ *
+ * \param[in] previous  The previous key or nullptr at a restart point.
+ * \param[in] key  The key to encode.
+ * \param[in] length  The size of the keys.
+ * \param[out] shared  The number of bytes shared with \p previous.
+ * \param[out] suffix  The number of bytes to save after the shared bytes.
+ */
+void key_sizes(
+      std::uint8_t const * previous
+    , std::uint8_t const * key
+    , std::uint32_t length
+    , std::uint32_t & shared
+    , std::uint32_t & suffix)
+{
+    std::uint32_t const end(key_end(key, length));
+
+    shared = 0;
+    if(previous != nullptr)
+    {
+        std::uint32_t const max_shared(std::min(end, key_end(previous, length)));
+        while(shared < max_shared && previous[shared] == key[shared])
+        {
+            ++shared;
+        }
+    }
+    suffix = end - shared;
+}
+
+
+
+} // no name namespace
+
+
+
+/** \brief Initialize a front coder for entries of \p stride bytes.
+ *
+ * \exception invalid_parameter
+ * The key must be at least one byte and at most 65535 bytes.
+ *
+ * \param[in] stride  The size of one entry, header and key included.
+ * \param[in] header_size  The size of the header found before the key.
+ */
+prefix_keys::prefix_keys(std::uint32_t stride, std::uint32_t header_size)
+    : f_stride(stride)
+    , f_header_size(header_size)
+{
+    if(stride <= header_size
+    || stride - header_size > 0xFFFF)
+    {
+        throw invalid_parameter(
+                  "the key of a front coded entry must be between 1 and 65535 bytes, got "
+                + std::to_string(static_cast<std::int64_t>(stride) - static_cast<std::int64_t>(header_size))
+                + ".");
+    }
+}
+
+
+std::uint32_t prefix_keys::get_stride() const
+{
+    return f_stride;
+}
+
+
+std::uint32_t prefix_keys::get_header_size() const
+{
+    return f_header_size;
+}
+
+
+std::uint32_t prefix_keys::get_key_size() const
+{
+    return f_stride - f_header_size;
+}
+
+
+/** \brief Calculate the size of \p count entries once encoded.
+ *
+ * \param[in] entries  The sorted array of fixed size entries.
+ * \param[in] count  The number of entries.
+ *
+ * \return The number of bytes, restart points included.
+ */
+std::uint32_t prefix_keys::get_encoded_size(std::uint8_t const * entries, std::uint32_t count) const
+{
+    std::uint32_t const length(get_key_size());
+    std::uint32_t const restarts((count + PREFIX_KEYS_RESTART_INTERVAL - 1) / PREFIX_KEYS_RESTART_INTERVAL);
+    std::uint32_t result(restarts * RESTART_SIZE + TAIL_SIZE);
+    for(std::uint32_t idx(0); idx < count; ++idx)
+    {
+        std::uint8_t const * entry(entries + static_cast<std::size_t>(idx) * f_stride);
+        std::uint32_t shared(0);
+        std::uint32_t suffix(0);
+        key_sizes(
+              idx % PREFIX_KEYS_RESTART_INTERVAL == 0 ? nullptr : entry - f_stride + f_header_size
+            , entry + f_header_size
+            , length
+            , shared
+            , suffix);
+        result += ENTRY_PREFIX_SIZE + f_header_size + suffix;
+    }
+    return result;
+}
+
+
+/** \brief Calculate the number of bytes used in an encoded buffer.
+ *
+ * \param[in] buffer  The encoded entries.
+ * \param[in] size  The size of \p buffer.
+ * \param[in] count  The number of entries in \p buffer.
+ *
+ * \return The number of bytes used, restart points included.
+ */
+std::uint32_t prefix_keys::get_used_size(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t count) const
+{
+    std::uint32_t const restarts(get_restart_count(buffer, size));
+    std::uint32_t offset(0);
+    if(count > 0)
+    {
+        // only the sizes matter, the keys do not get decoded
+        //
+        restart_t const r(get_restart(buffer, size, restarts - 1));
+        offset = r.f_offset;
+        for(std::uint32_t idx(r.f_position); idx < count; ++idx)
+        {
+            offset = next_entry(buffer, size, offset, nullptr);
+        }
+    }
+    return offset + restarts * RESTART_SIZE + TAIL_SIZE;
+}
+
+
+/** \brief The largest number of bytes one more entry can use.
+ *
+ * This includes a new restart point.
+ *
+ * \return The maximum size of one entry once encoded.
+ */
+std::uint32_t prefix_keys::get_max_entry_size() const
+{
+    return ENTRY_PREFIX_SIZE + f_stride + RESTART_SIZE;
+}
+
+
+/** \brief Encode \p count entries in \p buffer.
+ *
+ * If the entries do not fit, the \p buffer is left untouched and the
+ * function returns false.
+ *
+ * \param[in] entries  The sorted array of fixed size entries.
+ * \param[in] count  The number of entries.
+ * \param[out] buffer  The buffer receiving the encoded entries.
+ * \param[in] size  The size of \p buffer.
+ *
+ * \return true if the entries were saved in \p buffer.
+ */
+bool prefix_keys::encode(std::uint8_t const * entries, std::uint32_t count, std::uint8_t * buffer, std::uint32_t size) const
+{
+    if(get_encoded_size(entries, count) > size)
+    {
+        return false;
+    }
+
+    std::uint32_t const length(get_key_size());
+    std::uint32_t const restarts((count + PREFIX_KEYS_RESTART_INTERVAL - 1) / PREFIX_KEYS_RESTART_INTERVAL);
+    std::uint8_t * restart(buffer + size - TAIL_SIZE - restarts * RESTART_SIZE);
+    std::uint32_t offset(0);
+    for(std::uint32_t idx(0); idx < count; ++idx)
+    {
+        std::uint8_t const * entry(entries + static_cast<std::size_t>(idx) * f_stride);
+        bool const is_restart(idx % PREFIX_KEYS_RESTART_INTERVAL == 0);
+        if(is_restart)
+        {
+            restart_t const r{ offset, idx };
+            memcpy(restart, &r.f_offset, sizeof(r.f_offset));
+            memcpy(restart + sizeof(r.f_offset), &r.f_position, sizeof(r.f_position));
+            restart += RESTART_SIZE;
+        }
+
+        std::uint32_t shared(0);
+        std::uint32_t suffix(0);
+        key_sizes(
+              is_restart ? nullptr : entry - f_stride + f_header_size
+            , entry + f_header_size
+            , length
+            , shared
+            , suffix);
+        std::uint16_t const sizes[2] = {
+              static_cast<std::uint16_t>(shared)
+            , static_cast<std::uint16_t>(suffix)
+        };
+        memcpy(buffer + offset, sizes, ENTRY_PREFIX_SIZE);
+        offset += ENTRY_PREFIX_SIZE;
+        memcpy(buffer + offset, entry, f_header_size);
+        offset += f_header_size;
+        memcpy(buffer + offset, entry + f_header_size + shared, suffix);
+        offset += suffix;
+    }
+
+    memset(buffer + offset, 0, size - TAIL_SIZE - restarts * RESTART_SIZE - offset);
+    memcpy(buffer + size - TAIL_SIZE, &restarts, TAIL_SIZE);
+
+    return true;
+}
+
+
+/** \brief Decode \p count entries from \p buffer.
+ *
+ * \param[in] buffer  The encoded entries.
+ * \param[in] size  The size of \p buffer.
+ * \param[in] count  The number of entries in \p buffer.
+ * \param[out] entries  The array receiving \p count fixed size entries.
+ */
+void prefix_keys::decode(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t count, std::uint8_t * entries) const
+{
+    std::vector<std::uint8_t> key(get_key_size());
+    std::uint32_t offset(0);
+    for(std::uint32_t idx(0); idx < count; ++idx)
+    {
+        std::uint8_t * entry(entries + static_cast<std::size_t>(idx) * f_stride);
+        memcpy(entry, buffer + offset + ENTRY_PREFIX_SIZE, f_header_size);
+        offset = next_entry(buffer, size, offset, key.data());
+        memcpy(entry + f_header_size, key.data(), key.size());
+    }
+}
+
+
+/** \brief Retrieve the entry at \p position.
+ *
+ * The function decodes the entries from the restart point preceding
+ * \p position.
+ *
+ * \exception out_of_range
+ * The \p position must be smaller than \p count.
+ *
+ * \param[in] buffer  The encoded entries.
+ * \param[in] size  The size of \p buffer.
+ * \param[in] count  The number of entries in \p buffer.
+ * \param[in] position  The position of the entry to retrieve.
+ * \param[out] entry  The fixed size entry or nullptr.
+ *
+ * \return The offset of the header of that entry in \p buffer.
+ */
+std::uint32_t prefix_keys::get_entry(
+      std::uint8_t const * buffer
+    , std::uint32_t size
+    , std::uint32_t count
+    , std::uint32_t position
+    , std::uint8_t * entry) const
+{
+    if(position >= count)
+    {
+        throw out_of_range(
+                  "front coded entry position "
+                + std::to_string(position)
+                + " is out of range (count: "
+                + std::to_string(count)
+                + ").");
+    }
+
+    std::vector<std::uint8_t> key;
+    if(entry != nullptr)
+    {
+        key.resize(get_key_size());
+    }
+    restart_t const r(get_restart(buffer, size, find_restart(buffer, size, position)));
+    std::uint32_t offset(r.f_offset);
+    for(std::uint32_t idx(r.f_position);; ++idx)
+    {
+        std::uint32_t const header(offset + ENTRY_PREFIX_SIZE);
+        offset = next_entry(buffer, size, offset, entry == nullptr ? nullptr : key.data());
+        if(idx == position)
+        {
+            if(entry != nullptr)
+            {
+                memcpy(entry, buffer + header, f_header_size);
+                memcpy(entry + f_header_size, key.data(), key.size());
+            }
+            return header;
+        }
+    }
+}
+
+
+/** \brief Search the first entry with a key larger or equal to \p key.
+ *
+ * The function does a binary search over the restart points and then
+ * decodes the entries of one interval. Only the first \p length bytes
+ * of the keys are compared.
+ *
+ * \param[in] buffer  The encoded entries.
+ * \param[in] size  The size of \p buffer.
+ * \param[in] count  The number of entries in \p buffer.
+ * \param[in] key  The key to search.
+ * \param[in] length  The number of bytes of \p key to compare.
+ * \param[out] entry  The fixed size entry found or nullptr.
+ *
+ * \return The position of the entry or \p count if all the keys are
+ * smaller.
+ */
+std::uint32_t prefix_keys::lower_bound(
+      std::uint8_t const * buffer
+    , std::uint32_t size
+    , std::uint32_t count
+    , std::uint8_t const * key
+    , std::uint32_t length
+    , std::uint8_t * entry) const
+{
+    if(count == 0)
+    {
+        return 0;
+    }
+
+    std::vector<std::uint8_t> current(get_key_size());
+    if(length > current.size())
+    {
+        length = current.size();
+    }
+
+    // find the first restart point with a key larger or equal to `key`
+    //
+    std::uint32_t low(0);
+    std::uint32_t high(get_restart_count(buffer, size));
+    while(low < high)
+    {
+        std::uint32_t const middle((low + high) / 2);
+        next_entry(buffer, size, get_restart(buffer, size, middle).f_offset, current.data());
+        if(memcmp(current.data(), key, length) < 0)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    // then scan the previous interval; the key of the next restart point
+    // is larger or equal so the scan ends there at the latest
+    //
+    restart_t const r(get_restart(buffer, size, low == 0 ? 0 : low - 1));
+    std::uint32_t position(r.f_position);
+    std::uint32_t offset(r.f_offset);
+    for(; position < count; ++position)
+    {
+        std::uint32_t const header(offset + ENTRY_PREFIX_SIZE);
+        offset = next_entry(buffer, size, offset, current.data());
+        if(memcmp(current.data(), key, length) >= 0)
+        {
+            if(entry != nullptr)
+            {
+                memcpy(entry, buffer + header, f_header_size);
+                memcpy(entry + f_header_size, current.data(), current.size());
+            }
+            break;
+        }
+    }
+    return position;
+}
+
+
+/** \brief Remove the entry at \p position.
+ *
+ * The entry following the removed entry gets encoded again against
+ * the entry preceding the removed entry (or in full if the removed
+ * entry was a restart point). The other entries are moved down and
+ * the restart points updated.
+ *
+ * \exception out_of_range
+ * The \p position must be smaller than \p count.
+ *
+ * \param[in,out] buffer  The encoded entries.
+ * \param[in] size  The size of \p buffer.
+ * \param[in] count  The number of entries in \p buffer.
+ * \param[in] position  The position of the entry to remove.
+ */
+void prefix_keys::remove(std::uint8_t * buffer, std::uint32_t size, std::uint32_t count, std::uint32_t position) const
+{
+    if(position >= count)
+    {
+        throw out_of_range(
+                  "front coded entry position "
+                + std::to_string(position)
+                + " is out of range (count: "
+                + std::to_string(count)
+                + ").");
+    }
+
+    std::uint32_t const used(get_used_size(buffer, size, count));
+    std::uint32_t const restart_count(get_restart_count(buffer, size));
+    std::vector<restart_t> restarts;
+    for(std::uint32_t idx(0); idx < restart_count; ++idx)
+    {
+        restarts.push_back(get_restart(buffer, size, idx));
+    }
+    std::uint32_t const entries_end(used - restart_count * RESTART_SIZE - TAIL_SIZE);
+
+    // decode up to the removed entry
+    //
+    std::uint32_t const length(get_key_size());
+    std::uint32_t const restart(find_restart(buffer, size, position));
+    bool const is_restart(restarts[restart].f_position == position);
+    std::vector<std::uint8_t> previous(length);
+    std::uint32_t offset(restarts[restart].f_offset);
+    for(std::uint32_t idx(restarts[restart].f_position); idx < position; ++idx)
+    {
+        offset = next_entry(buffer, size, offset, previous.data());
+    }
+    std::uint32_t const removed_offset(offset);
+    std::vector<std::uint8_t> key(previous);
+    std::uint32_t tail(next_entry(buffer, size, removed_offset, key.data()));
+
+    // encode the next entry again unless it is a restart point, which
+    // does not depend on the removed entry
+    //
+    bool const next_is_restart(restart + 1 < restart_count
+                            && restarts[restart + 1].f_position == position + 1);
+    std::vector<std::uint8_t> replacement;
+    if(position + 1 < count
+    && !next_is_restart)
+    {
+        std::uint32_t const next_offset(tail);
+        tail = next_entry(buffer, size, next_offset, key.data());
+
+        std::uint32_t shared(0);
+        std::uint32_t suffix(0);
+        key_sizes(is_restart ? nullptr : previous.data(), key.data(), length, shared, suffix);
+        std::uint16_t const sizes[2] = {
+              static_cast<std::uint16_t>(shared)
+            , static_cast<std::uint16_t>(suffix)
+        };
+        replacement.resize(ENTRY_PREFIX_SIZE + f_header_size + suffix);
+        memcpy(replacement.data(), sizes, ENTRY_PREFIX_SIZE);
+        memcpy(replacement.data() + ENTRY_PREFIX_SIZE, buffer + next_offset + ENTRY_PREFIX_SIZE, f_header_size);
+        memcpy(replacement.data() + ENTRY_PREFIX_SIZE + f_header_size, key.data() + shared, suffix);
+    }
+    else if(is_restart)
+    {
+        // the removed restart point has no entry left in its interval
+        //
+        restarts.erase(restarts.begin() + restart);
+    }
+
+    std::uint32_t const removed_size(tail - removed_offset);
+    if(replacement.size() > removed_size)
+    {
+        throw logic_error("front coded entry got larger after a removal.");
+    }
+    std::uint32_t const delta(removed_size - replacement.size());
+
+    memmove(buffer + removed_offset + replacement.size(), buffer + tail, entries_end - tail);
+    if(!replacement.empty())
+    {
+        memcpy(buffer + removed_offset, replacement.data(), replacement.size());
+    }
+
+    for(auto & r : restarts)
+    {
+        if(r.f_position > position)
+        {
+            r.f_offset -= delta;
+            --r.f_position;
+        }
+    }
+
+    std::uint32_t const new_restart_count(restarts.size());
+    std::uint8_t * ptr(buffer + size - TAIL_SIZE - new_restart_count * RESTART_SIZE);
+    memset(buffer + entries_end - delta, 0, ptr - (buffer + entries_end - delta));
+    for(auto const & r : restarts)
+    {
+        memcpy(ptr, &r.f_offset, sizeof(r.f_offset));
+        memcpy(ptr + sizeof(r.f_offset), &r.f_position, sizeof(r.f_position));
+        ptr += RESTART_SIZE;
+    }
+    memcpy(buffer + size - TAIL_SIZE, &new_restart_count, TAIL_SIZE);
+}
+
+
+std::uint32_t prefix_keys::get_restart_count(std::uint8_t const * buffer, std::uint32_t size) const
+{
+    std::uint32_t count(0);
+    memcpy(&count, buffer + size - TAIL_SIZE, TAIL_SIZE);
+    if(static_cast<std::uint64_t>(count) * RESTART_SIZE + TAIL_SIZE > size)
+    {
+        throw corrupted_data(
+                  "front coded buffer has too many restart points ("
+                + std::to_string(count)
+                + ").");
+    }
+    return count;
+}
+
+
+prefix_keys::restart_t prefix_keys::get_restart(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t restart) const
+{
+    std::uint32_t const count(get_restart_count(buffer, size));
+    if(restart >= count)
+    {
+        throw corrupted_data(
+                  "front coded restart point "
+                + std::to_string(restart)
+                + " is missing.");
+    }
+
+    restart_t r;
+    std::uint8_t const * ptr(buffer + size - TAIL_SIZE - (count - restart) * RESTART_SIZE);
+    memcpy(&r.f_offset, ptr, sizeof(r.f_offset));
+    memcpy(&r.f_position, ptr + sizeof(r.f_offset), sizeof(r.f_position));
+    if(r.f_offset + ENTRY_PREFIX_SIZE + f_header_size > size - TAIL_SIZE - count * RESTART_SIZE)
+    {
+        throw corrupted_data(
+                  "front coded restart point "
+                + std::to_string(restart)
+                + " is out of bounds ("
+                + std::to_string(r.f_offset)
+                + ").");
+    }
+    return r;
+}
+
+
+/** \brief Find the last restart point at or before \p position.
+ *
+ * \param[in] buffer  The encoded entries.
+ * \param[in] size  The size of \p buffer.
+ * \param[in] position  The position of an entry.
+ *
+ * \return The index of the restart point.
+ */
+std::uint32_t prefix_keys::find_restart(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t position) const
+{
+    std::uint32_t low(0);
+    std::uint32_t high(get_restart_count(buffer, size));
+    while(low < high)
+    {
+        std::uint32_t const middle((low + high) / 2);
+        if(get_restart(buffer, size, middle).f_position <= position)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    if(low == 0)
+    {
+        throw corrupted_data("front coded buffer has no restart point for position 0.");
+    }
+    return low - 1;
+}
+
+
+/** \brief Decode the key of the entry at \p offset.
+ *
+ * On entry, \p key is the key of the previous entry. On return, it is
+ * the key of the entry at \p offset. If \p key is nullptr, only the
+ * size of the entry is read.
+ *
+ * \exception corrupted_data
+ * The sizes of the entry must fit the key and the buffer.
+ *
+ * \param[in] buffer  The encoded entries.
+ * \param[in] size  The size of \p buffer.
+ * \param[in] offset  The offset of the entry.
+ * \param[in,out] key  The key being decoded or nullptr.
+ *
+ * \return The offset of the next entry.
+ */
+std::uint32_t prefix_keys::next_entry(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t offset, std::uint8_t * key) const
+{
+    std::uint16_t sizes[2] = { 0, 0 };
+    if(offset + ENTRY_PREFIX_SIZE > size)
+    {
+        throw corrupted_data("front coded entry is out of bounds.");
+    }
+    memcpy(sizes, buffer + offset, ENTRY_PREFIX_SIZE);
+    std::uint32_t const length(get_key_size());
+    std::uint32_t const next(offset + ENTRY_PREFIX_SIZE + f_header_size + sizes[1]);
+    if(static_cast<std::uint32_t>(sizes[0]) + sizes[1] > length
+    || next > size)
+    {
+        throw corrupted_data(
+                  "front coded entry at "
+                + std::to_string(offset)
+                + " has invalid sizes ("
+                + std::to_string(sizes[0])
+                + " + "
+                + std::to_string(sizes[1])
+                + ").");
+    }
+
+    if(key != nullptr)
+    {
+        memcpy(key + sizes[0], buffer + offset + ENTRY_PREFIX_SIZE + f_header_size, sizes[1]);
+        memset(key + sizes[0] + sizes[1], 0, length - sizes[0] - sizes[1]);
+    }
+
+    return next;
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,109 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Front coding of the keys of an index block.
+ *
+ * Index blocks normally save fixed size entries: a header (flags,
+ * OID, reference) followed by the key padded with zeroes. With long
+ * string keys, most of each entry is a prefix shared with the previous
+ * key and zero padding.
+ *
+ * The prefix_keys class converts such a sorted array of fixed size
+ * entries to a front coded buffer and back. Each entry is saved as:
+ *
+ * \code
+ *     uint16_t    shared          // bytes shared with the previous key
+ *     uint16_t    suffix_length   // bytes following the shared bytes
+ *     uint8_t     header[header_size]
+ *     uint8_t     suffix[suffix_length]
+ * \endcode
+ *
+ * The trailing zeroes of the key are not saved. Every
+ * PREFIX_KEYS_RESTART_INTERVAL entries, the key is saved in full
+ * (shared is 0). The restart points are saved at the end of the buffer
+ * so a search can do a binary search over the restart points and then
+ * a short linear scan:
+ *
+ * \code
+ *     struct {
+ *         uint32_t    offset      // offset of the entry in the buffer
+ *         uint32_t    position    // position of the entry
+ *     } restarts[restart_count]
+ *     uint32_t    restart_count
+ * \endcode
+ *
+ * Removing an entry is done in place: the following entry gets encoded
+ * again against the previous one, which never makes it larger than the
+ * removed entry. So a removal never fails even when the block is full.
+ */
+
+// C++
+//
+#include    <cstdint>
+
+
+
+namespace prinbee
+{
+
+
+
+constexpr std::uint32_t             PREFIX_KEYS_RESTART_INTERVAL = 16;
+
+
+class prefix_keys
+{
+public:
+                                prefix_keys(std::uint32_t stride, std::uint32_t header_size);
+
+    std::uint32_t               get_stride() const;
+    std::uint32_t               get_header_size() const;
+    std::uint32_t               get_key_size() const;
+
+    std::uint32_t               get_encoded_size(std::uint8_t const * entries, std::uint32_t count) const;
+    std::uint32_t               get_used_size(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t count) const;
+    std::uint32_t               get_max_entry_size() const;
+    bool                        encode(std::uint8_t const * entries, std::uint32_t count, std::uint8_t * buffer, std::uint32_t size) const;
+    void                        decode(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t count, std::uint8_t * entries) const;
+    std::uint32_t               get_entry(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t count, std::uint32_t position, std::uint8_t * entry) const;
+    std::uint32_t               lower_bound(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t count, std::uint8_t const * key, std::uint32_t length, std::uint8_t * entry) const;
+    void                        remove(std::uint8_t * buffer, std::uint32_t size, std::uint32_t count, std::uint32_t position) const;
+
+private:
+    struct restart_t
+    {
+        std::uint32_t           f_offset = 0;
+        std::uint32_t           f_position = 0;
+    };
+
+    std::uint32_t               get_restart_count(std::uint8_t const * buffer, std::uint32_t size) const;
+    restart_t                   get_restart(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t restart) const;
+    std::uint32_t               find_restart(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t position) const;
+    std::uint32_t               next_entry(std::uint8_t const * buffer, std::uint32_t size, std::uint32_t offset, std::uint8_t * key) const;
+
+    std::uint32_t               f_stride = 0;
+    std::uint32_t               f_header_size = 0;
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -272,7 +272,7 @@ struct_description_t g_column_description[] =
     ),
     define_description( // DEFAULT <expression> (i.e. a script)
           FieldName(g_name_prinbee_fld_default_value)
-        , FieldType(struct_type_t::STRUCT_TYPE_P32STRING)
+        , FieldType(struct_type_t::STRUCT_TYPE_BUFFER32)
     ),
     define_description(
           FieldName(g_name_prinbee_fld_minimum_value)
@@ -294,6 +294,10 @@ struct_description_t g_column_description[] =
           FieldName(g_name_prinbee_fld_validation_script)
         , FieldType(struct_type_t::STRUCT_TYPE_P32STRING)
     ),
+    define_description( // COMMENT <description>
+          FieldName(g_name_prinbee_fld_description)
+        , FieldType(struct_type_t::STRUCT_TYPE_P32STRING)
+    ),
     end_descriptions()
 };
 
@@ -370,6 +374,10 @@ struct_description_t g_secondary_index_description[] =
           FieldName(g_name_prinbee_fld_name)
         , FieldType(struct_type_t::STRUCT_TYPE_P8STRING)
     ),
+    define_description(
+          FieldName(g_name_prinbee_fld_id)
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
+    ),
     define_description(
             // "distributed" -- each server only handle a partial index
             //                  (from some determined low bound to a
@@ -432,7 +440,10 @@ struct_description_t g_table_description[] =
           // For now, I removed the "temporary" flag because I do not see how
           // to implement it nor how it would be used
           //
-          FieldName("flags=logged/secure/translatable")
+          // The "index_layout" is the layout of the new `EIDX` and `TIDX`
+          // blocks of the primary, secondary, and expiration indexes
+          //
+          FieldName("flags=logged/secure/translatable/index_layout:4")
         , FieldType(struct_type_t::STRUCT_TYPE_BITS64)
     ),
     define_description(
@@ -1529,7 +1540,9 @@ void schema_column::set_description(std::string const & description)
 
 schema_sort_column::schema_sort_column(schema_table::pointer_t t)
     : f_schema_table(t)
+    , f_structure(std::make_shared<structure>(g_sort_column, structure::pointer_t(), false))
 {
+    f_structure->init_buffer();
 }
 
 
@@ -1540,7 +1553,7 @@ void schema_sort_column::from_binary(structure::pointer_t s)
     f_column_id = f_structure->get_uinteger(g_name_prinbee_fld_column_id);
     //f_flags = f_structure->get_uinteger(g_name_prinbee_fld_flags);
     f_length = f_structure->get_uinteger(g_name_prinbee_fld_length);
-    f_key_script = f_structure->get_uinteger(g_name_prinbee_fld_key_script);
+    f_key_script = f_structure->get_string(g_name_prinbee_fld_key_script);
 }
 
 
@@ -1727,7 +1740,7 @@ bool schema_sort_column::accept_null_columns() const
 
 bool schema_sort_column::place_nulls_last() const
 {
-    return f_structure->get_bits("flags.nulls") != SCHEMA_SORT_COLUMN_NULLS_LAST;
+    return f_structure->get_bits("flags.nulls") == SCHEMA_SORT_COLUMN_NULLS_LAST;
 }
 
 
@@ -1787,6 +1800,10 @@ schema_secondary_index::schema_secondary_index(schema_table::pointer_t t)
     : f_schema_table(t)
     , f_structure(std::make_shared<structure>(g_secondary_index_description))
 {
+    f_structure->init_buffer();
+
+    f_created_on = snapdev::now();
+    f_structure->set_nstime(g_name_prinbee_fld_created_on, f_created_on);
 }
 
 
@@ -1795,6 +1812,7 @@ void schema_secondary_index::from_binary(virtual_buffer::pointer_t b)
     f_structure->set_virtual_buffer(b, 0);
 
     f_name = f_structure->get_string(g_name_prinbee_fld_name);
+    f_id = static_cast<index_id_t>(f_structure->get_uinteger(g_name_prinbee_fld_id));
     //f_flags = f_structure->get_uinteger(g_name_prinbee_fld_flags);
     f_filter_script = f_structure->get_string(g_name_prinbee_fld_filter_script); // used as the sorting key if not empty
     f_description = f_structure->get_string(g_name_prinbee_fld_description);
@@ -2055,6 +2073,30 @@ void schema_secondary_index::set_name(std::string const & name)
 }
 
 
+/** \brief Retrieve the identifier of this index.
+ *
+ * The identifier is saved in the `SIDX` block of the index so the
+ * table can find the blocks of an index from its schema.
+ *
+ * \return The identifier of this index.
+ */
+index_id_t schema_secondary_index::get_id() const
+{
+    return f_id;
+}
+
+
+void schema_secondary_index::set_id(index_id_t id)
+{
+    if(f_id != id)
+    {
+        f_id = id;
+        f_structure->set_uinteger(g_name_prinbee_fld_id, id);
+        modified();
+    }
+}
+
+
 bool schema_secondary_index::get_distributed_index() const
 {
     return f_structure->get_bits("flags.distributed");
@@ -2144,9 +2186,30 @@ schema_sort_column::pointer_t schema_secondary_index::get_sort_column(int idx) c
 }
 
 
-void schema_secondary_index::add_sort_column(schema_sort_column::pointer_t)
+/** \brief Add a sort column at the end of this index.
+ *
+ * The sort column gets copied in the array of sort columns of this
+ * index and \p sc is then attached to that copy so further changes
+ * to \p sc are saved in the index.
+ *
+ * \param[in] sc  The sort column to add to this index.
+ */
+void schema_secondary_index::add_sort_column(schema_sort_column::pointer_t sc)
 {
-    throw not_yet_implemented("add_sort_column() -- need to implement that correctly...");
+    structure::pointer_t s(f_structure->new_array_item(g_name_prinbee_fld_sort_columns));
+    s->set_uinteger(g_name_prinbee_fld_column_id, sc->get_column_id());
+    s->set_bits("flags.descending", sc->is_descending() ? 1 : 0);
+    s->set_bits("flags.nulls", sc->place_nulls_last()
+                                    ? SCHEMA_SORT_COLUMN_NULLS_LAST
+                                    : (sc->accept_null_columns()
+                                            ? SCHEMA_SORT_COLUMN_NULLS_FIRST
+                                            : SCHEMA_SORT_COLUMN_WITHOUT_NULLS));
+    s->set_uinteger(g_name_prinbee_fld_length, sc->get_length());
+    s->set_string(g_name_prinbee_fld_key_script, sc->get_key_script());
+    sc->from_binary(s);
+
+    f_sort_columns.push_back(sc);
+    modified();
 }
 
 
@@ -3351,6 +3414,33 @@ void schema_table::set_translatable(bool translatable)
 }
 
 
+index_layout_t schema_table::get_index_layout() const
+{
+    return static_cast<index_layout_t>(f_structure->get_bits("flags.index_layout"));
+}
+
+
+/** \brief Define the layout of the index blocks of this table.
+ *
+ * The `EIDX` and `TIDX` blocks of the primary, secondary, and expiration
+ * indexes get created with this layout. The default is the sorted array.
+ * The Eytzinger layout makes searches faster at the cost of slower
+ * inserts, which is a good choice for tables mostly read.
+ *
+ * Changing the layout has no effect on the existing blocks.
+ *
+ * \param[in] layout  The layout of the new index blocks.
+ */
+void schema_table::set_index_layout(index_layout_t layout)
+{
+    if(get_index_layout() != layout)
+    {
+        f_structure->set_bits("flags.index_layout", static_cast<std::uint64_t>(layout));
+        modified();
+    }
+}
+
+
 column_ids_t schema_table::get_primary_key() const
 {
     return f_primary_key;
@@ -3527,6 +3617,51 @@ schema_column::pointer_t schema_table::get_expiration_date_column() const
 }
 
 
+/** \brief Add a column to this table.
+ *
+ * The new column is given the next available identifier. The other
+ * parameters of the column can be changed with the set_...() functions
+ * of the returned column.
+ *
+ * \exception defined_twice
+ * A column with the same name already exists in this table.
+ *
+ * \param[in] name  The name of the new column.
+ * \param[in] type  The type of the new column.
+ *
+ * \return The new column.
+ */
+schema_column::pointer_t schema_table::add_column(std::string const & name, struct_type_t type)
+{
+    if(f_columns_by_name.contains(name))
+    {
+        throw defined_twice(
+                  "column \""
+                + name
+                + "\" already exists in table \""
+                + f_name
+                + "\".");
+    }
+
+    column_id_t const id(f_columns_by_id.empty()
+                            ? 1
+                            : f_columns_by_id.rbegin()->first + 1);
+
+    structure::pointer_t s(f_structure->new_array_item(g_name_prinbee_fld_columns));
+    s->set_string(g_name_prinbee_fld_name, name);
+    s->set_uinteger(g_name_prinbee_fld_column_id, id);
+    s->set_uinteger(g_name_prinbee_fld_type, static_cast<int>(type));
+
+    schema_column::pointer_t column(std::make_shared<schema_column>(shared_from_this()));
+    column->from_binary(s);
+    f_columns_by_name[name] = column;
+    f_columns_by_id[id] = column;
+    modified();
+
+    return column;
+}
+
+
 schema_column::pointer_t schema_table::get_column(std::string const & name) const
 {
     auto it(f_columns_by_name.find(name));
@@ -3555,6 +3690,23 @@ schema_column::map_by_id_t schema_table::get_columns_by_id() const
 }
 
 
+/** \brief Get the largest column identifier of this table.
+ *
+ * The column identifiers are assigned in order starting at 1, so a
+ * row can save its cells in an array of that size.
+ *
+ * \return The largest column identifier or 0 if there are no columns.
+ */
+column_id_t schema_table::get_max_column_id() const
+{
+    if(f_columns_by_id.empty())
+    {
+        return 0;
+    }
+    return f_columns_by_id.rbegin()->first;
+}
+
+
 schema_column::map_by_name_t schema_table::get_columns_by_name() const
 {
     return f_columns_by_name;
@@ -3573,6 +3725,35 @@ schema_secondary_index::pointer_t schema_table::get_secondary_index(std::string
 }
 
 
+/** \brief Attach a secondary index to this table.
+ *
+ * The secondary indexes are defined separately from the table schema.
+ * Once loaded, they get attached to the table with this function so
+ * the table maintains them on each insert.
+ *
+ * \exception defined_twice
+ * An index with the same name or identifier is already attached.
+ *
+ * \param[in] index  The secondary index to attach to this table.
+ */
+void schema_table::add_secondary_index(schema_secondary_index::pointer_t index)
+{
+    if(f_secondary_indexes.contains(index->get_name())
+    || f_secondary_indexes_by_id.contains(index->get_id()))
+    {
+        throw defined_twice(
+                  "secondary index \""
+                + index->get_name()
+                + "\" already exists in table \""
+                + f_name
+                + "\".");
+    }
+
+    f_secondary_indexes[index->get_name()] = index;
+    f_secondary_indexes_by_id[index->get_id()] = index;
+}
+
+
 /** \brief Get the complete list of indexes.
  *
  * This function returns the map of all the existing indexes in this
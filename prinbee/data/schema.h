@@ -38,6 +38,7 @@
 
 // self
 //
+#include    "prinbee/data/key_search.h"
 #include    "prinbee/data/structure.h"
 
 
@@ -368,6 +369,8 @@ public:
     void                                    modified();
     std::string const &                     get_name() const;
     void                                    set_name(std::string const & name);
+    index_id_t                              get_id() const;
+    void                                    set_id(index_id_t id);
     //flag32_t                                get_flags() const;
     //void                                    set_flags(flag32_t flags);
     bool                                    get_distributed_index() const;
@@ -397,6 +400,7 @@ private:
     // cached fields
     //
     std::string                             f_name = std::string();
+    index_id_t                              f_id = index_id_t();
     std::string                             f_description = std::string();
     snapdev::timespec_ex                    f_created_on = snapdev::timespec_ex();
     snapdev::timespec_ex                    f_last_updated_on = snapdev::timespec_ex();
@@ -443,15 +447,20 @@ public:
     void                                    set_secure(bool secure);
     bool                                    is_translatable() const;
     void                                    set_translatable(bool translatable);
+    index_layout_t                          get_index_layout() const;
+    void                                    set_index_layout(index_layout_t layout);
     column_ids_t                            get_primary_key() const;
     void                                    set_primary_key(column_ids_t const & key);
     //void                                    assign_column_ids(pointer_t existing_schema = pointer_t());
     bool                                    has_expiration_date_column() const;
     schema_column::pointer_t                get_expiration_date_column() const;
+    schema_column::pointer_t                add_column(std::string const & name, struct_type_t type);
     schema_column::pointer_t                get_column(std::string const & name) const;
     schema_column::pointer_t                get_column(column_id_t id) const;
     schema_column::map_by_id_t              get_columns_by_id() const;
     schema_column::map_by_name_t            get_columns_by_name() const;
+    column_id_t                             get_max_column_id() const;
+    void                                    add_secondary_index(schema_secondary_index::pointer_t index);
     schema_secondary_index::pointer_t       get_secondary_index(std::string const & name) const;
     schema_secondary_index::map_by_name_t const &
                                             get_secondary_indexes() const;
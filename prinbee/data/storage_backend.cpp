@@ -0,0 +1,379 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Storage backend implementation.
+ *
+ * This file implements the buffer pool, the base storage backend, and
+ * the synchronous backend. The synchronous backend is used when
+ * io_uring is not available. It queues the requests like the io_uring
+ * backend, but executes them with pread() and pwrite() on submit().
+ */
+
+// self
+//
+#include    "prinbee/data/storage_backend.h"
+
+#include    "prinbee/exception.h"
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// C
+//
+#include    <string.h>
+#include    <sys/mman.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+/** \brief Allocate a pool of buffers.
+ *
+ * The pool allocates one contiguous area of memory for all its buffers.
+ * The memory is page aligned so it can be registered with the kernel
+ * as one single buffer (i.e. the io_uring backend registers it once
+ * and uses fixed buffer reads and writes).
+ *
+ * \exception invalid_parameter
+ * The buffer size and count must both be positive.
+ *
+ * \exception io_error
+ * The memory could not be allocated.
+ *
+ * \param[in] buffer_size  The size of one buffer, usually the page size.
+ * \param[in] count  The number of buffers in the pool.
+ */
+buffer_pool::buffer_pool(std::size_t buffer_size, std::size_t count)
+    : f_buffer_size(buffer_size)
+    , f_count(count)
+{
+    if(buffer_size == 0
+    || count == 0)
+    {
+        throw invalid_parameter("a buffer pool needs a buffer size and a count larger than zero.");
+    }
+
+    void * const ptr(mmap(
+              nullptr
+            , get_memory_size()
+            , PROT_READ | PROT_WRITE
+            , MAP_PRIVATE | MAP_ANONYMOUS
+            , -1
+            , 0));
+    if(ptr == MAP_FAILED)
+    {
+        int const e(errno);
+        throw io_error(
+                  "could not allocate a buffer pool of "
+                + std::to_string(get_memory_size())
+                + " bytes (errno: "
+                + std::to_string(e)
+                + ", "
+                + strerror(e)
+                + ").");
+    }
+    f_memory = reinterpret_cast<data_t>(ptr);
+
+    f_available.reserve(count);
+    for(std::size_t idx(count); idx > 0; --idx)
+    {
+        f_available.push_back(f_memory + (idx - 1) * buffer_size);
+    }
+}
+
+
+buffer_pool::~buffer_pool()
+{
+    munmap(f_memory, get_memory_size());
+}
+
+
+/** \brief Get a buffer from the pool.
+ *
+ * \exception full
+ * All the buffers of the pool are in use.
+ *
+ * \return A pointer to a buffer of get_buffer_size() bytes.
+ */
+data_t buffer_pool::acquire()
+{
+    if(f_available.empty())
+    {
+        throw full(
+                  "all the "
+                + std::to_string(f_count)
+                + " buffers of this pool are in use.");
+    }
+
+    data_t const buffer(f_available.back());
+    f_available.pop_back();
+    return buffer;
+}
+
+
+/** \brief Return a buffer to the pool.
+ *
+ * \exception logic_error
+ * The buffer is not part of this pool.
+ *
+ * \param[in] buffer  A buffer previously returned by acquire().
+ */
+void buffer_pool::release(data_t buffer)
+{
+    if(!is_buffer(buffer)
+    || (buffer - f_memory) % f_buffer_size != 0)
+    {
+        throw logic_error("buffer_pool::release() called with a buffer which is not part of this pool.");
+    }
+
+    f_available.push_back(buffer);
+}
+
+
+bool buffer_pool::is_buffer(const_data_t buffer) const
+{
+    return buffer >= f_memory
+        && buffer < f_memory + get_memory_size();
+}
+
+
+std::size_t buffer_pool::get_buffer_size() const
+{
+    return f_buffer_size;
+}
+
+
+std::size_t buffer_pool::get_count() const
+{
+    return f_count;
+}
+
+
+std::size_t buffer_pool::get_available() const
+{
+    return f_available.size();
+}
+
+
+data_t buffer_pool::get_memory() const
+{
+    return f_memory;
+}
+
+
+std::size_t buffer_pool::get_memory_size() const
+{
+    return f_buffer_size * f_count;
+}
+
+
+
+
+
+
+/** \brief Initialize a storage backend.
+ *
+ * The backend does not own the file descriptor, the dbfile does.
+ *
+ * \param[in] fd  The file descriptor of the file to read and write.
+ * \param[in] block_size  The size of one block (the page size).
+ * \param[in] buffer_count  The number of buffers in the buffer pool.
+ */
+storage_backend::storage_backend(int fd, std::size_t block_size, std::size_t buffer_count)
+    : f_fd(fd)
+    , f_block_size(block_size)
+    , f_buffer_pool(std::make_shared<buffer_pool>(block_size, buffer_count))
+{
+}
+
+
+storage_backend::~storage_backend()
+{
+}
+
+
+std::size_t storage_backend::get_block_size() const
+{
+    return f_block_size;
+}
+
+
+buffer_pool::pointer_t storage_backend::get_buffer_pool() const
+{
+    return f_buffer_pool;
+}
+
+
+/** \brief Release a buffer received in a completion callback.
+ *
+ * The buffer passed to the callback of a read_block() belongs to the
+ * caller until it calls this function.
+ *
+ * \param[in] buffer  The buffer to return to the pool.
+ */
+void storage_backend::release_buffer(data_t buffer)
+{
+    f_buffer_pool->release(buffer);
+}
+
+
+/** \brief Define a function called each time a block gets written.
+ *
+ * The dbfile uses this hook to refresh the checksum of the pages written
+ * with write_block() since those writes bypass its page cache. The hook
+ * is called with the data about to be written, before the request gets
+ * queued.
+ *
+ * \param[in] hook  The function to call or nullptr to remove the hook.
+ */
+void storage_backend::set_write_hook(write_hook_t hook)
+{
+    f_write_hook = hook;
+}
+
+
+void storage_backend::call_write_hook(reference_t offset, const_data_t data)
+{
+    if(f_write_hook != nullptr)
+    {
+        f_write_hook(offset, data);
+    }
+}
+
+
+/** \brief Wait for all the pending requests.
+ *
+ * This function submits the requests still in the queue and waits for
+ * all of them to complete.
+ */
+void storage_backend::wait_all()
+{
+    submit();
+    while(get_pending() > 0)
+    {
+        wait(get_pending());
+    }
+}
+
+
+
+
+
+
+sync_backend::sync_backend(int fd, std::size_t block_size, std::size_t buffer_count)
+    : storage_backend(fd, block_size, buffer_count)
+{
+}
+
+
+backend_t sync_backend::get_type() const
+{
+    return backend_t::BACKEND_SYNC;
+}
+
+
+void sync_backend::read_block(reference_t offset, completion_t callback)
+{
+    request_t r;
+    r.f_offset = offset;
+    r.f_buffer = f_buffer_pool->acquire();
+    r.f_callback = callback;
+    f_queue.push_back(r);
+}
+
+
+void sync_backend::write_block(reference_t offset, const_data_t data, completion_t callback)
+{
+    call_write_hook(offset, data);
+
+    request_t r;
+    r.f_write = true;
+    r.f_offset = offset;
+    r.f_data = data;
+    r.f_callback = callback;
+    f_queue.push_back(r);
+}
+
+
+/** \brief Execute the queued requests.
+ *
+ * The synchronous backend executes all the requests on submit(). The
+ * callbacks are only called from wait() like with the asynchronous
+ * backend.
+ *
+ * \return The number of requests that were executed.
+ */
+std::size_t sync_backend::submit()
+{
+    std::size_t const count(f_queue.size());
+    for(auto & r : f_queue)
+    {
+        ssize_t const result(r.f_write
+                    ? pwrite(f_fd, r.f_data, f_block_size, r.f_offset)
+                    : pread(f_fd, r.f_buffer, f_block_size, r.f_offset));
+        r.f_result = result < 0 ? -errno : static_cast<int>(result);
+        f_completed.push_back(r);
+    }
+    f_queue.clear();
+    return count;
+}
+
+
+std::size_t sync_backend::wait(std::size_t min_complete)
+{
+    if(f_completed.size() < min_complete)
+    {
+        submit();
+    }
+
+    std::vector<request_t> completed;
+    completed.swap(f_completed);
+    for(auto const & r : completed)
+    {
+        if(r.f_callback != nullptr)
+        {
+            r.f_callback(r.f_result, r.f_buffer);
+        }
+    }
+    return completed.size();
+}
+
+
+std::size_t sync_backend::get_pending() const
+{
+    return f_queue.size() + f_completed.size();
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,161 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Storage backends used for explicit block I/O.
+ *
+ * The dbfile gives direct access to its pages through mmap(). A page
+ * which is not yet in memory generates a major fault and the thread
+ * accessing it stalls until the kernel has read it. The storage backends
+ * offer an explicit, asynchronous way of reading and writing blocks so
+ * a scan or a multi-get can have many reads in flight at once.
+ *
+ * The blocks are read in buffers managed by a buffer_pool. The requests
+ * are queued, sent to the kernel in batches with submit(), and the
+ * completion callbacks get called from wait().
+ */
+
+// C++
+//
+#include    <cstdint>
+#include    <functional>
+#include    <memory>
+#include    <vector>
+
+
+
+namespace prinbee
+{
+
+
+
+typedef std::uint64_t               reference_t;
+typedef std::uint8_t *              data_t;
+typedef std::uint8_t const *        const_data_t;
+
+
+constexpr std::size_t               DEFAULT_BUFFER_POOL_SIZE = 64;
+
+
+enum class backend_t
+{
+    BACKEND_SYNC,
+    BACKEND_IO_URING,
+};
+
+
+class buffer_pool
+{
+public:
+    typedef std::shared_ptr<buffer_pool>    pointer_t;
+
+                                buffer_pool(std::size_t buffer_size, std::size_t count);
+                                buffer_pool(buffer_pool const & rhs) = delete;
+                                ~buffer_pool();
+
+    buffer_pool &               operator = (buffer_pool const & rhs) = delete;
+
+    data_t                      acquire();
+    void                        release(data_t buffer);
+    bool                        is_buffer(const_data_t buffer) const;
+    std::size_t                 get_buffer_size() const;
+    std::size_t                 get_count() const;
+    std::size_t                 get_available() const;
+    data_t                      get_memory() const;
+    std::size_t                 get_memory_size() const;
+
+private:
+    std::size_t                 f_buffer_size = 0;
+    std::size_t                 f_count = 0;
+    data_t                      f_memory = nullptr;
+    std::vector<data_t>         f_available = std::vector<data_t>();
+};
+
+
+class storage_backend
+{
+public:
+    typedef std::shared_ptr<storage_backend>    pointer_t;
+    typedef std::function<void(int result, data_t buffer)>
+                                                completion_t;
+    typedef std::function<void(reference_t offset, const_data_t data)>
+                                                write_hook_t;
+
+                                storage_backend(int fd, std::size_t block_size, std::size_t buffer_count);
+                                storage_backend(storage_backend const & rhs) = delete;
+    virtual                     ~storage_backend();
+
+    storage_backend &           operator = (storage_backend const & rhs) = delete;
+
+    virtual backend_t           get_type() const = 0;
+    std::size_t                 get_block_size() const;
+    buffer_pool::pointer_t      get_buffer_pool() const;
+    void                        release_buffer(data_t buffer);
+    void                        set_write_hook(write_hook_t hook);
+
+    virtual void                read_block(reference_t offset, completion_t callback) = 0;
+    virtual void                write_block(reference_t offset, const_data_t data, completion_t callback) = 0;
+    virtual std::size_t         submit() = 0;
+    virtual std::size_t         wait(std::size_t min_complete = 1) = 0;
+    virtual std::size_t         get_pending() const = 0;
+    void                        wait_all();
+
+protected:
+    void                        call_write_hook(reference_t offset, const_data_t data);
+
+    int                         f_fd = -1;
+    std::size_t                 f_block_size = 0;
+    buffer_pool::pointer_t      f_buffer_pool = buffer_pool::pointer_t();
+    write_hook_t                f_write_hook = write_hook_t();
+};
+
+
+class sync_backend
+    : public storage_backend
+{
+public:
+                                sync_backend(int fd, std::size_t block_size, std::size_t buffer_count);
+
+    virtual backend_t           get_type() const override;
+    virtual void                read_block(reference_t offset, completion_t callback) override;
+    virtual void                write_block(reference_t offset, const_data_t data, completion_t callback) override;
+    virtual std::size_t         submit() override;
+    virtual std::size_t         wait(std::size_t min_complete = 1) override;
+    virtual std::size_t         get_pending() const override;
+
+private:
+    struct request_t
+    {
+        bool                    f_write = false;
+        reference_t             f_offset = 0;
+        data_t                  f_buffer = nullptr;
+        const_data_t            f_data = nullptr;
+        completion_t            f_callback = completion_t();
+        int                     f_result = 0;
+    };
+
+    std::vector<request_t>      f_queue = std::vector<request_t>();
+    std::vector<request_t>      f_completed = std::vector<request_t>();
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -66,7 +66,7 @@ virtual_buffer::vbuf_t::vbuf_t()
 
 
 virtual_buffer::vbuf_t::vbuf_t(block::pointer_t b, std::uint64_t offset, std::uint64_t size)
-    : f_block(b)
+    : f_page(b->get_page())
     , f_offset(offset)
     , f_size(size)
 {
@@ -270,9 +270,9 @@ int virtual_buffer::pread(void * buf, std::uint64_t size, std::uint64_t offset,
             {
                 sz = b.f_size - offset;
             }
-            if(b.f_block != nullptr)
+            if(b.f_page)
             {
-                memcpy(buf, b.f_block->data() + b.f_offset + offset, sz);
+                memcpy(buf, b.f_page.data() + b.f_offset + offset, sz);
             }
             else
             {
@@ -340,9 +340,9 @@ int virtual_buffer::pwrite(void const * buf, std::uint64_t size, std::uint64_t o
             {
                 sz = b.f_size - offset;
             }
-            if(b.f_block != nullptr)
+            if(b.f_page)
             {
-                memcpy(b.f_block->data() + offset, in, sz);
+                memcpy(b.f_page.data() + b.f_offset + offset, in, sz);
             }
             else
             {
@@ -372,7 +372,7 @@ int virtual_buffer::pwrite(void const * buf, std::uint64_t size, std::uint64_t o
     }
 
     if(!f_buffers.empty()
-    && f_buffers.back().f_block == nullptr)
+    && !f_buffers.back().f_page)
     {
         std::uint64_t const available(f_buffers.back().f_data.capacity() - f_buffers.back().f_size);
         if(available > 0)
@@ -455,13 +455,13 @@ int virtual_buffer::pinsert(void const * buf, std::uint64_t size, std::uint64_t
         }
         else
         {
-            if(b->f_block != nullptr)
+            if(b->f_page)
             {
                 // if inserting within a block, we have to break the block
                 // in two
                 {
                     vbuf_t append;
-                    append.f_block = b->f_block;
+                    append.f_page = b->f_page;
                     append.f_size = b->f_size - offset;
                     append.f_offset = b->f_offset + offset;
                     f_buffers.insert(b + 1, append);
@@ -492,7 +492,7 @@ int virtual_buffer::pinsert(void const * buf, std::uint64_t size, std::uint64_t
         // append at the end
         //
         if(!f_buffers.empty()
-        && f_buffers.back().f_block == nullptr)
+        && !f_buffers.back().f_page)
         {
             f_buffers.back().f_data.insert(f_buffers.back().f_data.end(), in, in + size);
         }
@@ -587,7 +587,7 @@ SNAP_LOG_ERROR << "--- perase CASE 6 -- delete end of data" << SNAP_LOG_SEND;
                 {
                     // remove the start of this block
                     //
-                    if(it->f_block != nullptr)
+                    if(it->f_page)
                     {
 SNAP_LOG_ERROR << "--- perase CASE 7 -- block involved?!?" << SNAP_LOG_SEND;
                         it->f_offset += size;
@@ -607,7 +607,7 @@ SNAP_LOG_ERROR << "--- perase CASE 8 -- delete start of data size=" << size << "
                 {
                     // remove data from the middle of the block
                     //
-                    if(it->f_block != nullptr)
+                    if(it->f_page)
                     {
                         if(offset + size >= it->f_size)
                         {
@@ -619,7 +619,7 @@ SNAP_LOG_ERROR << "--- perase CASE 9 -- block involved?!?" << SNAP_LOG_SEND;
                         {
 SNAP_LOG_ERROR << "--- perase CASE 10 -- block involved?!?" << SNAP_LOG_SEND;
                             vbuf_t append;
-                            append.f_block = it->f_block;
+                            append.f_page = it->f_page;
                             append.f_size = it->f_size - size - offset;
                             append.f_offset = it->f_offset + size + offset;
                             f_buffers.insert(it, append);
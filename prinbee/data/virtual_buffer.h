@@ -92,7 +92,7 @@ private:
                                             vbuf_t();
                                             vbuf_t(block::pointer_t b, std::uint64_t offset, std::uint64_t size);
 
-        block::pointer_t                    f_block = block::pointer_t();
+        page_ref                            f_page = page_ref();    // the page of the block, keeps it pinned
         buffer_t                            f_data = buffer_t();    // data not (yet) in the block(s)
         std::uint64_t                       f_offset = 0;
         std::uint64_t                       f_size = 0;
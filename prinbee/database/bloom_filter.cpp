@@ -0,0 +1,324 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Blocked Bloom filter implementation.
+ *
+ * The number of blocks is always a power of two so the block of a key
+ * is found with a mask. The filter is sized for
+ * DEFAULT_BLOOM_FILTER_BITS_PER_KEY bits per expected key which, with
+ * DEFAULT_BLOOM_FILTER_HASH_COUNT bits per key, gives about 1% of false
+ * positives once the filter is full.
+ *
+ * The saved format is a small header followed by the blocks:
+ *
+ * \code
+ *     uint32_t    magic           // 'BLMF'
+ *     uint32_t    version         // BLOOM_FILTER_FORMAT_VERSION
+ *     uint32_t    hash_count
+ *     uint32_t    reserved
+ *     uint64_t    block_count
+ *     uint64_t    key_count
+ *     uint64_t    deleted_count
+ *     uint64_t    bits[block_count * 8]
+ * \endcode
+ */
+
+// self
+//
+#include    "prinbee/database/bloom_filter.h"
+
+#include    "prinbee/exception.h"
+#include    "prinbee/data/dbtype.h"
+#include    "prinbee/data/structure.h"
+#include    "prinbee/database/cell.h"
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+namespace
+{
+
+
+
+constexpr std::size_t const     WORDS_PER_BLOCK = BLOOM_FILTER_BLOCK_SIZE / sizeof(std::uint64_t);
+
+
+struct bloom_filter_header_t
+{
+    dbtype_t                    f_magic = dbtype_t::FILE_TYPE_BLOOM_FILTER;
+    std::uint32_t               f_version = 0;
+    std::uint32_t               f_hash_count = 0;
+    std::uint32_t               f_reserved = 0;
+    std::uint64_t               f_block_count = 0;
+    std::uint64_t               f_key_count = 0;
+    std::uint64_t               f_deleted_count = 0;
+};
+
+
+/** \brief Version of the saved filter.
+ *
+ * Version 0.1 was the empty `BLMF` structure which was never saved.
+ */
+version_t const                 BLOOM_FILTER_FORMAT_VERSION(0, 2);
+
+
+
+} // no name namespace
+
+
+
+/** \brief Create a filter for \p expected_keys keys.
+ *
+ * \param[in] expected_keys  The number of keys the filter is expected to
+ * hold.
+ */
+bloom_filter::bloom_filter(std::size_t expected_keys)
+{
+    reset(expected_keys);
+}
+
+
+/** \brief Clear the filter and resize it.
+ *
+ * The number of blocks is calculated so the filter offers
+ * DEFAULT_BLOOM_FILTER_BITS_PER_KEY bits per key for \p expected_keys keys
+ * and gets rounded up to a power of two.
+ *
+ * \param[in] expected_keys  The number of keys the filter is expected to
+ * hold.
+ */
+void bloom_filter::reset(std::size_t expected_keys)
+{
+    std::size_t const bits(expected_keys * DEFAULT_BLOOM_FILTER_BITS_PER_KEY);
+    std::size_t count(MIN_BLOOM_FILTER_BLOCK_COUNT);
+    while(count * BLOOM_FILTER_BLOCK_BITS < bits)
+    {
+        count *= 2;
+    }
+
+    f_bits.clear();
+    f_bits.resize(count * WORDS_PER_BLOCK);
+    f_block_mask = count - 1;
+    f_key_count = 0;
+    f_deleted_count = 0;
+}
+
+
+std::size_t bloom_filter::get_block_count() const
+{
+    return f_block_mask + 1;
+}
+
+
+/** \brief Number of keys the filter can hold.
+ *
+ * Once more keys are added, the rate of false positives goes up and the
+ * filter should be rebuilt with a larger size.
+ *
+ * \return The number of keys this filter was sized for.
+ */
+std::size_t bloom_filter::get_capacity() const
+{
+    return get_block_count() * BLOOM_FILTER_BLOCK_BITS / DEFAULT_BLOOM_FILTER_BITS_PER_KEY;
+}
+
+
+std::size_t bloom_filter::get_key_count() const
+{
+    return f_key_count;
+}
+
+
+/** \brief Number of keys deleted since the filter was built.
+ *
+ * The deleted keys are still set in the filter. When this number gets
+ * large compared to the number of keys, the filter should be rebuilt.
+ *
+ * \return The number of deleted keys.
+ */
+std::size_t bloom_filter::get_deleted_count() const
+{
+    return f_deleted_count;
+}
+
+
+std::uint32_t bloom_filter::get_hash_count() const
+{
+    return f_hash_count;
+}
+
+
+/** \brief Add a murmur3 key to the filter.
+ *
+ * \param[in] key  The 128 bit murmur3 key of the row.
+ */
+void bloom_filter::add(buffer_t const & key)
+{
+    std::uint64_t hash(0);
+    std::uint64_t step(0);
+    std::uint64_t * block(f_bits.data() + get_block(key, hash, step));
+    for(std::uint32_t idx(0); idx < f_hash_count; ++idx, hash += step)
+    {
+        std::size_t const bit(hash % BLOOM_FILTER_BLOCK_BITS);
+        block[bit / 64] |= 1ULL << (bit % 64);
+    }
+    ++f_key_count;
+}
+
+
+/** \brief Check whether a key may be in the filter.
+ *
+ * \param[in] key  The 128 bit murmur3 key of the row.
+ *
+ * \return false if the key was definitely never added.
+ */
+bool bloom_filter::may_contain(buffer_t const & key) const
+{
+    std::uint64_t hash(0);
+    std::uint64_t step(0);
+    std::uint64_t const * block(f_bits.data() + get_block(key, hash, step));
+    for(std::uint32_t idx(0); idx < f_hash_count; ++idx, hash += step)
+    {
+        std::size_t const bit(hash % BLOOM_FILTER_BLOCK_BITS);
+        if((block[bit / 64] & (1ULL << (bit % 64))) == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** \brief Count a deleted key.
+ *
+ * The bits of a key cannot be cleared since other keys may share them.
+ * This function only counts the deletion so the table knows when to
+ * rebuild the filter.
+ */
+void bloom_filter::mark_deleted()
+{
+    ++f_deleted_count;
+}
+
+
+/** \brief Save the filter in a buffer.
+ *
+ * \return A virtual buffer with the header and the bits of the filter.
+ */
+virtual_buffer::pointer_t bloom_filter::to_binary() const
+{
+    bloom_filter_header_t header;
+    header.f_version = BLOOM_FILTER_FORMAT_VERSION.to_binary();
+    header.f_hash_count = f_hash_count;
+    header.f_block_count = get_block_count();
+    header.f_key_count = f_key_count;
+    header.f_deleted_count = f_deleted_count;
+
+    virtual_buffer::pointer_t b(std::make_shared<virtual_buffer>());
+    b->pwrite(&header, sizeof(header), 0, true);
+    b->pwrite(f_bits.data(), f_bits.size() * sizeof(std::uint64_t), sizeof(header), true);
+    return b;
+}
+
+
+/** \brief Load a filter saved by to_binary().
+ *
+ * If the buffer does not hold a valid filter, the filter is left
+ * unchanged and the function returns false. The caller is expected to
+ * rebuild the filter in that case.
+ *
+ * \param[in] b  The buffer to load.
+ *
+ * \return true if the filter was loaded.
+ */
+bool bloom_filter::from_binary(virtual_buffer::pointer_t b)
+{
+    bloom_filter_header_t header;
+    if(b->size() < sizeof(header)
+    || b->pread(&header, sizeof(header), 0) != sizeof(header)
+    || header.f_magic != dbtype_t::FILE_TYPE_BLOOM_FILTER
+    || header.f_version != BLOOM_FILTER_FORMAT_VERSION.to_binary()
+    || header.f_hash_count == 0
+    || header.f_block_count < MIN_BLOOM_FILTER_BLOCK_COUNT
+    || (header.f_block_count & (header.f_block_count - 1)) != 0
+    || b->size() != sizeof(header) + header.f_block_count * BLOOM_FILTER_BLOCK_SIZE)
+    {
+        return false;
+    }
+
+    bits_t bits(header.f_block_count * WORDS_PER_BLOCK);
+    if(b->pread(bits.data(), bits.size() * sizeof(std::uint64_t), sizeof(header)) != static_cast<int>(bits.size() * sizeof(std::uint64_t)))
+    {
+        return false;
+    }
+
+    f_bits.swap(bits);
+    f_block_mask = header.f_block_count - 1;
+    f_key_count = header.f_key_count;
+    f_deleted_count = header.f_deleted_count;
+    f_hash_count = header.f_hash_count;
+    return true;
+}
+
+
+/** \brief Find the block of a key.
+ *
+ * \exception invalid_parameter
+ * The key must be a 128 bit murmur3 key.
+ *
+ * \param[in] key  The murmur3 key.
+ * \param[out] hash  The position of the first bit.
+ * \param[out] step  The distance between two bits.
+ *
+ * \return The index of the first word of the block in f_bits.
+ */
+std::size_t bloom_filter::get_block(buffer_t const & key, std::uint64_t & hash, std::uint64_t & step) const
+{
+    if(key.size() < 16)
+    {
+        throw invalid_parameter(
+                  "a bloom filter key must be a 128 bit murmur3 key, got "
+                + std::to_string(key.size())
+                + " bytes.");
+    }
+
+    std::size_t pos(0);
+    std::uint64_t const h1(read_be_uint64(key, pos));
+    hash = read_be_uint64(key, pos);
+
+    // the step must be odd so the bits do not cycle early
+    //
+    step = (h1 >> 32) | 1;
+    return (h1 & f_block_mask) * WORDS_PER_BLOCK;
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,101 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Blocked Bloom filter of the primary keys of a table.
+ *
+ * The filter tells whether a primary key may exist in the table. When it
+ * says no, the key is definitely not in the table and the walk through
+ * the `PIDX`, `TIDX`, and `EIDX` blocks can be avoided.
+ *
+ * The filter is divided in blocks of one cache line (64 bytes). All the
+ * bits of one key are set in the same block, so a lookup touches a single
+ * cache line. The bits are derived from the 128 bit murmur3 key of the
+ * row using double hashing: the first 64 bits select the block and give
+ * the step, the last 64 bits give the first bit.
+ *
+ * Bits cannot be removed, so deleted rows leave false positives behind
+ * until the filter gets rebuilt.
+ *
+ * The filter is not thread safe. The table lets many threads call
+ * may_contain() at once but modifies the filter only while it holds
+ * its lock in exclusive mode.
+ */
+
+// self
+//
+#include    "prinbee/data/virtual_buffer.h"
+
+
+// C++
+//
+#include    <vector>
+
+
+
+namespace prinbee
+{
+
+
+
+constexpr std::size_t               BLOOM_FILTER_BLOCK_SIZE = 64;                       // one cache line, in bytes
+constexpr std::size_t               BLOOM_FILTER_BLOCK_BITS = BLOOM_FILTER_BLOCK_SIZE * 8;
+constexpr std::size_t               DEFAULT_BLOOM_FILTER_BITS_PER_KEY = 10;
+constexpr std::uint32_t             DEFAULT_BLOOM_FILTER_HASH_COUNT = 7;
+constexpr std::size_t               MIN_BLOOM_FILTER_BLOCK_COUNT = 64;
+
+
+class bloom_filter
+{
+public:
+    typedef std::shared_ptr<bloom_filter>   pointer_t;
+
+                                bloom_filter(std::size_t expected_keys = 0);
+
+    void                        reset(std::size_t expected_keys);
+    std::size_t                 get_block_count() const;
+    std::size_t                 get_capacity() const;
+    std::size_t                 get_key_count() const;
+    std::size_t                 get_deleted_count() const;
+    std::uint32_t               get_hash_count() const;
+
+    void                        add(buffer_t const & key);
+    bool                        may_contain(buffer_t const & key) const;
+    void                        mark_deleted();
+
+    virtual_buffer::pointer_t   to_binary() const;
+    bool                        from_binary(virtual_buffer::pointer_t b);
+
+private:
+    typedef std::vector<std::uint64_t>      bits_t;
+
+    std::size_t                 get_block(buffer_t const & key, std::uint64_t & hash, std::uint64_t & step) const;
+
+    bits_t                      f_bits = bits_t();
+    std::size_t                 f_block_mask = 0;
+    std::size_t                 f_key_count = 0;
+    std::size_t                 f_deleted_count = 0;
+    std::uint32_t               f_hash_count = DEFAULT_BLOOM_FILTER_HASH_COUNT;
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -37,6 +37,14 @@
 #include    "snapdev/not_reached.h"
 
 
+// C++
+//
+#include    <cassert>
+#include    <cstring>
+#include    <iterator>
+#include    <limits>
+
+
 // last include
 //
 #include    <snapdev/poison.h>
@@ -48,7 +56,7 @@ namespace prinbee
 
 
 
-std::uint8_t read_uint8(buffer_t const & buffer, size_t & pos)
+std::uint8_t read_uint8(std::uint8_t const * buffer, size_t & pos)
 {
     pos += sizeof(std::uint8_t);
 
@@ -56,7 +64,7 @@ std::uint8_t read_uint8(buffer_t const & buffer, size_t & pos)
 }
 
 
-std::uint16_t read_be_uint16(buffer_t const & buffer, size_t & pos)
+std::uint16_t read_be_uint16(std::uint8_t const * buffer, size_t & pos)
 {
     pos += sizeof(std::uint16_t);
 
@@ -65,7 +73,7 @@ std::uint16_t read_be_uint16(buffer_t const & buffer, size_t & pos)
 }
 
 
-std::uint32_t read_be_uint32(buffer_t const & buffer, size_t & pos)
+std::uint32_t read_be_uint32(std::uint8_t const * buffer, size_t & pos)
 {
     pos += sizeof(std::uint32_t);
 
@@ -76,7 +84,7 @@ std::uint32_t read_be_uint32(buffer_t const & buffer, size_t & pos)
 }
 
 
-std::uint64_t read_be_uint64(buffer_t const & buffer, size_t & pos)
+std::uint64_t read_be_uint64(std::uint8_t const * buffer, size_t & pos)
 {
     pos += sizeof(std::uint64_t);
 
@@ -91,6 +99,30 @@ std::uint64_t read_be_uint64(buffer_t const & buffer, size_t & pos)
 }
 
 
+std::uint8_t read_uint8(buffer_t const & buffer, size_t & pos)
+{
+    return read_uint8(buffer.data(), pos);
+}
+
+
+std::uint16_t read_be_uint16(buffer_t const & buffer, size_t & pos)
+{
+    return read_be_uint16(buffer.data(), pos);
+}
+
+
+std::uint32_t read_be_uint32(buffer_t const & buffer, size_t & pos)
+{
+    return read_be_uint32(buffer.data(), pos);
+}
+
+
+std::uint64_t read_be_uint64(buffer_t const & buffer, size_t & pos)
+{
+    return read_be_uint64(buffer.data(), pos);
+}
+
+
 void push_uint8(buffer_t & buffer, std::uint8_t value)
 {
     buffer.push_back(value);
@@ -129,12 +161,108 @@ void push_be_uint64(buffer_t & buffer, std::uint64_t value)
 
 
 
+namespace
+{
+
+
+
+static_assert(sizeof(long double) <= 16, "a long double must fit in the inline value of a cell");
+
+
+/** \brief Check whether a type requires an integer larger than 64 bits.
+ *
+ * Only those integers get allocated; all the other integers are saved
+ * inline in the cell.
+ *
+ * \param[in] type  The type of the column.
+ *
+ * \return true if the integer requires 128 to 512 bits.
+ */
+bool is_big_integer(struct_type_t type)
+{
+    switch(type)
+    {
+    case struct_type_t::STRUCT_TYPE_BITS128:
+    case struct_type_t::STRUCT_TYPE_BITS256:
+    case struct_type_t::STRUCT_TYPE_BITS512:
+    case struct_type_t::STRUCT_TYPE_INT128:
+    case struct_type_t::STRUCT_TYPE_UINT128:
+    case struct_type_t::STRUCT_TYPE_INT256:
+    case struct_type_t::STRUCT_TYPE_UINT256:
+    case struct_type_t::STRUCT_TYPE_INT512:
+    case struct_type_t::STRUCT_TYPE_UINT512:
+    case struct_type_t::STRUCT_TYPE_NSTIME:
+        return true;
+
+    default:
+        return false;
+
+    }
+}
+
+
+/** \brief Check whether a small integer gets sign extended.
+ *
+ * \param[in] type  The type of the column.
+ *
+ * \return true if the type is a signed integer of up to 64 bits.
+ */
+bool is_signed_integer(struct_type_t type)
+{
+    switch(type)
+    {
+    case struct_type_t::STRUCT_TYPE_INT8:
+    case struct_type_t::STRUCT_TYPE_INT16:
+    case struct_type_t::STRUCT_TYPE_INT32:
+    case struct_type_t::STRUCT_TYPE_INT64:
+    case struct_type_t::STRUCT_TYPE_TIME:
+    case struct_type_t::STRUCT_TYPE_MSTIME:
+    case struct_type_t::STRUCT_TYPE_USTIME:
+        return true;
+
+    default:
+        return false;
+
+    }
+}
+
+
+
+}
+// no name namespace
+
+
+
 cell::cell(schema_column::pointer_t c)
     : f_schema_column(c)
 {
 }
 
 
+cell::cell(cell const & rhs)
+    : f_schema_column(rhs.f_schema_column)
+{
+    copy_value(rhs);
+}
+
+
+cell::~cell()
+{
+    clear_value();
+}
+
+
+cell & cell::operator = (cell const & rhs)
+{
+    if(this != &rhs)
+    {
+        f_schema_column = rhs.f_schema_column;
+        copy_value(rhs);
+    }
+    return *this;
+}
+
+
 schema_column::pointer_t cell::schema() const
 {
     return f_schema_column;
@@ -173,7 +301,7 @@ oid_t cell::get_oid() const
               struct_type_t::STRUCT_TYPE_OID
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -193,7 +321,7 @@ std::int8_t cell::get_int8() const
               struct_type_t::STRUCT_TYPE_INT8
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -214,7 +342,7 @@ std::uint8_t cell::get_uint8() const
             , struct_type_t::STRUCT_TYPE_UINT8
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -235,7 +363,7 @@ std::int16_t cell::get_int16() const
               struct_type_t::STRUCT_TYPE_INT16
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -256,7 +384,7 @@ std::uint16_t cell::get_uint16() const
             , struct_type_t::STRUCT_TYPE_UINT16
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -277,7 +405,7 @@ std::int32_t cell::get_int32() const
               struct_type_t::STRUCT_TYPE_INT32
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -298,7 +426,7 @@ std::uint32_t cell::get_uint32() const
             , struct_type_t::STRUCT_TYPE_UINT32
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -319,7 +447,7 @@ std::int64_t cell::get_int64() const
               struct_type_t::STRUCT_TYPE_INT64
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -340,7 +468,7 @@ std::uint64_t cell::get_uint64() const
             , struct_type_t::STRUCT_TYPE_UINT64
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -361,7 +489,7 @@ int512_t cell::get_int128() const
               struct_type_t::STRUCT_TYPE_INT128
         });
 
-    return f_integer;
+    return get_big_integer();
 }
 
 
@@ -371,7 +499,7 @@ void cell::set_int128(int512_t value)
               struct_type_t::STRUCT_TYPE_INT128
         });
 
-    f_integer = value;
+    set_big_integer(value);
 }
 
 
@@ -381,7 +509,7 @@ uint512_t cell::get_uint128() const
               struct_type_t::STRUCT_TYPE_UINT128
         });
 
-    return f_integer;
+    return get_big_integer();
 }
 
 
@@ -391,7 +519,7 @@ void cell::set_uint128(uint512_t value)
               struct_type_t::STRUCT_TYPE_UINT128
         });
 
-    f_integer = value;
+    set_big_integer(value);
 }
 
 
@@ -401,7 +529,7 @@ int512_t cell::get_int256() const
               struct_type_t::STRUCT_TYPE_INT256
         });
 
-    return f_integer;
+    return get_big_integer();
 }
 
 
@@ -411,7 +539,7 @@ void cell::set_int256(int512_t value)
               struct_type_t::STRUCT_TYPE_INT256
         });
 
-    f_integer = value;
+    set_big_integer(value);
 }
 
 
@@ -421,7 +549,7 @@ uint512_t cell::get_uint256() const
               struct_type_t::STRUCT_TYPE_UINT256
         });
 
-    return f_integer;
+    return get_big_integer();
 }
 
 
@@ -431,7 +559,7 @@ void cell::set_uint256(uint512_t value)
               struct_type_t::STRUCT_TYPE_UINT256
         });
 
-    f_integer = value;
+    set_big_integer(value);
 }
 
 
@@ -441,7 +569,7 @@ int512_t cell::get_int512() const
               struct_type_t::STRUCT_TYPE_INT512
         });
 
-    return f_integer;
+    return get_big_integer();
 }
 
 
@@ -451,7 +579,7 @@ void cell::set_int512(int512_t value)
               struct_type_t::STRUCT_TYPE_INT512
         });
 
-    f_integer = value;
+    set_big_integer(value);
 }
 
 
@@ -461,7 +589,7 @@ uint512_t cell::get_uint512() const
               struct_type_t::STRUCT_TYPE_UINT512
         });
 
-    return f_integer;
+    return get_big_integer();
 }
 
 
@@ -471,7 +599,7 @@ void cell::set_uint512(uint512_t value)
               struct_type_t::STRUCT_TYPE_UINT512
         });
 
-    f_integer = value;
+    set_big_integer(value);
 }
 
 
@@ -481,7 +609,7 @@ std::uint64_t cell::get_time() const
               struct_type_t::STRUCT_TYPE_TIME
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -501,7 +629,7 @@ std::uint64_t cell::get_time_ms() const
               struct_type_t::STRUCT_TYPE_MSTIME
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -521,7 +649,7 @@ std::uint64_t cell::get_time_us() const
               struct_type_t::STRUCT_TYPE_USTIME
         });
 
-    return f_integer.f_value[0];
+    return get_uinteger();
 }
 
 
@@ -553,7 +681,7 @@ float cell::get_float32() const
               struct_type_t::STRUCT_TYPE_FLOAT32
         });
 
-    return f_float_value;
+    return get_float_value();
 }
 
 
@@ -563,7 +691,7 @@ void cell::set_float32(float value)
               struct_type_t::STRUCT_TYPE_FLOAT32
         });
 
-    f_float_value = value;
+    set_float_value(value);
 }
 
 
@@ -573,7 +701,7 @@ double cell::get_float64() const
               struct_type_t::STRUCT_TYPE_FLOAT64
         });
 
-    return f_float_value;
+    return get_float_value();
 }
 
 
@@ -583,7 +711,7 @@ void cell::set_float64(double value)
               struct_type_t::STRUCT_TYPE_FLOAT64
         });
 
-    f_float_value = value;
+    set_float_value(value);
 }
 
 
@@ -593,7 +721,7 @@ long double cell::get_float128() const
               struct_type_t::STRUCT_TYPE_FLOAT128
         });
 
-    return f_float_value;
+    return get_float_value();
 }
 
 
@@ -603,7 +731,7 @@ void cell::set_float128(long double value)
               struct_type_t::STRUCT_TYPE_FLOAT128
         });
 
-    f_float_value = value;
+    set_float_value(value);
 }
 
 
@@ -613,7 +741,7 @@ version_t cell::get_version() const
               struct_type_t::STRUCT_TYPE_VERSION
         });
 
-    return version_t(f_integer.f_value[0]);
+    return version_t(get_uinteger());
 }
 
 
@@ -635,7 +763,7 @@ std::string cell::get_string() const
             , struct_type_t::STRUCT_TYPE_P32STRING
         });
 
-    return f_string;
+    return std::string(get_string_data(), f_length);
 }
 
 
@@ -647,7 +775,7 @@ void cell::set_string(std::string const & value)
             , struct_type_t::STRUCT_TYPE_P32STRING
         });
 
-    f_string = value;
+    set_string_value(value.data(), value.length());
 }
 
 
@@ -663,6 +791,12 @@ void cell::column_id_to_binary(buffer_t & buffer) const
 
 
 column_id_t cell::column_id_from_binary(buffer_t const & buffer, size_t & pos)
+{
+    return column_id_from_binary(buffer.data(), pos);
+}
+
+
+column_id_t cell::column_id_from_binary(std::uint8_t const * buffer, size_t & pos)
 {
     return static_cast<column_id_t>(read_be_uint16(buffer, pos));
 }
@@ -679,20 +813,20 @@ void cell::value_to_binary(buffer_t & buffer) const
     case struct_type_t::STRUCT_TYPE_BITS8:
     case struct_type_t::STRUCT_TYPE_UINT8:
     case struct_type_t::STRUCT_TYPE_INT8:
-        push_uint8(buffer, f_integer.f_value[0]);
+        push_uint8(buffer, get_uinteger());
         break;
 
     case struct_type_t::STRUCT_TYPE_BITS16:
     case struct_type_t::STRUCT_TYPE_UINT16:
     case struct_type_t::STRUCT_TYPE_INT16:
-        push_be_uint16(buffer, f_integer.f_value[0]);
+        push_be_uint16(buffer, get_uinteger());
         break;
 
     case struct_type_t::STRUCT_TYPE_BITS32:
     case struct_type_t::STRUCT_TYPE_UINT32:
     case struct_type_t::STRUCT_TYPE_VERSION:
     case struct_type_t::STRUCT_TYPE_INT32:
-        push_be_uint32(buffer, f_integer.f_value[0]);
+        push_be_uint32(buffer, get_uinteger());
         break;
 
     case struct_type_t::STRUCT_TYPE_BITS64:
@@ -703,37 +837,46 @@ void cell::value_to_binary(buffer_t & buffer) const
     case struct_type_t::STRUCT_TYPE_MSTIME:
     case struct_type_t::STRUCT_TYPE_USTIME:
     case struct_type_t::STRUCT_TYPE_INT64:
-        push_be_uint64(buffer, f_integer.f_value[0]);
+        push_be_uint64(buffer, get_uinteger());
         break;
 
     case struct_type_t::STRUCT_TYPE_BITS128:
     case struct_type_t::STRUCT_TYPE_NSTIME:
     case struct_type_t::STRUCT_TYPE_UINT128:
     case struct_type_t::STRUCT_TYPE_INT128:
-        push_be_uint64(buffer, f_integer.f_value[1]);
-        push_be_uint64(buffer, f_integer.f_value[0]);
+        {
+            uint512_t const value(get_big_integer());
+            push_be_uint64(buffer, value.f_value[1]);
+            push_be_uint64(buffer, value.f_value[0]);
+        }
         break;
 
     case struct_type_t::STRUCT_TYPE_BITS256:
     case struct_type_t::STRUCT_TYPE_UINT256:
     case struct_type_t::STRUCT_TYPE_INT256:
-        push_be_uint64(buffer, f_integer.f_value[3]);
-        push_be_uint64(buffer, f_integer.f_value[2]);
-        push_be_uint64(buffer, f_integer.f_value[1]);
-        push_be_uint64(buffer, f_integer.f_value[0]);
+        {
+            uint512_t const value(get_big_integer());
+            push_be_uint64(buffer, value.f_value[3]);
+            push_be_uint64(buffer, value.f_value[2]);
+            push_be_uint64(buffer, value.f_value[1]);
+            push_be_uint64(buffer, value.f_value[0]);
+        }
         break;
 
     case struct_type_t::STRUCT_TYPE_BITS512:
     case struct_type_t::STRUCT_TYPE_UINT512:
     case struct_type_t::STRUCT_TYPE_INT512:
-        push_be_uint64(buffer, f_integer.f_value[7]);
-        push_be_uint64(buffer, f_integer.f_value[6]);
-        push_be_uint64(buffer, f_integer.f_value[5]);
-        push_be_uint64(buffer, f_integer.f_value[4]);
-        push_be_uint64(buffer, f_integer.f_value[3]);
-        push_be_uint64(buffer, f_integer.f_value[2]);
-        push_be_uint64(buffer, f_integer.f_value[1]);
-        push_be_uint64(buffer, f_integer.f_value[0]);
+        {
+            uint512_t const value(get_big_integer());
+            push_be_uint64(buffer, value.f_value[7]);
+            push_be_uint64(buffer, value.f_value[6]);
+            push_be_uint64(buffer, value.f_value[5]);
+            push_be_uint64(buffer, value.f_value[4]);
+            push_be_uint64(buffer, value.f_value[3]);
+            push_be_uint64(buffer, value.f_value[2]);
+            push_be_uint64(buffer, value.f_value[1]);
+            push_be_uint64(buffer, value.f_value[0]);
+        }
         break;
 
     case struct_type_t::STRUCT_TYPE_FLOAT32:
@@ -743,7 +886,7 @@ void cell::value_to_binary(buffer_t & buffer) const
                 float       f_float;
             };
             fi value;
-            value.f_float = f_float_value;
+            value.f_float = get_float_value();
             push_be_uint32(buffer, value.f_int);
         }
         break;
@@ -755,7 +898,7 @@ void cell::value_to_binary(buffer_t & buffer) const
                 double          f_float;
             };
             fi value;
-            value.f_float = f_float_value;
+            value.f_float = get_float_value();
             push_be_uint64(buffer, value.f_int);
         }
         break;
@@ -766,8 +909,8 @@ void cell::value_to_binary(buffer_t & buffer) const
                 std::uint64_t   f_int[2] = { 0, 0 };
                 long double     f_float;
             };
-            fi const * value(reinterpret_cast<fi const *>(&f_float_value));
-            //value.f_float = f_float_value;
+            long double const float_value(get_float_value());
+            fi const * value(reinterpret_cast<fi const *>(&float_value));
             push_be_uint64(buffer, value->f_int[1]);
             push_be_uint64(buffer, value->f_int[0]);
         }
@@ -780,14 +923,14 @@ void cell::value_to_binary(buffer_t & buffer) const
             std::size_t const size(f_schema_column->get_minimum_length());
             if(size > 0)
             {
-                std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(f_string.c_str()));
-                buffer.insert(buffer.end(), s, s + f_string.length());
-                if(f_string.length() < size)
+                std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(get_string_data()));
+                buffer.insert(buffer.end(), s, s + f_length);
+                if(f_length < size)
                 {
                     // if the string is shorter than the CHAR field, then
                     // fill the rest with '\0'
                     //
-                    buffer.insert(buffer.end(), size - f_string.length(), 0);
+                    buffer.insert(buffer.end(), size - f_length, 0);
                 }
             }
         }
@@ -795,7 +938,7 @@ void cell::value_to_binary(buffer_t & buffer) const
 
     case struct_type_t::STRUCT_TYPE_P8STRING:
         {
-            std::size_t const size(f_string.length());
+            std::size_t const size(f_length);
             if(size > 255)
             {
                 throw out_of_bounds(
@@ -806,7 +949,7 @@ void cell::value_to_binary(buffer_t & buffer) const
             push_uint8(buffer, size);
             if(size > 0)
             {
-                std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(f_string.c_str()));
+                std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(get_string_data()));
                 buffer.insert(buffer.end(), s, s + size);
             }
         }
@@ -814,7 +957,7 @@ void cell::value_to_binary(buffer_t & buffer) const
 
     case struct_type_t::STRUCT_TYPE_P16STRING:
         {
-            std::size_t const size(f_string.length());
+            std::size_t const size(f_length);
             if(size > 65535)
             {
                 throw out_of_bounds(
@@ -825,7 +968,7 @@ void cell::value_to_binary(buffer_t & buffer) const
             push_be_uint16(buffer, size);
             if(size > 0)
             {
-                std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(f_string.c_str()));
+                std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(get_string_data()));
                 buffer.insert(buffer.end(), s, s + size);
             }
         }
@@ -833,7 +976,7 @@ void cell::value_to_binary(buffer_t & buffer) const
 
     case struct_type_t::STRUCT_TYPE_P32STRING:
         {
-            std::size_t const size(f_string.length());
+            std::size_t const size(f_length);
             if(size > 4294967295)
             {
                 throw out_of_bounds(
@@ -844,7 +987,7 @@ void cell::value_to_binary(buffer_t & buffer) const
             push_be_uint32(buffer, size);
             if(size > 0)
             {
-                std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(f_string.c_str()));
+                std::uint8_t const * s(reinterpret_cast<std::uint8_t const *>(get_string_data()));
                 buffer.insert(buffer.end(), s, s + size);
             }
         }
@@ -874,7 +1017,153 @@ void cell::value_to_binary(buffer_t & buffer) const
 }
 
 
+/** \brief Convert the value to a key which can be compared with memcmp().
+ *
+ * The value_to_binary() function saves numbers in big endian which sorts
+ * unsigned numbers properly. This function also makes sure that signed
+ * numbers, floating points and strings sort as expected:
+ *
+ * \li signed numbers get their sign bit inverted so negative numbers
+ * come first;
+ * \li positive floating points get their sign bit set and negative
+ * floating points get all their bits inverted;
+ * \li strings are saved without their size; a zero byte gets saved as
+ * 0x00 0x01 and the string ends with 0x00 0x00 so a string sorts before
+ * all the strings it is a prefix of.
+ *
+ * The result is used as the key of secondary indexes.
+ *
+ * \exception type_mismatch
+ * The type of the cell cannot be used in a key.
+ *
+ * \param[in,out] buffer  The buffer where the key gets appended.
+ */
+void cell::value_to_key(buffer_t & buffer) const
+{
+    std::size_t const start(buffer.size());
+    switch(f_schema_column->get_type())
+    {
+    case struct_type_t::STRUCT_TYPE_INT8:
+    case struct_type_t::STRUCT_TYPE_INT16:
+    case struct_type_t::STRUCT_TYPE_INT32:
+    case struct_type_t::STRUCT_TYPE_INT64:
+    case struct_type_t::STRUCT_TYPE_INT128:
+    case struct_type_t::STRUCT_TYPE_INT256:
+    case struct_type_t::STRUCT_TYPE_INT512:
+        value_to_binary(buffer);
+        buffer[start] ^= 0x80;
+        break;
+
+    case struct_type_t::STRUCT_TYPE_FLOAT32:
+    case struct_type_t::STRUCT_TYPE_FLOAT64:
+    case struct_type_t::STRUCT_TYPE_FLOAT128:
+        {
+            // the float128 is saved as a double; the order is kept
+            // although two very close values may end up being equal
+            //
+            if(f_schema_column->get_type() == struct_type_t::STRUCT_TYPE_FLOAT32)
+            {
+                value_to_binary(buffer);
+            }
+            else
+            {
+                union fi {
+                    std::uint64_t   f_int = 0;
+                    double          f_float;
+                };
+                fi value;
+                value.f_float = static_cast<double>(get_float_value());
+                push_be_uint64(buffer, value.f_int);
+            }
+            if((buffer[start] & 0x80) != 0)
+            {
+                for(std::size_t idx(start); idx < buffer.size(); ++idx)
+                {
+                    buffer[idx] = ~buffer[idx];
+                }
+            }
+            else
+            {
+                buffer[start] |= 0x80;
+            }
+        }
+        break;
+
+    case struct_type_t::STRUCT_TYPE_CHAR:
+    case struct_type_t::STRUCT_TYPE_P8STRING:
+    case struct_type_t::STRUCT_TYPE_P16STRING:
+    case struct_type_t::STRUCT_TYPE_P32STRING:
+        {
+            char const * str(get_string_data());
+            for(std::uint32_t idx(0); idx < f_length; ++idx)
+            {
+                buffer.push_back(static_cast<std::uint8_t>(str[idx]));
+                if(str[idx] == '\0')
+                {
+                    buffer.push_back(1);
+                }
+            }
+            buffer.push_back(0);
+            buffer.push_back(0);
+        }
+        break;
+
+    case struct_type_t::STRUCT_TYPE_VOID:
+    case struct_type_t::STRUCT_TYPE_BITS8:
+    case struct_type_t::STRUCT_TYPE_UINT8:
+    case struct_type_t::STRUCT_TYPE_BITS16:
+    case struct_type_t::STRUCT_TYPE_UINT16:
+    case struct_type_t::STRUCT_TYPE_BITS32:
+    case struct_type_t::STRUCT_TYPE_UINT32:
+    case struct_type_t::STRUCT_TYPE_VERSION:
+    case struct_type_t::STRUCT_TYPE_BITS64:
+    case struct_type_t::STRUCT_TYPE_UINT64:
+    case struct_type_t::STRUCT_TYPE_REFERENCE:
+    case struct_type_t::STRUCT_TYPE_OID:
+    case struct_type_t::STRUCT_TYPE_TIME:
+    case struct_type_t::STRUCT_TYPE_MSTIME:
+    case struct_type_t::STRUCT_TYPE_USTIME:
+    case struct_type_t::STRUCT_TYPE_BITS128:
+    case struct_type_t::STRUCT_TYPE_NSTIME:
+    case struct_type_t::STRUCT_TYPE_UINT128:
+    case struct_type_t::STRUCT_TYPE_BITS256:
+    case struct_type_t::STRUCT_TYPE_UINT256:
+    case struct_type_t::STRUCT_TYPE_BITS512:
+    case struct_type_t::STRUCT_TYPE_UINT512:
+        value_to_binary(buffer);
+        break;
+
+    case struct_type_t::STRUCT_TYPE_MAGIC:
+    case struct_type_t::STRUCT_TYPE_STRUCTURE_VERSION:
+    case struct_type_t::STRUCT_TYPE_STRUCTURE:
+    case struct_type_t::STRUCT_TYPE_UNION:
+    case struct_type_t::STRUCT_TYPE_ARRAY8:
+    case struct_type_t::STRUCT_TYPE_ARRAY16:
+    case struct_type_t::STRUCT_TYPE_ARRAY32:
+    case struct_type_t::STRUCT_TYPE_UNION_ARRAY8:
+    case struct_type_t::STRUCT_TYPE_UNION_ARRAY16:
+    case struct_type_t::STRUCT_TYPE_UNION_ARRAY32:
+    case struct_type_t::STRUCT_TYPE_BUFFER8:
+    case struct_type_t::STRUCT_TYPE_BUFFER16:
+    case struct_type_t::STRUCT_TYPE_BUFFER32:
+    case struct_type_t::STRUCT_TYPE_END:
+    case struct_type_t::STRUCT_TYPE_RENAMED:
+        throw type_mismatch(
+                  "unexpected type ("
+                + std::to_string(static_cast<int>(f_schema_column->get_type()))
+                + ") to convert a cell to a key.");
+
+    }
+}
+
+
 void cell::value_from_binary(buffer_t const & buffer, std::size_t & pos)
+{
+    value_from_binary(buffer.data(), pos);
+}
+
+
+void cell::value_from_binary(std::uint8_t const * buffer, std::size_t & pos)
 {
     switch(f_schema_column->get_type())
     {
@@ -926,66 +1215,76 @@ void cell::value_from_binary(buffer_t const & buffer, std::size_t & pos)
 
     case struct_type_t::STRUCT_TYPE_BITS128:
     case struct_type_t::STRUCT_TYPE_UINT128:
-        f_integer.f_value[7] = 0;
-        f_integer.f_value[6] = 0;
-        f_integer.f_value[5] = 0;
-        f_integer.f_value[4] = 0;
-        f_integer.f_value[3] = 0;
-        f_integer.f_value[2] = 0;
-        f_integer.f_value[1] = read_be_uint64(buffer, pos);
-        f_integer.f_value[0] = read_be_uint64(buffer, pos);
+        {
+            uint512_t value;
+            value.f_value[1] = read_be_uint64(buffer, pos);
+            value.f_value[0] = read_be_uint64(buffer, pos);
+            set_big_integer(value);
+        }
         break;
 
     case struct_type_t::STRUCT_TYPE_NSTIME:
     case struct_type_t::STRUCT_TYPE_INT128:
-        f_integer.f_value[1] = read_be_uint64(buffer, pos);
-        f_integer.f_value[0] = read_be_uint64(buffer, pos);
-
-        // extend sign
-        f_integer.f_value[7] = static_cast<std::int64_t>(f_integer.f_value[1]) < 0 ? -1 : 0;
-        f_integer.f_value[6] = f_integer.f_value[7];
-        f_integer.f_value[5] = f_integer.f_value[7];
-        f_integer.f_value[4] = f_integer.f_value[7];
-        f_integer.f_value[3] = f_integer.f_value[7];
-        f_integer.f_value[2] = f_integer.f_value[7];
+        {
+            uint512_t value;
+            value.f_value[1] = read_be_uint64(buffer, pos);
+            value.f_value[0] = read_be_uint64(buffer, pos);
+
+            // extend sign
+            value.f_value[7] = static_cast<std::int64_t>(value.f_value[1]) < 0 ? -1 : 0;
+            value.f_value[6] = value.f_value[7];
+            value.f_value[5] = value.f_value[7];
+            value.f_value[4] = value.f_value[7];
+            value.f_value[3] = value.f_value[7];
+            value.f_value[2] = value.f_value[7];
+            set_big_integer(value);
+        }
         break;
 
     case struct_type_t::STRUCT_TYPE_BITS256:
     case struct_type_t::STRUCT_TYPE_UINT256:
-        f_integer.f_value[7] = 0;
-        f_integer.f_value[6] = 0;
-        f_integer.f_value[5] = 0;
-        f_integer.f_value[4] = 0;
-        f_integer.f_value[3] = read_be_uint64(buffer, pos);
-        f_integer.f_value[2] = read_be_uint64(buffer, pos);
-        f_integer.f_value[1] = read_be_uint64(buffer, pos);
-        f_integer.f_value[0] = read_be_uint64(buffer, pos);
+        {
+            uint512_t value;
+            value.f_value[3] = read_be_uint64(buffer, pos);
+            value.f_value[2] = read_be_uint64(buffer, pos);
+            value.f_value[1] = read_be_uint64(buffer, pos);
+            value.f_value[0] = read_be_uint64(buffer, pos);
+            set_big_integer(value);
+        }
         break;
 
     case struct_type_t::STRUCT_TYPE_INT256:
-        f_integer.f_value[3] = read_be_uint64(buffer, pos);
-        f_integer.f_value[2] = read_be_uint64(buffer, pos);
-        f_integer.f_value[1] = read_be_uint64(buffer, pos);
-        f_integer.f_value[0] = read_be_uint64(buffer, pos);
-
-        // extend sign
-        f_integer.f_value[7] = static_cast<std::int64_t>(f_integer.f_value[3]) < 0 ? -1 : 0;
-        f_integer.f_value[6] = f_integer.f_value[7];
-        f_integer.f_value[5] = f_integer.f_value[7];
-        f_integer.f_value[4] = f_integer.f_value[7];
+        {
+            uint512_t value;
+            value.f_value[3] = read_be_uint64(buffer, pos);
+            value.f_value[2] = read_be_uint64(buffer, pos);
+            value.f_value[1] = read_be_uint64(buffer, pos);
+            value.f_value[0] = read_be_uint64(buffer, pos);
+
+            // extend sign
+            value.f_value[7] = static_cast<std::int64_t>(value.f_value[3]) < 0 ? -1 : 0;
+            value.f_value[6] = value.f_value[7];
+            value.f_value[5] = value.f_value[7];
+            value.f_value[4] = value.f_value[7];
+            set_big_integer(value);
+        }
         break;
 
     case struct_type_t::STRUCT_TYPE_BITS512:
     case struct_type_t::STRUCT_TYPE_UINT512:
     case struct_type_t::STRUCT_TYPE_INT512:
-        f_integer.f_value[7] = read_be_uint64(buffer, pos);
-        f_integer.f_value[6] = read_be_uint64(buffer, pos);
-        f_integer.f_value[5] = read_be_uint64(buffer, pos);
-        f_integer.f_value[4] = read_be_uint64(buffer, pos);
-        f_integer.f_value[3] = read_be_uint64(buffer, pos);
-        f_integer.f_value[2] = read_be_uint64(buffer, pos);
-        f_integer.f_value[1] = read_be_uint64(buffer, pos);
-        f_integer.f_value[0] = read_be_uint64(buffer, pos);
+        {
+            uint512_t value;
+            value.f_value[7] = read_be_uint64(buffer, pos);
+            value.f_value[6] = read_be_uint64(buffer, pos);
+            value.f_value[5] = read_be_uint64(buffer, pos);
+            value.f_value[4] = read_be_uint64(buffer, pos);
+            value.f_value[3] = read_be_uint64(buffer, pos);
+            value.f_value[2] = read_be_uint64(buffer, pos);
+            value.f_value[1] = read_be_uint64(buffer, pos);
+            value.f_value[0] = read_be_uint64(buffer, pos);
+            set_big_integer(value);
+        }
         break;
 
     case struct_type_t::STRUCT_TYPE_FLOAT32:
@@ -996,7 +1295,7 @@ void cell::value_from_binary(buffer_t const & buffer, std::size_t & pos)
             };
             fi value;
             value.f_int = read_be_uint32(buffer, pos);
-            f_float_value = value.f_float;
+            set_float_value(value.f_float);
         }
         break;
 
@@ -1008,7 +1307,7 @@ void cell::value_from_binary(buffer_t const & buffer, std::size_t & pos)
             };
             fi value;
             value.f_int = read_be_uint64(buffer, pos);
-            f_float_value = value.f_float;
+            set_float_value(value.f_float);
         }
         break;
 
@@ -1021,7 +1320,7 @@ void cell::value_from_binary(buffer_t const & buffer, std::size_t & pos)
             fi value;
             value.f_int[1] = read_be_uint64(buffer, pos);
             value.f_int[0] = read_be_uint64(buffer, pos);
-            f_float_value = value.f_float;
+            set_float_value(value.f_float);
         }
         break;
 
@@ -1030,14 +1329,12 @@ void cell::value_from_binary(buffer_t const & buffer, std::size_t & pos)
             // Note: the CHAR size is fixed so the minimum & maximum are the same
             //
             std::size_t const size(f_schema_column->get_minimum_length());
-            f_string.resize(size);
-            memcpy(&f_string[0], buffer.data() + pos, size);
+            char const * str(reinterpret_cast<char const *>(buffer + pos));
 
             // in case the string was shorter than the full length, we may have
             // some '\0' at the end, trim them
             //
-            std::size_t const len(strnlen(f_string.c_str(), size));
-            f_string.resize(len);
+            set_string_value(str, strnlen(str, size));
 
             pos += size;
         }
@@ -1046,8 +1343,7 @@ void cell::value_from_binary(buffer_t const & buffer, std::size_t & pos)
     case struct_type_t::STRUCT_TYPE_P8STRING:
         {
             std::size_t const size(read_uint8(buffer, pos));
-            f_string.resize(size);
-            memcpy(&f_string[0], buffer.data() + pos, size);
+            set_string_value(reinterpret_cast<char const *>(buffer + pos), size);
             pos += size;
         }
         break;
@@ -1055,8 +1351,7 @@ void cell::value_from_binary(buffer_t const & buffer, std::size_t & pos)
     case struct_type_t::STRUCT_TYPE_P16STRING:
         {
             size_t const size(read_be_uint16(buffer, pos));
-            f_string.resize(size);
-            memcpy(&f_string[0], buffer.data() + pos, size);
+            set_string_value(reinterpret_cast<char const *>(buffer + pos), size);
             pos += size;
         }
         break;
@@ -1064,8 +1359,7 @@ void cell::value_from_binary(buffer_t const & buffer, std::size_t & pos)
     case struct_type_t::STRUCT_TYPE_P32STRING:
         {
             size_t const size(read_be_uint32(buffer, pos));
-            f_string.resize(size);
-            memcpy(&f_string[0], buffer.data() + pos, size);
+            set_string_value(reinterpret_cast<char const *>(buffer + pos), size);
             pos += size;
         }
         break;
@@ -1094,6 +1388,127 @@ void cell::value_from_binary(buffer_t const & buffer, std::size_t & pos)
 }
 
 
+/** \brief Skip the binary value of a column.
+ *
+ * This function moves \p pos after the value of \p column found in
+ * \p buffer without decoding it. It is used to find a given cell in a
+ * row blob without decoding the cells before it.
+ *
+ * \exception type_mismatch
+ * The type of the column cannot be used in a row.
+ *
+ * \param[in] column  The column of the value to skip.
+ * \param[in] buffer  The buffer with the binary value.
+ * \param[in,out] pos  The position of the value, moved after it.
+ */
+void cell::skip_binary_value(schema_column::pointer_t column, std::uint8_t const * buffer, std::size_t & pos)
+{
+    switch(column->get_type())
+    {
+    case struct_type_t::STRUCT_TYPE_VOID:
+        break;
+
+    case struct_type_t::STRUCT_TYPE_BITS8:
+    case struct_type_t::STRUCT_TYPE_UINT8:
+    case struct_type_t::STRUCT_TYPE_INT8:
+        pos += sizeof(std::uint8_t);
+        break;
+
+    case struct_type_t::STRUCT_TYPE_BITS16:
+    case struct_type_t::STRUCT_TYPE_UINT16:
+    case struct_type_t::STRUCT_TYPE_INT16:
+        pos += sizeof(std::uint16_t);
+        break;
+
+    case struct_type_t::STRUCT_TYPE_BITS32:
+    case struct_type_t::STRUCT_TYPE_UINT32:
+    case struct_type_t::STRUCT_TYPE_INT32:
+    case struct_type_t::STRUCT_TYPE_VERSION:
+    case struct_type_t::STRUCT_TYPE_FLOAT32:
+        pos += sizeof(std::uint32_t);
+        break;
+
+    case struct_type_t::STRUCT_TYPE_BITS64:
+    case struct_type_t::STRUCT_TYPE_UINT64:
+    case struct_type_t::STRUCT_TYPE_INT64:
+    case struct_type_t::STRUCT_TYPE_REFERENCE:
+    case struct_type_t::STRUCT_TYPE_OID:
+    case struct_type_t::STRUCT_TYPE_TIME:
+    case struct_type_t::STRUCT_TYPE_MSTIME:
+    case struct_type_t::STRUCT_TYPE_USTIME:
+    case struct_type_t::STRUCT_TYPE_FLOAT64:
+        pos += sizeof(std::uint64_t);
+        break;
+
+    case struct_type_t::STRUCT_TYPE_BITS128:
+    case struct_type_t::STRUCT_TYPE_UINT128:
+    case struct_type_t::STRUCT_TYPE_INT128:
+    case struct_type_t::STRUCT_TYPE_NSTIME:
+    case struct_type_t::STRUCT_TYPE_FLOAT128:
+        pos += sizeof(std::uint64_t) * 2;
+        break;
+
+    case struct_type_t::STRUCT_TYPE_BITS256:
+    case struct_type_t::STRUCT_TYPE_UINT256:
+    case struct_type_t::STRUCT_TYPE_INT256:
+        pos += sizeof(std::uint64_t) * 4;
+        break;
+
+    case struct_type_t::STRUCT_TYPE_BITS512:
+    case struct_type_t::STRUCT_TYPE_UINT512:
+    case struct_type_t::STRUCT_TYPE_INT512:
+        pos += sizeof(std::uint64_t) * 8;
+        break;
+
+    case struct_type_t::STRUCT_TYPE_CHAR:
+        pos += column->get_minimum_length();
+        break;
+
+    case struct_type_t::STRUCT_TYPE_P8STRING:
+        {
+            std::size_t const size(read_uint8(buffer, pos));
+            pos += size;
+        }
+        break;
+
+    case struct_type_t::STRUCT_TYPE_P16STRING:
+        {
+            std::size_t const size(read_be_uint16(buffer, pos));
+            pos += size;
+        }
+        break;
+
+    case struct_type_t::STRUCT_TYPE_P32STRING:
+        {
+            std::size_t const size(read_be_uint32(buffer, pos));
+            pos += size;
+        }
+        break;
+
+    case struct_type_t::STRUCT_TYPE_MAGIC:
+    case struct_type_t::STRUCT_TYPE_STRUCTURE_VERSION:
+    case struct_type_t::STRUCT_TYPE_STRUCTURE:
+    case struct_type_t::STRUCT_TYPE_UNION:
+    case struct_type_t::STRUCT_TYPE_ARRAY8:
+    case struct_type_t::STRUCT_TYPE_ARRAY16:
+    case struct_type_t::STRUCT_TYPE_ARRAY32:
+    case struct_type_t::STRUCT_TYPE_UNION_ARRAY8:
+    case struct_type_t::STRUCT_TYPE_UNION_ARRAY16:
+    case struct_type_t::STRUCT_TYPE_UNION_ARRAY32:
+    case struct_type_t::STRUCT_TYPE_BUFFER8:
+    case struct_type_t::STRUCT_TYPE_BUFFER16:
+    case struct_type_t::STRUCT_TYPE_BUFFER32:
+    case struct_type_t::STRUCT_TYPE_END:
+    case struct_type_t::STRUCT_TYPE_RENAMED:
+        throw type_mismatch(
+                  "unexpected type ("
+                + std::to_string(static_cast<int>(column->get_type()))
+                + ") to skip the binary value of a cell.");
+
+    }
+}
+
+
 void cell::copy_from(cell const & source)
 {
     if(f_schema_column->get_type() == source.f_schema_column->get_type())
@@ -1138,20 +1553,20 @@ void cell::copy_from(cell const & source)
         case struct_type_t::STRUCT_TYPE_USTIME:
         case struct_type_t::STRUCT_TYPE_NSTIME:
         case struct_type_t::STRUCT_TYPE_VERSION:
-            f_integer = source.f_integer;
+            copy_value(source);
             break;
 
         case struct_type_t::STRUCT_TYPE_FLOAT32:
         case struct_type_t::STRUCT_TYPE_FLOAT64:
         case struct_type_t::STRUCT_TYPE_FLOAT128:
-            f_float_value = source.f_float_value;
+            copy_value(source);
             break;
 
         case struct_type_t::STRUCT_TYPE_CHAR:
         case struct_type_t::STRUCT_TYPE_P8STRING:
         case struct_type_t::STRUCT_TYPE_P16STRING:
         case struct_type_t::STRUCT_TYPE_P32STRING:
-            f_string = source.f_string;
+            copy_value(source);
             break;
 
         case struct_type_t::STRUCT_TYPE_MAGIC:
@@ -1218,8 +1633,9 @@ void cell::copy_from(cell const & source)
         case struct_type_t::STRUCT_TYPE_NSTIME:
         case struct_type_t::STRUCT_TYPE_VERSION:
             {
-                buffer_t buf(sizeof(source.f_integer.f_value));
-                std::memcpy(buf.data(), source.f_integer.f_value, sizeof(source.f_integer.f_value));
+                uint512_t const integer(source.get_big_integer());
+                buffer_t buf(sizeof(integer.f_value));
+                std::memcpy(buf.data(), integer.f_value, sizeof(integer.f_value));
                 value = typed_buffer_to_string(source.f_schema_column->get_type(), buf, 16);
             }
             break;
@@ -1228,8 +1644,9 @@ void cell::copy_from(cell const & source)
         case struct_type_t::STRUCT_TYPE_FLOAT64:
         case struct_type_t::STRUCT_TYPE_FLOAT128:
             {
-                buffer_t buf(sizeof(source.f_float_value));
-                memcpy(buf.data(), &source.f_float_value, sizeof(source.f_float_value));
+                long double const float_value(source.get_float_value());
+                buffer_t buf(sizeof(float_value));
+                memcpy(buf.data(), &float_value, sizeof(float_value));
                 value = typed_buffer_to_string(source.f_schema_column->get_type(), buf, 16);
             }
             break;
@@ -1238,7 +1655,7 @@ void cell::copy_from(cell const & source)
         case struct_type_t::STRUCT_TYPE_P8STRING:
         case struct_type_t::STRUCT_TYPE_P16STRING:
         case struct_type_t::STRUCT_TYPE_P32STRING:
-            value = source.f_string;
+            value = std::string(source.get_string_data(), source.f_length);
             break;
 
         case struct_type_t::STRUCT_TYPE_MAGIC:
@@ -1289,8 +1706,10 @@ void cell::copy_from(cell const & source)
             {
                 // unsigned
                 buffer_t const buf(string_to_typed_buffer(struct_type_t::STRUCT_TYPE_UINT512, value));
-                assert(buf.size() == sizeof(source.f_integer));
-                memcpy(f_integer.f_value, buf.data(), sizeof(f_integer.f_value));
+                uint512_t integer;
+                assert(buf.size() == sizeof(integer.f_value));
+                memcpy(integer.f_value, buf.data(), sizeof(integer.f_value));
+                set_big_integer(integer);
             }
             break;
 
@@ -1308,8 +1727,10 @@ void cell::copy_from(cell const & source)
             {
                 // signed
                 buffer_t const buf(string_to_typed_buffer(struct_type_t::STRUCT_TYPE_INT512, value));
-                assert(buf.size() == sizeof(source.f_integer));
-                memcpy(f_integer.f_value, buf.data(), sizeof(f_integer.f_value));
+                uint512_t integer;
+                assert(buf.size() == sizeof(integer.f_value));
+                memcpy(integer.f_value, buf.data(), sizeof(integer.f_value));
+                set_big_integer(integer);
             }
             break;
 
@@ -1317,7 +1738,7 @@ void cell::copy_from(cell const & source)
             {
                 buffer_t buf(string_to_typed_buffer(struct_type_t::STRUCT_TYPE_FLOAT32, value));
                 assert(buf.size() == sizeof(float));
-                f_float_value = *reinterpret_cast<float *>(buf.data());
+                set_float_value(*reinterpret_cast<float *>(buf.data()));
             }
             break;
 
@@ -1325,7 +1746,7 @@ void cell::copy_from(cell const & source)
             {
                 buffer_t buf(string_to_typed_buffer(struct_type_t::STRUCT_TYPE_FLOAT64, value));
                 assert(buf.size() == sizeof(double));
-                f_float_value = *reinterpret_cast<double *>(buf.data());
+                set_float_value(*reinterpret_cast<double *>(buf.data()));
             }
             break;
 
@@ -1333,7 +1754,7 @@ void cell::copy_from(cell const & source)
             {
                 buffer_t buf(string_to_typed_buffer(struct_type_t::STRUCT_TYPE_FLOAT128, value));
                 assert(buf.size() == sizeof(long double));
-                f_float_value = *reinterpret_cast<long double *>(buf.data());
+                set_float_value(*reinterpret_cast<long double *>(buf.data()));
             }
             break;
 
@@ -1341,7 +1762,7 @@ void cell::copy_from(cell const & source)
         case struct_type_t::STRUCT_TYPE_P8STRING:
         case struct_type_t::STRUCT_TYPE_P16STRING:
         case struct_type_t::STRUCT_TYPE_P32STRING:
-            f_string = value;
+            set_string_value(value.data(), value.length());
             break;
 
         case struct_type_t::STRUCT_TYPE_MAGIC:
@@ -1371,27 +1792,196 @@ void cell::copy_from(cell const & source)
 
 void cell::set_integer(std::int64_t value)
 {
-    f_integer.f_value[0] = value;
-    f_integer.f_value[1] = value < 0 ? -1 : 0;
-    f_integer.f_value[2] = f_integer.f_value[1];
-    f_integer.f_value[3] = f_integer.f_value[1];
-    f_integer.f_value[4] = f_integer.f_value[1];
-    f_integer.f_value[5] = f_integer.f_value[1];
-    f_integer.f_value[6] = f_integer.f_value[1];
-    f_integer.f_value[7] = f_integer.f_value[1];
+    // the sign gets extended by get_big_integer() when necessary
+    //
+    set_uinteger(value);
+}
+
+
+void cell::set_uinteger(std::uint64_t value)
+{
+    clear_value();
+    f_value.f_integer = value;
+}
+
+
+std::uint64_t cell::get_uinteger() const
+{
+    if(f_storage == value_storage_t::VALUE_STORAGE_BIG_INTEGER)
+    {
+        return f_value.f_big_integer->f_value[0];
+    }
+    return f_value.f_integer;
+}
+
+
+/** \brief Get the integer as a 512 bit number.
+ *
+ * Integers of up to 64 bits are saved inline. This function extends
+ * them to 512 bits, including the sign of signed types.
+ *
+ * \return The integer of this cell.
+ */
+uint512_t cell::get_big_integer() const
+{
+    if(f_storage == value_storage_t::VALUE_STORAGE_BIG_INTEGER)
+    {
+        return *f_value.f_big_integer;
+    }
+
+    uint512_t result;
+    result.f_value[0] = f_value.f_integer;
+    if(is_signed_integer(f_schema_column->get_type())
+    && static_cast<std::int64_t>(f_value.f_integer) < 0)
+    {
+        for(std::size_t idx(1); idx < std::size(result.f_value); ++idx)
+        {
+            result.f_value[idx] = static_cast<std::uint64_t>(-1);
+        }
+    }
+    return result;
+}
+
+
+/** \brief Save an integer of any size.
+ *
+ * The integer only gets allocated when the type of the column requires
+ * more than 64 bits. Otherwise only the lower 64 bits are kept.
+ *
+ * \param[in] value  The new value of this cell.
+ */
+void cell::set_big_integer(uint512_t const & value)
+{
+    if(!is_big_integer(f_schema_column->get_type()))
+    {
+        set_uinteger(value.f_value[0]);
+        return;
+    }
+
+    if(f_storage == value_storage_t::VALUE_STORAGE_BIG_INTEGER)
+    {
+        *f_value.f_big_integer = value;
+        return;
+    }
+
+    uint512_t * integer(new uint512_t(value));
+    clear_value();
+    f_value.f_big_integer = integer;
+    f_storage = value_storage_t::VALUE_STORAGE_BIG_INTEGER;
+}
+
+
+long double cell::get_float_value() const
+{
+    long double result(0.0L);
+    if(f_storage == value_storage_t::VALUE_STORAGE_INLINE)
+    {
+        memcpy(&result, f_value.f_inline, sizeof(result));
+    }
+    return result;
+}
+
+
+void cell::set_float_value(long double value)
+{
+    clear_value();
+    memcpy(f_value.f_inline, &value, sizeof(value));
+}
+
+
+char const * cell::get_string_data() const
+{
+    if(f_storage == value_storage_t::VALUE_STORAGE_LONG_STRING)
+    {
+        return f_value.f_long_string;
+    }
+    return reinterpret_cast<char const *>(f_value.f_inline);
+}
+
+
+/** \brief Save a string.
+ *
+ * Strings of up to INLINE_SIZE bytes are saved inline. Longer strings
+ * get allocated.
+ *
+ * \exception out_of_bounds
+ * A string cannot be larger than 4Gb.
+ *
+ * \param[in] value  The characters of the string.
+ * \param[in] length  The number of characters.
+ */
+void cell::set_string_value(char const * value, std::size_t length)
+{
+    if(length > std::numeric_limits<std::uint32_t>::max())
+    {
+        throw out_of_bounds(
+                  "string too long for a cell (max: 4Gb, actually: "
+                + std::to_string(length)
+                + ").");
+    }
+
+    if(length <= INLINE_SIZE)
+    {
+        // the value may be our own string
+        //
+        char copy[INLINE_SIZE];
+        memcpy(copy, value, length);
+        clear_value();
+        memcpy(f_value.f_inline, copy, length);
+    }
+    else
+    {
+        char * str(new char[length]);
+        memcpy(str, value, length);
+        clear_value();
+        f_value.f_long_string = str;
+        f_storage = value_storage_t::VALUE_STORAGE_LONG_STRING;
+    }
+    f_length = length;
+}
+
+
+void cell::copy_value(cell const & source)
+{
+    switch(source.f_storage)
+    {
+    case value_storage_t::VALUE_STORAGE_INLINE:
+        clear_value();
+        f_value = source.f_value;
+        f_length = source.f_length;
+        break;
+
+    case value_storage_t::VALUE_STORAGE_BIG_INTEGER:
+        set_big_integer(*source.f_value.f_big_integer);
+        break;
+
+    case value_storage_t::VALUE_STORAGE_LONG_STRING:
+        set_string_value(source.f_value.f_long_string, source.f_length);
+        break;
+
+    }
 }
 
 
-void cell::set_uinteger(uint64_t value)
+void cell::clear_value()
 {
-    f_integer.f_value[0] = value;
-    f_integer.f_value[1] = 0;
-    f_integer.f_value[2] = 0;
-    f_integer.f_value[3] = 0;
-    f_integer.f_value[4] = 0;
-    f_integer.f_value[5] = 0;
-    f_integer.f_value[6] = 0;
-    f_integer.f_value[7] = 0;
+    switch(f_storage)
+    {
+    case value_storage_t::VALUE_STORAGE_INLINE:
+        break;
+
+    case value_storage_t::VALUE_STORAGE_BIG_INTEGER:
+        delete f_value.f_big_integer;
+        break;
+
+    case value_storage_t::VALUE_STORAGE_LONG_STRING:
+        delete [] f_value.f_long_string;
+        break;
+
+    }
+    f_value = value_t();
+    f_length = 0;
+    f_storage = value_storage_t::VALUE_STORAGE_INLINE;
 }
 
 
@@ -55,6 +55,10 @@ std::uint8_t  read_uint8(buffer_t const & buffer, size_t & pos);
 std::uint16_t read_be_uint16(buffer_t const & buffer, size_t & pos);
 std::uint32_t read_be_uint32(buffer_t const & buffer, size_t & pos);
 std::uint64_t read_be_uint64(buffer_t const & buffer, size_t & pos);
+std::uint8_t  read_uint8(std::uint8_t const * buffer, size_t & pos);
+std::uint16_t read_be_uint16(std::uint8_t const * buffer, size_t & pos);
+std::uint32_t read_be_uint32(std::uint8_t const * buffer, size_t & pos);
+std::uint64_t read_be_uint64(std::uint8_t const * buffer, size_t & pos);
 
 void push_uint8(buffer_t & buffer, uint8_t value);
 void push_be_uint16(buffer_t & buffer, uint16_t value);
@@ -70,6 +74,10 @@ public:
     typedef std::map<column_id_t, pointer_t>    map_t;
 
                                                 cell(schema_column::pointer_t t);
+                                                cell(cell const & rhs);
+                                                ~cell();
+
+    cell &                                      operator = (cell const & rhs);
 
     schema_column::pointer_t                    schema() const;
     struct_type_t                               type() const;
@@ -150,21 +158,55 @@ public:
 
     void                                        column_id_to_binary(buffer_t & buffer) const;
     static column_id_t                          column_id_from_binary(buffer_t const & buffer, size_t & pos);
+    static column_id_t                          column_id_from_binary(std::uint8_t const * buffer, size_t & pos);
 
     void                                        value_to_binary(buffer_t & buffer) const;
     void                                        value_from_binary(buffer_t const & buffer, size_t & pos);
+    void                                        value_from_binary(std::uint8_t const * buffer, size_t & pos);
+    static void                                 skip_binary_value(schema_column::pointer_t column, std::uint8_t const * buffer, size_t & pos);
+    void                                        value_to_key(buffer_t & buffer) const;
 
     void                                        copy_from(cell const & source);
 
 private:
+    // the value is a tagged union: integers of up to 64 bits, floats and
+    // short strings are saved inline, larger integers and strings are
+    // allocated
+    //
+    static constexpr std::size_t                INLINE_SIZE = 16;
+
+    enum class value_storage_t : std::uint8_t
+    {
+        VALUE_STORAGE_INLINE,
+        VALUE_STORAGE_BIG_INTEGER,
+        VALUE_STORAGE_LONG_STRING,
+    };
+
+    union value_t
+    {
+        std::uint64_t                           f_integer;
+        std::uint8_t                            f_inline[INLINE_SIZE];
+        uint512_t *                             f_big_integer;
+        char *                                  f_long_string;
+    };
+
     void                                        set_integer(std::int64_t value);
     void                                        set_uinteger(std::uint64_t value);
+    std::uint64_t                               get_uinteger() const;
+    uint512_t                                   get_big_integer() const;
+    void                                        set_big_integer(uint512_t const & value);
+    long double                                 get_float_value() const;
+    void                                        set_float_value(long double value);
+    char const *                                get_string_data() const;
+    void                                        set_string_value(char const * value, std::size_t length);
+    void                                        copy_value(cell const & source);
+    void                                        clear_value();
     void                                        verify_cell_type(std::vector<struct_type_t> const & expected) const;
 
     schema_column::pointer_t                    f_schema_column = schema_column::pointer_t();
-    uint512_t                                   f_integer = uint512_t();
-    long double                                 f_float_value = 0.0L;
-    std::string                                 f_string = std::string();
+    value_t                                     f_value = value_t();
+    std::uint32_t                               f_length = 0;
+    value_storage_t                             f_storage = value_storage_t::VALUE_STORAGE_INLINE;
 };
 
 
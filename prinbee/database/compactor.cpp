@@ -0,0 +1,317 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Background compaction of a table.
+ *
+ * The compactor owns a thread which wakes up every interval and calls
+ * table::compact() once. The threshold and budget are passed as is to
+ * that function. The statistics of all the passes are accumulated so
+ * an administrator can see how much space was reclaimed and at which
+ * I/O cost.
+ */
+
+// self
+//
+#include    "prinbee/database/compactor.h"
+
+#include    "prinbee/exception.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/runner.h>
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+namespace detail
+{
+
+
+
+/** \brief Background thread compacting a table.
+ *
+ * This runner wakes up at regular intervals and calls run_once() on
+ * its compactor.
+ */
+class compactor_runner
+    : public cppthread::runner
+{
+public:
+                            compactor_runner(compactor * c, std::uint64_t interval);
+
+    virtual void            run() override;
+    void                    wakeup();
+
+private:
+    compactor *             f_compactor = nullptr;
+    std::uint64_t           f_interval = DEFAULT_COMPACTION_INTERVAL;
+};
+
+
+compactor_runner::compactor_runner(compactor * c, std::uint64_t interval)
+    : runner("compactor")
+    , f_compactor(c)
+    , f_interval(interval)
+{
+}
+
+
+void compactor_runner::run()
+{
+    while(continue_running())
+    {
+        {
+            cppthread::guard lock(f_mutex);
+            f_mutex.timed_wait(f_interval * 1000);
+        }
+        if(!continue_running())
+        {
+            break;
+        }
+
+        try
+        {
+            f_compactor->run_once();
+        }
+        catch(std::exception const & e)
+        {
+            SNAP_LOG_ERROR
+                << "background compaction failed: "
+                << e.what()
+                << SNAP_LOG_SEND;
+        }
+    }
+}
+
+
+void compactor_runner::wakeup()
+{
+    cppthread::guard lock(f_mutex);
+    f_mutex.signal();
+}
+
+
+
+} // namespace detail
+
+
+
+/** \brief Initialize a compactor for table \p t.
+ *
+ * The compactor keeps a weak pointer to the table. Once the table is
+ * gone, the passes do nothing.
+ *
+ * The thread does not get started automatically, call start() once
+ * the settings are as expected.
+ *
+ * \param[in] t  The table to compact.
+ */
+compactor::compactor(table::pointer_t t)
+    : f_table(t)
+{
+}
+
+
+compactor::~compactor()
+{
+    stop();
+}
+
+
+/** \brief Define the percent of use under which a block gets compacted.
+ *
+ * A `DATA` block where the live rows use less than \p threshold percent
+ * of the space gets compacted. Use a small number to only compact
+ * nearly empty blocks. A number larger than 100 is clamped to 100.
+ *
+ * \param[in] threshold  The threshold in percent.
+ */
+void compactor::set_threshold(std::uint32_t threshold)
+{
+    cppthread::guard lock(f_mutex);
+    f_threshold = std::min(threshold, static_cast<std::uint32_t>(100));
+}
+
+
+std::uint32_t compactor::get_threshold() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_threshold;
+}
+
+
+/** \brief Define the maximum number of bytes moved by one pass.
+ *
+ * The budget along with the interval defines the maximum rate at which
+ * the compactor writes row data. Use 0 to compact the entire table in
+ * each pass.
+ *
+ * \param[in] budget  The number of bytes one pass can move.
+ */
+void compactor::set_budget(std::size_t budget)
+{
+    cppthread::guard lock(f_mutex);
+    f_budget = budget;
+}
+
+
+std::size_t compactor::get_budget() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_budget;
+}
+
+
+/** \brief Define the number of milliseconds between two passes.
+ *
+ * The new interval is used the next time the thread gets started.
+ *
+ * \param[in] interval  The interval in milliseconds.
+ */
+void compactor::set_interval(std::uint64_t interval)
+{
+    if(interval == 0)
+    {
+        throw invalid_parameter("the compactor interval must be at least 1 millisecond.");
+    }
+
+    cppthread::guard lock(f_mutex);
+    f_interval = interval;
+}
+
+
+std::uint64_t compactor::get_interval() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_interval;
+}
+
+
+void compactor::start()
+{
+    if(f_thread != nullptr)
+    {
+        return;
+    }
+
+    f_runner = std::make_shared<detail::compactor_runner>(this, get_interval());
+    f_thread = std::make_shared<cppthread::thread>("compactor", f_runner);
+    f_thread->start();
+}
+
+
+void compactor::stop()
+{
+    if(f_thread == nullptr)
+    {
+        return;
+    }
+
+    f_thread->stop([this](cppthread::thread *)
+        {
+            f_runner->wakeup();
+        });
+    f_thread.reset();
+    f_runner.reset();
+}
+
+
+bool compactor::is_running() const
+{
+    return f_thread != nullptr;
+}
+
+
+/** \brief Run one compaction pass.
+ *
+ * This function is called by the background thread. It can also be
+ * called directly, for example, to compact a table before a backup.
+ *
+ * The statistics of the pass get added to the statistics returned by
+ * get_statistics().
+ *
+ * \return The statistics of this pass.
+ */
+compaction_statistics_t compactor::run_once()
+{
+    std::uint32_t threshold(0);
+    std::size_t budget(0);
+    {
+        cppthread::guard lock(f_mutex);
+        threshold = f_threshold;
+        budget = f_budget;
+    }
+
+    table::pointer_t t(f_table.lock());
+    if(t == nullptr)
+    {
+        return compaction_statistics_t();
+    }
+
+    compaction_statistics_t const result(t->compact(threshold, budget));
+
+    cppthread::guard lock(f_mutex);
+    f_statistics.f_blocks_scanned += result.f_blocks_scanned;
+    f_statistics.f_blocks_freed += result.f_blocks_freed;
+    f_statistics.f_rows_moved += result.f_rows_moved;
+    f_statistics.f_bytes_moved += result.f_bytes_moved;
+    f_statistics.f_bytes_reclaimed += result.f_bytes_reclaimed;
+    f_statistics.f_pages_read += result.f_pages_read;
+    f_statistics.f_pages_written += result.f_pages_written;
+
+    return result;
+}
+
+
+/** \brief Retrieve the statistics accumulated by all the passes.
+ *
+ * \return A copy of the accumulated statistics.
+ */
+compaction_statistics_t compactor::get_statistics() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_statistics;
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,98 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Background compaction of a table.
+ *
+ * The compactor runs a thread which calls table::compact() at regular
+ * intervals. Each call is limited to a budget of bytes to move so the
+ * compaction does not monopolize the disk. With the default settings,
+ * the compactor moves at most 1Mb of row data every 10 seconds.
+ */
+
+// self
+//
+#include    "prinbee/database/table.h"
+
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+#include    <cppthread/thread.h>
+
+
+
+namespace prinbee
+{
+
+
+
+namespace detail
+{
+class compactor_runner;
+}
+
+
+constexpr std::uint32_t             DEFAULT_COMPACTION_THRESHOLD = 50;                  // in percent
+constexpr std::size_t               DEFAULT_COMPACTION_BUDGET = 1024ULL * 1024ULL;      // in bytes per pass
+constexpr std::uint64_t             DEFAULT_COMPACTION_INTERVAL = 10000;                // in milliseconds
+
+
+class compactor
+{
+public:
+    typedef std::shared_ptr<compactor>  pointer_t;
+
+                                compactor(table::pointer_t t);
+                                compactor(compactor const & rhs) = delete;
+                                ~compactor();
+
+    compactor &                 operator = (compactor const & rhs) = delete;
+
+    void                        set_threshold(std::uint32_t threshold);
+    std::uint32_t               get_threshold() const;
+    void                        set_budget(std::size_t budget);
+    std::size_t                 get_budget() const;
+    void                        set_interval(std::uint64_t interval);
+    std::uint64_t               get_interval() const;
+
+    void                        start();
+    void                        stop();
+    bool                        is_running() const;
+    compaction_statistics_t     run_once();
+    compaction_statistics_t     get_statistics() const;
+
+private:
+    table::weak_pointer_t       f_table = table::weak_pointer_t();
+    mutable cppthread::mutex    f_mutex = cppthread::mutex();
+    std::uint32_t               f_threshold = DEFAULT_COMPACTION_THRESHOLD;
+    std::size_t                 f_budget = DEFAULT_COMPACTION_BUDGET;
+    std::uint64_t               f_interval = DEFAULT_COMPACTION_INTERVAL;
+    compaction_statistics_t     f_statistics = compaction_statistics_t();
+    std::shared_ptr<detail::compactor_runner>
+                                f_runner = std::shared_ptr<detail::compactor_runner>();
+    cppthread::thread::pointer_t
+                                f_thread = cppthread::thread::pointer_t();
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
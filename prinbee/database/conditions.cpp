@@ -57,6 +57,9 @@ namespace prinbee
  * By default the list is empty meaning that all the columns will be
  * returned.
  *
+ * Only the cells of those columns get decoded. The rows returned are
+ * then incomplete and must not be committed back to the table.
+ *
  * \param[in] column_names  The name of the columns to return in your cursor.
  */
 void conditions::set_columns(column_names_t const & column_names)
@@ -195,6 +198,51 @@ bool conditions::get_reverse() const
 }
 
 
+/** \brief Define which rows a scan of the "_tree" index returns.
+ *
+ * The tree index of a `TABLE_MODEL_TREE` table is searched with the path
+ * found in the minimum key. By default, only the direct children of that
+ * path are returned. With TREE_MODE_SUBTREE, all the descendants are
+ * returned, each parent before its children.
+ *
+ * \param[in] mode  The tree scan mode.
+ */
+void conditions::set_tree_mode(tree_mode_t mode)
+{
+    f_tree_mode = mode;
+}
+
+
+tree_mode_t conditions::get_tree_mode() const
+{
+    return f_tree_mode;
+}
+
+
+/** \brief Request a read-only cursor.
+ *
+ * A read-only cursor returns views of the rows using the
+ * cursor::next_view() and cursor::previous_view() functions. The views
+ * point directly to the data in the table and only decode the cells
+ * that get accessed. This is much faster when only a few columns are
+ * needed.
+ *
+ * The views are only valid until the table gets modified.
+ *
+ * \param[in] read_only  Whether the cursor returns views.
+ */
+void conditions::set_read_only(bool read_only)
+{
+    f_read_only = read_only;
+}
+
+
+bool conditions::get_read_only() const
+{
+    return f_read_only;
+}
+
+
 
 } // namespace prinbee
 // vim: ts=4 sw=4 et
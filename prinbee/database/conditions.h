@@ -56,6 +56,12 @@ enum class null_mode_t
     NULL_MODE_LAST          // return the rows with nulls last
 };
 
+enum class tree_mode_t
+{
+    TREE_MODE_CHILDREN,     // direct children of the key path (default)
+    TREE_MODE_SUBTREE       // all the descendants of the key path
+};
+
 typedef size_t                                  count_t;
 constexpr count_t                               DEFAULT_CURSOR_COUNT = 100;
 constexpr count_t                               CURSOR_NO_LIMIT = 0;
@@ -125,6 +131,12 @@ public:
     void                                        set_reverse(bool reverse = true);
     bool                                        get_reverse() const;
 
+    void                                        set_tree_mode(tree_mode_t mode);
+    tree_mode_t                                 get_tree_mode() const;
+
+    void                                        set_read_only(bool read_only = true);
+    bool                                        get_read_only() const;
+
 private:
     column_names_t                              f_column_names = column_names_t();  // if empty, all columns
     size_t                                      f_offset = 0;
@@ -137,7 +149,9 @@ private:
     row_pointer_t                               f_max_filter = row_pointer_t();
     mutable buffer_t                            f_murmur_key = buffer_t();
     null_mode_t                                 f_null_mode = null_mode_t::NULL_MODE_SORTED;
+    tree_mode_t                                 f_tree_mode = tree_mode_t::TREE_MODE_CHILDREN;
     bool                                        f_reverse = false;
+    bool                                        f_read_only = false;
 };
 
 
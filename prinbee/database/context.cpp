@@ -183,6 +183,7 @@ class context_impl
 public:
                                         context_impl(context * c, context_setup const & setup);
                                         context_impl(context_impl const & rhs) = delete;
+                                        ~context_impl();
 
     context_impl &                      operator = (context_impl const & rhs) = delete;
 
@@ -243,6 +244,27 @@ context_impl::context_impl(context * c, context_setup const & setup)
 }
 
 
+context_impl::~context_impl()
+{
+    for(auto const & t : f_tables)
+    {
+        try
+        {
+            t.second->save_bloom_filter();
+        }
+        catch(std::exception const & e)
+        {
+            SNAP_LOG_ERROR
+                << "could not save the bloom filter of table \""
+                << t.first
+                << "\": "
+                << e.what()
+                << SNAP_LOG_SEND;
+        }
+    }
+}
+
+
 std::string const & context_impl::get_context_path()
 {
     if(f_context_path.empty())
@@ -380,6 +402,7 @@ void context_impl::initialize()
         for(auto const & table_dir : order_list)
         {
             table::pointer_t t(std::make_shared<table>(f_context, table_dir, f_schema_complex_types));
+            t->get_dbfile()->set_table(t);
             f_tables[t->get_name()] = t;
         }
 
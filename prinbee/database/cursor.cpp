@@ -122,79 +122,56 @@ std::cerr << "position global = " << f_global_position << " local = " << f_local
 
 row::pointer_t cursor::next_row()
 {
-std::cerr << "get next row: " << f_local_position << " vs " << f_rows.size() << " cache " << f_cache << "\n";
-    if(f_local_position >= f_rows.size())
+    verify_read_only(false);
+    if(!next_position())
     {
-        if(f_complete)
-        {
-            return row::pointer_t();
-        }
-
-        // read some more rows
-        //
-        if(!f_cache)
-        {
-            f_multiple_pages = true;
-            f_global_position += f_rows.size();
-            f_rows.clear();
-            f_local_position = 0;
-        }
-
-        f_table->read_rows(shared_from_this());
-
-        // this happens when no new rows were added by the read_rows() call
-        //
-        if(f_local_position >= f_rows.size())
-        {
-            return row::pointer_t();
-        }
+        return row::pointer_t();
     }
-
-    row::pointer_t result(f_rows[f_local_position]);
-    ++f_local_position;
-    return result;
+    return f_rows[f_local_position - 1];
 }
 
 
 row::pointer_t cursor::previous_row()
 {
-    if(f_local_position == 0)
+    verify_read_only(false);
+    if(!previous_position())
     {
-        if(f_global_position == 0)
-        {
-            return row::pointer_t();
-        }
-
-        // read some previous rows (again)
-        //
-        f_multiple_pages = true;
-        f_rows.clear();
+        return row::pointer_t();
+    }
+    return f_rows[f_local_position];
+}
 
-        size_t const count(f_conditions.get_count());
-        if(f_global_position > count)
-        {
-            f_global_position -= count;
-        }
-        else
-        {
-            f_global_position = 0;
-        }
 
-        f_table->read_rows(shared_from_this());
+/** \brief Get the next row of a read-only cursor.
+ *
+ * When the conditions were marked read-only, the cursor returns views
+ * of the rows instead of the rows themselves. The views are only valid
+ * until the table gets modified.
+ *
+ * \exception logic_error
+ * The cursor is not read-only.
+ *
+ * \return The next view or nullptr once all the rows were read.
+ */
+row_view::pointer_t cursor::next_view()
+{
+    verify_read_only(true);
+    if(!next_position())
+    {
+        return row_view::pointer_t();
+    }
+    return f_views[f_local_position - 1];
+}
 
-        f_local_position = f_rows.size();
 
-        // this happens if the rows we read earlier do not match anymore
-        // (this means the `limit` calculation can be quite skewed)
-        //
-        if(f_local_position == 0)
-        {
-            return row::pointer_t();
-        }
+row_view::pointer_t cursor::previous_view()
+{
+    verify_read_only(true);
+    if(!previous_position())
+    {
+        return row_view::pointer_t();
     }
-
-    --f_local_position;
-    return f_rows[f_local_position];
+    return f_views[f_local_position];
 }
 
 
@@ -254,6 +231,109 @@ row::vector_t & cursor::get_rows()
 }
 
 
+row_view::vector_t & cursor::get_views()
+{
+    return f_views;
+}
+
+
+std::size_t cursor::loaded_rows() const
+{
+    return f_conditions.get_read_only() ? f_views.size() : f_rows.size();
+}
+
+
+void cursor::verify_read_only(bool read_only) const
+{
+    if(f_conditions.get_read_only() != read_only)
+    {
+        throw logic_error(
+              read_only
+                ? "cursor::next_view() and cursor::previous_view() are only available on read-only cursors."
+                : "cursor::next_row() and cursor::previous_row() are not available on read-only cursors.");
+    }
+}
+
+
+bool cursor::next_position()
+{
+std::cerr << "get next row: " << f_local_position << " vs " << loaded_rows() << " cache " << f_cache << "\n";
+    if(f_local_position >= loaded_rows())
+    {
+        if(f_complete)
+        {
+            return false;
+        }
+
+        // read some more rows
+        //
+        if(!f_cache)
+        {
+            f_multiple_pages = true;
+            f_global_position += loaded_rows();
+            f_rows.clear();
+            f_views.clear();
+            f_local_position = 0;
+        }
+
+        f_table->read_rows(shared_from_this());
+
+        // this happens when no new rows were added by the read_rows() call
+        //
+        if(f_local_position >= loaded_rows())
+        {
+            return false;
+        }
+    }
+
+    ++f_local_position;
+    return true;
+}
+
+
+bool cursor::previous_position()
+{
+    if(f_local_position == 0)
+    {
+        if(f_global_position == 0)
+        {
+            return false;
+        }
+
+        // read some previous rows (again)
+        //
+        f_multiple_pages = true;
+        f_rows.clear();
+        f_views.clear();
+
+        size_t const count(f_conditions.get_count());
+        if(f_global_position > count)
+        {
+            f_global_position -= count;
+        }
+        else
+        {
+            f_global_position = 0;
+        }
+
+        f_table->read_rows(shared_from_this());
+
+        f_local_position = loaded_rows();
+
+        // this happens if the rows we read earlier do not match anymore
+        // (this means the `limit` calculation can be quite skewed)
+        //
+        if(f_local_position == 0)
+        {
+            return false;
+        }
+    }
+
+    --f_local_position;
+    return true;
+}
+
+
 
 } // namespace prinbee
 // vim: ts=4 sw=4 et
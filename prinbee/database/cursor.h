@@ -43,6 +43,9 @@ namespace prinbee
 class table;
 typedef std::shared_ptr<table>                  table_pointer_t;
 typedef std::vector<row_pointer_t>              row_vector_t;
+class row_view;
+typedef std::shared_ptr<row_view>               row_view_pointer_t;
+typedef std::vector<row_view_pointer_t>         row_view_vector_t;
 
 namespace detail
 {
@@ -67,6 +70,8 @@ public:
     size_t                                      get_position() const;
     row_pointer_t                               next_row();
     row_pointer_t                               previous_row();
+    row_view_pointer_t                          next_view();
+    row_view_pointer_t                          previous_view();
 
     bool                                        get_cache() const;
     void                                        set_cache(bool cache = true);
@@ -77,8 +82,14 @@ public:
     //
     detail::cursor_state_pointer_t              get_state();
     row_vector_t &                              get_rows();
+    row_view_vector_t &                         get_views();
 
 private:
+    std::size_t                                 loaded_rows() const;
+    void                                        verify_read_only(bool read_only) const;
+    bool                                        next_position();
+    bool                                        previous_position();
+
     table_pointer_t                             f_table;
     detail::cursor_state_pointer_t              f_cursor_state = detail::cursor_state_pointer_t();
     conditions const                            f_conditions;
@@ -88,6 +99,7 @@ private:
     bool                                        f_cache = false;            // keep all the data; otherwise keep at most conditions.f_count rows
     bool                                        f_complete = false;         // if true we found the end of the data
     row_vector_t                                f_rows = row_vector_t();
+    row_view_vector_t                           f_views = row_view_vector_t();  // used instead of f_rows when read-only
 };
 
 
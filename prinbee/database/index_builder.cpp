@@ -0,0 +1,842 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Bottom-up bulk loading of an index.
+ *
+ * Each pair is saved as a fixed size record: the partition as a 32 bit
+ * big endian number, the key padded with zeroes to the key size of the
+ * index, and the OID. The partition and key are compared with memcmp()
+ * so the records sort by partition first and then by key.
+ *
+ * The in memory records are not moved while sorting. Instead, a vector
+ * of pointers to the records gets sorted. When the memory budget (which
+ * includes those pointers) is reached, the records are written in that
+ * order to an unnamed temporary file (O_TMPFILE). The merge reads each run through a buffer of about
+ * `budget / number of runs` bytes so the memory used remains bounded
+ * whatever the number of entries.
+ *
+ * The blocks of each level are allocated as the previous one gets full,
+ * so the `EIDX` blocks of a tree mostly follow each other in the file.
+ * While being filled, a block uses the sorted layout; it gets converted
+ * to the Eytzinger layout, if requested, once full.
+ */
+
+// self
+//
+#include    "prinbee/database/index_builder.h"
+
+#include    "prinbee/exception.h"
+#include    "prinbee/database/table.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+#include    <queue>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+namespace
+{
+
+
+
+/** \brief Read the records of one run in order.
+ *
+ * The reader loads \p buffer_size bytes at a time from the run file and
+ * gives access to one record at a time.
+ */
+class run_reader
+{
+public:
+    run_reader(int fd, std::uint64_t size, std::size_t record_size, std::size_t buffer_size)
+        : f_fd(fd)
+        , f_size(size)
+        , f_record_size(record_size)
+        , f_buffer(std::max(buffer_size / record_size, static_cast<std::size_t>(1)) * record_size)
+    {
+        load();
+    }
+
+    std::uint8_t const * current() const
+    {
+        return f_position < f_available ? f_buffer.data() + f_position : nullptr;
+    }
+
+    void next()
+    {
+        f_position += f_record_size;
+        if(f_position >= f_available)
+        {
+            load();
+        }
+    }
+
+private:
+    void load()
+    {
+        f_position = 0;
+        f_available = static_cast<std::size_t>(std::min(
+                              static_cast<std::uint64_t>(f_buffer.size())
+                            , f_size - f_offset));
+        std::size_t done(0);
+        while(done < f_available)
+        {
+            ssize_t const r(pread(f_fd, f_buffer.data() + done, f_available - done, f_offset + done));
+            if(r <= 0)
+            {
+                int const e(errno);
+                throw io_error(
+                      "index_builder could not read a temporary run (errno: "
+                    + std::to_string(e)
+                    + ", "
+                    + strerror(e)
+                    + ").");
+            }
+            done += r;
+        }
+        f_offset += f_available;
+    }
+
+    int                         f_fd = -1;
+    std::uint64_t               f_size = 0;
+    std::uint64_t               f_offset = 0;
+    std::size_t                 f_record_size = 0;
+    std::size_t                 f_position = 0;
+    std::size_t                 f_available = 0;
+    std::vector<std::uint8_t>   f_buffer = std::vector<std::uint8_t>();
+};
+
+
+
+} // no name namespace
+
+
+
+/** \brief Initialize an index builder.
+ *
+ * The builder allocates the blocks of the index in table \p t. The
+ * keys are saved using \p key_size bytes.
+ *
+ * \exception invalid_parameter
+ * The \p key_size must be at least 1.
+ *
+ * \param[in] t  The table where the index blocks get allocated.
+ * \param[in] key_size  The size of the keys in bytes.
+ */
+index_builder::index_builder(table_pointer_t t, std::uint32_t key_size)
+    : f_table(t.get())
+    , f_key_size(key_size)
+{
+    if(key_size == 0)
+    {
+        throw invalid_parameter("the key size of an index_builder must be at least 1.");
+    }
+}
+
+
+index_builder::~index_builder()
+{
+    close_runs();
+}
+
+
+std::uint32_t index_builder::get_key_size() const
+{
+    return f_key_size;
+}
+
+
+std::uint32_t index_builder::get_fill_factor() const
+{
+    return f_fill_factor;
+}
+
+
+/** \brief Define how full the blocks get packed.
+ *
+ * The `EIDX` and `TIDX` blocks get filled up to \p fill_factor percent
+ * of their capacity. Keeping some room in each block avoids splitting
+ * all the blocks as soon as new keys get inserted all over the index.
+ * If the index is not going to change much, use 100.
+ *
+ * \exception invalid_parameter
+ * The \p fill_factor must be between 50 and 100 inclusive.
+ *
+ * \param[in] fill_factor  The fill factor in percent.
+ */
+void index_builder::set_fill_factor(std::uint32_t fill_factor)
+{
+    if(fill_factor < MIN_INDEX_FILL_FACTOR
+    || fill_factor > MAX_INDEX_FILL_FACTOR)
+    {
+        throw invalid_parameter(
+                  "the index fill factor must be between "
+                + std::to_string(MIN_INDEX_FILL_FACTOR)
+                + " and "
+                + std::to_string(MAX_INDEX_FILL_FACTOR)
+                + ", "
+                + std::to_string(fill_factor)
+                + " is not valid.");
+    }
+    f_fill_factor = fill_factor;
+}
+
+
+index_layout_t index_builder::get_layout() const
+{
+    return f_layout;
+}
+
+
+void index_builder::set_layout(index_layout_t layout)
+{
+    f_layout = layout;
+}
+
+
+std::size_t index_builder::get_memory_budget() const
+{
+    return f_memory_budget;
+}
+
+
+/** \brief Define the amount of memory used to sort the entries.
+ *
+ * Once the records added to the builder use \p budget bytes, they get
+ * sorted and saved in a temporary file. The same budget is shared by
+ * the read buffers of the runs while merging them.
+ *
+ * \exception invalid_parameter
+ * The \p budget must be at least 1Mb.
+ *
+ * \param[in] budget  The number of bytes used to sort the records.
+ */
+void index_builder::set_memory_budget(std::size_t budget)
+{
+    if(budget < MIN_INDEX_BUILDER_MEMORY_BUDGET)
+    {
+        throw invalid_parameter(
+                  "the index_builder memory budget must be at least "
+                + std::to_string(MIN_INDEX_BUILDER_MEMORY_BUDGET)
+                + " bytes.");
+    }
+    f_memory_budget = budget;
+}
+
+
+std::string const & index_builder::get_temporary_directory() const
+{
+    return f_temporary_directory;
+}
+
+
+/** \brief Define where the sorted runs get saved.
+ *
+ * The runs are saved in unnamed files created in this directory. They
+ * are never visible in the directory and the space gets released as
+ * soon as the builder is done with them.
+ *
+ * \param[in] path  The path to an existing directory.
+ */
+void index_builder::set_temporary_directory(std::string const & path)
+{
+    f_temporary_directory = path;
+}
+
+
+/** \brief Define the function computing the partition of a key.
+ *
+ * By default, all the keys go in the same tree. When a partition
+ * function is defined, one tree gets built per partition and the
+ * install callback of build() gets called once per tree.
+ *
+ * The partition function must be defined before adding entries.
+ *
+ * \exception logic_error
+ * Entries were already added to this builder.
+ *
+ * \param[in] partition  The function returning the partition of a key.
+ */
+void index_builder::set_partition(partition_t partition)
+{
+    if(f_count != 0)
+    {
+        throw logic_error("the index_builder partition must be defined before adding entries.");
+    }
+    f_partition = partition;
+}
+
+
+/** \brief Add one entry to the index.
+ *
+ * The entries can be added in any order.
+ *
+ * \exception invalid_size
+ * The \p key cannot be larger than the key size of the index.
+ *
+ * \param[in] key  The key of the entry.
+ * \param[in] oid  The OID of the row.
+ */
+void index_builder::add(buffer_t const & key, oid_t oid)
+{
+    if(key.size() > f_key_size)
+    {
+        throw invalid_size(
+                  "index_builder key of "
+                + std::to_string(key.size())
+                + " bytes is larger than the index key size ("
+                + std::to_string(f_key_size)
+                + ").");
+    }
+
+    // each record also uses one pointer while sorting
+    //
+    std::size_t const record_size(get_record_size());
+    std::size_t const max_records(std::max(
+                  f_memory_budget / (record_size + sizeof(std::uint8_t const *))
+                , static_cast<std::size_t>(1)));
+    if(f_records.size() / record_size >= max_records)
+    {
+        save_run();
+    }
+    if(f_records.capacity() == 0)
+    {
+        f_records.reserve(max_records * record_size);
+    }
+
+    std::uint32_t const partition(f_partition == nullptr ? 0 : f_partition(key));
+    std::size_t const pos(f_records.size());
+    f_records.resize(pos + record_size);
+    std::uint8_t * r(f_records.data() + pos);
+    r[0] = partition >> 24;
+    r[1] = partition >> 16;
+    r[2] = partition >> 8;
+    r[3] = partition;
+    memcpy(r + sizeof(std::uint32_t), key.data(), key.size());
+    memcpy(r + sizeof(std::uint32_t) + f_key_size, &oid, sizeof(oid_t));
+
+    ++f_count;
+}
+
+
+std::uint64_t index_builder::get_count() const
+{
+    return f_count;
+}
+
+
+/** \brief Number of runs saved in temporary files so far.
+ *
+ * \return The number of temporary runs.
+ */
+std::size_t index_builder::get_run_count() const
+{
+    return f_runs.size();
+}
+
+
+/** \brief Build the index.
+ *
+ * This function sorts the entries, fills the blocks and calls \p install
+ * with the root of each tree. The \p first_key parameter is the smallest
+ * key of that tree, which can be used to find the partition the tree is
+ * for. If no entries were added, \p install does not get called.
+ *
+ * The \p install function gets called only once all the trees were
+ * built. If the build fails, for example because a key was added twice,
+ * the blocks allocated so far are freed and nothing gets installed.
+ * The caller is expected to verify that the trees can be installed
+ * before calling this function.
+ *
+ * Once done, the builder is empty and can be reused.
+ *
+ * \exception defined_twice
+ * The same key cannot be added twice to the same partition.
+ *
+ * \param[in] install  The function called with the root of each tree.
+ */
+void index_builder::build(install_t install)
+{
+    try
+    {
+        build_all_trees();
+    }
+    catch(...)
+    {
+        // nothing was installed yet so the blocks of the trees built so
+        // far can be released
+        //
+        free_new_blocks();
+        reset();
+        throw;
+    }
+
+    // all the keys were verified, install the trees
+    //
+    tree_t::vector_t const trees(std::move(f_trees));
+    reset();
+    for(auto const & t : trees)
+    {
+        install(t.f_first_key, t.f_root);
+    }
+}
+
+
+void index_builder::build_all_trees()
+{
+    std::size_t const record_size(get_record_size());
+    if(f_runs.empty())
+    {
+        // everything fits in memory
+        //
+        sort_records();
+        auto it(f_sorted.cbegin());
+        build_trees(
+              [this, &it]() -> std::uint8_t const *
+              {
+                  return it == f_sorted.cend() ? nullptr : *it++;
+              });
+    }
+    else
+    {
+        if(!f_records.empty())
+        {
+            save_run();
+        }
+        f_records = std::vector<std::uint8_t>();
+        f_sorted = std::vector<std::uint8_t const *>();
+
+        std::size_t const compare_size(sizeof(std::uint32_t) + f_key_size);
+        std::size_t const buffer_size(f_memory_budget / f_runs.size());
+        std::vector<run_reader> readers;
+        readers.reserve(f_runs.size());
+        for(auto const & r : f_runs)
+        {
+            readers.emplace_back(r.f_fd, r.f_size, record_size, buffer_size);
+        }
+
+        auto greater([&readers, compare_size](std::size_t lhs, std::size_t rhs)
+            {
+                return memcmp(readers[lhs].current(), readers[rhs].current(), compare_size) > 0;
+            });
+        std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(greater)> heap(greater);
+        for(std::size_t idx(0); idx < readers.size(); ++idx)
+        {
+            if(readers[idx].current() != nullptr)
+            {
+                heap.push(idx);
+            }
+        }
+
+        // the record returned by next() must remain valid until the
+        // following call, so the reader moves forward one call later
+        //
+        std::size_t last(readers.size());
+        build_trees(
+              [&readers, &heap, &last]() -> std::uint8_t const *
+              {
+                  if(last < readers.size())
+                  {
+                      readers[last].next();
+                      if(readers[last].current() != nullptr)
+                      {
+                          heap.push(last);
+                      }
+                      last = readers.size();
+                  }
+                  if(heap.empty())
+                  {
+                      return nullptr;
+                  }
+                  last = heap.top();
+                  heap.pop();
+                  return readers[last].current();
+              });
+    }
+}
+
+
+/** \brief Get ready for the next build.
+ *
+ * The temporary runs get closed and the memory used by the records
+ * released.
+ */
+void index_builder::reset()
+{
+    close_runs();
+    f_records = std::vector<std::uint8_t>();
+    f_sorted = std::vector<std::uint8_t const *>();
+    f_count = 0;
+    f_levels.clear();
+    f_previous_entry_index.reset();
+    f_trees.clear();
+    f_new_blocks.clear();
+}
+
+
+/** \brief Release the blocks allocated by a build that failed.
+ *
+ * The blocks are not yet referenced by anything since the trees are
+ * installed only once they were all built.
+ */
+void index_builder::free_new_blocks()
+{
+    f_levels.clear();
+    f_previous_entry_index.reset();
+
+    for(auto const offset : f_new_blocks)
+    {
+        f_table->free_block(f_table->get_block(offset), true);
+    }
+    f_new_blocks.clear();
+}
+
+
+std::size_t index_builder::get_record_size() const
+{
+    return sizeof(std::uint32_t) + f_key_size + sizeof(oid_t);
+}
+
+
+void index_builder::sort_records()
+{
+    std::size_t const record_size(get_record_size());
+    std::size_t const compare_size(sizeof(std::uint32_t) + f_key_size);
+    f_sorted.clear();
+    f_sorted.reserve(f_records.size() / record_size);
+    for(std::size_t pos(0); pos < f_records.size(); pos += record_size)
+    {
+        f_sorted.push_back(f_records.data() + pos);
+    }
+    std::sort(
+          f_sorted.begin()
+        , f_sorted.end()
+        , [compare_size](std::uint8_t const * lhs, std::uint8_t const * rhs)
+          {
+              return memcmp(lhs, rhs, compare_size) < 0;
+          });
+}
+
+
+void index_builder::save_run()
+{
+    sort_records();
+
+    int const fd(open(f_temporary_directory.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR));
+    if(fd == -1)
+    {
+        int const e(errno);
+        throw io_error(
+              "index_builder could not create a temporary file in \""
+            + f_temporary_directory
+            + "\" (errno: "
+            + std::to_string(e)
+            + ", "
+            + strerror(e)
+            + ").");
+    }
+    f_runs.push_back({ fd, 0 });
+
+    // write the records in order, going through a buffer to avoid one
+    // system call per record
+    //
+    std::size_t const record_size(get_record_size());
+    std::vector<std::uint8_t> buffer;
+    buffer.reserve(std::max(static_cast<std::size_t>(1024 * 1024) / record_size, static_cast<std::size_t>(1)) * record_size);
+    auto flush([&]()
+        {
+            std::size_t done(0);
+            while(done < buffer.size())
+            {
+                ssize_t const r(write(fd, buffer.data() + done, buffer.size() - done));
+                if(r <= 0)
+                {
+                    int const e(errno);
+                    throw io_error(
+                          "index_builder could not write a temporary run (errno: "
+                        + std::to_string(e)
+                        + ", "
+                        + strerror(e)
+                        + ").");
+                }
+                done += r;
+            }
+            f_runs.back().f_size += buffer.size();
+            buffer.clear();
+        });
+    for(auto const * r : f_sorted)
+    {
+        if(buffer.size() + record_size > buffer.capacity())
+        {
+            flush();
+        }
+        buffer.insert(buffer.end(), r, r + record_size);
+    }
+    flush();
+
+    f_records.clear();
+    f_sorted.clear();
+}
+
+
+void index_builder::close_runs()
+{
+    for(auto const & r : f_runs)
+    {
+        close(r.f_fd);
+    }
+    f_runs.clear();
+}
+
+
+/** \brief Build the trees from the sorted records.
+ *
+ * The \p next function returns the records in order and nullptr once
+ * all the records were returned. The first key and root of each tree
+ * get saved in f_trees.
+ *
+ * \exception defined_twice
+ * The same key cannot be added twice to the same partition.
+ *
+ * \param[in] next  The function returning the next record.
+ */
+void index_builder::build_trees(next_record_t next)
+{
+    std::size_t const compare_size(sizeof(std::uint32_t) + f_key_size);
+    std::vector<std::uint8_t> previous(compare_size);
+    buffer_t first_key;
+    bool started(false);
+    for(std::uint8_t const * r(next()); r != nullptr; r = next())
+    {
+        buffer_t key(r + sizeof(std::uint32_t), r + compare_size);
+        if(started)
+        {
+            if(memcmp(previous.data(), r, sizeof(std::uint32_t)) != 0)
+            {
+                // new partition, the previous tree is complete
+                //
+                f_trees.push_back({ first_key, end_tree() });
+                started = false;
+            }
+            else if(memcmp(previous.data(), r, compare_size) == 0)
+            {
+                throw defined_twice("index_builder found the same key twice in one partition.");
+            }
+        }
+        if(!started)
+        {
+            first_key = key;
+            f_levels.clear();
+            f_previous_entry_index.reset();
+            started = true;
+        }
+        memcpy(previous.data(), r, compare_size);
+
+        oid_t oid(0);
+        memcpy(&oid, r + compare_size, sizeof(oid_t));
+        append(0, key, oid);
+    }
+    if(started)
+    {
+        f_trees.push_back({ first_key, end_tree() });
+    }
+}
+
+
+/** \brief Append one entry to the block currently filled at \p level.
+ *
+ * Level 0 represents the `EIDX` blocks. The other levels are `TIDX`
+ * blocks. When the current block of that level is full, it gets closed
+ * which adds its first key to the level above.
+ *
+ * \param[in] level  The level where the entry gets added.
+ * \param[in] key  The key of the entry.
+ * \param[in] reference  The OID of the row or the reference of the child.
+ */
+void index_builder::append(std::size_t level, buffer_t const & key, reference_t reference)
+{
+    if(level >= f_levels.size())
+    {
+        f_levels.resize(level + 1);
+    }
+
+    if(f_levels[level].f_block != nullptr)
+    {
+        std::uint32_t count(0);
+        std::uint32_t max_count(0);
+        bool is_full(false);
+        if(level == 0)
+        {
+            block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(f_levels[level].f_block));
+            count = entry_index->get_count();
+            max_count = entry_index->get_max_count();
+            is_full = entry_index->is_full();
+        }
+        else
+        {
+            block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(f_levels[level].f_block));
+            count = top_index->get_count();
+            max_count = top_index->get_max_count();
+            is_full = top_index->is_full();
+        }
+        std::uint32_t const target(std::max(max_count * f_fill_factor / 100, level == 0 ? 1U : 2U));
+        if(count >= target
+        || is_full)
+        {
+            close_block(level);
+        }
+    }
+
+    if(f_levels[level].f_block == nullptr)
+    {
+        if(level == 0)
+        {
+            block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(
+                            f_table->allocate_new_block(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)));
+            f_new_blocks.push_back(entry_index->get_offset());
+            entry_index->set_key_size(f_key_size);
+            if(f_layout == index_layout_t::INDEX_LAYOUT_PREFIX)
+            {
+                // the number of front coded entries depends on the keys
+                // so this layout is used while filling the block
+                //
+                entry_index->set_layout(f_layout);
+            }
+            if(f_previous_entry_index != nullptr)
+            {
+                f_previous_entry_index->set_next(entry_index->get_offset());
+                entry_index->set_previous(f_previous_entry_index->get_offset());
+            }
+            f_previous_entry_index = entry_index;
+            f_levels[level].f_block = entry_index;
+        }
+        else
+        {
+            block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(
+                            f_table->allocate_new_block(dbtype_t::BLOCK_TYPE_TOP_INDEX)));
+            f_new_blocks.push_back(top_index->get_offset());
+            top_index->set_size(sizeof(reference_t) + f_key_size);
+            if(f_layout == index_layout_t::INDEX_LAYOUT_PREFIX)
+            {
+                top_index->set_layout(f_layout);
+            }
+            f_levels[level].f_block = top_index;
+        }
+        f_levels[level].f_first_key = key;
+        ++f_levels[level].f_blocks;
+    }
+
+    if(level == 0)
+    {
+        block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(f_levels[level].f_block));
+        entry_index->add_entry(key, reference, entry_index->get_count());
+    }
+    else
+    {
+        block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(f_levels[level].f_block));
+        top_index->add_index(key, reference, top_index->get_count());
+    }
+}
+
+
+void index_builder::close_block(std::size_t level)
+{
+    block::pointer_t b(f_levels[level].f_block);
+    buffer_t const first_key(f_levels[level].f_first_key);
+    f_levels[level].f_block.reset();
+
+    apply_layout(level, b);
+
+    append(level + 1, first_key, b->get_offset());
+}
+
+
+void index_builder::apply_layout(std::size_t level, block::pointer_t b)
+{
+    if(f_layout == index_layout_t::INDEX_LAYOUT_SORTED
+    || f_layout == index_layout_t::INDEX_LAYOUT_PREFIX)
+    {
+        return;
+    }
+
+    if(level == 0)
+    {
+        std::static_pointer_cast<block_entry_index>(b)->set_layout(f_layout);
+    }
+    else
+    {
+        std::static_pointer_cast<block_top_index>(b)->set_layout(f_layout);
+    }
+}
+
+
+/** \brief Close the blocks still being filled.
+ *
+ * The blocks are closed from the bottom up. The block of the last level
+ * which is also the only block of that level is the root of the tree.
+ *
+ * \return The reference to the root of the tree.
+ */
+reference_t index_builder::end_tree()
+{
+    reference_t root(NULL_FILE_ADDR);
+    for(std::size_t level(0); level < f_levels.size(); ++level)
+    {
+        if(f_levels[level].f_block == nullptr)
+        {
+            continue;
+        }
+        if(level + 1 == f_levels.size()
+        && f_levels[level].f_blocks == 1)
+        {
+            block::pointer_t b(f_levels[level].f_block);
+            apply_layout(level, b);
+            root = b->get_offset();
+            break;
+        }
+        close_block(level);
+    }
+
+    f_levels.clear();
+    f_previous_entry_index.reset();
+
+    return root;
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
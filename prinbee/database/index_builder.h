@@ -0,0 +1,159 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Bottom-up bulk loading of an index.
+ *
+ * Adding the entries of a large table to an index one at a time means
+ * one tree descent and random I/O per entry, and the blocks end up about
+ * half full since they get split in two. The index_builder is used for
+ * initial imports and to create an index on an existing table instead.
+ *
+ * The (key, OID) pairs are first collected. When the memory budget is
+ * reached, the collected pairs get sorted and saved in a temporary file
+ * (a run). Once all the pairs were added, the runs are merged and the
+ * sorted pairs are used to fill the `EIDX` blocks one after the other up
+ * to the fill factor. Each time an `EIDX` is full, its first key is added
+ * to the `TIDX` of the level above, which is built the same way, and so
+ * on up to the root.
+ *
+ * The pairs can be partitioned (i.e. the primary index uses one tree per
+ * `PIDX` slot). The partition is the most significant part of the sort
+ * key so each tree is built in one go and the callback receives the
+ * root of each tree.
+ */
+
+// self
+//
+#include    "prinbee/database/index_tree.h"
+
+
+// C++
+//
+#include    <functional>
+#include    <vector>
+
+
+
+namespace prinbee
+{
+
+
+
+constexpr std::size_t               DEFAULT_INDEX_BUILDER_MEMORY_BUDGET = 64 * 1024 * 1024;
+constexpr std::size_t               MIN_INDEX_BUILDER_MEMORY_BUDGET = 1024 * 1024;
+
+
+class index_builder
+{
+public:
+    typedef std::shared_ptr<index_builder>      pointer_t;
+    typedef std::function<std::uint32_t(buffer_t const & key)>
+                                                partition_t;
+    typedef std::function<void(buffer_t const & first_key, reference_t root)>
+                                                install_t;
+
+                                index_builder(table_pointer_t t, std::uint32_t key_size);
+                                index_builder(index_builder const & rhs) = delete;
+                                ~index_builder();
+
+    index_builder &             operator = (index_builder const & rhs) = delete;
+
+    std::uint32_t               get_key_size() const;
+    std::uint32_t               get_fill_factor() const;
+    void                        set_fill_factor(std::uint32_t fill_factor);
+    index_layout_t              get_layout() const;
+    void                        set_layout(index_layout_t layout);
+    std::size_t                 get_memory_budget() const;
+    void                        set_memory_budget(std::size_t budget);
+    std::string const &         get_temporary_directory() const;
+    void                        set_temporary_directory(std::string const & path);
+    void                        set_partition(partition_t partition);
+
+    void                        add(buffer_t const & key, oid_t oid);
+    std::uint64_t               get_count() const;
+    std::size_t                 get_run_count() const;
+    void                        build(install_t install);
+
+private:
+    struct run_t
+    {
+        typedef std::vector<run_t>  vector_t;
+
+        int                     f_fd = -1;
+        std::uint64_t           f_size = 0;
+    };
+
+    struct tree_t
+    {
+        typedef std::vector<tree_t> vector_t;
+
+        buffer_t                f_first_key = buffer_t();
+        reference_t             f_root = NULL_FILE_ADDR;
+    };
+
+    struct level_t
+    {
+        typedef std::vector<level_t>    vector_t;
+
+        block::pointer_t        f_block = block::pointer_t();
+        buffer_t                f_first_key = buffer_t();
+        std::uint64_t           f_blocks = 0;
+    };
+
+    typedef std::function<std::uint8_t const *()>
+                                next_record_t;
+
+    std::size_t                 get_record_size() const;
+    void                        sort_records();
+    void                        save_run();
+    void                        close_runs();
+    void                        reset();
+    void                        free_new_blocks();
+    void                        build_all_trees();
+    void                        build_trees(next_record_t next);
+    void                        append(std::size_t level, buffer_t const & key, reference_t reference);
+    void                        close_block(std::size_t level);
+    void                        apply_layout(std::size_t level, block::pointer_t b);
+    reference_t                 end_tree();
+
+    table *                     f_table = nullptr;
+    std::uint32_t               f_key_size = 0;
+    std::uint32_t               f_fill_factor = DEFAULT_INDEX_FILL_FACTOR;
+    index_layout_t              f_layout = index_layout_t::INDEX_LAYOUT_SORTED;
+    std::size_t                 f_memory_budget = DEFAULT_INDEX_BUILDER_MEMORY_BUDGET;
+    std::string                 f_temporary_directory = std::string("/tmp");
+    partition_t                 f_partition = partition_t();
+    std::vector<std::uint8_t>   f_records = std::vector<std::uint8_t>();
+    std::vector<std::uint8_t const *>
+                                f_sorted = std::vector<std::uint8_t const *>();
+    run_t::vector_t             f_runs = run_t::vector_t();
+    std::uint64_t               f_count = 0;
+    level_t::vector_t           f_levels = level_t::vector_t();
+    block_entry_index::pointer_t
+                                f_previous_entry_index = block_entry_index::pointer_t();
+    tree_t::vector_t            f_trees = tree_t::vector_t();
+    std::vector<reference_t>    f_new_blocks = std::vector<reference_t>();
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,629 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief B+tree of `TIDX` and `EIDX` blocks.
+ *
+ * The key of each `TIDX` index is the smallest key of the child it
+ * references, except for the first index of a block which is ignored
+ * by the search (a key smaller than all the others goes to the first
+ * child). The blocks of one level are not linked together except for
+ * the `EIDX` which have a next and previous reference so an index can
+ * be walked in order.
+ *
+ * A full block gets split in two. The split keeps the keys evenly
+ * distributed except when the new key goes at the very end of the
+ * index. In that case, the keys are most certainly inserted in order
+ * (i.e. a counter or a date) and the left block keeps "fill factor"
+ * percent of the entries. With a fill factor of 100%, sequential inserts
+ * fill each block completely.
+ *
+ * When a block becomes less than 25% full, it gets merged with one of
+ * its siblings if the result fills at most "fill factor" percent of a
+ * block. Otherwise the block is left as is. An empty block is always
+ * removed.
+ */
+
+// self
+//
+#include    "prinbee/database/index_tree.h"
+
+#include    "prinbee/exception.h"
+#include    "prinbee/database/table.h"
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+index_tree::index_tree(table_pointer_t t, std::uint32_t key_size)
+    : f_table(t.get())
+    , f_key_size(key_size)
+{
+    if(key_size == 0)
+    {
+        throw invalid_parameter("the key size of an index_tree must be at least 1.");
+    }
+}
+
+
+std::uint32_t index_tree::get_key_size() const
+{
+    return f_key_size;
+}
+
+
+std::uint32_t index_tree::get_fill_factor() const
+{
+    return f_fill_factor;
+}
+
+
+/** \brief Change the fill factor of this index.
+ *
+ * The fill factor is the percentage of entries kept in the left block
+ * when a block gets split while adding a key at the end of the index.
+ * It is also the maximum fill of a block resulting from a merge.
+ *
+ * \exception invalid_parameter
+ * The fill factor must be between 50 and 100.
+ *
+ * \param[in] fill_factor  The new fill factor in percent.
+ */
+void index_tree::set_fill_factor(std::uint32_t fill_factor)
+{
+    if(fill_factor < MIN_INDEX_FILL_FACTOR
+    || fill_factor > MAX_INDEX_FILL_FACTOR)
+    {
+        throw invalid_parameter(
+                  "the index fill factor ("
+                + std::to_string(fill_factor)
+                + ") must be between "
+                + std::to_string(MIN_INDEX_FILL_FACTOR)
+                + " and "
+                + std::to_string(MAX_INDEX_FILL_FACTOR)
+                + ".");
+    }
+
+    f_fill_factor = fill_factor;
+}
+
+
+index_layout_t index_tree::get_layout() const
+{
+    return f_layout;
+}
+
+
+/** \brief Define the layout of the new blocks.
+ *
+ * Existing blocks keep their layout.
+ *
+ * \param[in] layout  The layout of the blocks created from now on.
+ */
+void index_tree::set_layout(index_layout_t layout)
+{
+    f_layout = layout;
+}
+
+
+/** \brief Search for \p key.
+ *
+ * \param[in] root  The reference to the root of the tree.
+ * \param[in] key  The key to search.
+ *
+ * \return The OID attached to \p key or NULL_FILE_ADDR if not found.
+ */
+oid_t index_tree::find(reference_t root, buffer_t const & key)
+{
+    if(root == NULL_FILE_ADDR)
+    {
+        return NULL_FILE_ADDR;
+    }
+
+    path_t::vector_t path;
+    bool rightmost(true);
+    std::uint32_t position(0);
+    return find_entry_index(root, key, path, rightmost)->find_entry(key, position);
+}
+
+
+/** \brief Search for the first key larger or equal to \p key.
+ *
+ * This function is used to start a range scan. It returns the `EIDX`
+ * where \p key would be inserted and sets \p position to the position
+ * of the first entry larger or equal to \p key in that block. When all
+ * the keys of that block are smaller, \p position is equal to the number
+ * of entries and the scan continues with the next `EIDX`.
+ *
+ * \param[in] root  The reference to the root of the tree.
+ * \param[in] key  The key to search.
+ * \param[out] position  The position of the first key larger or equal.
+ *
+ * \return The `EIDX` where the scan starts or nullptr if the index is empty.
+ */
+block_entry_index::pointer_t index_tree::lower_bound(reference_t root, buffer_t const & key, std::uint32_t & position)
+{
+    position = 0;
+    if(root == NULL_FILE_ADDR)
+    {
+        return block_entry_index::pointer_t();
+    }
+
+    path_t::vector_t path;
+    bool rightmost(true);
+    block_entry_index::pointer_t entry_index(find_entry_index(root, key, path, rightmost));
+    entry_index->find_entry(key, position);
+    return entry_index;
+}
+
+
+/** \brief Add \p key to the index.
+ *
+ * This function adds the \p key and its \p oid to the index. If the
+ * `EIDX` where the key goes is full, it gets split and the split gets
+ * propagated to the parent `TIDX` blocks. If the root gets split, a new
+ * root is created and \p root is updated.
+ *
+ * \param[in,out] root  The reference to the root of the tree.
+ * \param[in] key  The key to add.
+ * \param[in] oid  The OID of the row with that key.
+ *
+ * \return true if the key was added, false if it was already present.
+ */
+bool index_tree::insert(reference_t & root, buffer_t const & key, oid_t oid)
+{
+    if(root == NULL_FILE_ADDR)
+    {
+        block_entry_index::pointer_t entry_index(new_entry_index());
+        entry_index->add_entry(key, oid, 0);
+        root = entry_index->get_offset();
+        ++f_statistics.f_inserts;
+        return true;
+    }
+
+    path_t::vector_t path;
+    bool rightmost(true);
+    block_entry_index::pointer_t entry_index(find_entry_index(root, key, path, rightmost));
+    if(entry_index->find_entry(key) != NULL_FILE_ADDR)
+    {
+        return false;
+    }
+
+    std::uint32_t const position(entry_index->get_position());
+    std::uint32_t const count(entry_index->get_count());
+    std::uint32_t const max_count(entry_index->get_max_count());
+    ++f_statistics.f_inserts;
+    if(!entry_index->is_full())
+    {
+        entry_index->add_entry(key, oid, position);
+        return true;
+    }
+
+    std::uint32_t const split_position(get_split_position(count, max_count, position, rightmost));
+    block_entry_index::pointer_t right(new_entry_index());
+    entry_index->split(right, split_position);
+    if(position >= split_position)
+    {
+        right->add_entry(key, oid, position - split_position);
+    }
+    else
+    {
+        entry_index->add_entry(key, oid, position);
+    }
+    ++f_statistics.f_entry_index_splits;
+
+    insert_index(root, path, right->get_key(0), right->get_offset(), rightmost);
+
+    return true;
+}
+
+
+/** \brief Remove \p key from the index.
+ *
+ * This function removes the \p key from the index. When the `EIDX`
+ * becomes mostly empty, it gets merged with a sibling and the merge is
+ * propagated to the parent `TIDX` blocks. If the root ends up with a
+ * single child, that child becomes the new root. If the index becomes
+ * empty, \p root is set to NULL_FILE_ADDR.
+ *
+ * \param[in,out] root  The reference to the root of the tree.
+ * \param[in] key  The key to remove.
+ *
+ * \return true if the key was removed, false if it was not present.
+ */
+bool index_tree::remove(reference_t & root, buffer_t const & key)
+{
+    if(root == NULL_FILE_ADDR)
+    {
+        return false;
+    }
+
+    path_t::vector_t path;
+    bool rightmost(true);
+    block_entry_index::pointer_t entry_index(find_entry_index(root, key, path, rightmost));
+    if(entry_index->find_entry(key) == NULL_FILE_ADDR)
+    {
+        return false;
+    }
+
+    entry_index->remove_entry(entry_index->get_position());
+    ++f_statistics.f_removals;
+
+    std::uint32_t const count(entry_index->get_count());
+    if(count == 0)
+    {
+        unlink_entry_index(entry_index);
+        f_table->free_block(entry_index, true);
+        if(path.empty())
+        {
+            root = NULL_FILE_ADDR;
+            return true;
+        }
+        remove_index(root, path, path.back().f_position);
+        collapse_root(root);
+        return true;
+    }
+
+    std::uint32_t const max_count(entry_index->get_max_count());
+    if(path.empty()
+    || !is_underflow(count, max_count))
+    {
+        return true;
+    }
+
+    block_top_index::pointer_t parent(path.back().f_top_index);
+    std::uint32_t const position(path.back().f_position);
+    block_entry_index::pointer_t left;
+    block_entry_index::pointer_t right;
+    std::uint32_t right_position(0);
+    if(position + 1 < parent->get_count())
+    {
+        left = entry_index;
+        right = std::static_pointer_cast<block_entry_index>(f_table->get_block(parent->get_reference(position + 1)));
+        right_position = position + 1;
+    }
+    else if(position > 0)
+    {
+        left = std::static_pointer_cast<block_entry_index>(f_table->get_block(parent->get_reference(position - 1)));
+        right = entry_index;
+        right_position = position;
+    }
+    else
+    {
+        return true;
+    }
+    if(!can_merge(left->get_count(), right->get_count(), max_count)
+    || !left->can_merge(right))
+    {
+        return true;
+    }
+
+    left->merge(right);
+    f_table->free_block(right, true);
+    ++f_statistics.f_merges;
+
+    remove_index(root, path, right_position);
+    collapse_root(root);
+
+    return true;
+}
+
+
+index_tree_statistics_t index_tree::get_statistics() const
+{
+    return f_statistics;
+}
+
+
+block_entry_index::pointer_t index_tree::find_entry_index(
+      reference_t root
+    , buffer_t const & key
+    , path_t::vector_t & path
+    , bool & rightmost)
+{
+    block::pointer_t b(f_table->get_block(root));
+    while(b->get_dbtype() == dbtype_t::BLOCK_TYPE_TOP_INDEX)
+    {
+        block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(b));
+        std::uint32_t position(0);
+        reference_t const reference(top_index->find_index(key, position));
+        if(reference == NULL_FILE_ADDR)
+        {
+            throw corrupted_data(
+                      "found an empty block TIDX at "
+                    + std::to_string(top_index->get_offset())
+                    + " in an index.");
+        }
+        rightmost = rightmost && position + 1 == top_index->get_count();
+        path.push_back({ top_index, position });
+        b = f_table->get_block(reference);
+    }
+
+    if(b->get_dbtype() != dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+    {
+        throw type_mismatch(
+                  "Found unexpected block of type \""
+                + std::string(to_name(b->get_dbtype()))
+                + "\" in an index. Expected an \""
+                + to_name(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+                + "\".");
+    }
+
+    return std::static_pointer_cast<block_entry_index>(b);
+}
+
+
+std::uint32_t index_tree::get_split_position(
+      std::uint32_t count
+    , std::uint32_t max_count
+    , std::uint32_t position
+    , bool rightmost) const
+{
+    if(rightmost
+    && position >= count)
+    {
+        // keys are likely added in order, keep the left block full
+        //
+        std::uint32_t const keep(max_count * f_fill_factor / 100);
+        return std::max(std::min(keep, count), static_cast<std::uint32_t>(1));
+    }
+
+    return std::max(count / 2, static_cast<std::uint32_t>(1));
+}
+
+
+bool index_tree::is_underflow(std::uint32_t count, std::uint32_t max_count) const
+{
+    return count * 4 < max_count;
+}
+
+
+bool index_tree::can_merge(std::uint32_t count, std::uint32_t sibling_count, std::uint32_t max_count) const
+{
+    return count == 0
+        || sibling_count == 0
+        || (count + sibling_count) * 100 <= max_count * f_fill_factor;
+}
+
+
+block_entry_index::pointer_t index_tree::new_entry_index()
+{
+    block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(
+                    f_table->allocate_new_block(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)));
+    entry_index->set_key_size(f_key_size);
+    entry_index->set_layout(f_layout);
+    return entry_index;
+}
+
+
+block_top_index::pointer_t index_tree::new_top_index()
+{
+    block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(
+                    f_table->allocate_new_block(dbtype_t::BLOCK_TYPE_TOP_INDEX)));
+    top_index->set_size(sizeof(reference_t) + f_key_size);
+    top_index->set_layout(f_layout);
+    return top_index;
+}
+
+
+/** \brief Add a reference to a new child in the parent block.
+ *
+ * After a split, the new right block has to be added to the parent
+ * just after the block that was split. If the parent is full, it gets
+ * split too and so on up to the root.
+ *
+ * \param[in,out] root  The reference to the root of the tree.
+ * \param[in,out] path  The `TIDX` blocks from the root to the split block.
+ * \param[in] key  The smallest key of the new block.
+ * \param[in] reference  The reference to the new block.
+ * \param[in] rightmost  Whether the split happened at the end of the index.
+ */
+void index_tree::insert_index(
+      reference_t & root
+    , path_t::vector_t & path
+    , buffer_t const & key
+    , reference_t reference
+    , bool rightmost)
+{
+    buffer_t separator(key);
+    for(;;)
+    {
+        if(path.empty())
+        {
+            // the root was split, add a level
+            //
+            block_top_index::pointer_t top_index(new_top_index());
+            top_index->add_index(buffer_t(f_key_size, 0), root, 0);
+            top_index->add_index(separator, reference, 1);
+            root = top_index->get_offset();
+            ++f_statistics.f_new_roots;
+            return;
+        }
+
+        block_top_index::pointer_t top_index(path.back().f_top_index);
+        std::uint32_t const position(path.back().f_position + 1);
+        path.pop_back();
+
+        std::uint32_t const count(top_index->get_count());
+        std::uint32_t const max_count(top_index->get_max_count());
+        if(!top_index->is_full())
+        {
+            top_index->add_index(separator, reference, position);
+            return;
+        }
+
+        std::uint32_t const split_position(get_split_position(count, max_count, position, rightmost));
+        block_top_index::pointer_t right(new_top_index());
+        top_index->split(right, split_position);
+        if(position >= split_position)
+        {
+            right->add_index(separator, reference, position - split_position);
+        }
+        else
+        {
+            top_index->add_index(separator, reference, position);
+        }
+        ++f_statistics.f_top_index_splits;
+
+        separator = right->get_key(0);
+        reference = right->get_offset();
+    }
+}
+
+
+/** \brief Remove the index at \p position from the last block of \p path.
+ *
+ * When a child gets merged or becomes empty, its reference is removed
+ * from the parent. The parent may then become mostly empty and get
+ * merged with one of its siblings and so on up to the root.
+ *
+ * \param[in,out] root  The reference to the root of the tree.
+ * \param[in,out] path  The `TIDX` blocks from the root to the parent.
+ * \param[in] position  The position of the index to remove.
+ */
+void index_tree::remove_index(reference_t & root, path_t::vector_t & path, std::uint32_t position)
+{
+    block_top_index::pointer_t top_index(path.back().f_top_index);
+    path.pop_back();
+
+    top_index->remove_index(position);
+    std::uint32_t const count(top_index->get_count());
+    if(count == 0)
+    {
+        f_table->free_block(top_index, true);
+        if(path.empty())
+        {
+            root = NULL_FILE_ADDR;
+            return;
+        }
+        remove_index(root, path, path.back().f_position);
+        return;
+    }
+
+    std::uint32_t const max_count(top_index->get_max_count());
+    if(path.empty()
+    || !is_underflow(count, max_count))
+    {
+        return;
+    }
+
+    block_top_index::pointer_t parent(path.back().f_top_index);
+    std::uint32_t const parent_position(path.back().f_position);
+    block_top_index::pointer_t left;
+    block_top_index::pointer_t right;
+    std::uint32_t right_position(0);
+    if(parent_position + 1 < parent->get_count())
+    {
+        left = top_index;
+        right = std::static_pointer_cast<block_top_index>(f_table->get_block(parent->get_reference(parent_position + 1)));
+        right_position = parent_position + 1;
+    }
+    else if(parent_position > 0)
+    {
+        left = std::static_pointer_cast<block_top_index>(f_table->get_block(parent->get_reference(parent_position - 1)));
+        right = top_index;
+        right_position = parent_position;
+    }
+    else
+    {
+        return;
+    }
+    if(!can_merge(left->get_count(), right->get_count(), max_count)
+    || !left->can_merge(right))
+    {
+        return;
+    }
+
+    // the key of the first index of a block is ignored by the search so
+    // it may be larger than some of the keys of its child; once merged
+    // it becomes a real separator so use the key from the parent
+    //
+    reference_t const first(right->get_reference(0));
+    right->remove_index(0);
+    right->add_index(parent->get_key(right_position), first, 0);
+
+    left->merge(right);
+    f_table->free_block(right, true);
+    ++f_statistics.f_merges;
+
+    remove_index(root, path, right_position);
+}
+
+
+void index_tree::unlink_entry_index(block_entry_index::pointer_t entry_index)
+{
+    reference_t const previous(entry_index->get_previous());
+    reference_t const next(entry_index->get_next());
+    if(previous != NULL_FILE_ADDR)
+    {
+        std::static_pointer_cast<block_entry_index>(f_table->get_block(previous))->set_next(next);
+    }
+    if(next != NULL_FILE_ADDR)
+    {
+        std::static_pointer_cast<block_entry_index>(f_table->get_block(next))->set_previous(previous);
+    }
+    entry_index->set_previous(NULL_FILE_ADDR);
+    entry_index->set_next(NULL_FILE_ADDR);
+}
+
+
+/** \brief Remove the root levels with a single child.
+ *
+ * After merges, the root `TIDX` may end up with a single child. That
+ * level is useless so the child becomes the new root.
+ *
+ * \param[in,out] root  The reference to the root of the tree.
+ */
+void index_tree::collapse_root(reference_t & root)
+{
+    while(root != NULL_FILE_ADDR)
+    {
+        block::pointer_t b(f_table->get_block(root));
+        if(b->get_dbtype() != dbtype_t::BLOCK_TYPE_TOP_INDEX)
+        {
+            return;
+        }
+        block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(b));
+        if(top_index->get_count() != 1)
+        {
+            return;
+        }
+        root = top_index->get_reference(0);
+        f_table->free_block(top_index, true);
+        ++f_statistics.f_collapsed_roots;
+    }
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
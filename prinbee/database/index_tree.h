@@ -0,0 +1,132 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief B+tree of `TIDX` and `EIDX` blocks.
+ *
+ * An index is a B+tree where the leaves are `EIDX` blocks and the inner
+ * nodes are `TIDX` blocks. The root of the tree is saved by the owner of
+ * the index (i.e. one slot of the `PIDX` for the primary index, the
+ * `top_index` field of an `SIDX` for a secondary index).
+ *
+ * The index_tree takes care of splitting the blocks when they are full
+ * and merging them when they become mostly empty. The splits are
+ * propagated up to the root. When the root gets split, a new `TIDX` is
+ * created and the root reference changes. This is why the functions
+ * modifying the tree take the root by reference: the caller has to save
+ * the new root when it changes.
+ *
+ * The functions modifying the tree are not thread safe; the table calls
+ * them while holding its lock in exclusive mode. The searches, find()
+ * and lower_bound(), do not modify the blocks so many readers can search
+ * the same tree at once.
+ */
+
+// self
+//
+#include    "prinbee/block/block_entry_index.h"
+#include    "prinbee/block/block_top_index.h"
+
+
+// C++
+//
+#include    <vector>
+
+
+
+namespace prinbee
+{
+
+
+
+constexpr std::uint32_t             DEFAULT_INDEX_FILL_FACTOR = 90;
+constexpr std::uint32_t             MIN_INDEX_FILL_FACTOR = 50;
+constexpr std::uint32_t             MAX_INDEX_FILL_FACTOR = 100;
+
+
+struct index_tree_statistics_t
+{
+    std::size_t                     f_inserts = 0;
+    std::size_t                     f_removals = 0;
+    std::size_t                     f_entry_index_splits = 0;
+    std::size_t                     f_top_index_splits = 0;
+    std::size_t                     f_merges = 0;
+    std::size_t                     f_new_roots = 0;
+    std::size_t                     f_collapsed_roots = 0;
+};
+
+
+class index_tree
+{
+public:
+    typedef std::shared_ptr<index_tree>     pointer_t;
+
+                                index_tree(table_pointer_t t, std::uint32_t key_size);
+                                index_tree(index_tree const & rhs) = delete;
+
+    index_tree &                operator = (index_tree const & rhs) = delete;
+
+    std::uint32_t               get_key_size() const;
+    std::uint32_t               get_fill_factor() const;
+    void                        set_fill_factor(std::uint32_t fill_factor);
+    index_layout_t              get_layout() const;
+    void                        set_layout(index_layout_t layout);
+
+    oid_t                       find(reference_t root, buffer_t const & key);
+    block_entry_index::pointer_t
+                                lower_bound(reference_t root, buffer_t const & key, std::uint32_t & position);
+    bool                        insert(reference_t & root, buffer_t const & key, oid_t oid);
+    bool                        remove(reference_t & root, buffer_t const & key);
+    index_tree_statistics_t     get_statistics() const;
+
+private:
+    struct path_t
+    {
+        typedef std::vector<path_t> vector_t;
+
+        block_top_index::pointer_t
+                                f_top_index = block_top_index::pointer_t();
+        std::uint32_t           f_position = 0;
+    };
+
+    block_entry_index::pointer_t
+                                find_entry_index(reference_t root, buffer_t const & key, path_t::vector_t & path, bool & rightmost);
+    std::uint32_t               get_split_position(std::uint32_t count, std::uint32_t max_count, std::uint32_t position, bool rightmost) const;
+    bool                        is_underflow(std::uint32_t count, std::uint32_t max_count) const;
+    bool                        can_merge(std::uint32_t count, std::uint32_t sibling_count, std::uint32_t max_count) const;
+    block_entry_index::pointer_t
+                                new_entry_index();
+    block_top_index::pointer_t  new_top_index();
+    void                        insert_index(reference_t & root, path_t::vector_t & path, buffer_t const & key, reference_t reference, bool rightmost);
+    void                        remove_index(reference_t & root, path_t::vector_t & path, std::uint32_t position);
+    void                        unlink_entry_index(block_entry_index::pointer_t entry_index);
+    void                        collapse_root(reference_t & root);
+
+    table *                     f_table = nullptr;
+    std::uint32_t               f_key_size = 0;
+    std::uint32_t               f_fill_factor = DEFAULT_INDEX_FILL_FACTOR;
+    index_layout_t              f_layout = index_layout_t::INDEX_LAYOUT_SORTED;
+    index_tree_statistics_t     f_statistics = index_tree_statistics_t();
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,463 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Background deletion of the rows which expired.
+ *
+ * The reaper keeps one timer per table in a timer wheel. A timer is set
+ * to the expiration date of the first row found in the expiration index
+ * of its table. When a timer fires, the reaper calls table::expire_rows()
+ * and sets the timer again. If a whole batch of rows got deleted, more
+ * rows are likely waiting so the timer is set to fire immediately.
+ *
+ * The next expiration date of a table is also refreshed at regular
+ * intervals since rows inserted in the meantime may expire earlier.
+ */
+
+// self
+//
+#include    "prinbee/database/reaper.h"
+
+#include    "prinbee/exception.h"
+
+
+// snaplogger
+//
+#include    <snaplogger/message.h>
+
+
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/runner.h>
+
+
+// snapdev
+//
+#include    <snapdev/timespec_ex.h>
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+namespace
+{
+
+
+
+std::uint64_t get_current_time()
+{
+    snapdev::timespec_ex const now(snapdev::now());
+    return now.tv_sec * 1'000'000 + now.tv_nsec / 1'000;
+}
+
+
+
+} // no name namespace
+
+
+
+namespace detail
+{
+
+
+
+/** \brief Background thread deleting the expired rows.
+ *
+ * This runner calls run_once() on its reaper and then sleeps until the
+ * next timer is due, but never more than the refresh interval.
+ */
+class reaper_runner
+    : public cppthread::runner
+{
+public:
+                            reaper_runner(reaper * r, std::uint64_t refresh_interval);
+
+    virtual void            run() override;
+    void                    wakeup();
+
+private:
+    reaper *                f_reaper = nullptr;
+    std::uint64_t           f_refresh_interval = DEFAULT_REAPER_REFRESH_INTERVAL;
+};
+
+
+reaper_runner::reaper_runner(reaper * r, std::uint64_t refresh_interval)
+    : runner("reaper")
+    , f_reaper(r)
+    , f_refresh_interval(refresh_interval)
+{
+}
+
+
+void reaper_runner::run()
+{
+    while(continue_running())
+    {
+        std::uint64_t const now(get_current_time());
+        std::uint64_t next_wakeup(TIMER_WHEEL_NO_TIMER);
+        try
+        {
+            next_wakeup = f_reaper->run_once(now);
+        }
+        catch(std::exception const & e)
+        {
+            SNAP_LOG_ERROR
+                << "background row expiration failed: "
+                << e.what()
+                << SNAP_LOG_SEND;
+        }
+
+        // wait in microseconds
+        //
+        std::uint64_t wait(f_refresh_interval * 1000);
+        if(next_wakeup != TIMER_WHEEL_NO_TIMER)
+        {
+            std::uint64_t const current(get_current_time());
+            wait = std::clamp(
+                      next_wakeup > current ? next_wakeup - current : 0
+                    , static_cast<std::uint64_t>(1000)
+                    , wait);
+        }
+        {
+            cppthread::guard lock(f_mutex);
+            f_mutex.timed_wait(wait);
+        }
+    }
+}
+
+
+void reaper_runner::wakeup()
+{
+    cppthread::guard lock(f_mutex);
+    f_mutex.signal();
+}
+
+
+
+} // namespace detail
+
+
+
+/** \brief Initialize a reaper.
+ *
+ * The reaper starts without any tables. Use add_table() or add_context()
+ * to define the tables it takes care of.
+ *
+ * The thread does not get started automatically, call start() once
+ * the settings are as expected.
+ */
+reaper::reaper()
+    : f_timers(get_current_time())
+{
+}
+
+
+reaper::~reaper()
+{
+    stop();
+}
+
+
+/** \brief Add a table to the reaper.
+ *
+ * The reaper keeps a weak pointer to the table. Once the table is
+ * gone, the reaper forgets about it.
+ *
+ * The table gets checked on the next pass. Adding the same table
+ * twice has no effect.
+ *
+ * \param[in] t  The table of which expired rows get deleted.
+ */
+void reaper::add_table(table::pointer_t t)
+{
+    if(t == nullptr)
+    {
+        throw invalid_parameter("reaper::add_table() called with a null table.");
+    }
+
+    {
+        cppthread::guard lock(f_mutex);
+        for(auto const & it : f_tables)
+        {
+            if(it.second.lock() == t)
+            {
+                return;
+            }
+        }
+        timer_wheel::timer_id_t const id(f_next_id);
+        ++f_next_id;
+        f_tables[id] = t;
+        f_timers.add(id, f_timers.get_current_time());
+    }
+
+    if(f_runner != nullptr)
+    {
+        f_runner->wakeup();
+    }
+}
+
+
+/** \brief Add all the tables of a context which can expire rows.
+ *
+ * Only the tables with an expiration date column get added.
+ *
+ * \param[in] c  The context with the tables to add.
+ */
+void reaper::add_context(context::pointer_t c)
+{
+    for(auto const & it : c->list_tables())
+    {
+        if(it.second->get_schema()->has_expiration_date_column())
+        {
+            add_table(it.second);
+        }
+    }
+}
+
+
+/** \brief Remove a table from the reaper.
+ *
+ * \param[in] t  The table to remove.
+ *
+ * \return true if the table was found and removed.
+ */
+bool reaper::remove_table(table::pointer_t t)
+{
+    cppthread::guard lock(f_mutex);
+    for(auto it(f_tables.begin()); it != f_tables.end(); ++it)
+    {
+        if(it->second.lock() == t)
+        {
+            f_timers.remove(it->first);
+            f_tables.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+std::size_t reaper::get_table_count() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_tables.size();
+}
+
+
+/** \brief Define the maximum number of rows deleted per table per pass.
+ *
+ * Use 0 to delete all the expired rows of a table in one pass.
+ *
+ * \param[in] batch_size  The number of rows one pass can delete.
+ */
+void reaper::set_batch_size(std::size_t batch_size)
+{
+    cppthread::guard lock(f_mutex);
+    f_batch_size = batch_size;
+}
+
+
+std::size_t reaper::get_batch_size() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_batch_size;
+}
+
+
+/** \brief Define the number of milliseconds between two refreshes.
+ *
+ * The next expiration date of a table is checked again at least once
+ * per interval. The new interval is used the next time the thread gets
+ * started.
+ *
+ * \param[in] interval  The interval in milliseconds.
+ */
+void reaper::set_refresh_interval(std::uint64_t interval)
+{
+    if(interval == 0)
+    {
+        throw invalid_parameter("the reaper refresh interval must be at least 1 millisecond.");
+    }
+
+    cppthread::guard lock(f_mutex);
+    f_refresh_interval = interval;
+}
+
+
+std::uint64_t reaper::get_refresh_interval() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_refresh_interval;
+}
+
+
+void reaper::start()
+{
+    if(f_thread != nullptr)
+    {
+        return;
+    }
+
+    f_runner = std::make_shared<detail::reaper_runner>(this, get_refresh_interval());
+    f_thread = std::make_shared<cppthread::thread>("reaper", f_runner);
+    f_thread->start();
+}
+
+
+void reaper::stop()
+{
+    if(f_thread == nullptr)
+    {
+        return;
+    }
+
+    f_thread->stop([this](cppthread::thread *)
+        {
+            f_runner->wakeup();
+        });
+    f_thread.reset();
+    f_runner.reset();
+}
+
+
+bool reaper::is_running() const
+{
+    return f_thread != nullptr;
+}
+
+
+/** \brief Delete the rows which expired at \p now.
+ *
+ * This function is called by the background thread. It can also be
+ * called directly, for example, to purge the tables before a backup.
+ *
+ * Each table with a timer due at \p now gets up to one batch of rows
+ * deleted and its timer set again.
+ *
+ * \param[in] now  The current time in microseconds.
+ *
+ * \return The time of the next timer or TIMER_WHEEL_NO_TIMER.
+ */
+std::uint64_t reaper::run_once(std::uint64_t now)
+{
+    timer_wheel::timer_id_vector_t expired;
+    std::size_t batch_size(0);
+    std::uint64_t refresh(0);
+    {
+        cppthread::guard lock(f_mutex);
+        f_timers.advance(now, expired);
+        batch_size = f_batch_size;
+        refresh = f_refresh_interval * 1000;
+        ++f_statistics.f_passes;
+    }
+
+    for(auto const id : expired)
+    {
+        table::pointer_t t;
+        {
+            cppthread::guard lock(f_mutex);
+            auto it(f_tables.find(id));
+            if(it == f_tables.end())
+            {
+                continue;
+            }
+            t = it->second.lock();
+            if(t == nullptr)
+            {
+                f_tables.erase(it);
+                continue;
+            }
+        }
+
+        std::size_t deleted(0);
+        std::uint64_t next(now + refresh);
+        try
+        {
+            deleted = t->expire_rows(now, batch_size);
+            if(batch_size != 0
+            && deleted >= batch_size)
+            {
+                // there are probably more rows to delete
+                //
+                next = now;
+            }
+            else
+            {
+                std::uint64_t const expiration(t->get_next_expiration());
+                if(expiration != 0)
+                {
+                    next = std::min(next, expiration);
+                }
+            }
+        }
+        catch(std::exception const & e)
+        {
+            SNAP_LOG_ERROR
+                << "could not delete expired rows of table \""
+                << t->get_name()
+                << "\": "
+                << e.what()
+                << SNAP_LOG_SEND;
+
+            cppthread::guard lock(f_mutex);
+            ++f_statistics.f_errors;
+        }
+
+        cppthread::guard lock(f_mutex);
+        ++f_statistics.f_tables_visited;
+        f_statistics.f_rows_deleted += deleted;
+        if(f_tables.find(id) != f_tables.end())
+        {
+            f_timers.add(id, next);
+        }
+    }
+
+    cppthread::guard lock(f_mutex);
+    return f_timers.get_next_wakeup();
+}
+
+
+/** \brief Retrieve the statistics accumulated by all the passes.
+ *
+ * \return A copy of the accumulated statistics.
+ */
+reaper_statistics_t reaper::get_statistics() const
+{
+    cppthread::guard lock(f_mutex);
+    return f_statistics;
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,123 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Background deletion of the rows which expired.
+ *
+ * The reaper runs a thread which deletes the rows of a set of tables
+ * once their expiration date is reached. The reaper does not scan the
+ * tables. Instead, it asks each table for the date of its next
+ * expiration (the first entry of its expiration index) and keeps that
+ * date in a timer wheel. The thread sleeps until the next date in the
+ * wheel is reached.
+ *
+ * Each pass deletes at most a batch of rows per table so a large number
+ * of rows expiring at once does not block the other tables.
+ */
+
+// self
+//
+#include    "prinbee/database/context.h"
+#include    "prinbee/database/timer_wheel.h"
+
+
+// cppthread
+//
+#include    <cppthread/mutex.h>
+#include    <cppthread/thread.h>
+
+
+
+namespace prinbee
+{
+
+
+
+namespace detail
+{
+class reaper_runner;
+}
+
+
+constexpr std::size_t               DEFAULT_REAPER_BATCH_SIZE = 1000;                   // in rows per table per pass
+constexpr std::uint64_t             DEFAULT_REAPER_REFRESH_INTERVAL = 60000;            // in milliseconds
+
+
+/** \brief Counters of the reaper.
+ *
+ * The reaper::get_statistics() function returns these counters.
+ */
+struct reaper_statistics_t
+{
+    std::uint64_t               f_passes = 0;
+    std::uint64_t               f_tables_visited = 0;
+    std::uint64_t               f_rows_deleted = 0;
+    std::uint64_t               f_errors = 0;
+};
+
+
+class reaper
+{
+public:
+    typedef std::shared_ptr<reaper> pointer_t;
+
+                                reaper();
+                                reaper(reaper const & rhs) = delete;
+                                ~reaper();
+
+    reaper &                    operator = (reaper const & rhs) = delete;
+
+    void                        add_table(table::pointer_t t);
+    void                        add_context(context::pointer_t c);
+    bool                        remove_table(table::pointer_t t);
+    std::size_t                 get_table_count() const;
+
+    void                        set_batch_size(std::size_t batch_size);
+    std::size_t                 get_batch_size() const;
+    void                        set_refresh_interval(std::uint64_t interval);
+    std::uint64_t               get_refresh_interval() const;
+
+    void                        start();
+    void                        stop();
+    bool                        is_running() const;
+    std::uint64_t               run_once(std::uint64_t now);
+    reaper_statistics_t         get_statistics() const;
+
+private:
+    typedef std::map<timer_wheel::timer_id_t, table::weak_pointer_t>
+                                table_map_t;
+
+    mutable cppthread::mutex    f_mutex = cppthread::mutex();
+    std::size_t                 f_batch_size = DEFAULT_REAPER_BATCH_SIZE;
+    std::uint64_t               f_refresh_interval = DEFAULT_REAPER_REFRESH_INTERVAL;
+    timer_wheel                 f_timers;
+    timer_wheel::timer_id_t     f_next_id = 1;
+    table_map_t                 f_tables = table_map_t();
+    reaper_statistics_t         f_statistics = reaper_statistics_t();
+    std::shared_ptr<detail::reaper_runner>
+                                f_runner = std::shared_ptr<detail::reaper_runner>();
+    cppthread::thread::pointer_t
+                                f_thread = cppthread::thread::pointer_t();
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -36,7 +36,8 @@
 
 // C++
 //
-#include    <iostream>
+#include    <algorithm>
+#include    <limits>
 
 
 // last include
@@ -73,6 +74,160 @@ namespace
 std::uint32_t   g_murmur3_seed = 0x6BC4A931;
 
 
+/** \brief Flag marking a row saved with a column directory.
+ *
+ * A row blob starts with the version of the schema used to save it. When
+ * this bit is set in that version, the version is followed by a directory
+ * of the cells sorted by column identifier. Each entry is the column
+ * identifier followed by the offset of the value in the blob. This allows
+ * for decoding a few of the cells without having to go through the others.
+ *
+ * The rows saved without this bit have the column identifier saved in
+ * front of each value instead.
+ */
+constexpr std::uint32_t     ROW_FLAG_COLUMN_DIRECTORY = 0x80000000;
+constexpr std::size_t       ROW_DIRECTORY_ENTRY_SIZE = sizeof(std::uint16_t) + sizeof(std::uint32_t);
+
+
+struct row_directory_t
+{
+    column_id_t get_column_id(std::size_t idx) const
+    {
+        std::size_t pos(idx * ROW_DIRECTORY_ENTRY_SIZE);
+        return cell::column_id_from_binary(f_entries, pos);
+    }
+
+    std::uint32_t get_offset(std::size_t idx) const
+    {
+        std::size_t pos(idx * ROW_DIRECTORY_ENTRY_SIZE + sizeof(std::uint16_t));
+        return read_be_uint32(f_entries, pos);
+    }
+
+    bool find(column_id_t column_id, std::uint32_t & offset) const
+    {
+        std::size_t i(0);
+        std::size_t j(f_count);
+        while(i < j)
+        {
+            std::size_t const mid((i + j) / 2);
+            column_id_t const id(get_column_id(mid));
+            if(id == column_id)
+            {
+                offset = get_offset(mid);
+                return true;
+            }
+            if(id < column_id)
+            {
+                i = mid + 1;
+            }
+            else
+            {
+                j = mid;
+            }
+        }
+        return false;
+    }
+
+    std::uint8_t const *    f_entries = nullptr;    // nullptr if the row has no directory
+    std::size_t             f_count = 0;
+};
+
+
+/** \brief Read the header of a row blob.
+ *
+ * \param[in] blob  The blob of the row.
+ * \param[out] version  The version of the schema used to save the row.
+ * \param[out] directory  The column directory, if the row has one.
+ *
+ * \return The position of the first cell.
+ */
+std::size_t read_row_header(std::uint8_t const * blob, schema_version_t & version, row_directory_t & directory)
+{
+    std::size_t pos(0);
+    std::uint32_t const header(read_be_uint32(blob, pos));
+    version = header & ~ROW_FLAG_COLUMN_DIRECTORY;
+    if((header & ROW_FLAG_COLUMN_DIRECTORY) != 0)
+    {
+        directory.f_count = read_be_uint16(blob, pos);
+        directory.f_entries = blob + pos;
+        pos += directory.f_count * ROW_DIRECTORY_ENTRY_SIZE;
+    }
+    return pos;
+}
+
+
+/** \brief Get the schema used to save a row.
+ *
+ * \exception schema_not_found
+ * The schema with that version is not available.
+ *
+ * \param[in] t  The table of the row.
+ * \param[in] version  The version found in the row.
+ *
+ * \return The schema with that version.
+ */
+schema_table::pointer_t get_row_schema(table::pointer_t t, schema_version_t version)
+{
+    if(version == t->get_schema_version())
+    {
+        return t->get_schema();
+    }
+
+    schema_table::pointer_t schema(t->get_schema(version));
+    if(schema == nullptr)
+    {
+        throw schema_not_found(
+                  "schema version "
+                + std::to_string(version)
+                + " of table \""
+                + t->get_name()
+                + "\" is not available.");
+    }
+    return schema;
+}
+
+
+/** \brief Convert the expiration date cell to microseconds.
+ *
+ * \exception type_mismatch
+ * The "expiration_date" column must be of type TIME, MSTIME, or USTIME.
+ *
+ * \param[in] t  The table of the row, used for the error message.
+ * \param[in] c  The "expiration_date" cell or nullptr.
+ *
+ * \return The expiration date in microseconds or 0 if not defined.
+ */
+std::uint64_t expiration_date_to_us(table::pointer_t t, cell::pointer_t c)
+{
+    if(c == nullptr
+    || c->is_void())
+    {
+        return 0;
+    }
+
+    switch(c->type())
+    {
+    case struct_type_t::STRUCT_TYPE_TIME:
+        return c->get_time() * 1'000'000;
+
+    case struct_type_t::STRUCT_TYPE_MSTIME:
+        return c->get_time_ms() * 1'000;
+
+    case struct_type_t::STRUCT_TYPE_USTIME:
+        return c->get_time_us();
+
+    default:
+        throw type_mismatch(
+                  "the \""
+                + std::string(g_expiration_date_column)
+                + "\" column of table \""
+                + t->get_name()
+                + "\" must be of type TIME, MSTIME, or USTIME.");
+
+    }
+}
+
+
 
 } // no name namespace
 
@@ -81,6 +236,14 @@ std::uint32_t   g_murmur3_seed = 0x6BC4A931;
 row::row(table::pointer_t t)
     : f_table(t)
 {
+    // one slot per column so decoding a row does not allocate each cell
+    //
+    if(t != nullptr)
+    {
+        std::size_t const count(t->get_schema()->get_max_column_id());
+        f_cells.resize(count, cell(schema_column::pointer_t()));
+        f_defined.resize((count + 63) / 64);
+    }
 }
 
 
@@ -98,7 +261,29 @@ buffer_t row::to_binary() const
     // data whatever the version
     //
     table::pointer_t t(get_table());
-    push_be_uint32(result, t->get_schema_version());
+    push_be_uint32(result, t->get_schema_version() | ROW_FLAG_COLUMN_DIRECTORY);
+
+    // the cells are in the array sorted by column identifier and the
+    // columns added later have larger identifiers so the directory is
+    // sorted as expected
+    //
+    std::vector<cell const *> defined;
+    defined.reserve(f_cells.size() + f_added_cells.size());
+    for(std::size_t idx(0); idx < f_cells.size(); ++idx)
+    {
+        if((f_defined[idx / 64] & (1ULL << (idx % 64))) != 0)
+        {
+            defined.push_back(&f_cells[idx]);
+        }
+    }
+    for(auto const & c : f_added_cells)
+    {
+        defined.push_back(c.second.get());
+    }
+
+    push_be_uint16(result, defined.size());
+    std::size_t const directory(result.size());
+    result.resize(directory + defined.size() * ROW_DIRECTORY_ENTRY_SIZE);
 
     // TODO: have several loops:
     //
@@ -109,10 +294,18 @@ buffer_t row::to_binary() const
     // Ultimately, filters should work against any columns, but speed wise
     // it's just not good if compressed and/or encrypted;
     //
-    for(auto const & c : f_cells)
+    for(std::size_t idx(0); idx < defined.size(); ++idx)
     {
-        c.second->column_id_to_binary(result);
-        c.second->value_to_binary(result);
+        std::uint8_t * entry(result.data() + directory + idx * ROW_DIRECTORY_ENTRY_SIZE);
+        column_id_t const column_id(defined[idx]->schema()->get_column_id());
+        std::uint32_t const offset(result.size());
+        entry[0] = column_id >> 8;
+        entry[1] = column_id;
+        entry[2] = offset >> 24;
+        entry[3] = offset >> 16;
+        entry[4] = offset >> 8;
+        entry[5] = offset;
+        defined[idx]->value_to_binary(result);
     }
 
     if(result.size() > std::numeric_limits<std::uint32_t>::max())
@@ -132,87 +325,170 @@ buffer_t row::to_binary() const
  * This function transforms the specified \p blob in a set of cells in this
  * row.
  *
+ * When \p projection is not empty, only the cells of those columns get
+ * decoded. The row is then incomplete and must not be written back to the
+ * database.
+ *
  * \todo
- * We need to consider looking into not defining all the cells if the user
- * only asked for a few of them. This may actually be a feature to implement
- * in the to_binary() function. In any event, if a SELECT only requests
- * column "A" then we should only return that one column and not all of them.
- * This will save us a lot of bandwidth, but it also means that the row is
- * incomplete and can't be written back to the database. So we have to have
- * a form of special case. (We also want to support updates without all the
- * data available in the row; i.e. with parts only available on disk...)
- * i.e. an UPDATE table-name SET column-name = 123 WHERE primary-key = 'abc';
+ * We also want to support updates without all the data available in the
+ * row (i.e. with parts only available on disk...) as in
+ * an UPDATE table-name SET column-name = 123 WHERE primary-key = 'abc';
  * is "complicated" if the column cannot just be overwritten--that is, we
  * need all the columns to re-write the row somewhere else.
  *
  * \param[in] blob  The blob to extract to this row object.
+ * \param[in] projection  The sorted identifiers of the columns to decode or
+ * an empty list to decode all the cells.
+ */
+void row::from_binary(buffer_t const & blob, column_ids_t const & projection)
+{
+    from_binary(blob.data(), blob.size(), projection);
+}
+
+
+/** \brief Transform a blob into a set of cells in a row.
+ *
+ * This function is an overload which reads the blob directly from memory
+ * such as the block where the row is saved. This avoids a copy of the
+ * data in a buffer first.
+ *
+ * The row includes a directory of its cells so the cells of a projection
+ * are found without going through the other cells.
+ *
+ * \param[in] blob  A pointer to the blob to extract to this row object.
+ * \param[in] size  The size of the blob in bytes.
+ * \param[in] projection  The sorted identifiers of the columns to decode or
+ * an empty list to decode all the cells.
  */
-void row::from_binary(buffer_t const & blob)
+void row::from_binary(std::uint8_t const * blob, std::size_t size, column_ids_t const & projection)
 {
     table::pointer_t t(f_table.lock());
-    size_t pos(0);
-    schema_version_t const version(read_be_uint32(blob, pos));
-    if(version != t->get_schema_version())
+    schema_version_t version(0);
+    row_directory_t directory;
+    std::size_t pos(read_row_header(blob, version, directory));
+    schema_table::pointer_t schema(get_row_schema(t, version));
+
+    if(directory.f_entries != nullptr)
     {
+        if(!projection.empty()
+        && version == t->get_schema_version())
+        {
+            for(auto const column_id : projection)
+            {
+                std::uint32_t offset(0);
+                if(directory.find(column_id, offset))
+                {
+                    std::size_t p(offset);
+                    cell_from_binary(schema, column_id, blob, p, projection);
+                }
+            }
+            return;
+        }
+
         // the schema changed, make sure to
         //
         // read & convert the old row
         //    AND
         // save the new version of the row to the database
         //
-        while(pos < blob.size())
+        for(std::size_t idx(0); idx < directory.f_count; ++idx)
         {
-            column_id_t const column_id(cell::column_id_from_binary(blob, pos));
-            schema_column::pointer_t exist_schema(t->get_column(column_id, version));
-            if(exist_schema == nullptr)
-            {
-                throw column_not_found(
-                          "column with identifier "
-                        + std::to_string(static_cast<int>(column_id))
-                        + " does not exist in \""
-                        + get_table()->get_name()
-                        + "\" schema version "
-                        + std::to_string(version)
-                        + " (from_binary).");
-            }
-            cell::pointer_t c(std::make_shared<cell>(exist_schema));
-            c->value_from_binary(blob, pos); // we MUST read or skip that data, so make sure to do that
-
-            schema_column::pointer_t current_schema(t->get_column(exist_schema->get_name()));
-            if(current_schema != nullptr)
-            {
-                cell::pointer_t cell(get_cell(column_id, true));
-                cell->copy_from(*c);
-            }
-            //else -- instead of a useless call to c->value_from_binary() we should also have a c->skip_binary_value()
+            std::size_t p(directory.get_offset(idx));
+            cell_from_binary(schema, directory.get_column_id(idx), blob, p, projection);
         }
+        return;
     }
-    else
+
+    // rows saved before the column directory was added
+    //
+    while(pos + sizeof(std::uint16_t) <= size)
     {
-        while(pos + sizeof(std::uint16_t) <= blob.size())
+        column_id_t const column_id(cell::column_id_from_binary(blob, pos));
+        if(column_id == 0)
         {
-            column_id_t const column_id(cell::column_id_from_binary(blob, pos));
-            if(column_id == 0)
-            {
-                // this happens because we align the data (although we may
-                // not want to do that?)
-                break;
-            }
-
-std::cerr << "READ COLUMN DATA... pos = " << pos << " vs " << blob.size() << " column ID " << column_id << "\n";
-            cell::pointer_t cell(get_cell(column_id, true));
-            cell->value_from_binary(blob, pos);
+            // this happens because we align the data (although we may
+            // not want to do that?)
+            break;
         }
+        cell_from_binary(schema, column_id, blob, pos, projection);
+    }
+}
+
+
+/** \brief Decode one cell of a blob.
+ *
+ * The \p schema is the schema used to save the row. If it is not the
+ * current schema, the value is converted to the current column with the
+ * same name. The cells of columns which were deleted since and the cells
+ * not included in the \p projection are skipped.
+ *
+ * \exception column_not_found
+ * The blob references a column which does not exist in its schema.
+ *
+ * \param[in] schema  The schema used to save the row.
+ * \param[in] column_id  The identifier of the column in \p schema.
+ * \param[in] blob  The blob of the row.
+ * \param[in,out] pos  The position of the value, moved after it.
+ * \param[in] projection  The sorted identifiers of the columns to decode.
+ */
+void row::cell_from_binary(
+      schema_table::pointer_t schema
+    , column_id_t column_id
+    , std::uint8_t const * blob
+    , std::size_t & pos
+    , column_ids_t const & projection)
+{
+    table::pointer_t t(f_table.lock());
+    schema_column::pointer_t column(schema->get_column(column_id));
+    if(column == nullptr)
+    {
+        throw column_not_found(
+                  "column with identifier "
+                + std::to_string(static_cast<int>(column_id))
+                + " does not exist in \""
+                + t->get_name()
+                + "\" schema version "
+                + std::to_string(schema->get_schema_version())
+                + " (from_binary).");
+    }
+
+    schema_column::pointer_t current(column);
+    if(schema != t->get_schema())
+    {
+        current = t->get_column(column->get_name());
+    }
+    if(current == nullptr
+    || (!projection.empty()
+        && !std::binary_search(projection.begin(), projection.end(), current->get_column_id())))
+    {
+        cell::skip_binary_value(column, blob, pos);
+        return;
+    }
+
+    cell * c(find_cell(current->get_column_id()));
+    if(c == nullptr)
+    {
+        c = add_cell(current);
+    }
+    if(current == column)
+    {
+        c->value_from_binary(blob, pos);
+    }
+    else
+    {
+        cell value(column);
+        value.value_from_binary(blob, pos);
+        c->copy_from(value);
     }
 }
 
 
 cell::pointer_t row::get_cell(column_id_t const & column_id, bool create)
 {
-    auto it(f_cells.find(column_id));
-    if(it != f_cells.end())
+    cell * c(find_cell(column_id));
+    if(c != nullptr)
     {
-            return it->second;
+        return get_pointer(c);
     }
 
     schema_column::pointer_t column(get_table()->get_column(column_id));
@@ -231,9 +507,7 @@ cell::pointer_t row::get_cell(column_id_t const & column_id, bool create)
         return cell::pointer_t();
     }
 
-    cell::pointer_t c(std::make_shared<cell>(column));
-    f_cells[column_id] = c;
-    return c;
+    return get_pointer(add_cell(column));
 }
 
 
@@ -250,10 +524,10 @@ cell::pointer_t row::get_cell(std::string const & column_name, bool create)
                 + "\".");
     }
 
-    auto it(f_cells.find(column->get_column_id()));
-    if(it != f_cells.end())
+    cell * c(find_cell(column->get_column_id()));
+    if(c != nullptr)
     {
-            return it->second;
+        return get_pointer(c);
     }
 
     if(!create)
@@ -261,18 +535,28 @@ cell::pointer_t row::get_cell(std::string const & column_name, bool create)
         return cell::pointer_t();
     }
 
-    cell::pointer_t c(std::make_shared<cell>(column));
-    f_cells[column->get_column_id()] = c;
-    return c;
+    return get_pointer(add_cell(column));
 }
 
 
 void row::delete_cell(column_id_t const & column_id)
 {
-    auto it(f_cells.find(column_id));
-    if(it != f_cells.end())
+    std::size_t const idx(column_id - 1);
+    if(column_id > 0
+    && idx < f_cells.size())
+    {
+        // keep the column so a cell pointer still held by the caller
+        // remains valid
+        //
+        f_defined[idx / 64] &= ~(1ULL << (idx % 64));
+        f_cells[idx] = cell(f_cells[idx].schema());
+        return;
+    }
+
+    auto it(f_added_cells.find(column_id));
+    if(it != f_added_cells.end())
     {
-        f_cells.erase(it);
+        f_added_cells.erase(it);
     }
 }
 
@@ -294,9 +578,48 @@ void row::delete_cell(std::string const & column_name)
 }
 
 
+/** \brief Get the cells defined in this row.
+ *
+ * The cells are saved in an array within the row. The pointers returned
+ * here share the ownership of the row.
+ *
+ * \return A map of the cells defined in this row by column identifier.
+ */
 cell::map_t row::cells() const
 {
-    return f_cells;
+    cell::map_t result(f_added_cells);
+    for(std::size_t idx(0); idx < f_cells.size(); ++idx)
+    {
+        if((f_defined[idx / 64] & (1ULL << (idx % 64))) != 0)
+        {
+            result[idx + 1] = get_pointer(const_cast<cell *>(&f_cells[idx]));
+        }
+    }
+    return result;
+}
+
+
+/** \brief Get the date when this row expires.
+ *
+ * If the table has an "expiration_date" column and that column is set in
+ * this row, then the row gets deleted once that date is reached. This
+ * function returns that date in microseconds whatever the type of the
+ * column.
+ *
+ * \exception type_mismatch
+ * The "expiration_date" column must be of type TIME, MSTIME, or USTIME.
+ *
+ * \return The expiration date in microseconds or 0 if the row does not
+ * expire.
+ */
+std::uint64_t row::get_expiration_date()
+{
+    if(!get_table()->get_schema()->has_expiration_date_column())
+    {
+        return 0;
+    }
+
+    return expiration_date_to_us(get_table(), get_cell(g_expiration_date_column, false));
 }
 
 
@@ -403,9 +726,9 @@ void row::generate_mumur3(buffer_t & murmur3, version_t version, std::string con
 // this is why we have a max. number of versions and that should
 // remain fairly small)
 //
-throw not_yet_implemented("we have to fix the version/language usage: i.e. it's a sub-index, not part of the primary index");
     if(!version.is_null())
     {
+throw not_yet_implemented("we have to fix the version/language usage: i.e. it's a sub-index, not part of the primary index");
         // at least we have a branch, maybe a revision too
         //
         if(add_separator)
@@ -434,5 +757,418 @@ throw not_yet_implemented("we have to fix the version/language usage: i.e. it's
 }
 
 
+/** \brief Generate the key of this row in a secondary index.
+ *
+ * The key is the concatenation of the sort columns of the \p index. Each
+ * column starts with one byte defining whether the column is null. That
+ * byte places the nulls before or after the other values as defined by
+ * the sort column. The value is then saved with cell::value_to_key().
+ * For a descending column, the bytes of the value are inverted.
+ *
+ * When \p bound is true, the row represents the minimum or maximum of a
+ * range as defined in the conditions. In that case, the key ends at the
+ * first missing column so that column and the following ones match any
+ * value. To use such a key as a maximum, the caller appends a 0xFF byte.
+ *
+ * \todo
+ * The key script of the sort columns is not yet supported.
+ *
+ * \exception column_not_found
+ * A column which does not accept nulls is not defined in this row.
+ *
+ * \param[in] index  The secondary index for which the key gets generated.
+ * \param[out] key  The buffer where the key gets saved.
+ * \param[in] bound  Whether this row is the bound of a range.
+ *
+ * \return true if at least one of the columns is null.
+ */
+bool row::generate_secondary_key(schema_secondary_index::pointer_t index, buffer_t & key, bool bound)
+{
+    key.clear();
+    bool has_null(false);
+    std::size_t const max(index->get_column_count());
+    for(std::size_t idx(0); idx < max; ++idx)
+    {
+        schema_sort_column::pointer_t sc(index->get_sort_column(idx));
+        cell::pointer_t const c(get_cell(sc->get_column_id(), false));
+        if(c == nullptr
+        || c->is_void())
+        {
+            if(bound)
+            {
+                break;
+            }
+            if(!sc->accept_null_columns())
+            {
+                throw column_not_found(
+                          "column #"
+                        + std::to_string(sc->get_column_id())
+                        + " is required by secondary index \""
+                        + index->get_name()
+                        + "\".");
+            }
+            has_null = true;
+            push_uint8(key, sc->place_nulls_last()
+                                ? SECONDARY_KEY_NULL_LAST
+                                : SECONDARY_KEY_NULL_FIRST);
+            continue;
+        }
+
+        push_uint8(key, SECONDARY_KEY_VALUE);
+        std::size_t const start(key.size());
+        c->value_to_key(key);
+        if(sc->is_descending())
+        {
+            for(std::size_t pos(start); pos < key.size(); ++pos)
+            {
+                key[pos] = ~key[pos];
+            }
+        }
+    }
+
+    return has_null;
+}
+
+
+/** \brief Search the cell of \p column_id.
+ *
+ * \param[in] column_id  The identifier of the column.
+ *
+ * \return A pointer to the cell or nullptr if not defined in this row.
+ */
+cell * row::find_cell(column_id_t column_id)
+{
+    std::size_t const idx(column_id - 1);
+    if(column_id > 0
+    && idx < f_cells.size())
+    {
+        if((f_defined[idx / 64] & (1ULL << (idx % 64))) == 0)
+        {
+            return nullptr;
+        }
+        return &f_cells[idx];
+    }
+
+    auto it(f_added_cells.find(column_id));
+    if(it != f_added_cells.end())
+    {
+        return it->second.get();
+    }
+    return nullptr;
+}
+
+
+/** \brief Define the cell of \p column in this row.
+ *
+ * The cell is saved in the array of cells unless the column was added
+ * to the schema after this row was created.
+ *
+ * \param[in] column  The column of the new cell.
+ *
+ * \return A pointer to the new cell.
+ */
+cell * row::add_cell(schema_column::pointer_t column)
+{
+    column_id_t const column_id(column->get_column_id());
+    std::size_t const idx(column_id - 1);
+    if(column_id > 0
+    && idx < f_cells.size())
+    {
+        f_defined[idx / 64] |= 1ULL << (idx % 64);
+        f_cells[idx] = cell(column);
+        return &f_cells[idx];
+    }
+
+    cell::pointer_t c(std::make_shared<cell>(column));
+    f_added_cells[column_id] = c;
+    return c.get();
+}
+
+
+/** \brief Return a shared pointer to \p c.
+ *
+ * The cells saved in the array belong to the row, so the pointer shares
+ * the ownership of the row instead of allocating a control block.
+ *
+ * \param[in] c  The cell to return.
+ *
+ * \return A shared pointer to the cell.
+ */
+cell::pointer_t row::get_pointer(cell * c) const
+{
+    if(f_cells.empty()
+    || c < &f_cells.front()
+    || c > &f_cells.back())
+    {
+        return f_added_cells.at(c->schema()->get_column_id());
+    }
+
+    return cell::pointer_t(std::const_pointer_cast<row>(weak_from_this().lock()), c);
+}
+
+
+
+/** \class row_view
+ * \brief A read-only view of a row saved in a block.
+ *
+ * The view points directly to the blob of the row in the block where it
+ * is saved. Nothing gets copied and the cells are only decoded when
+ * accessed. The first access finds the position of each cell in the
+ * blob without decoding the values.
+ *
+ * The view keeps the block pinned. However, it is only valid until the
+ * row gets updated, deleted, or moved by a compaction. Use to_row() to
+ * get a copy which remains valid.
+ */
+
+
+/** \brief Initialize a view of a row.
+ *
+ * \param[in] t  The table the row is part of.
+ * \param[in] b  The block where the row is saved.
+ * \param[in] blob  A pointer to the blob of the row in block \p b.
+ * \param[in] size  The size of the blob in bytes.
+ */
+row_view::row_view(
+          table::pointer_t t
+        , block_pointer_t b
+        , std::uint8_t const * blob
+        , std::uint32_t size)
+    : f_table(t)
+    , f_block(b)
+    , f_blob(blob)
+    , f_size(size)
+{
+    std::size_t pos(0);
+    f_version = read_be_uint32(f_blob, pos) & ~ROW_FLAG_COLUMN_DIRECTORY;
+}
+
+
+table::pointer_t row_view::get_table() const
+{
+    return f_table.lock();
+}
+
+
+std::uint8_t const * row_view::data() const
+{
+    return f_blob;
+}
+
+
+std::uint32_t row_view::size() const
+{
+    return f_size;
+}
+
+
+schema_version_t row_view::get_schema_version() const
+{
+    return f_version;
+}
+
+
+cell::pointer_t row_view::get_cell(column_id_t const & column_id)
+{
+    index_columns();
+
+    std::size_t const idx(column_id - 1);
+    if(column_id == 0
+    || idx >= f_columns.size()
+    || f_columns[idx].f_schema == nullptr)
+    {
+        return cell::pointer_t();
+    }
+
+    column_t & c(f_columns[idx]);
+    if(c.f_cell == nullptr)
+    {
+        std::size_t pos(c.f_offset);
+        schema_column::pointer_t column(get_table()->get_column(column_id));
+        c.f_cell = std::make_shared<cell>(column);
+        if(c.f_schema == column)
+        {
+            c.f_cell->value_from_binary(f_blob, pos);
+        }
+        else
+        {
+            cell value(c.f_schema);
+            value.value_from_binary(f_blob, pos);
+            c.f_cell->copy_from(value);
+        }
+    }
+
+    return c.f_cell;
+}
+
+
+cell::pointer_t row_view::get_cell(std::string const & column_name)
+{
+    table::pointer_t t(get_table());
+    schema_column::pointer_t column(t->get_column(column_name));
+    if(column == nullptr)
+    {
+        throw column_not_found(
+                  "Column \""
+                + column_name
+                + "\" does not exist in \""
+                + t->get_name()
+                + "\".");
+    }
+
+    return get_cell(column->get_column_id());
+}
+
+
+/** \brief Get all the cells of this view.
+ *
+ * This function decodes all the cells. If you need all the cells, it
+ * may be more efficient to call to_row() instead.
+ *
+ * \return A map of the cells defined in this row by column identifier.
+ */
+cell::map_t row_view::cells()
+{
+    index_columns();
+
+    cell::map_t result;
+    for(std::size_t idx(0); idx < f_columns.size(); ++idx)
+    {
+        if(f_columns[idx].f_schema != nullptr)
+        {
+            column_id_t const column_id(static_cast<column_id_t>(idx + 1));
+            result[column_id] = get_cell(column_id);
+        }
+    }
+    return result;
+}
+
+
+/** \brief Get the date when this row expires.
+ *
+ * This function only decodes the "expiration_date" cell.
+ *
+ * \exception type_mismatch
+ * The "expiration_date" column must be of type TIME, MSTIME, or USTIME.
+ *
+ * \return The expiration date in microseconds or 0 if the row does not
+ * expire.
+ */
+std::uint64_t row_view::get_expiration_date()
+{
+    table::pointer_t t(get_table());
+    if(!t->get_schema()->has_expiration_date_column())
+    {
+        return 0;
+    }
+
+    return expiration_date_to_us(t, get_cell(g_expiration_date_column));
+}
+
+
+/** \brief Decode the whole row.
+ *
+ * The returned row is a copy of the data which remains valid after the
+ * row gets modified in the table. It can also be modified and committed
+ * unless a \p projection was used.
+ *
+ * \param[in] projection  The sorted identifiers of the columns to decode or
+ * an empty list to decode all the cells.
+ *
+ * \return A new row with the cells of this view.
+ */
+row::pointer_t row_view::to_row(column_ids_t const & projection) const
+{
+    row::pointer_t result(std::make_shared<row>(get_table()));
+    result->from_binary(f_blob, f_size, projection);
+    return result;
+}
+
+
+/** \brief Find the position of each cell in the blob.
+ *
+ * The first time a cell is accessed, the position of each cell is read
+ * from the column directory of the row. Older rows without a directory
+ * get scanned once, skipping the values instead of decoding them.
+ *
+ * If the row was saved with an older version of the schema, the cells
+ * get attached to the current column with the same name. The cells of
+ * columns which were since deleted are ignored.
+ *
+ * \exception column_not_found
+ * The blob references a column which does not exist in its schema.
+ */
+void row_view::index_columns()
+{
+    if(f_indexed)
+    {
+        return;
+    }
+    f_indexed = true;
+
+    table::pointer_t t(get_table());
+    schema_table::pointer_t current_schema(t->get_schema());
+    schema_table::pointer_t schema(get_row_schema(t, f_version));
+    f_columns.resize(current_schema->get_max_column_id());
+
+    auto add_column = [&](column_id_t column_id, std::size_t offset)
+    {
+        schema_column::pointer_t column(schema->get_column(column_id));
+        if(column == nullptr)
+        {
+            throw column_not_found(
+                      "column with identifier "
+                    + std::to_string(static_cast<int>(column_id))
+                    + " does not exist in \""
+                    + t->get_name()
+                    + "\" schema version "
+                    + std::to_string(f_version)
+                    + " (row_view).");
+        }
+
+        schema_column::pointer_t current(schema == current_schema
+                                    ? column
+                                    : current_schema->get_column(column->get_name()));
+        if(current != nullptr)
+        {
+            std::size_t const idx(current->get_column_id() - 1);
+            if(idx < f_columns.size())
+            {
+                f_columns[idx].f_schema = column;
+                f_columns[idx].f_offset = offset;
+            }
+        }
+
+        return column;
+    };
+
+    schema_version_t version(0);
+    row_directory_t directory;
+    std::size_t pos(read_row_header(f_blob, version, directory));
+    if(directory.f_entries != nullptr)
+    {
+        for(std::size_t idx(0); idx < directory.f_count; ++idx)
+        {
+            add_column(directory.get_column_id(idx), directory.get_offset(idx));
+        }
+        return;
+    }
+
+    while(pos + sizeof(std::uint16_t) <= f_size)
+    {
+        column_id_t const column_id(cell::column_id_from_binary(f_blob, pos));
+        if(column_id == 0)
+        {
+            // the data may be followed by padding
+            //
+            break;
+        }
+
+        cell::skip_binary_value(add_column(column_id, pos), f_blob, pos);
+    }
+}
+
+
+
 } // namespace prinbee
 // vim: ts=4 sw=4 et
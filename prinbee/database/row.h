@@ -30,6 +30,9 @@
  * The server uses it to transform the data so as to sort it when working
  * with secondary indexes.
  *
+ * The row_view class gives a read-only access to a row directly in the
+ * block where it is saved. The cells are only decoded when accessed.
+ *
  * \note
  * The primary key is a special case and we have access to it
  * _automatically_.
@@ -41,12 +44,24 @@
 #include    "prinbee/database/table.h"
 
 
+// C++
+//
+#include    <vector>
+
+
 
 namespace prinbee
 {
 
 
 
+// the first byte of each column of a secondary key
+//
+constexpr std::uint8_t                          SECONDARY_KEY_NULL_FIRST = 0x00;
+constexpr std::uint8_t                          SECONDARY_KEY_VALUE = 0x01;
+constexpr std::uint8_t                          SECONDARY_KEY_NULL_LAST = 0x02;
+
+
 class row
     : public std::enable_shared_from_this<row>
 {
@@ -59,23 +74,87 @@ public:
     table::pointer_t                            get_table() const;
 
     buffer_t                                    to_binary() const;
-    void                                        from_binary(buffer_t const & blob);
+    void                                        from_binary(buffer_t const & blob, column_ids_t const & projection = column_ids_t());
+    void                                        from_binary(std::uint8_t const * blob, std::size_t size, column_ids_t const & projection = column_ids_t());
 
     cell::pointer_t                             get_cell(column_id_t const & column_id, bool create);
     cell::pointer_t                             get_cell(std::string const & column_name, bool create);
     void                                        delete_cell(column_id_t const & column_id);
     void                                        delete_cell(std::string const & column_name);
     cell::map_t                                 cells() const;
+    std::uint64_t                               get_expiration_date();
 
     bool                                        commit();
     bool                                        insert();
     bool                                        update();
 
     void                                        generate_mumur3(buffer_t & murmur3, version_t version = version_t(), std::string const language = std::string());
+    bool                                        generate_secondary_key(schema_secondary_index::pointer_t index, buffer_t & key, bool bound = false);
+
+private:
+    void                                        cell_from_binary(
+                                                      schema_table::pointer_t schema
+                                                    , column_id_t column_id
+                                                    , std::uint8_t const * blob
+                                                    , std::size_t & pos
+                                                    , column_ids_t const & projection);
+    cell *                                      find_cell(column_id_t column_id);
+    cell *                                      add_cell(schema_column::pointer_t column);
+    cell::pointer_t                             get_pointer(cell * c) const;
+
+    // the cells are saved in an array indexed by column identifier and a
+    // bitmap tells which cells are defined; columns added to the schema
+    // after the row was created are saved in the map
+    //
+    table::weak_pointer_t                       f_table = table::weak_pointer_t();
+    std::vector<cell>                           f_cells = std::vector<cell>();
+    std::vector<std::uint64_t>                  f_defined = std::vector<std::uint64_t>();
+    cell::map_t                                 f_added_cells = cell::map_t();
+};
+
+
+class row_view
+{
+public:
+    typedef std::shared_ptr<row_view>           pointer_t;
+    typedef std::vector<pointer_t>              vector_t;
+
+                                                row_view(
+                                                      table::pointer_t t
+                                                    , block_pointer_t b
+                                                    , std::uint8_t const * blob
+                                                    , std::uint32_t size);
+
+    table::pointer_t                            get_table() const;
+    std::uint8_t const *                        data() const;
+    std::uint32_t                               size() const;
+    schema_version_t                            get_schema_version() const;
+
+    cell::pointer_t                             get_cell(column_id_t const & column_id);
+    cell::pointer_t                             get_cell(std::string const & column_name);
+    cell::map_t                                 cells();
+    std::uint64_t                               get_expiration_date();
+    row::pointer_t                              to_row(column_ids_t const & projection = column_ids_t()) const;
 
 private:
+    struct column_t
+    {
+        schema_column::pointer_t                f_schema = schema_column::pointer_t();  // column as saved in the blob
+        std::uint32_t                           f_offset = 0;                           // position of the value in the blob
+        cell::pointer_t                         f_cell = cell::pointer_t();             // once decoded
+    };
+
+    void                                        index_columns();
+
+    // the block remains pinned as long as the view exists
+    //
     table::weak_pointer_t                       f_table = table::weak_pointer_t();
-    cell::map_t                                 f_cells = cell::map_t();
+    block_pointer_t                             f_block = block_pointer_t();
+    std::uint8_t const *                        f_blob = nullptr;
+    std::uint32_t                               f_size = 0;
+    schema_version_t                            f_version = 0;
+    bool                                        f_indexed = false;
+    std::vector<column_t>                       f_columns = std::vector<column_t>();
 };
 
 
@@ -0,0 +1,587 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Size class allocator for rows.
+ *
+ * The sizes of the slots grow by steps of a quarter of a power of two:
+ * 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, ... This limits
+ * the space wasted at the end of a slot to 25% in the worst case and
+ * keeps the number of size classes small.
+ *
+ * Each `SLOT` block has a bitmap with one bit per slot (1 means free) and
+ * a summary bitmap with one bit per word of the first bitmap (1 means
+ * that word has at least one free slot). Finding a free slot is a couple
+ * of count trailing zero instructions. The blocks with at least one free
+ * slot are kept in a list per size class so an allocation never has to
+ * search for a block.
+ *
+ * When the last slot of a block gets released, the block is returned to
+ * the list of free blocks unless it is the last block of its size class
+ * with free slots. That one is kept to avoid allocating and releasing
+ * a block over and over again when one row gets added and removed.
+ */
+
+// self
+//
+#include    "prinbee/database/slot_allocator.h"
+
+#include    "prinbee/exception.h"
+#include    "prinbee/block/block_slot_data.h"
+#include    "prinbee/database/table.h"
+#include    "prinbee/file/file_table.h"
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+namespace
+{
+
+
+
+/** \brief The meta data found at the start of each slot.
+ *
+ * This is the same structure as the one used by the block_free_space
+ * so the block_free_space::get_flag() and get_size() functions can be
+ * used on a row whichever allocator was used to save it.
+ */
+struct slot_meta_t
+{
+    std::uint32_t       f_size : 24 /* = 0 */;
+    std::uint32_t       f_flags : 8 /* = 0 */;
+};
+
+
+static_assert(sizeof(slot_meta_t) == sizeof(std::uint32_t)
+            , "the slot_meta_t structure must be exactly 32 bits");
+
+
+// same bit as the FREE_SPACE_FLAG_ALLOCATED of the block_free_space
+//
+constexpr std::uint8_t      SLOT_FLAG_ALLOCATED = 0x01;
+
+constexpr std::uint32_t     MIN_SLOT_SIZE = 16;
+
+// each block must at least have that many slots
+//
+constexpr std::uint32_t     MIN_SLOT_COUNT = 4;
+
+constexpr std::uint32_t     BITS_PER_WORD = 64;
+
+
+
+std::uint32_t highest_power_of_two(std::uint32_t value)
+{
+    return 1U << (31 - __builtin_clz(value));
+}
+
+
+slot_meta_t * get_meta(data_t ptr)
+{
+    return reinterpret_cast<slot_meta_t *>(ptr);
+}
+
+
+
+}
+// no name namespace
+
+
+
+/** \brief Initialize the allocator of a table.
+ *
+ * The size classes depend on the page size of the table. The largest
+ * class is the largest multiple of 8 which still gives 4 slots per
+ * block. Larger rows have to be allocated with the block_free_space.
+ *
+ * The allocator does not know about the existing `SLOT` blocks until
+ * load() gets called.
+ *
+ * \param[in] t  The table using this allocator.
+ */
+slot_allocator::slot_allocator(table_pointer_t t)
+    : f_table(t.get())
+    , f_page_size(t->get_page_size())
+{
+    std::uint32_t const max_slot_size(round_down(
+              (f_page_size - block_slot_data::HEADER_SIZE) / MIN_SLOT_COUNT
+            , sizeof(reference_t)));
+    for(std::uint32_t size(MIN_SLOT_SIZE); size <= max_slot_size;)
+    {
+        f_slot_sizes.push_back(size);
+        size += std::max(static_cast<std::uint32_t>(sizeof(reference_t)), highest_power_of_two(size) / 4);
+    }
+
+    // direct lookup of the size class from the size in multiples of 8
+    //
+    if(!f_slot_sizes.empty())
+    {
+        f_size_classes.resize(f_slot_sizes.back() / sizeof(reference_t) + 1, 0);
+        std::uint32_t size_class(0);
+        for(std::size_t idx(0); idx < f_size_classes.size(); ++idx)
+        {
+            if(idx * sizeof(reference_t) > f_slot_sizes[size_class])
+            {
+                ++size_class;
+            }
+            f_size_classes[idx] = size_class;
+        }
+    }
+
+    f_partial.resize(f_slot_sizes.size(), nullptr);
+}
+
+
+std::size_t slot_allocator::get_size_class_count() const
+{
+    return f_slot_sizes.size();
+}
+
+
+/** \brief Get the size class used to allocate \p size bytes.
+ *
+ * \param[in] size  The number of bytes to allocate.
+ *
+ * \return The size class or NO_SIZE_CLASS if \p size is too large.
+ */
+std::uint32_t slot_allocator::get_size_class(std::uint32_t size) const
+{
+    std::size_t const idx(round_up(size + sizeof(slot_meta_t), sizeof(reference_t)) / sizeof(reference_t));
+    if(idx >= f_size_classes.size())
+    {
+        return NO_SIZE_CLASS;
+    }
+    return f_size_classes[idx];
+}
+
+
+/** \brief Get the size of the slots of a size class.
+ *
+ * The size includes the meta data found at the start of each slot.
+ *
+ * \param[in] size_class  The size class.
+ *
+ * \return The size of one slot in bytes.
+ */
+std::uint32_t slot_allocator::get_slot_size(std::uint32_t size_class) const
+{
+    if(size_class >= f_slot_sizes.size())
+    {
+        throw invalid_parameter(
+                  "size class "
+                + std::to_string(size_class)
+                + " is out of range.");
+    }
+    return f_slot_sizes[size_class];
+}
+
+
+/** \brief The largest size that this allocator can allocate.
+ *
+ * \return The largest size that allocate() accepts.
+ */
+std::uint32_t slot_allocator::get_max_size() const
+{
+    if(f_slot_sizes.empty())
+    {
+        return 0;
+    }
+    return f_slot_sizes.back() - sizeof(slot_meta_t);
+}
+
+
+/** \brief Rebuild the bitmaps from the `SLOT` blocks.
+ *
+ * This function walks the list of `SLOT` blocks which starts in the
+ * file header. Each block gets added to the allocator and its bitmap
+ * is built from the meta data at the start of each slot. The other
+ * blocks of the file are not read.
+ *
+ * It is expected to be called once, when the table gets opened.
+ *
+ * \exception corrupted_data
+ * The list includes a block which is not a `SLOT` block, a block found
+ * twice, or a `SLOT` block with a slot size which does not match one of
+ * our size classes.
+ */
+void slot_allocator::load()
+{
+    f_blocks.clear();
+    std::fill(f_partial.begin(), f_partial.end(), nullptr);
+    f_statistics.f_slots_in_use = 0;
+    f_statistics.f_bytes_in_use = 0;
+
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(f_table->get_block(0)));
+    reference_t previous(NULL_FILE_ADDR);
+    for(reference_t offset(header->get_first_slot_block()); offset != NULL_FILE_ADDR;)
+    {
+        if(f_blocks.find(offset) != f_blocks.end())
+        {
+            throw corrupted_data(
+                      "the list of SLOT blocks loops back to offset "
+                    + std::to_string(offset)
+                    + ".");
+        }
+
+        block::pointer_t slot_block(f_table->get_block(offset));
+        if(slot_block->get_dbtype() != dbtype_t::BLOCK_TYPE_SLOT_DATA)
+        {
+            throw corrupted_data(
+                      "block at offset "
+                    + std::to_string(offset)
+                    + " in the list of SLOT blocks is a "
+                    + to_name(slot_block->get_dbtype())
+                    + " block.");
+        }
+
+        block_slot_data::pointer_t data(std::static_pointer_cast<block_slot_data>(slot_block));
+        std::uint32_t const slot_size(data->get_slot_size());
+        std::uint32_t const size_class(slot_size < sizeof(slot_meta_t)
+                                            ? NO_SIZE_CLASS
+                                            : get_size_class(slot_size - sizeof(slot_meta_t)));
+        if(size_class == NO_SIZE_CLASS
+        || f_slot_sizes[size_class] != slot_size)
+        {
+            throw corrupted_data(
+                      "SLOT block at offset "
+                    + std::to_string(offset)
+                    + " has an unsupported slot size ("
+                    + std::to_string(slot_size)
+                    + ").");
+        }
+
+        slot_block_t & b(add_block(offset, size_class, data->get_slot_count()));
+        b.f_previous_block = previous;
+        b.f_next_block = data->get_next_slot_block();
+        for(std::uint32_t slot(0); slot < b.f_count; ++slot)
+        {
+            slot_meta_t const * meta(get_meta(data->data(block_slot_data::HEADER_SIZE + slot * slot_size)));
+            if((meta->f_flags & SLOT_FLAG_ALLOCATED) != 0)
+            {
+                set_used(b, slot);
+                f_statistics.f_bytes_in_use += slot_size;
+            }
+        }
+        if(b.f_used == b.f_count)
+        {
+            unlink_block(b);
+        }
+
+        previous = offset;
+        offset = b.f_next_block;
+    }
+}
+
+
+/** \brief Allocate a slot large enough for \p size bytes.
+ *
+ * The function returns the same structure as the
+ * block_free_space::get_free_space() function. The f_reference field
+ * is the reference to save in the indirect index and f_size is the
+ * size of the slot, meta data included.
+ *
+ * \exception invalid_parameter
+ * The \p size is larger than get_max_size().
+ *
+ * \param[in] size  The number of bytes to allocate.
+ *
+ * \return The block, reference, and size of the new slot.
+ */
+free_space_t slot_allocator::allocate(std::uint32_t size)
+{
+    std::uint32_t const size_class(get_size_class(size));
+    if(size_class == NO_SIZE_CLASS)
+    {
+        throw invalid_parameter(
+                  "slot_allocator::allocate() called with a size ("
+                + std::to_string(size)
+                + ") larger than the largest slot ("
+                + std::to_string(get_max_size())
+                + ").");
+    }
+    std::uint32_t const slot_size(f_slot_sizes[size_class]);
+
+    slot_block_t * b(f_partial[size_class]);
+    if(b == nullptr)
+    {
+        block_slot_data::pointer_t data(std::static_pointer_cast<block_slot_data>(
+                        f_table->allocate_new_block(dbtype_t::BLOCK_TYPE_SLOT_DATA)));
+        data->set_slot_size(slot_size);
+        std::uint32_t const count(data->get_slot_count());
+        for(std::uint32_t slot(0); slot < count; ++slot)
+        {
+            slot_meta_t * meta(get_meta(data->data(block_slot_data::HEADER_SIZE + slot * slot_size)));
+            meta->f_size = slot_size;
+            meta->f_flags = 0;
+        }
+        b = &add_block(data->get_offset(), size_class, count);
+
+        // the new block becomes the first of the list saved in the file
+        //
+        file_table::pointer_t header(std::static_pointer_cast<file_table>(f_table->get_block(0)));
+        b->f_next_block = header->get_first_slot_block();
+        data->set_next_slot_block(b->f_next_block);
+        if(b->f_next_block != NULL_FILE_ADDR)
+        {
+            f_blocks.at(b->f_next_block).f_previous_block = b->f_offset;
+        }
+        header->set_first_slot_block(b->f_offset);
+        ++f_statistics.f_blocks_allocated;
+    }
+
+    std::uint32_t slot(0);
+    for(std::size_t idx(0);; ++idx)
+    {
+        if(b->f_summary[idx] != 0)
+        {
+            std::size_t const word(idx * BITS_PER_WORD + __builtin_ctzll(b->f_summary[idx]));
+            slot = word * BITS_PER_WORD + __builtin_ctzll(b->f_free[word]);
+            break;
+        }
+    }
+    set_used(*b, slot);
+    if(b->f_used == b->f_count)
+    {
+        unlink_block(*b);
+    }
+
+    reference_t const offset(b->f_offset + block_slot_data::HEADER_SIZE + slot * slot_size);
+
+    free_space_t result;
+    result.f_block = f_table->get_block(b->f_offset);
+    get_meta(result.f_block->data(offset))->f_flags = SLOT_FLAG_ALLOCATED;
+    result.f_reference = offset + sizeof(slot_meta_t);
+    result.f_size = slot_size;
+
+    ++f_statistics.f_allocations;
+    f_statistics.f_bytes_in_use += slot_size;
+
+    return result;
+}
+
+
+/** \brief Release a slot.
+ *
+ * The \p reference is the one returned by allocate(). Once released, the
+ * slot can be reused immediately.
+ *
+ * \exception logic_error
+ * The \p reference must be a reference returned by allocate() and which
+ * was not yet released.
+ *
+ * \param[in] reference  The reference to the slot to release.
+ */
+void slot_allocator::release(reference_t reference)
+{
+    std::uint32_t const position(reference % f_page_size);
+    reference_t const offset(reference - position);
+    auto it(f_blocks.find(offset));
+    if(it == f_blocks.end())
+    {
+        throw logic_error(
+                  "slot_allocator::release() called with reference "
+                + std::to_string(reference)
+                + " which is not in a SLOT block.");
+    }
+    slot_block_t & b(it->second);
+    std::uint32_t const slot_size(f_slot_sizes[b.f_size_class]);
+
+    std::uint32_t const start(block_slot_data::HEADER_SIZE + sizeof(slot_meta_t));
+    if(position < start
+    || (position - start) % slot_size != 0
+    || (position - start) / slot_size >= b.f_count)
+    {
+        throw logic_error(
+                  "slot_allocator::release() called with reference "
+                + std::to_string(reference)
+                + " which is not the start of a slot.");
+    }
+    std::uint32_t const slot((position - start) / slot_size);
+    if((b.f_free[slot / BITS_PER_WORD] & (1ULL << (slot % BITS_PER_WORD))) != 0)
+    {
+        throw logic_error(
+                  "slot_allocator::release() called with reference "
+                + std::to_string(reference)
+                + " which is not allocated.");
+    }
+
+    block::pointer_t data(f_table->get_block(offset));
+    data_t ptr(data->data(reference));
+    if(f_table->is_secure())
+    {
+        memset(ptr, 0, slot_size - sizeof(slot_meta_t));
+    }
+    get_meta(ptr - sizeof(slot_meta_t))->f_flags = 0;
+
+    bool const was_full(b.f_used == b.f_count);
+    set_free(b, slot);
+    if(was_full)
+    {
+        link_block(b);
+    }
+
+    ++f_statistics.f_releases;
+    f_statistics.f_bytes_in_use -= slot_size;
+
+    // keep the last block with free slots of this size class
+    //
+    if(b.f_used == 0
+    && (b.f_previous != nullptr || b.f_next != nullptr))
+    {
+        unlink_block(b);
+        remove_block(b);
+        f_blocks.erase(it);
+        f_table->free_block(data, true);
+        ++f_statistics.f_blocks_released;
+    }
+}
+
+
+slot_allocator_statistics_t slot_allocator::get_statistics() const
+{
+    slot_allocator_statistics_t result(f_statistics);
+    result.f_block_count = f_blocks.size();
+    return result;
+}
+
+
+slot_allocator::slot_block_t & slot_allocator::add_block(reference_t offset, std::uint32_t size_class, std::uint32_t count)
+{
+    slot_block_t & b(f_blocks[offset]);
+    b.f_offset = offset;
+    b.f_size_class = size_class;
+    b.f_count = count;
+    b.f_used = 0;
+
+    // all the slots are free, except the bits past the last slot
+    //
+    std::size_t const words((count + BITS_PER_WORD - 1) / BITS_PER_WORD);
+    b.f_free.assign(words, ~0ULL);
+    if(count % BITS_PER_WORD != 0)
+    {
+        b.f_free.back() = (1ULL << (count % BITS_PER_WORD)) - 1;
+    }
+    b.f_summary.assign((words + BITS_PER_WORD - 1) / BITS_PER_WORD, ~0ULL);
+    if(words % BITS_PER_WORD != 0)
+    {
+        b.f_summary.back() = (1ULL << (words % BITS_PER_WORD)) - 1;
+    }
+
+    link_block(b);
+
+    return b;
+}
+
+
+void slot_allocator::link_block(slot_block_t & b)
+{
+    b.f_previous = nullptr;
+    b.f_next = f_partial[b.f_size_class];
+    if(b.f_next != nullptr)
+    {
+        b.f_next->f_previous = &b;
+    }
+    f_partial[b.f_size_class] = &b;
+}
+
+
+void slot_allocator::unlink_block(slot_block_t & b)
+{
+    if(b.f_previous != nullptr)
+    {
+        b.f_previous->f_next = b.f_next;
+    }
+    else
+    {
+        f_partial[b.f_size_class] = b.f_next;
+    }
+    if(b.f_next != nullptr)
+    {
+        b.f_next->f_previous = b.f_previous;
+    }
+    b.f_previous = nullptr;
+    b.f_next = nullptr;
+}
+
+
+/** \brief Remove a block from the list of `SLOT` blocks saved in the file.
+ *
+ * \param[in] b  The block about to be freed.
+ */
+void slot_allocator::remove_block(slot_block_t & b)
+{
+    if(b.f_previous_block == NULL_FILE_ADDR)
+    {
+        file_table::pointer_t header(std::static_pointer_cast<file_table>(f_table->get_block(0)));
+        header->set_first_slot_block(b.f_next_block);
+    }
+    else
+    {
+        block_slot_data::pointer_t previous(std::static_pointer_cast<block_slot_data>(f_table->get_block(b.f_previous_block)));
+        previous->set_next_slot_block(b.f_next_block);
+        f_blocks.at(b.f_previous_block).f_next_block = b.f_next_block;
+    }
+    if(b.f_next_block != NULL_FILE_ADDR)
+    {
+        f_blocks.at(b.f_next_block).f_previous_block = b.f_previous_block;
+    }
+}
+
+
+void slot_allocator::set_free(slot_block_t & b, std::uint32_t slot)
+{
+    std::uint32_t const word(slot / BITS_PER_WORD);
+    b.f_free[word] |= 1ULL << (slot % BITS_PER_WORD);
+    b.f_summary[word / BITS_PER_WORD] |= 1ULL << (word % BITS_PER_WORD);
+    --b.f_used;
+    --f_statistics.f_slots_in_use;
+}
+
+
+void slot_allocator::set_used(slot_block_t & b, std::uint32_t slot)
+{
+    std::uint32_t const word(slot / BITS_PER_WORD);
+    b.f_free[word] &= ~(1ULL << (slot % BITS_PER_WORD));
+    if(b.f_free[word] == 0)
+    {
+        b.f_summary[word / BITS_PER_WORD] &= ~(1ULL << (word % BITS_PER_WORD));
+    }
+    ++b.f_used;
+    ++f_statistics.f_slots_in_use;
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,131 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Size class allocator for rows.
+ *
+ * The slot_allocator is an alternative to the block_free_space for the
+ * allocation of the space used by rows. Each `SLOT` block is dedicated
+ * to one size class and divided in slots of that size. The allocator
+ * keeps a bitmap of the free slots of each block in memory so finding
+ * a free slot or releasing one does not require reading any other page
+ * than the one where the row lives.
+ *
+ * The bitmaps are not saved. They get rebuilt from the `SLOT` blocks
+ * when the allocator is loaded. The `SLOT` blocks are linked in a list
+ * which starts in the file header so the other blocks are not read.
+ *
+ * The allocator is owned by a table and is not thread safe. The table
+ * serializes the calls.
+ */
+
+// self
+//
+#include    "prinbee/block/block_free_space.h"
+
+
+// C++
+//
+#include    <unordered_map>
+#include    <vector>
+
+
+
+namespace prinbee
+{
+
+
+
+constexpr std::uint32_t             NO_SIZE_CLASS = static_cast<std::uint32_t>(-1);
+
+
+struct slot_allocator_statistics_t
+{
+    std::size_t                     f_allocations = 0;
+    std::size_t                     f_releases = 0;
+    std::size_t                     f_blocks_allocated = 0;
+    std::size_t                     f_blocks_released = 0;
+    std::size_t                     f_block_count = 0;
+    std::size_t                     f_slots_in_use = 0;
+    std::size_t                     f_bytes_in_use = 0;
+};
+
+
+class slot_allocator
+{
+public:
+    typedef std::shared_ptr<slot_allocator>     pointer_t;
+
+                                slot_allocator(table_pointer_t t);
+                                slot_allocator(slot_allocator const & rhs) = delete;
+
+    slot_allocator &            operator = (slot_allocator const & rhs) = delete;
+
+    std::size_t                 get_size_class_count() const;
+    std::uint32_t               get_size_class(std::uint32_t size) const;
+    std::uint32_t               get_slot_size(std::uint32_t size_class) const;
+    std::uint32_t               get_max_size() const;
+
+    void                        load();
+    free_space_t                allocate(std::uint32_t size);
+    void                        release(reference_t reference);
+    slot_allocator_statistics_t get_statistics() const;
+
+private:
+    struct slot_block_t
+    {
+        reference_t             f_offset = NULL_FILE_ADDR;
+        std::uint32_t           f_size_class = NO_SIZE_CLASS;
+        std::uint32_t           f_count = 0;
+        std::uint32_t           f_used = 0;
+        std::vector<std::uint64_t>
+                                f_free = std::vector<std::uint64_t>();
+        std::vector<std::uint64_t>
+                                f_summary = std::vector<std::uint64_t>();
+        slot_block_t *          f_previous = nullptr;
+        slot_block_t *          f_next = nullptr;
+
+        // list of all the SLOT blocks saved in the file
+        //
+        reference_t             f_previous_block = NULL_FILE_ADDR;
+        reference_t             f_next_block = NULL_FILE_ADDR;
+    };
+
+    slot_block_t &              add_block(reference_t offset, std::uint32_t size_class, std::uint32_t count);
+    void                        link_block(slot_block_t & b);
+    void                        unlink_block(slot_block_t & b);
+    void                        remove_block(slot_block_t & b);
+    void                        set_free(slot_block_t & b, std::uint32_t slot);
+    void                        set_used(slot_block_t & b, std::uint32_t slot);
+
+    table *                     f_table = nullptr;
+    std::uint32_t               f_page_size = 0;
+    std::vector<std::uint32_t>  f_slot_sizes = std::vector<std::uint32_t>();
+    std::vector<std::uint32_t>  f_size_classes = std::vector<std::uint32_t>();
+    std::unordered_map<reference_t, slot_block_t>
+                                f_blocks = std::unordered_map<reference_t, slot_block_t>();
+    std::vector<slot_block_t *> f_partial = std::vector<slot_block_t *>();
+    slot_allocator_statistics_t f_statistics = slot_allocator_statistics_t();
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
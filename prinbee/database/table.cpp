@@ -28,12 +28,17 @@
 //
 #include    "prinbee/database/table.h"
 
+#include    "prinbee/database/bloom_filter.h"
 #include    "prinbee/database/context.h"
+#include    "prinbee/database/index_builder.h"
+#include    "prinbee/database/index_tree.h"
 #include    "prinbee/database/row.h"
+#include    "prinbee/database/slot_allocator.h"
 
 // all the blocks since we create them here
 //
 #include    "prinbee/block/block_blob.h"
+#include    "prinbee/block/block_cache.h"
 #include    "prinbee/block/block_data.h"
 #include    "prinbee/block/block_entry_index.h"
 #include    "prinbee/block/block_free_block.h"
@@ -45,6 +50,7 @@
 #include    "prinbee/block/block_secondary_index.h"
 #include    "prinbee/block/block_schema.h"
 #include    "prinbee/block/block_schema_list.h"
+#include    "prinbee/block/block_slot_data.h"
 #include    "prinbee/block/block_top_index.h"
 #include    "prinbee/block/block_top_indirect_index.h"
 #include    "prinbee/file/file_bloom_filter.h"
@@ -57,6 +63,12 @@
 #include    <snaplogger/message.h>
 
 
+// cppthread
+//
+#include    <cppthread/guard.h>
+#include    <cppthread/mutex.h>
+
+
 // snapdev
 //
 #include    <snapdev/glob_to_list.h>
@@ -66,7 +78,20 @@
 
 // C++
 //
+#include    <algorithm>
+#include    <cassert>
+#include    <cstring>
 #include    <iostream>
+#include    <limits>
+#include    <mutex>
+#include    <set>
+#include    <shared_mutex>
+#include    <thread>
+
+
+// C
+//
+#include    <unistd.h>
 
 
 // last include
@@ -99,6 +124,25 @@ public:
         std::uint32_t                       f_index_position = 0;       // position within the index at end of a read
     };
 
+    struct tree_frame_t
+    {
+        typedef std::vector<tree_frame_t>   vector_t;
+
+        oid_t                               f_parent = NULL_OID;        // OID of the node whose children are read
+        buffer_t                            f_key = buffer_t();         // last child key read under that node
+    };
+
+    struct scan_state_t
+    {
+        buffer_t                            f_key = buffer_t();         // last key read from the index
+        std::size_t                         f_position = 0;             // number of rows returned so far
+        std::size_t                         f_skipped = 0;              // rows skipped because of the offset
+        int                                 f_pass = 0;                 // NULL_MODE_FIRST/LAST read the nulls in a separate pass
+        oid_t                               f_oid = NULL_OID;           // next OID to read from the indirect index
+        tree_frame_t::vector_t              f_tree_stack = tree_frame_t::vector_t();    // nodes being read by the tree scan
+        bool                                f_done = false;
+    };
+
                                         cursor_state(index_type_t index_type, schema_secondary_index::pointer_t secondary_index);
 
     index_type_t                        get_index_type() const;
@@ -110,6 +154,9 @@ public:
     void                                set_entry_index(block_entry_index::pointer_t entry_index);
     std::uint32_t                       get_entry_index_close_position() const;
     void                                set_entry_index_close_position(std::uint32_t position);
+    oid_t                               get_expired_oid() const;
+    void                                set_expired_oid(oid_t oid);
+    scan_state_t &                      get_scan_state();
 
 private:
     index_type_t                        f_index_type = index_type_t::INDEX_TYPE_INVALID;
@@ -117,6 +164,8 @@ private:
     index_reference_t::vector_t         f_row_references = index_reference_t::vector_t();
     block_entry_index::pointer_t        f_entry_index = block_entry_index::pointer_t();
     std::uint32_t                       f_entry_index_position = std::uint32_t(0);
+    oid_t                               f_expired_oid = NULL_OID;
+    scan_state_t                        f_scan_state = scan_state_t();
 };
 
 
@@ -175,6 +224,33 @@ void cursor_state::set_entry_index_close_position(std::uint32_t position)
 }
 
 
+/** \brief Get the OID of the expired row found by the primary key.
+ *
+ * When the primary index points to a row which expired but was not
+ * yet deleted by the reaper, the read_primary() function does not
+ * return it. It saves its OID here instead so the row_insert() can
+ * delete it before adding the new row with the same key.
+ *
+ * \return The OID of the expired row or NULL_OID.
+ */
+oid_t cursor_state::get_expired_oid() const
+{
+    return f_expired_oid;
+}
+
+
+void cursor_state::set_expired_oid(oid_t oid)
+{
+    f_expired_oid = oid;
+}
+
+
+cursor_state::scan_state_t & cursor_state::get_scan_state()
+{
+    return f_scan_state;
+}
+
+
 
 
 
@@ -184,28 +260,137 @@ struct cursor_data
                                         cursor_data(
                                                   cursor::pointer_t cursor
                                                 , cursor_state::pointer_t state
-                                                , row::vector_t & rows);
+                                                , row::vector_t & rows
+                                                , row_view::vector_t & views);
 
     cursor::pointer_t                   f_cursor;
     cursor_state::pointer_t             f_state;
     row::vector_t &                     f_rows;
+    row_view::vector_t &                f_views;    // used instead of f_rows by read-only cursors
+    column_ids_t                        f_projection = column_ids_t();  // sorted, if empty decode all the columns
+    std::uint64_t                       f_now = 0;      // in microseconds, rows which expired by then are filtered
 };
 
 
 cursor_data::cursor_data(
           cursor::pointer_t cursor
         , cursor_state::pointer_t state
-        , row::vector_t & rows)
+        , row::vector_t & rows
+        , row_view::vector_t & views)
     : f_cursor(cursor)
     , f_state(state)
     , f_rows(rows)
+    , f_views(views)
+{
+}
+
+
+
+
+
+
+
+/** \brief Maximum number of times a row can be found MOVED.
+ *
+ * When a row gets moved without updating its reference in the `INDR`
+ * block, the old space holds the new location. In theory, this happens
+ * at most once or twice before the compactor fixes the reference. A
+ * longer chain means the data is corrupted (i.e. we may be in a loop).
+ */
+constexpr int const                     MAX_MOVED_HOPS = 16;
+
+
+/** \brief Number of OIDs read ahead by the indirect index scan.
+ *
+ * The read_indirect() function reads the references of that many OIDs
+ * and asks the dbfile to prefetch their pages before decoding the
+ * previous batch of rows. Large enough to keep the disk busy, small
+ * enough not to push the pages being decoded out of memory.
+ */
+constexpr std::size_t const             INDIRECT_SCAN_BATCH_SIZE = 256;
+
+
+/** \brief Size of the keys of the expiration index.
+ *
+ * The key is the expiration date in microseconds followed by the OID of
+ * the row, both in big endian. This way the index is sorted by date and
+ * two rows expiring at the same time have different keys.
+ */
+constexpr std::uint32_t const           EXPIRATION_INDEX_KEY_SIZE = sizeof(std::uint64_t) + sizeof(oid_t);
+
+
+/** \brief Size of the keys of the tree index.
+ *
+ * The key is the OID of the parent row, the last segment of the path
+ * padded or truncated to TREE_INDEX_NAME_SIZE bytes and the OID of the
+ * row, all numbers in big endian. The parent path is not repeated in
+ * each key, the OID of the parent replaces it. This way all the children
+ * of a node are found in one contiguous range of the index and the keys
+ * remain small whatever the depth of the tree.
+ */
+constexpr std::uint32_t const           TREE_INDEX_KEY_SIZE = 64;
+constexpr std::uint32_t const           TREE_INDEX_NAME_SIZE = TREE_INDEX_KEY_SIZE - sizeof(oid_t) * 2;
+
+
+/** \brief Split a tree path in its parent path and last segment.
+ *
+ * The trailing slashes are ignored. A path without a slash (or only
+ * a leading slash) is a child of the root and \p parent is set to an
+ * empty string.
+ *
+ * \param[in] path  The path to split.
+ * \param[out] parent  The path of the parent.
+ * \param[out] name  The last segment of the path.
+ *
+ * \return false if \p path represents the root itself.
+ */
+bool split_tree_path(std::string const & path, std::string & parent, std::string & name)
 {
+    std::string::size_type const end(path.find_last_not_of('/'));
+    if(end == std::string::npos)
+    {
+        parent.clear();
+        name.clear();
+        return false;
+    }
+
+    std::string::size_type const slash(path.rfind('/', end));
+    if(slash == std::string::npos)
+    {
+        parent.clear();
+        name = path.substr(0, end + 1);
+        return true;
+    }
+
+    name = path.substr(slash + 1, end - slash);
+    std::string::size_type const parent_end(path.find_last_not_of('/', slash));
+    if(parent_end == std::string::npos)
+    {
+        parent.clear();
+    }
+    else
+    {
+        parent = path.substr(0, parent_end + 1);
+    }
+    return true;
 }
 
 
+struct compaction_row_t
+{
+    oid_t                               f_oid = NULL_OID;
+    reference_t                         f_reference = NULL_FILE_ADDR;
+    std::uint32_t                       f_size = 0;
+};
 
 
+struct indirect_row_t
+{
+    typedef std::vector<indirect_row_t> vector_t;
 
+    oid_t                               f_oid = NULL_OID;
+    reference_t                         f_reference = NULL_FILE_ADDR;
+};
 
 
 enum class commit_mode_t
@@ -216,6 +401,83 @@ enum class commit_mode_t
 };
 
 
+/** \brief State kept between the rows of a batch.
+ *
+ * The new rows of a batch get consecutive OIDs. The `INDR` block of the
+ * last OID is kept so the next one does not have to walk down the `TIND`
+ * blocks again.
+ */
+struct commit_batch_t
+{
+    oid_t                               f_last_oid = NULL_OID;
+    block_indirect_index::pointer_t     f_indirect_index = block_indirect_index::pointer_t();
+    oid_t                               f_position = 0;     // position of f_last_oid in f_indirect_index
+};
+
+
+/** \brief Reader/writer lock of a table.
+ *
+ * Reads (cursors, next expiration) take the lock in shared mode so many
+ * threads can read a table at the same time. Commits, deletions, the
+ * reaper, and the compactor take it in exclusive mode.
+ *
+ * A writer reads the table too (i.e. a commit first selects the row to
+ * know whether it exists), so the exclusive mode is recursive and the
+ * thread holding it can also take the shared mode. The shared mode
+ * itself is not recursive; the read paths never read through a cursor.
+ */
+class table_lock
+{
+public:
+    void lock()
+    {
+        if(f_writer.load(std::memory_order_relaxed) == std::this_thread::get_id())
+        {
+            ++f_depth;
+            return;
+        }
+        f_mutex.lock();
+        f_writer.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        f_depth = 1;
+    }
+
+    void unlock()
+    {
+        --f_depth;
+        if(f_depth == 0)
+        {
+            f_writer.store(std::thread::id(), std::memory_order_relaxed);
+            f_mutex.unlock();
+        }
+    }
+
+    void lock_shared()
+    {
+        if(f_writer.load(std::memory_order_relaxed) == std::this_thread::get_id())
+        {
+            ++f_depth;
+            return;
+        }
+        f_mutex.lock_shared();
+    }
+
+    void unlock_shared()
+    {
+        if(f_writer.load(std::memory_order_relaxed) == std::this_thread::get_id())
+        {
+            unlock();
+            return;
+        }
+        f_mutex.unlock_shared();
+    }
+
+private:
+    std::shared_mutex                   f_mutex = std::shared_mutex();
+    std::atomic<std::thread::id>        f_writer = std::thread::id();
+    std::size_t                         f_depth = 0;
+};
+
+
 
 class table_impl
 {
@@ -249,18 +511,53 @@ public:
     void                                        free_block(block::pointer_t block, bool clear_block);
     schema_table::pointer_t                     get_schema(schema_version_t version);
     schema_secondary_index::pointer_t           get_secondary_index(std::string const & name) const;
-    bool                                        row_commit(row_pointer_t row, commit_mode_t mode);
-    void                                        row_insert(row::pointer_t row_data, cursor::pointer_t cur);
+    bool                                        row_commit(row_pointer_t row, commit_mode_t mode, commit_batch_t * batch = nullptr);
+    bool                                        commit_batch(row::vector_t const & rows);
+    void                                        row_insert(row::pointer_t row_data, cursor::pointer_t cur, commit_batch_t * batch = nullptr);
     void                                        row_update(row::pointer_t row_data, cursor::pointer_t cur);
+    bool                                        row_delete(oid_t oid);
     block_primary_index::pointer_t              get_primary_index_block(bool create);
+    std::uint32_t                               get_index_fill_factor();
+    void                                        set_index_fill_factor(std::uint32_t fill_factor);
+    index_builder::pointer_t                    create_primary_index_builder();
+    void                                        build_primary_index(index_builder::pointer_t builder);
+    std::uint64_t                               build_secondary_index(std::string const & name);
     void                                        read_rows(cursor_data & data);
+    compaction_statistics_t                     compact(std::uint32_t threshold, std::size_t budget);
+    std::size_t                                 expire_rows(std::uint64_t now, std::size_t max);
+    std::uint64_t                               get_next_expiration();
+    void                                        save_bloom_filter();
 
 private:
     block::pointer_t                            allocate_block(dbtype_t type, reference_t offset);
+    void                                        release_unused_blocks();
     void                                        start_update_process(bool restart);
+    oid_t                                       reserve_oid(block_indirect_index::pointer_t & indr, oid_t & position_oid, commit_batch_t * batch);
+    block_indirect_index::pointer_t             get_indirect_index(oid_t & oid);
     reference_t                                 get_indirect_reference(oid_t oid);
-    row::pointer_t                              get_indirect_row(oid_t oid);
+    oid_t                                       get_indirect_rows(oid_t oid, oid_t last_oid, bool reverse, indirect_row_t::vector_t & rows);
+    slot_allocator::pointer_t                   get_slot_allocator();
+    index_tree::pointer_t                       get_primary_index_tree();
+    index_tree::pointer_t                       get_secondary_index_tree();
+    block_secondary_index::pointer_t            get_secondary_index_block(schema_secondary_index::pointer_t index, bool create);
+    buffer_t                                    get_secondary_index_key(row::pointer_t row_data, schema_secondary_index::pointer_t index, oid_t oid);
+    void                                        insert_secondary_keys(row::pointer_t row_data, oid_t oid);
+    index_tree::pointer_t                       get_expiration_index_tree();
+    index_tree::pointer_t                       get_tree_index_tree();
+    column_id_t                                 get_tree_path_column();
+    oid_t                                       find_tree_oid(std::string const & path);
+    oid_t                                       get_tree_parent_oid(row::pointer_t row_data);
+    buffer_t                                    get_tree_index_key(oid_t parent_oid, std::string const & name, oid_t oid);
+    void                                        insert_tree_key(row::pointer_t row_data, oid_t parent_oid, oid_t oid);
+    buffer_t                                    get_expiration_index_key(std::uint64_t expiration_date, oid_t oid);
+    void                                        insert_expiration_key(row::pointer_t row_data, oid_t oid);
+    bloom_filter::pointer_t                     get_bloom_filter();
+    void                                        rebuild_bloom_filter(std::size_t expected_keys);
+    bool                                        is_expired(row_view::pointer_t view, std::uint64_t now);
+    void                                        add_row(cursor_data & data, row_view::pointer_t view, row::pointer_t row_data = row::pointer_t());
+    row_view::pointer_t                         get_indirect_row_view(oid_t oid);
     row::pointer_t                              get_row(reference_t row_reference);
+    row_view::pointer_t                         get_row_view(reference_t row_reference);
 
     void                                        read_secondary(cursor_data & data);
     void                                        read_indirect(cursor_data & data);
@@ -274,7 +571,16 @@ private:
     schema_table::pointer_t                     f_schema_table = schema_table::pointer_t();
     schema_table::map_by_version_t              f_schema_table_by_version = schema_table::map_by_version_t();
     dbfile::pointer_t                           f_dbfile = dbfile::pointer_t();
-    block::map_t                                f_blocks = block::map_t();
+    block_cache                                 f_blocks = block_cache();
+    table_lock                                  f_lock = table_lock();
+    cppthread::mutex                            f_lazy_mutex = cppthread::mutex();      // objects created by the first reader
+    slot_allocator::pointer_t                   f_slot_allocator = slot_allocator::pointer_t();
+    index_tree::pointer_t                       f_primary_index_tree = index_tree::pointer_t();
+    index_tree::pointer_t                       f_secondary_index_tree = index_tree::pointer_t();
+    index_tree::pointer_t                       f_expiration_index_tree = index_tree::pointer_t();
+    index_tree::pointer_t                       f_tree_index_tree = index_tree::pointer_t();
+    std::string                                 f_bloom_filter_filename = std::string();
+    bloom_filter::pointer_t                     f_bloom_filter = bloom_filter::pointer_t();
 };
 
 
@@ -288,6 +594,7 @@ table_impl::table_impl(
 {
     // extract the name of the table
     //
+    std::string tables_path;
     std::string::size_type const pos(table_dir.rfind('/'));
     if(pos == std::string::npos)
     {
@@ -295,6 +602,7 @@ table_impl::table_impl(
     }
     else
     {
+        tables_path = table_dir.substr(0, pos);
         f_name = table_dir.substr(pos + 1);
     }
 
@@ -337,8 +645,30 @@ table_impl::table_impl(
         schema->from_binary(b);
         f_schema_table_by_version[schema->get_schema_version()] = schema;
     }
+    if(f_schema_table_by_version.empty())
+    {
+        throw schema_not_found(
+                  "no schema found for table \""
+                + f_name
+                + "\" in \""
+                + table_dir
+                + "\".");
+    }
+
+    // the latest schema is the one used to write new rows
+    //
+    f_schema_table = f_schema_table_by_version.rbegin()->second;
+
+    // the data files are saved along the schemata
+    //
+    f_dbfile = std::make_shared<dbfile>(tables_path, f_name, "main");
+
+    // TODO: the schema does not yet offer a "block_size" so for now
+    //       all our blocks are exactly one system page
+    //
+    f_dbfile->set_page_size(dbfile::get_system_page_size());
 
-    f_dbfile = std::make_shared<dbfile>(c->get_path(), f_schema_table->get_name(), "main");
+    f_bloom_filter_filename = table_dir + "/bloom.pbf";
 }
 
 
@@ -350,7 +680,17 @@ dbfile::pointer_t table_impl::get_dbfile() const
 
 schema_table::pointer_t table_impl::get_schema(schema_version_t version)
 {
-    return f_schema_table_by_version[version];
+    if(version == schema_version_t())
+    {
+        return f_schema_table;
+    }
+
+    auto const it(f_schema_table_by_version.find(version));
+    if(it == f_schema_table_by_version.end())
+    {
+        return schema_table::pointer_t();
+    }
+    return it->second;
 #if 0
     // the very first time `get_schema()` is called, `version` must be
     // set to `0.0` (a.k.a. `schema_version_t()`) which is how the latest schema
@@ -598,26 +938,26 @@ size_t table_impl::get_page_size() const
 
 block::pointer_t table_impl::allocate_block(dbtype_t type, reference_t offset)
 {
-    auto it(f_blocks.find(offset));
-    if(it != f_blocks.end())
+    block::pointer_t existing(f_blocks.find(offset));
+    if(existing != nullptr)
     {
-        if(type == it->second->get_dbtype())
+        if(type == existing->get_dbtype())
         {
-            return it->second;
+            return existing;
         }
         // TBD: I think only FREE blocks can be replaced by something else
         //      and vice versa or we've got a bug on our hands
         //
         if(type != dbtype_t::BLOCK_TYPE_FREE_BLOCK
-        && it->second->get_dbtype() != dbtype_t::BLOCK_TYPE_FREE_BLOCK)
+        && existing->get_dbtype() != dbtype_t::BLOCK_TYPE_FREE_BLOCK)
         {
             throw logic_error(
                       "allocate_block() called a non-free block type trying to allocate a non-free block ("
                     + std::string(to_name(type))
                     + "). You can go from a free to non-free and non-free to free only.");
         }
-        //it->second->replacing(); -- this won't work right at this time TODO...
-        f_blocks.erase(it);
+        //existing->replacing(); -- this won't work right at this time TODO...
+        f_blocks.erase(offset);
     }
 
     block::pointer_t b;
@@ -676,6 +1016,10 @@ block::pointer_t table_impl::allocate_block(dbtype_t type, reference_t offset)
         b = std::make_shared<block_secondary_index>(f_dbfile, offset);
         break;
 
+    case dbtype_t::BLOCK_TYPE_SLOT_DATA:
+        b = std::make_shared<block_slot_data>(f_dbfile, offset);
+        break;
+
     case dbtype_t::BLOCK_TYPE_TOP_INDEX:
         b = std::make_shared<block_top_index>(f_dbfile, offset);
         break;
@@ -693,18 +1037,51 @@ block::pointer_t table_impl::allocate_block(dbtype_t type, reference_t offset)
     }
 
     b->set_table(f_table->get_pointer());
-    b->set_data(f_dbfile->data(offset));
+    b->set_page(f_dbfile->get_page(offset));
     b->get_structure()->set_block(b, 0, get_page_size());
     b->set_dbtype(type);
 
+    // this call is used to convert the binary data from the file version
+    // to the latest running version; if the version is already up to
+    // date, then nothing happens; it has to happen before the block gets
+    // shared with the other readers
+    //
+    b->from_current_file_version();
+
+    // the structure is parsed on first use; do it now since the block
+    // gets shared by all the readers of the table once in the cache
+    //
+    snapdev::NOT_USED(b->get_structure()->get_static_size());
+
     f_context->limit_allocated_memory();
+    release_unused_blocks();
 
     // we add this block to the list of blocks only after the call to
     // limit the allocated memory
     //
-    f_blocks[offset] = b;
+    // if another thread created the same block in the meantime, the
+    // cache returns that other block so everyone shares the same object
+    //
+    return f_blocks.insert(offset, b);
+}
 
-    return b;
+
+/** \brief Release blocks nobody references anymore.
+ *
+ * Each block keeps its page pinned in the dbfile page cache. As long as
+ * the block is in our block cache, the page can't be evicted. When the
+ * page cache goes over budget, this function removes the blocks that are
+ * only referenced by the block cache. This unpins their pages so the
+ * page cache can evict them.
+ */
+void table_impl::release_unused_blocks()
+{
+    if(!f_dbfile->is_cache_over_budget())
+    {
+        return;
+    }
+
+    f_blocks.release_unused();
 }
 
 
@@ -800,8 +1177,17 @@ block::pointer_t table_impl::get_block(reference_t offset)
         throw logic_error("Requested a block with an offset >= to the existing file size.");
     }
 
-    structure::pointer_t s(std::make_shared<structure>(g_block_header));
-    data_t d(f_dbfile->data(offset));
+    // the block is likely already loaded, in which case we do not need
+    // to read its header again
+    //
+    block::pointer_t b(f_blocks.find(offset));
+    if(b != nullptr)
+    {
+        return b;
+    }
+
+    structure::pointer_t s(std::make_shared<structure>(g_block_header, structure::pointer_t(), false));
+    page_ref const page(f_dbfile->get_page(offset));
     virtual_buffer::pointer_t header(std::make_shared<virtual_buffer>());
 #ifdef _DEBUG
     if(s->get_static_size() != BLOCK_HEADER_SIZE)
@@ -809,20 +1195,12 @@ block::pointer_t table_impl::get_block(reference_t offset)
         throw logic_error("sizeof(g_block_header) != BLOCK_HEADER_SIZE");
     }
 #endif
-    header->pwrite(d, s->get_static_size(), 0, true);
+    header->pwrite(page.data(), s->get_static_size(), 0, true);
     s->set_virtual_buffer(header, 0);
     dbtype_t const type(static_cast<dbtype_t>(s->get_uinteger("magic")));
     //schema_version_t const version(s->get_uinteger("version"));
 
-    block::pointer_t b(allocate_block(type, offset));
-
-    // this last call is used to convert the binary data from the
-    // file version to the latest running version; the result will
-    // be saved back in the block so that way the conversion doesn't
-    // happen over and over again; if the version is already up to
-    // date, then nothing happens
-    //
-    b->from_current_file_version();
+    b = allocate_block(type, offset);
 
     return b;
 
@@ -890,6 +1268,13 @@ block::pointer_t table_impl::allocate_new_block(dbtype_t type)
         offset = header->get_first_free_block();
         if(offset == NULL_FILE_ADDR)
         {
+            // pages preallocated in a previous session are reused first
+            //
+            if(f_dbfile->get_high_water_mark() == NULL_FILE_ADDR)
+            {
+                f_dbfile->set_high_water_mark(header->get_high_water_mark());
+            }
+
             offset = f_dbfile->append_free_block(NULL_FILE_ADDR);
 
             std::size_t const page_size(f_dbfile->get_page_size());
@@ -901,6 +1286,7 @@ block::pointer_t table_impl::allocate_new_block(dbtype_t type)
             f_dbfile->append_free_block(NULL_FILE_ADDR);
 
             header->set_first_free_block(offset + page_size);
+            header->set_high_water_mark(f_dbfile->get_high_water_mark());
         }
         else
         {
@@ -948,11 +1334,13 @@ void table_impl::free_block(block::pointer_t block, bool clear_block)
 }
 
 
-bool table_impl::row_commit(row::pointer_t row_data, commit_mode_t mode)
+bool table_impl::row_commit(row::pointer_t row_data, commit_mode_t mode, commit_batch_t * batch)
 {
+    std::lock_guard<table_lock> lock(f_lock);
+
     conditions cond;
     cond.set_columns({"_oid"});
-    cond.set_key("primary", row_data, row::pointer_t());
+    cond.set_key("_primary", row_data, row::pointer_t());
     cursor::pointer_t cur(f_table->row_select(cond));
 
     row::pointer_t r(cur->next_row());
@@ -968,7 +1356,7 @@ std::cerr << "+++ mode = " << static_cast<int>(mode) << "\n";
         }
 
 std::cerr << "+++ row_insert()\n";
-        row_insert(row_data, cur);
+        row_insert(row_data, cur, batch);
     }
     else
     {
@@ -987,21 +1375,86 @@ std::cerr << "+++ row_insert()\n";
 }
 
 
-/** \brief Insert a new row.
+/** \brief Commit many rows at once.
  *
- * This is an internal function which the table_impl uses to insert a new
- * row.
+ * The rows are sorted by their primary key (the murmur3 key) so the
+ * rows going to the same `EIDX` block get added one after the other,
+ * while that block is still hot. The rows of a tree table are kept in
+ * the input order since the parents must be inserted before their
+ * children.
  *
- * \note
- * The row_commit() is called first and determines whether to call
- * insert or update or generate an error.
+ * The new rows get consecutive OIDs and reuse the `INDR` block of the
+ * previous row. The table is locked once for the whole batch and the
+ * dirty pages are flushed once at the end.
  *
- * \param[in] row_data  The row to be inserted.
+ * \param[in] rows  The rows to commit.
+ *
+ * \return true if all the rows were committed.
  */
-void table_impl::row_insert(row::pointer_t row_data, cursor::pointer_t cur)
+bool table_impl::commit_batch(row::vector_t const & rows)
+{
+    std::lock_guard<table_lock> lock(f_lock);
+
+    row::vector_t sorted(rows);
+    if(f_schema_table->get_model() != model_t::TABLE_MODEL_TREE)
+    {
+        std::vector<std::pair<buffer_t, row::pointer_t>> keys;
+        keys.reserve(rows.size());
+        for(auto const & r : rows)
+        {
+            buffer_t key;
+            r->generate_mumur3(key);
+            keys.emplace_back(key, r);
+        }
+        std::stable_sort(
+                  keys.begin()
+                , keys.end()
+                , [](auto const & a, auto const & b)
+                {
+                    return a.first < b.first;
+                });
+        for(std::size_t idx(0); idx < keys.size(); ++idx)
+        {
+            sorted[idx] = keys[idx].second;
+        }
+    }
+
+    commit_batch_t batch;
+    bool result(true);
+    for(auto const & r : sorted)
+    {
+        if(!row_commit(r, commit_mode_t::COMMIT_MODE_COMMIT, &batch))
+        {
+            result = false;
+        }
+    }
+
+    f_dbfile->flush_all(true);
+
+    return result;
+}
+
+
+/** \brief Reserve the OID of a new row.
+ *
+ * This function allocates the OID of a new row and finds the `INDR`
+ * block and the position in that block where the reference to the row
+ * data gets saved. The `TIND` and `INDR` blocks are created as required.
+ *
+ * When called for the rows of a batch, the `INDR` of the previous OID is
+ * reused as long as the new OID fits in it.
+ *
+ * \param[out] indr  The `INDR` block where the row reference goes.
+ * \param[out] position_oid  The position of the reference in \p indr.
+ * \param[in,out] batch  The state of the batch or nullptr.
+ *
+ * \return The OID of the new row.
+ */
+oid_t table_impl::reserve_oid(
+      block_indirect_index::pointer_t & indr
+    , oid_t & position_oid
+    , commit_batch_t * batch)
 {
-    // if inserting, we first need to allocation this row's OID
-    //
     file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
     oid_t oid(header->get_first_free_oid());
     bool const must_exist(oid != NULL_OID);
@@ -1011,15 +1464,30 @@ void table_impl::row_insert(row::pointer_t row_data, cursor::pointer_t cur)
         //
         oid = header->get_last_oid();
         header->set_last_oid(oid + 1);
+
+        // in a batch, the next new OID most often goes in the same `INDR`
+        // as the previous one
+        //
+        if(batch != nullptr
+        && batch->f_indirect_index != nullptr
+        && oid == batch->f_last_oid + 1
+        && batch->f_position < batch->f_indirect_index->get_max_count())
+        {
+            indr = batch->f_indirect_index;
+            position_oid = batch->f_position + 1;
+            batch->f_last_oid = oid;
+            batch->f_position = position_oid;
+            return oid;
+        }
     }
 
     // found a free OID, go to it in the indirect table and replace
     // the first free OID with the one in that table (i.e. unlink
     // `oid` from the list)
     //
-    oid_t position_oid(oid);
+    position_oid = oid;
     oid_t parent_oid(oid);
-    block_indirect_index::pointer_t indr;
+    indr.reset();
     reference_t offset(header->get_indirect_index());
 std::cerr << "+++ GET INDIRECT INDEX: " << offset << " from " << oid << "\n";
     if(offset == NULL_FILE_ADDR)
@@ -1172,77 +1640,333 @@ std::cerr << "+++ GOT AN EXISTING INDIRECT INDEX BLOCK! " << position_oid << " v
         }
     }
 
+
+    if(batch != nullptr)
+    {
+        batch->f_last_oid = oid;
+        batch->f_indirect_index = must_exist
+                                    ? block_indirect_index::pointer_t()
+                                    : indr;
+        batch->f_position = position_oid;
+    }
+
+    return oid;
+}
+
+
+/** \brief Insert a new row.
+ *
+ * This is an internal function which the table_impl uses to insert a new
+ * row.
+ *
+ * \note
+ * The row_commit() is called first and determines whether to call
+ * insert or update or generate an error.
+ *
+ * \param[in] row_data  The row to be inserted.
+ * \param[in] cur  The cursor used to search for the row.
+ * \param[in,out] batch  The state of the batch or nullptr.
+ */
+void table_impl::row_insert(row::pointer_t row_data, cursor::pointer_t cur, commit_batch_t * batch)
+{
+    // the primary key may still point to a row which expired but was
+    // not yet deleted by the reaper; delete it now, which also means
+    // the EIDX saved in the cursor state cannot be used anymore
+    //
+    oid_t const expired_oid(cur->get_state()->get_expired_oid());
+    if(expired_oid != NULL_OID)
+    {
+        row_delete(expired_oid);
+        cur->get_state()->set_entry_index(block_entry_index::pointer_t());
+    }
+
+    // in a tree table, the parent must exist; check before anything
+    // gets allocated
+    //
+    bool const is_tree(f_schema_table->get_model() == model_t::TABLE_MODEL_TREE);
+    oid_t const tree_parent_oid(is_tree ? get_tree_parent_oid(row_data) : NULL_OID);
+
+    // if inserting, we first need to allocate this row's OID
+    //
+    block_indirect_index::pointer_t indr;
+    oid_t position_oid(NULL_OID);
+    oid_t const oid(reserve_oid(indr, position_oid, batch));
+
     // we always overwrite the _oid, actually the user should never set
     // this column directly
     //
     cell::pointer_t oid_cell(row_data->get_cell("_oid", true));
     oid_cell->set_oid(oid);
 
-    block_free_space::pointer_t fspc;
-    reference_t fspc_offset(header->get_blobs_with_free_space());
-    if(fspc_offset == NULL_FILE_ADDR)
-    {
-        // not yet allocated, create a Free Space block
-        //
-        fspc = std::static_pointer_cast<block_free_space>(
-                        allocate_new_block(dbtype_t::BLOCK_TYPE_FREE_SPACE));
+    buffer_t const blob(row_data->to_binary());
 
-        header->set_blobs_with_free_space(fspc->get_offset());
+    // small rows go in a slot of the closest size class, the others
+    // are saved in `DATA` blocks managed by the `FSPC` lists
+    //
+    free_space_t free_space;
+    slot_allocator::pointer_t slots(get_slot_allocator());
+    if(blob.size() <= slots->get_max_size())
+    {
+        free_space = slots->allocate(blob.size());
     }
     else
     {
-        fspc = std::static_pointer_cast<block_free_space>(get_block(fspc_offset));
+        file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+        block_free_space::pointer_t fspc;
+        reference_t fspc_offset(header->get_blobs_with_free_space());
+        if(fspc_offset == NULL_FILE_ADDR)
+        {
+            // not yet allocated, create a Free Space block
+            //
+            fspc = std::static_pointer_cast<block_free_space>(
+                            allocate_new_block(dbtype_t::BLOCK_TYPE_FREE_SPACE));
 
-        assert(fspc->get_dbtype() == dbtype_t::BLOCK_TYPE_FREE_SPACE);
-    }
+            header->set_blobs_with_free_space(fspc->get_offset());
+        }
+        else
+        {
+            fspc = std::static_pointer_cast<block_free_space>(get_block(fspc_offset));
 
-    buffer_t const blob(row_data->to_binary());
+            assert(fspc->get_dbtype() == dbtype_t::BLOCK_TYPE_FREE_SPACE);
+        }
 
-    free_space_t free_space(fspc->get_free_space(blob.size()));
+        free_space = fspc->get_free_space(blob.size());
+    }
 
     assert(free_space.f_size >= blob.size());
 
-    memcpy(free_space.f_block->data(free_space.f_reference), blob.data(), blob.size());
+    // the allocated space is rounded up and may have been used before;
+    // row::from_binary() stops on a column identifier of 0 so the padding
+    // must be cleared
+    //
+    data_t const ptr(free_space.f_block->data(free_space.f_reference));
+    memcpy(ptr, blob.data(), blob.size());
+    memset(ptr + blob.size(), 0, block_free_space::get_data_size(ptr) - blob.size());
     indr->set_reference(position_oid, free_space.f_reference);
 
+    conditions const & cond(cur->get_conditions());
+    buffer_t const & key(cond.get_murmur_key());
+
+    // the select() that failed to find this row left us with the EIDX
+    // and the position where the new key goes; when that block still has
+    // room, this is the fast path
+    //
     block_entry_index::pointer_t entry_index(cur->get_state()->get_entry_index());
-    if(entry_index != nullptr)
+    if(entry_index != nullptr
+    && entry_index->get_count() < entry_index->get_max_count())
     {
         std::uint32_t const position(cur->get_state()->get_entry_index_close_position());
-        conditions const & cond(cur->get_conditions());
-        buffer_t const & key(cond.get_murmur_key());
         entry_index->add_entry(key, oid, position);
-        return;
     }
-
-    cursor_state::index_reference_t::vector_t const & index_references(cur->get_state()->get_index_references());
-    if(index_references.empty())
+    else
     {
-        // this happens when we have a brand new table
+        // otherwise go through the index tree which splits the blocks as
+        // required; if the root changes, save the new one in the PIDX slot
         //
         block_primary_index::pointer_t primary_index(get_primary_index_block(true));
+        reference_t const previous_root(primary_index->get_top_index(key));
+        reference_t root(previous_root);
+        if(!get_primary_index_tree()->insert(root, key, oid))
+        {
+            throw logic_error("table: row_insert() found the key of the new row in the primary index.");
+        }
+        if(root != previous_root)
+        {
+            primary_index->set_top_index(key, root);
+        }
+    }
 
-        conditions const & cond(cur->get_conditions());
-        buffer_t const & key(cond.get_murmur_key());
-
-std::cerr << "+++ CREATE A NEW ENTRY INDEX THOUGH... (references is empty)\n";
-        entry_index = std::static_pointer_cast<block_entry_index>(
-                        allocate_new_block(dbtype_t::BLOCK_TYPE_ENTRY_INDEX));
+    // the filter gets rebuilt at twice its size once it holds more keys
+    // than it was sized for; this is done here since the readers share
+    // the filter and can't modify it
+    //
+    bloom_filter::pointer_t filter(get_bloom_filter());
+    filter->add(key);
+    if(filter->get_key_count() > filter->get_capacity())
+    {
+        rebuild_bloom_filter(filter->get_key_count() * 2);
+    }
 
-        // a murmur key is 16 bytes
-        //
-        entry_index->set_key_size(16);
+    insert_secondary_keys(row_data, oid);
+    insert_expiration_key(row_data, oid);
+    if(is_tree)
+    {
+        insert_tree_key(row_data, tree_parent_oid, oid);
+    }
+}
 
-        entry_index->add_entry(key, oid);
 
-// 1583048029
-std::cerr << "set_top_index() -- " << static_cast<int>(key[14]) << " " << static_cast<int>(key[15]) << "\n";
-        primary_index->set_top_index(key, entry_index->get_offset());
+/** \brief Add a new row to the secondary indexes.
+ *
+ * This function generates the key of the row for each secondary index
+ * of the table and inserts it in that index. It has to be called once
+ * per new row whatever the path used to update the primary index.
+ *
+ * \todo
+ * Support the filter script (i.e. partial indexes).
+ *
+ * \param[in] row_data  The row being inserted.
+ * \param[in] oid  The OID of the new row.
+ */
+void table_impl::insert_secondary_keys(row::pointer_t row_data, oid_t oid)
+{
+    for(auto const & it : f_schema_table->get_secondary_indexes())
+    {
+        block_secondary_index::pointer_t secondary_index(get_secondary_index_block(it.second, true));
+        reference_t secondary_root(secondary_index->get_top_index());
+        if(!get_secondary_index_tree()->insert(secondary_root, get_secondary_index_key(row_data, it.second, oid), oid))
+        {
+            throw logic_error("table: row_insert() found the key of the new row in secondary index \"" + it.first + "\".");
+        }
+        secondary_index->set_top_index(secondary_root);
+        secondary_index->set_number_of_rows(secondary_index->get_number_of_rows() + 1);
     }
-    else
+}
+
+
+/** \brief Add a new row to the expiration index.
+ *
+ * If the row has an expiration date, its key gets added to the
+ * expiration index so the reaper can find it once it expires.
+ *
+ * \param[in] row_data  The row being inserted.
+ * \param[in] oid  The OID of the new row.
+ */
+void table_impl::insert_expiration_key(row::pointer_t row_data, oid_t oid)
+{
+    std::uint64_t const expiration_date(row_data->get_expiration_date());
+    if(expiration_date == 0)
+    {
+        return;
+    }
+
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+    reference_t root(header->get_expiration_index_block());
+    if(!get_expiration_index_tree()->insert(root, get_expiration_index_key(expiration_date, oid), oid))
+    {
+        throw logic_error("table: row_insert() found the key of the new row in the expiration index.");
+    }
+    header->set_expiration_index_block(root);
+}
+
+
+/** \brief Get the Bloom filter of the primary keys.
+ *
+ * The first time this function gets called, the filter is loaded from
+ * the `bloom.pbf` file of the table. The file is then deleted so that if
+ * the process crashes, the filter, which is only saved on exit, does not
+ * get reused with a table that changed since. When the file is missing
+ * or invalid, the filter gets rebuilt from the primary index.
+ *
+ * The first call may come from any of the readers of the table, so the
+ * loading is protected by its own mutex.
+ *
+ * \return The Bloom filter of this table.
+ */
+bloom_filter::pointer_t table_impl::get_bloom_filter()
+{
+    cppthread::guard lock(f_lazy_mutex);
+
+    if(f_bloom_filter == nullptr)
+    {
+        f_bloom_filter = std::make_shared<bloom_filter>();
+
+        virtual_buffer::pointer_t b(std::make_shared<virtual_buffer>());
+        b->load_file(f_bloom_filter_filename, false);
+        snapdev::NOT_USED(unlink(f_bloom_filter_filename.c_str()));
+        if(!f_bloom_filter->from_binary(b))
+        {
+            rebuild_bloom_filter(0);
+        }
+    }
+
+    return f_bloom_filter;
+}
+
+
+/** \brief Regenerate the Bloom filter from the primary index.
+ *
+ * The function clears the filter and adds all the keys found in the
+ * primary index to it. This removes the bits of the deleted rows.
+ *
+ * \param[in] expected_keys  The number of keys the filter gets sized for.
+ */
+void table_impl::rebuild_bloom_filter(std::size_t expected_keys)
+{
+    if(f_bloom_filter == nullptr)
+    {
+        f_bloom_filter = std::make_shared<bloom_filter>();
+    }
+    f_bloom_filter->reset(expected_keys);
+
+    block_primary_index::pointer_t primary_index(get_primary_index_block(false));
+    if(primary_index == nullptr)
+    {
+        return;
+    }
+
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+    header->set_bloom_filter_flags(static_cast<flags_t>(bloom_filter_algorithm_t::BLOOM_FILTER_ALGORITHM_BLOCKED_BITS));
+
+    // each entry of the `PIDX` is the root of a separate tree; the
+    // entry of a key is defined by its last bits
+    //
+    std::uint32_t const key_size(get_primary_index_tree()->get_key_size());
+    buffer_t const first_key(key_size, 0);
+    std::uint32_t const max_index(1U << primary_index->get_size());
+    for(std::uint32_t k(0); k < max_index; ++k)
+    {
+        buffer_t key(first_key);
+        key[key_size - 1] = k;
+        key[key_size - 2] = k >> 8;
+        key[key_size - 3] = k >> 16;
+        reference_t const root(primary_index->get_top_index(key));
+        if(root == NULL_FILE_ADDR)
+        {
+            continue;
+        }
+
+        std::uint32_t position(0);
+        block_entry_index::pointer_t entry_index(get_primary_index_tree()->lower_bound(root, first_key, position));
+        while(entry_index != nullptr)
+        {
+            std::uint32_t const count(entry_index->get_count());
+            for(; position < count; ++position)
+            {
+                buffer_t const entry_key(entry_index->get_key(position));
+                if(primary_index->key_to_index(entry_key) != k)
+                {
+                    break;
+                }
+                f_bloom_filter->add(entry_key);
+            }
+            if(position < count
+            || entry_index->get_next() == NULL_FILE_ADDR)
+            {
+                break;
+            }
+            entry_index = std::static_pointer_cast<block_entry_index>(get_block(entry_index->get_next()));
+            position = 0;
+        }
+    }
+}
+
+
+/** \brief Save the Bloom filter.
+ *
+ * If the filter was loaded or built, it gets saved in the `bloom.pbf`
+ * file of the table so it does not need to be rebuilt on the next start.
+ */
+void table_impl::save_bloom_filter()
+{
+    std::lock_guard<table_lock> lock(f_lock);
+
+    if(f_bloom_filter == nullptr)
     {
-throw not_yet_implemented("table: TODO implement insert close to existing entry");
+        return;
     }
+
+    f_bloom_filter->to_binary()->save_file(f_bloom_filter_filename);
 }
 
 
@@ -1254,6 +1978,133 @@ snapdev::NOT_USED(row_data, cur);
 }
 
 
+/** \brief Delete a row.
+ *
+ * This function removes the keys of the row from the primary, secondary,
+ * and expiration indexes, releases the space used by the row data, and
+ * clears its reference in the indirect index.
+ *
+ * The OID of a deleted row does not get reused.
+ *
+ * \param[in] oid  The OID of the row to delete.
+ *
+ * \return true if the row existed and got deleted.
+ */
+bool table_impl::row_delete(oid_t oid)
+{
+    std::lock_guard<table_lock> lock(f_lock);
+
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+    if(oid == NULL_OID
+    || header->get_indirect_index() == NULL_FILE_ADDR
+    || oid >= header->get_last_oid())
+    {
+        return false;
+    }
+
+    // free OIDs and MISSING_FILE_ADDR are all smaller than a page
+    //
+    reference_t const page_size(get_page_size());
+    oid_t position(oid);
+    block_indirect_index::pointer_t indr(get_indirect_index(position));
+    oid_t p(position);
+    reference_t const reference(indr->get_reference(p, false));
+    if(reference < page_size)
+    {
+        return false;
+    }
+    row::pointer_t r(get_row(reference));
+
+    // primary index
+    //
+    block_primary_index::pointer_t primary_index(get_primary_index_block(false));
+    if(primary_index != nullptr)
+    {
+        buffer_t key;
+        r->generate_mumur3(key);
+        reference_t const previous_root(primary_index->get_top_index(key));
+        reference_t root(previous_root);
+        if(root != NULL_FILE_ADDR
+        && get_primary_index_tree()->remove(root, key)
+        && root != previous_root)
+        {
+            primary_index->set_top_index(key, root);
+        }
+        get_bloom_filter()->mark_deleted();
+    }
+
+    // secondary indexes
+    //
+    for(auto const & it : f_schema_table->get_secondary_indexes())
+    {
+        block_secondary_index::pointer_t secondary_index(get_secondary_index_block(it.second, false));
+        if(secondary_index == nullptr)
+        {
+            continue;
+        }
+        reference_t secondary_root(secondary_index->get_top_index());
+        if(secondary_root != NULL_FILE_ADDR
+        && get_secondary_index_tree()->remove(secondary_root, get_secondary_index_key(r, it.second, oid)))
+        {
+            secondary_index->set_top_index(secondary_root);
+            secondary_index->set_number_of_rows(secondary_index->get_number_of_rows() - 1);
+        }
+    }
+
+    // expiration index
+    //
+    std::uint64_t const expiration_date(r->get_expiration_date());
+    if(expiration_date != 0)
+    {
+        reference_t root(header->get_expiration_index_block());
+        if(root != NULL_FILE_ADDR
+        && get_expiration_index_tree()->remove(root, get_expiration_index_key(expiration_date, oid)))
+        {
+            header->set_expiration_index_block(root);
+        }
+    }
+
+    // tree index; if the parent was deleted first, the key remains
+    // but it cannot be reached anymore
+    //
+    if(f_schema_table->get_model() == model_t::TABLE_MODEL_TREE)
+    {
+        std::string parent;
+        std::string name;
+        reference_t root(header->get_tree_index_block());
+        if(root != NULL_FILE_ADDR
+        && split_tree_path(r->get_cell(get_tree_path_column(), true)->get_string(), parent, name))
+        {
+            oid_t const parent_oid(parent.empty() ? NULL_OID : find_tree_oid(parent));
+            if((parent.empty() || parent_oid != NULL_OID)
+            && get_tree_index_tree()->remove(root, get_tree_index_key(parent_oid, name, oid)))
+            {
+                header->set_tree_index_block(root);
+            }
+        }
+    }
+
+    // row data
+    //
+    block::pointer_t b(get_block(reference - reference % page_size));
+    if(b->get_dbtype() == dbtype_t::BLOCK_TYPE_SLOT_DATA)
+    {
+        get_slot_allocator()->release(reference);
+    }
+    else
+    {
+        block_free_space::pointer_t fspc(std::static_pointer_cast<block_free_space>(
+                        get_block(header->get_blobs_with_free_space())));
+        fspc->release_space(reference);
+    }
+
+    indr->set_reference(position, NULL_FILE_ADDR);
+    header->set_deleted_rows(header->get_deleted_rows() + 1);
+
+    return true;
+}
+
+
 block_primary_index::pointer_t table_impl::get_primary_index_block(bool create)
 {
     block_primary_index::pointer_t primary_index;
@@ -1304,6 +2155,30 @@ block_primary_index::pointer_t table_impl::get_primary_index_block(bool create)
  * \return The reference to a row or NULL_FILE_ADDR.
  */
 reference_t table_impl::get_indirect_reference(oid_t oid)
+{
+    block_indirect_index::pointer_t indr(get_indirect_index(oid));
+    return indr->get_reference(oid, true);
+}
+
+
+/** \brief Retrieve the `INDR` block holding the reference to a row.
+ *
+ * This function walks the `TIND` blocks down to the `INDR` block which
+ * holds the reference of the row with the specified \p oid.
+ *
+ * On return, \p oid is the position of the reference within the
+ * returned `INDR` block, ready to be used with its get_reference()
+ * and set_reference() functions.
+ *
+ * \exception logic_error
+ * The \p oid must be the OID of an existing row.
+ *
+ * \param[in,out] oid  The OID of the row, replaced by its position in
+ * the `INDR` block.
+ *
+ * \return The `INDR` block with the reference to the row.
+ */
+block_indirect_index::pointer_t table_impl::get_indirect_index(oid_t & oid)
 {
     // search for a row using its OID
     //
@@ -1343,202 +2218,1848 @@ reference_t table_impl::get_indirect_reference(oid_t oid)
                 + "\" instead.");
     }
 
-    block_indirect_index::pointer_t indr(std::static_pointer_cast<block_indirect_index>(block));
-    return indr->get_reference(oid, true);
+    return std::static_pointer_cast<block_indirect_index>(block);
 }
 
 
-row::pointer_t table_impl::get_indirect_row(oid_t oid)
+row_view::pointer_t table_impl::get_indirect_row_view(oid_t oid)
 {
-    return get_row(get_indirect_reference(oid));
+    return get_row_view(get_indirect_reference(oid));
 }
 
 
-row::pointer_t table_impl::get_row(reference_t row_reference)
+index_tree::pointer_t table_impl::get_primary_index_tree()
 {
-    block_data::pointer_t data(std::static_pointer_cast<block_data>(get_block(row_reference)));
-    const_data_t ptr(data->data(row_reference));
-    std::uint32_t const size(block_free_space::get_size(ptr));
-    row::pointer_t row(std::make_shared<row>(f_table->get_pointer()));
+    cppthread::guard lock(f_lazy_mutex);
 
-    // TODO: rework the from_binary() to access the ptr/size pair instead
-    //       so we can avoid one copy
-    //
-    buffer_t const blob(ptr, ptr + size);
-    row->from_binary(blob);
+    if(f_primary_index_tree == nullptr)
+    {
+        // a murmur key is 16 bytes
+        //
+        f_primary_index_tree = std::make_shared<index_tree>(f_table->get_pointer(), 16);
+        f_primary_index_tree->set_layout(f_schema_table->get_index_layout());
+    }
 
-    return row;
+    return f_primary_index_tree;
 }
 
 
-void table_impl::read_rows(cursor_data & data)
+index_tree::pointer_t table_impl::get_secondary_index_tree()
 {
-    switch(data.f_state->get_index_type())
+    cppthread::guard lock(f_lazy_mutex);
+
+    if(f_secondary_index_tree == nullptr)
     {
-    case index_type_t::INDEX_TYPE_SECONDARY:
-        read_secondary(data);
-        break;
+        f_secondary_index_tree = std::make_shared<index_tree>(f_table->get_pointer(), SECONDARY_INDEX_KEY_SIZE);
+        f_secondary_index_tree->set_fill_factor(get_index_fill_factor());
+        f_secondary_index_tree->set_layout(f_schema_table->get_index_layout());
+    }
 
-    case index_type_t::INDEX_TYPE_INDIRECT:
-        read_indirect(data);
-        break;
+    return f_secondary_index_tree;
+}
 
-    case index_type_t::INDEX_TYPE_PRIMARY:
-        read_primary(data);
-        break;
 
-    case index_type_t::INDEX_TYPE_EXPIRATION:
-        read_expiration(data);
-        break;
+index_tree::pointer_t table_impl::get_expiration_index_tree()
+{
+    cppthread::guard lock(f_lazy_mutex);
+
+    if(f_expiration_index_tree == nullptr)
+    {
+        f_expiration_index_tree = std::make_shared<index_tree>(f_table->get_pointer(), EXPIRATION_INDEX_KEY_SIZE);
+        f_expiration_index_tree->set_fill_factor(get_index_fill_factor());
+        f_expiration_index_tree->set_layout(f_schema_table->get_index_layout());
+    }
+
+    return f_expiration_index_tree;
+}
+
+
+index_tree::pointer_t table_impl::get_tree_index_tree()
+{
+    cppthread::guard lock(f_lazy_mutex);
+
+    if(f_tree_index_tree == nullptr)
+    {
+        f_tree_index_tree = std::make_shared<index_tree>(f_table->get_pointer(), TREE_INDEX_KEY_SIZE);
+        f_tree_index_tree->set_fill_factor(get_index_fill_factor());
+
+        // the children of a page share the parent OID and often the
+        // beginning of their name so front coding saves a lot of space
+        //
+        f_tree_index_tree->set_layout(index_layout_t::INDEX_LAYOUT_PREFIX);
+    }
+
+    return f_tree_index_tree;
+}
+
+
+/** \brief Get the column holding the path of the rows of a tree table.
+ *
+ * A `TABLE_MODEL_TREE` table must have a primary key composed of exactly
+ * one string column. That column is the path of the row.
+ *
+ * \exception type_mismatch
+ * The primary key is not one string column.
+ *
+ * \return The identifier of the path column.
+ */
+column_id_t table_impl::get_tree_path_column()
+{
+    column_ids_t const ids(f_schema_table->get_primary_key());
+    if(ids.size() == 1)
+    {
+        switch(f_schema_table->get_column(ids[0])->get_type())
+        {
+        case struct_type_t::STRUCT_TYPE_P8STRING:
+        case struct_type_t::STRUCT_TYPE_P16STRING:
+        case struct_type_t::STRUCT_TYPE_P32STRING:
+            return ids[0];
+
+        default:
+            break;
+
+        }
+    }
+
+    throw type_mismatch(
+              "the primary key of tree table \""
+            + f_name
+            + "\" must be exactly one string column (the path).");
+}
+
+
+/** \brief Search the OID of the row with the specified path.
+ *
+ * \param[in] path  The path of the row to search.
+ *
+ * \return The OID of the row or NULL_OID if no row has that path.
+ */
+oid_t table_impl::find_tree_oid(std::string const & path)
+{
+    block_primary_index::pointer_t primary_index(get_primary_index_block(false));
+    if(primary_index == nullptr)
+    {
+        return NULL_OID;
+    }
+
+    row::pointer_t r(f_table->row_new());
+    r->get_cell(get_tree_path_column(), true)->set_string(path);
+    buffer_t key;
+    r->generate_mumur3(key);
+    reference_t const root(primary_index->get_top_index(key));
+    if(root == NULL_FILE_ADDR)
+    {
+        return NULL_OID;
+    }
+    return get_primary_index_tree()->find(root, key);
+}
+
+
+/** \brief Get the OID of the parent of a row in a tree table.
+ *
+ * The tree is expected to be perfect: the parent of a row must exist
+ * before the row gets inserted. The rows at the top of the tree have
+ * the root as their parent which is represented by NULL_OID.
+ *
+ * \exception row_not_found
+ * The parent of the row does not exist.
+ *
+ * \param[in] row_data  The row of which the parent is searched.
+ *
+ * \return The OID of the parent row or NULL_OID for the root.
+ */
+oid_t table_impl::get_tree_parent_oid(row::pointer_t row_data)
+{
+    std::string const path(row_data->get_cell(get_tree_path_column(), true)->get_string());
+    std::string parent;
+    std::string name;
+    if(!split_tree_path(path, parent, name)
+    || parent.empty())
+    {
+        return NULL_OID;
+    }
+
+    oid_t const parent_oid(find_tree_oid(parent));
+    if(parent_oid == NULL_OID)
+    {
+        throw row_not_found(
+                  "the parent \""
+                + parent
+                + "\" of \""
+                + path
+                + "\" does not exist in tree table \""
+                + f_name
+                + "\".");
+    }
+    return parent_oid;
+}
+
+
+/** \brief Generate the key saved in the tree index.
+ *
+ * \param[in] parent_oid  The OID of the parent row.
+ * \param[in] name  The last segment of the path of the row.
+ * \param[in] oid  The OID of the row.
+ *
+ * \return The key to save in the index.
+ */
+buffer_t table_impl::get_tree_index_key(oid_t parent_oid, std::string const & name, oid_t oid)
+{
+    buffer_t key;
+    push_be_uint64(key, parent_oid);
+    key.insert(key.end(), name.begin(), name.begin() + std::min(name.length(), static_cast<std::size_t>(TREE_INDEX_NAME_SIZE)));
+    key.resize(sizeof(oid_t) + TREE_INDEX_NAME_SIZE);
+    push_be_uint64(key, oid);
+    return key;
+}
+
+
+/** \brief Add a new row to the tree index.
+ *
+ * The root itself (i.e. "/") is not added to the tree index since it
+ * is not the child of any row.
+ *
+ * \param[in] row_data  The new row.
+ * \param[in] parent_oid  The OID of the parent as returned by
+ * get_tree_parent_oid().
+ * \param[in] oid  The OID of the new row.
+ */
+void table_impl::insert_tree_key(row::pointer_t row_data, oid_t parent_oid, oid_t oid)
+{
+    std::string parent;
+    std::string name;
+    if(!split_tree_path(row_data->get_cell(get_tree_path_column(), true)->get_string(), parent, name))
+    {
+        return;
+    }
+
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+    reference_t root(header->get_tree_index_block());
+    if(!get_tree_index_tree()->insert(root, get_tree_index_key(parent_oid, name, oid), oid))
+    {
+        throw logic_error("table: row_insert() found the key of the new row in the tree index.");
+    }
+    header->set_tree_index_block(root);
+}
+
+
+/** \brief Search for the `SIDX` block of a secondary index.
+ *
+ * The `SIDX` blocks are linked together starting with the one referenced
+ * in the table header. The block with the same identifier as \p index
+ * gets returned. If not found and \p create is true, a new `SIDX` gets
+ * created at the end of the list.
+ *
+ * \param[in] index  The secondary index to search.
+ * \param[in] create  Whether to create the block if it does not exist yet.
+ *
+ * \return The `SIDX` block or nullptr.
+ */
+block_secondary_index::pointer_t table_impl::get_secondary_index_block(
+      schema_secondary_index::pointer_t index
+    , bool create)
+{
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+    block_secondary_index::pointer_t previous;
+    for(reference_t offset(header->get_secondary_index_block()); offset != NULL_FILE_ADDR;)
+    {
+        block_secondary_index::pointer_t secondary_index(std::static_pointer_cast<block_secondary_index>(get_block(offset)));
+        if(secondary_index->get_id() == index->get_id())
+        {
+            return secondary_index;
+        }
+        previous = secondary_index;
+        offset = secondary_index->get_next_secondary_index();
+    }
+
+    if(!create)
+    {
+        return block_secondary_index::pointer_t();
+    }
+
+    block_secondary_index::pointer_t secondary_index(std::static_pointer_cast<block_secondary_index>(
+                    allocate_new_block(dbtype_t::BLOCK_TYPE_SECONDARY_INDEX)));
+    secondary_index->set_id(index->get_id());
+    if(previous == nullptr)
+    {
+        header->set_secondary_index_block(secondary_index->get_offset());
+    }
+    else
+    {
+        previous->set_next_secondary_index(secondary_index->get_offset());
+    }
+    return secondary_index;
+}
+
+
+/** \brief Generate the key saved in a secondary index.
+ *
+ * The key generated by row::generate_secondary_key() gets truncated or
+ * padded to SECONDARY_INDEX_KEY_PREFIX_SIZE bytes and it is followed by
+ * the OID in big endian. This way two rows with the same values have
+ * different keys and the rows are sorted by OID within equal values.
+ *
+ * \param[in] row_data  The row to generate the key of.
+ * \param[in] index  The secondary index.
+ * \param[in] oid  The OID of the row.
+ *
+ * \return The key to save in the index.
+ */
+buffer_t table_impl::get_secondary_index_key(
+      row::pointer_t row_data
+    , schema_secondary_index::pointer_t index
+    , oid_t oid)
+{
+    buffer_t key;
+    row_data->generate_secondary_key(index, key);
+    key.resize(SECONDARY_INDEX_KEY_PREFIX_SIZE);
+    push_be_uint64(key, oid);
+    return key;
+}
+
+
+/** \brief Generate the key saved in the expiration index.
+ *
+ * \param[in] expiration_date  The expiration date in microseconds.
+ * \param[in] oid  The OID of the row.
+ *
+ * \return The key to save in the index.
+ */
+buffer_t table_impl::get_expiration_index_key(std::uint64_t expiration_date, oid_t oid)
+{
+    buffer_t key;
+    push_be_uint64(key, expiration_date);
+    push_be_uint64(key, oid);
+    return key;
+}
+
+
+std::uint32_t table_impl::get_index_fill_factor()
+{
+    return get_primary_index_tree()->get_fill_factor();
+}
+
+
+void table_impl::set_index_fill_factor(std::uint32_t fill_factor)
+{
+    get_primary_index_tree()->set_fill_factor(fill_factor);
+    get_secondary_index_tree()->set_fill_factor(fill_factor);
+    get_expiration_index_tree()->set_fill_factor(fill_factor);
+    get_tree_index_tree()->set_fill_factor(fill_factor);
+}
+
+
+index_builder::pointer_t table_impl::create_primary_index_builder()
+{
+    block_primary_index::pointer_t primary_index(get_primary_index_block(true));
+
+    // a murmur key is 16 bytes
+    //
+    index_builder::pointer_t builder(std::make_shared<index_builder>(f_table->get_pointer(), 16));
+    builder->set_fill_factor(get_index_fill_factor());
+    builder->set_layout(get_primary_index_tree()->get_layout());
+    builder->set_partition([primary_index](buffer_t const & key)
+        {
+            return primary_index->key_to_index(key);
+        });
+    return builder;
+}
+
+
+void table_impl::build_primary_index(index_builder::pointer_t builder)
+{
+    std::lock_guard<table_lock> lock(f_lock);
+
+    // verify all the `PIDX` entries before building anything
+    //
+    block_primary_index::pointer_t primary_index(get_primary_index_block(true));
+    std::uint32_t const key_size(builder->get_key_size());
+    std::uint32_t const max_index(1U << primary_index->get_size());
+    for(std::uint32_t k(0); k < max_index; ++k)
+    {
+        buffer_t key(key_size, 0);
+        key[key_size - 1] = k;
+        key[key_size - 2] = k >> 8;
+        key[key_size - 3] = k >> 16;
+        if(primary_index->get_top_index(key) != NULL_FILE_ADDR)
+        {
+            throw logic_error("table: the primary index must be empty to be bulk loaded.");
+        }
+    }
+
+    std::uint64_t const count(builder->get_count());
+    builder->build([primary_index](buffer_t const & first_key, reference_t root)
+        {
+            primary_index->set_top_index(first_key, root);
+        });
+
+    rebuild_bloom_filter(count);
+}
+
+
+/** \brief Build a secondary index from the existing rows.
+ *
+ * This function reads all the rows of the table, generates their
+ * secondary key and builds the index bottom up. This is used when a
+ * secondary index gets added to a table which already has rows.
+ *
+ * \exception invalid_name
+ * The table has no secondary index named \p name.
+ * \exception logic_error
+ * The secondary index is not empty.
+ *
+ * \param[in] name  The name of the secondary index to build.
+ *
+ * \return The number of rows added to the index.
+ */
+std::uint64_t table_impl::build_secondary_index(std::string const & name)
+{
+    std::lock_guard<table_lock> lock(f_lock);
+
+    schema_secondary_index::pointer_t index(get_secondary_index(name));
+    if(index == nullptr)
+    {
+        throw invalid_name(
+                  "\""
+                + name
+                + "\" is not a known secondary index in table \""
+                + get_name()
+                + "\".");
+    }
+
+    block_secondary_index::pointer_t secondary_index(get_secondary_index_block(index, true));
+    if(secondary_index->get_top_index() != NULL_FILE_ADDR)
+    {
+        throw logic_error("table: the secondary index \"" + name + "\" must be empty to be bulk loaded.");
+    }
+
+    index_builder::pointer_t builder(std::make_shared<index_builder>(f_table->get_pointer(), SECONDARY_INDEX_KEY_SIZE));
+    builder->set_fill_factor(get_index_fill_factor());
+    builder->set_layout(get_secondary_index_tree()->get_layout());
+
+    conditions cond;
+    cond.set_key("_indirect", row::pointer_t(), row::pointer_t());
+    cursor::pointer_t cur(f_table->row_select(cond));
+    for(;;)
+    {
+        row::pointer_t r(cur->next_row());
+        if(r == nullptr)
+        {
+            break;
+        }
+        oid_t const oid(r->get_cell("_oid", false)->get_oid());
+        builder->add(get_secondary_index_key(r, index, oid), oid);
+    }
+
+    std::uint64_t const count(builder->get_count());
+    builder->build([secondary_index](buffer_t const & first_key, reference_t root)
+        {
+            snapdev::NOT_USED(first_key);
+            secondary_index->set_top_index(root);
+        });
+    secondary_index->set_number_of_rows(count);
+
+    return count;
+}
+
+
+/** \brief Get the slot allocator of this table.
+ *
+ * The allocator gets created and its bitmaps rebuilt from the `SLOT`
+ * blocks the first time it is needed.
+ *
+ * \return The slot allocator of this table.
+ */
+slot_allocator::pointer_t table_impl::get_slot_allocator()
+{
+    if(f_slot_allocator == nullptr)
+    {
+        f_slot_allocator = std::make_shared<slot_allocator>(f_table->get_pointer());
+        f_slot_allocator->load();
+    }
+
+    return f_slot_allocator;
+}
+
+
+row::pointer_t table_impl::get_row(reference_t row_reference)
+{
+    // the row may be in a `DATA` or a `SLOT` block
+    //
+    block::pointer_t data(get_block(row_reference));
+    const_data_t ptr(data->data(row_reference));
+    std::uint32_t const size(block_free_space::get_data_size(ptr));
+    row::pointer_t row(std::make_shared<row>(f_table->get_pointer()));
+    row->from_binary(ptr, size);
+
+    return row;
+}
+
+
+/** \brief Get a read-only view of a row.
+ *
+ * The view points directly to the row in its block. The data is neither
+ * copied nor decoded until a cell gets accessed.
+ *
+ * \param[in] row_reference  The reference to the row in a `DATA` or `SLOT`
+ * block.
+ *
+ * \return The view of the row.
+ */
+row_view::pointer_t table_impl::get_row_view(reference_t row_reference)
+{
+    block::pointer_t data(get_block(row_reference));
+    const_data_t ptr(data->data(row_reference));
+    std::uint32_t const size(block_free_space::get_data_size(ptr));
+    return std::make_shared<row_view>(f_table->get_pointer(), data, ptr, size);
+}
+
+
+/** \brief Check whether a row expired.
+ *
+ * The rows which expired remain in the table until the reaper deletes
+ * them. In the meantime, the read functions use this function to hide
+ * them.
+ *
+ * Only the expiration date cell of the row gets decoded.
+ *
+ * \param[in] view  The view of the row to check.
+ * \param[in] now  The current time in microseconds or 0 if the table
+ * does not support expiration.
+ *
+ * \return true if the row expired.
+ */
+bool table_impl::is_expired(row_view::pointer_t view, std::uint64_t now)
+{
+    if(now == 0)
+    {
+        return false;
+    }
+
+    std::uint64_t const expiration_date(view->get_expiration_date());
+    return expiration_date != 0
+        && expiration_date <= now;
+}
+
+
+/** \brief Add a row to the rows read by a cursor.
+ *
+ * A read-only cursor receives the \p view as is. Otherwise the row gets
+ * decoded, unless the caller already did so and passes it in \p row_data.
+ * When the conditions select a few columns, only those get decoded.
+ *
+ * \param[in] data  The cursor data where the row gets added.
+ * \param[in] view  The view of the row to add.
+ * \param[in] row_data  The row if already decoded.
+ */
+void table_impl::add_row(cursor_data & data, row_view::pointer_t view, row::pointer_t row_data)
+{
+    if(data.f_cursor->get_conditions().get_read_only())
+    {
+        data.f_views.push_back(view);
+        return;
+    }
+
+    if(row_data == nullptr
+    || !data.f_projection.empty())
+    {
+        row_data = view->to_row(data.f_projection);
+    }
+    data.f_rows.push_back(row_data);
+}
+
+
+void table_impl::read_rows(cursor_data & data)
+{
+    std::shared_lock<table_lock> lock(f_lock);
+
+    // rows which expired are hidden until the reaper deletes them
+    //
+    if(f_schema_table->has_expiration_date_column())
+    {
+        snapdev::timespec_ex const now(snapdev::now());
+        data.f_now = now.tv_sec * 1'000'000 + now.tv_nsec / 1'000;
+    }
+
+    // only decode the columns the user asked for
+    //
+    for(auto const & name : data.f_cursor->get_conditions().get_columns())
+    {
+        schema_column::pointer_t column(f_schema_table->get_column(name));
+        if(column == nullptr)
+        {
+            throw column_not_found(
+                      "column \""
+                    + name
+                    + "\" selected in the conditions does not exist in table \""
+                    + f_schema_table->get_name()
+                    + "\".");
+        }
+        data.f_projection.push_back(column->get_column_id());
+    }
+    std::sort(data.f_projection.begin(), data.f_projection.end());
+
+    switch(data.f_state->get_index_type())
+    {
+    case index_type_t::INDEX_TYPE_SECONDARY:
+        read_secondary(data);
+        break;
+
+    case index_type_t::INDEX_TYPE_INDIRECT:
+        read_indirect(data);
+        break;
+
+    case index_type_t::INDEX_TYPE_PRIMARY:
+        read_primary(data);
+        break;
+
+    case index_type_t::INDEX_TYPE_EXPIRATION:
+        read_expiration(data);
+        break;
+
+    case index_type_t::INDEX_TYPE_TREE:
+        read_tree(data);
+        break;
+
+    default:
+        throw logic_error("unexpected index type in read_rows().");
+
+    }
+}
+
+
+/** \brief Read the next page of rows of a secondary index.
+ *
+ * The rows are read in the order of the index, or in reverse order if
+ * the conditions say so, between the minimum and maximum keys of the
+ * conditions. Each call reads at most "count" rows. The cursor state
+ * remembers the last key read so the next call continues from there
+ * even if the index changed in between. If the cursor position does
+ * not match the number of rows read so far (i.e. the cursor was rewound
+ * or went back), the scan restarts from the beginning.
+ *
+ * The keys saved in the index are truncated, so the key of each row is
+ * generated again and compared against the exact minimum and maximum.
+ *
+ * With NULL_MODE_FIRST and NULL_MODE_LAST, the index is read twice: once
+ * for the rows with a null in their key and once for the other rows.
+ *
+ * \param[in] data  The cursor data where the rows get added.
+ */
+void table_impl::read_secondary(cursor_data & data)
+{
+    schema_secondary_index::pointer_t index(data.f_state->get_secondary_index());
+    block_secondary_index::pointer_t secondary_index(get_secondary_index_block(index, false));
+    if(secondary_index == nullptr)
+    {
+        return;
+    }
+    reference_t const root(secondary_index->get_top_index());
+    if(root == NULL_FILE_ADDR)
+    {
+        return;
+    }
+
+    cursor_state::scan_state_t & scan(data.f_state->get_scan_state());
+    if(scan.f_position != data.f_cursor->get_position())
+    {
+        scan = cursor_state::scan_state_t();
+    }
+    if(scan.f_done)
+    {
+        return;
+    }
+
+    conditions const & cond(data.f_cursor->get_conditions());
+    buffer_t min_key;
+    if(cond.get_min_key() != nullptr)
+    {
+        cond.get_min_key()->generate_secondary_key(index, min_key, true);
+    }
+    buffer_t max_key;
+    if(cond.get_max_key() != nullptr)
+    {
+        cond.get_max_key()->generate_secondary_key(index, max_key, true);
+        max_key.push_back(0xFF);
+    }
+    std::size_t const min_length(std::min(min_key.size(), static_cast<std::size_t>(SECONDARY_INDEX_KEY_PREFIX_SIZE)));
+    std::size_t const max_length(std::min(max_key.size(), static_cast<std::size_t>(SECONDARY_INDEX_KEY_PREFIX_SIZE)));
+
+    null_mode_t const null_mode(cond.get_nulls());
+    bool const two_passes(null_mode == null_mode_t::NULL_MODE_FIRST
+                       || null_mode == null_mode_t::NULL_MODE_LAST);
+    bool const reverse(cond.get_reverse());
+    count_t const count(cond.get_count());
+    count_t const limit(cond.get_limit());
+    count_t read(0);
+
+    index_tree::pointer_t tree(get_secondary_index_tree());
+    for(;;)
+    {
+        // find where this pass (re)starts; the entries are read strictly
+        // after (or before in reverse) the search key when resuming
+        //
+        buffer_t search(scan.f_key);
+        if(search.empty())
+        {
+            search = reverse ? max_key : min_key;
+            search.resize(std::min(search.size(), static_cast<std::size_t>(SECONDARY_INDEX_KEY_PREFIX_SIZE)));
+            search.resize(SECONDARY_INDEX_KEY_SIZE, reverse ? 0xFF : 0x00);
+        }
+        std::uint32_t position(0);
+        block_entry_index::pointer_t entry_index(tree->lower_bound(root, search, position));
+        if(!reverse
+        && !scan.f_key.empty()
+        && position < entry_index->get_count()
+        && entry_index->get_key(position) == scan.f_key)
+        {
+            ++position;
+        }
+
+        for(;;)
+        {
+            if(reverse)
+            {
+                if(position == 0)
+                {
+                    reference_t const previous(entry_index->get_previous());
+                    if(previous == NULL_FILE_ADDR)
+                    {
+                        break;
+                    }
+                    entry_index = std::static_pointer_cast<block_entry_index>(get_block(previous));
+                    position = entry_index->get_count();
+                    continue;
+                }
+                --position;
+            }
+            else if(position >= entry_index->get_count())
+            {
+                reference_t const next(entry_index->get_next());
+                if(next == NULL_FILE_ADDR)
+                {
+                    break;
+                }
+                entry_index = std::static_pointer_cast<block_entry_index>(get_block(next));
+                position = 0;
+                continue;
+            }
+
+            buffer_t const key(entry_index->get_key(position));
+            oid_t const oid(entry_index->get_oid(position));
+            if(reverse)
+            {
+                if(min_length > 0
+                && memcmp(key.data(), min_key.data(), min_length) < 0)
+                {
+                    break;
+                }
+            }
+            else
+            {
+                ++position;
+                if(max_length > 0
+                && memcmp(key.data(), max_key.data(), max_length) > 0)
+                {
+                    break;
+                }
+            }
+            scan.f_key = key;
+
+            row_view::pointer_t view(get_indirect_row_view(oid));
+            if(is_expired(view, data.f_now))
+            {
+                continue;
+            }
+            row::pointer_t r(view->to_row());
+            buffer_t row_key;
+            bool const has_null(r->generate_secondary_key(index, row_key));
+            if((!min_key.empty() && row_key < min_key)
+            || (!max_key.empty() && row_key > max_key))
+            {
+                continue;
+            }
+            switch(null_mode)
+            {
+            case null_mode_t::NULL_MODE_SORTED:
+                break;
+
+            case null_mode_t::NULL_MODE_IGNORE:
+                if(has_null)
+                {
+                    continue;
+                }
+                break;
+
+            case null_mode_t::NULL_MODE_FIRST:
+                if(has_null != (scan.f_pass == 0))
+                {
+                    continue;
+                }
+                break;
+
+            case null_mode_t::NULL_MODE_LAST:
+                if(has_null != (scan.f_pass == 1))
+                {
+                    continue;
+                }
+                break;
+
+            }
+            if(scan.f_skipped < cond.get_offset())
+            {
+                ++scan.f_skipped;
+                continue;
+            }
+
+            add_row(data, view, r);
+            ++scan.f_position;
+            ++read;
+            if(limit != CURSOR_NO_LIMIT
+            && scan.f_position >= limit)
+            {
+                scan.f_done = true;
+                return;
+            }
+            if(count != 0
+            && read >= count)
+            {
+                return;
+            }
+        }
+
+        if(!two_passes
+        || scan.f_pass != 0)
+        {
+            scan.f_done = true;
+            return;
+        }
+        scan.f_pass = 1;
+        scan.f_key.clear();
+    }
+}
+
+
+/** \brief Read the next page of rows in OID order.
+ *
+ * This scan goes through the `TIND`/`INDR` tree and returns all the rows
+ * sorted by OID, or in reverse order if the conditions say so. It is
+ * used by maintenance jobs and exports which need to visit every row.
+ *
+ * The references are read in batches of INDIRECT_SCAN_BATCH_SIZE OIDs.
+ * Before decoding the rows of one batch, the references of the next
+ * batch are read and their pages get prefetched. That way the kernel
+ * loads the next `DATA` and `SLOT` pages while we decode the current
+ * ones and the scan is not bounded by the latency of page faults.
+ *
+ * The offset is applied to the references directly, so skipped rows
+ * are not decoded. As with read_secondary(), the scan restarts from
+ * the beginning if the cursor position does not match the number of
+ * rows read so far.
+ *
+ * \param[in] data  The cursor data where the rows get added.
+ */
+void table_impl::read_indirect(cursor_data & data)
+{
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+    reference_t tref(header->get_indirect_index());
+    if(tref == NULL_FILE_ADDR)
+    {
+        // we have nothing here
+        // (happens until we do some commit)
+        //
+        return;
+    }
+
+    cursor_state::scan_state_t & scan(data.f_state->get_scan_state());
+    if(scan.f_position != data.f_cursor->get_position())
+    {
+        scan = cursor_state::scan_state_t();
+    }
+    if(scan.f_done)
+    {
+        return;
+    }
+
+    conditions const & cond(data.f_cursor->get_conditions());
+    bool const reverse(cond.get_reverse());
+    count_t const count(cond.get_count());
+    count_t const limit(cond.get_limit());
+    count_t read(0);
+
+    oid_t const last_oid(header->get_last_oid());
+    if(scan.f_oid == NULL_OID)
+    {
+        scan.f_oid = reverse ? last_oid - 1 : 1;
+    }
+
+    indirect_row_t::vector_t rows;
+    oid_t next_oid(get_indirect_rows(scan.f_oid, last_oid, reverse, rows));
+    reference_vector_t prefetch;
+    for(auto const & r : rows)
+    {
+        prefetch.push_back(r.f_reference);
+    }
+    f_dbfile->prefetch(prefetch);
+
+    while(!rows.empty())
+    {
+        // read ahead while we decode the current batch
+        //
+        indirect_row_t::vector_t next_rows;
+        next_oid = get_indirect_rows(next_oid, last_oid, reverse, next_rows);
+        prefetch.clear();
+        for(auto const & r : next_rows)
+        {
+            prefetch.push_back(r.f_reference);
+        }
+        f_dbfile->prefetch(prefetch);
+
+        for(auto const & r : rows)
+        {
+            scan.f_oid = reverse ? r.f_oid - 1 : r.f_oid + 1;
+            if(scan.f_oid == NULL_OID)
+            {
+                // this is the first OID, there is nothing left in reverse
+                // order and a NULL_OID would restart the scan from the end
+                //
+                scan.f_done = true;
+            }
+
+            // when rows can expire, we have to check their expiration
+            // date to know whether they count against the offset
+            //
+            row_view::pointer_t view;
+            if(data.f_now != 0)
+            {
+                view = get_row_view(r.f_reference);
+                if(is_expired(view, data.f_now))
+                {
+                    continue;
+                }
+            }
+            if(scan.f_skipped < cond.get_offset())
+            {
+                ++scan.f_skipped;
+                continue;
+            }
+
+            if(view == nullptr)
+            {
+                view = get_row_view(r.f_reference);
+            }
+            add_row(data, view);
+            ++scan.f_position;
+            ++read;
+            if(limit != CURSOR_NO_LIMIT
+            && scan.f_position >= limit)
+            {
+                scan.f_done = true;
+                return;
+            }
+            if(count != 0
+            && read >= count)
+            {
+                return;
+            }
+        }
+
+        rows.swap(next_rows);
+    }
+
+    scan.f_done = true;
+}
+
+
+/** \brief Read the references of the rows following \p oid.
+ *
+ * This function reads up to INDIRECT_SCAN_BATCH_SIZE entries from the
+ * `INDR` blocks starting at \p oid and going up (or down when \p reverse
+ * is true). The entries which are not row references (i.e. free OIDs and
+ * MISSING_FILE_ADDR) are skipped. The OIDs are limited to \p last_oid,
+ * the next OID to be allocated.
+ *
+ * Each `INDR` block is searched once and then read sequentially.
+ *
+ * \param[in] oid  The first OID to read.
+ * \param[in] last_oid  The next OID to be allocated in this table.
+ * \param[in] reverse  Whether to read the OIDs in decreasing order.
+ * \param[out] rows  The vector where the OIDs and references are added.
+ *
+ * \return The OID to read next or NULL_OID once the first OID was read
+ * in reverse order.
+ */
+oid_t table_impl::get_indirect_rows(
+          oid_t oid
+        , oid_t last_oid
+        , bool reverse
+        , indirect_row_t::vector_t & rows)
+{
+    reference_t const page_size(f_dbfile->get_page_size());
+    for(std::size_t count(0); count < INDIRECT_SCAN_BATCH_SIZE && oid != NULL_OID && oid < last_oid; )
+    {
+        oid_t position(oid);
+        block_indirect_index::pointer_t indr(get_indirect_index(position));
+        oid_t const max_count(indr->get_max_count());
+        for(; count < INDIRECT_SCAN_BATCH_SIZE; ++count)
+        {
+            // free OIDs and MISSING_FILE_ADDR are all smaller than a page
+            // and the first page is the header, never a `DATA` block
+            //
+            oid_t p(position);
+            reference_t const reference(indr->get_reference(p, false));
+            if(reference >= page_size)
+            {
+                rows.push_back({ oid, reference });
+            }
+
+            if(reverse)
+            {
+                --oid;
+                --position;
+                if(position == 0)
+                {
+                    ++count;
+                    break;
+                }
+            }
+            else
+            {
+                ++oid;
+                ++position;
+                if(position > max_count
+                || oid >= last_oid)
+                {
+                    ++count;
+                    break;
+                }
+            }
+        }
+    }
+
+    return oid;
+}
+
+
+void table_impl::read_primary(cursor_data & data)
+{
+    // the primary index has a single position at position 0
+    //
+std::cerr << "the position is: " << data.f_cursor->get_position() << "\n";
+    if(data.f_cursor->get_position() > 0)
+    {
+        return;
+    }
+
+    block_primary_index::pointer_t primary_index(get_primary_index_block(false));
+    if(primary_index == nullptr)
+    {
+        // we have nothing here
+        // (happens until we do some commit)
+        //
+std::cerr << "read_primary: no primary index block!?\n";
+        return;
+    }
+
+    // the primary key is "special" in that we get the content of the
+    // columns and then calculate the murmur value; the murmur is what's
+    // used as the key, not the content of the columns
+    //
+    conditions const & cond(data.f_cursor->get_conditions());
+    buffer_t const & key(cond.get_murmur_key());
+
+    // most lookups of missing keys stop here
+    //
+    if(!get_bloom_filter()->may_contain(key))
+    {
+        return;
+    }
+std::cerr << "read primary with \"set_top_index()\" -- " << static_cast<int>(key[14]) << " " << static_cast<int>(key[15]) << "\n";
+
+    // we may have one `PIDX`
+    //
+    // TODO: consider making the primary index optional
+    //
+    reference_t ref(primary_index->get_top_index(key));
+    if(ref == NULL_FILE_ADDR)
+    {
+        // no such entry, "SELECT" returns an empty list
+        //
+std::cerr << "read_primary: no top index reference!?\n";
+        return;
+    }
+    block::pointer_t block(get_block(ref));
+
+    // we can have any number of `TIDX` or directly an `EIDX`
+    //
+std::cerr << "read_primary: loop through top indexex if any!?\n";
+    while(block->get_dbtype() == dbtype_t::BLOCK_TYPE_TOP_INDEX)
+    {
+std::cerr << "read_primary: got at least one top indexex!\n";
+        // we have a top index
+        //
+        block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(block));
+        std::uint32_t position(0);
+        ref = top_index->find_index(key, position);
+        cursor_state::index_reference_t idx_ref = {
+              ref
+            , position
+        };
+std::cerr << "read_primary: found a top index!?\n";
+        data.f_state->add_index_reference(idx_ref);
+        if(ref == NULL_FILE_ADDR)
+        {
+            // no such entry, "SELECT" returns an empty list
+            //
+std::cerr << "read_primary: top index has null reference!?\n";
+            return;
+        }
+        block = get_block(ref);
+    }
+
+    if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+    {
+        throw type_mismatch(
+                  "Found unexpected block of type \""
+                + std::string(to_name(block->get_dbtype()))
+                + "\". Expected an  \""
+                + to_name(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+                + "\".");
+    }
+
+    block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(block));
+    data.f_state->set_entry_index(entry_index);
+
+    std::uint32_t position(0);
+    oid_t const oid(entry_index->find_entry(key, position));
+    data.f_state->set_entry_index_close_position(position);
+    if(oid == NULL_FILE_ADDR)
+    {
+std::cerr << "read_primary: indirect index has null reference!?\n";
+        return;
+    }
+
+std::cerr << "read_primary: reading row!?\n";
+    row_view::pointer_t view(get_indirect_row_view(oid));
+    if(is_expired(view, data.f_now))
+    {
+        data.f_state->set_expired_oid(oid);
+        return;
+    }
+    add_row(data, view);
+
+//std::cerr << "table: TODO implement read primary...\n";
+//throw not_yet_implemented("table: TODO implement read primary");
+}
+
+
+/** \brief Read the next page of rows in order of expiration.
+ *
+ * The expiration index includes all the rows with an expiration date
+ * sorted by that date. The rows which already expired are not returned
+ * even if the reaper did not yet delete them. When the conditions
+ * define a minimum or a maximum key, only the rows with an expiration
+ * date within that range are returned.
+ *
+ * As with read_secondary(), the cursor state remembers the last key
+ * read so the next call continues from there and the scan restarts
+ * from the beginning if the cursor position does not match the number
+ * of rows read so far.
+ *
+ * \param[in] data  The cursor data where the rows get added.
+ */
+void table_impl::read_expiration(cursor_data & data)
+{
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+    reference_t const root(header->get_expiration_index_block());
+    if(root == NULL_FILE_ADDR)
+    {
+        return;
+    }
+
+    cursor_state::scan_state_t & scan(data.f_state->get_scan_state());
+    if(scan.f_position != data.f_cursor->get_position())
+    {
+        scan = cursor_state::scan_state_t();
+    }
+    if(scan.f_done)
+    {
+        return;
+    }
+
+    conditions const & cond(data.f_cursor->get_conditions());
+    std::uint64_t min_date(0);
+    if(cond.get_min_key() != nullptr)
+    {
+        min_date = cond.get_min_key()->get_expiration_date();
+    }
+    if(data.f_now != 0)
+    {
+        min_date = std::max(min_date, data.f_now + 1);
+    }
+    std::uint64_t max_date(std::numeric_limits<std::uint64_t>::max());
+    if(cond.get_max_key() != nullptr)
+    {
+        std::uint64_t const date(cond.get_max_key()->get_expiration_date());
+        if(date != 0)
+        {
+            max_date = date;
+        }
+    }
+    if(min_date > max_date)
+    {
+        scan.f_done = true;
+        return;
+    }
+
+    bool const reverse(cond.get_reverse());
+    count_t const count(cond.get_count());
+    count_t const limit(cond.get_limit());
+    count_t read(0);
+
+    buffer_t search(scan.f_key);
+    if(search.empty())
+    {
+        search = reverse
+                    ? get_expiration_index_key(max_date, std::numeric_limits<oid_t>::max())
+                    : get_expiration_index_key(min_date, NULL_OID);
+    }
+    std::uint32_t position(0);
+    block_entry_index::pointer_t entry_index(get_expiration_index_tree()->lower_bound(root, search, position));
+    if(!reverse
+    && !scan.f_key.empty()
+    && position < entry_index->get_count()
+    && entry_index->get_key(position) == scan.f_key)
+    {
+        ++position;
+    }
+
+    for(;;)
+    {
+        if(reverse)
+        {
+            if(position == 0)
+            {
+                reference_t const previous(entry_index->get_previous());
+                if(previous == NULL_FILE_ADDR)
+                {
+                    break;
+                }
+                entry_index = std::static_pointer_cast<block_entry_index>(get_block(previous));
+                position = entry_index->get_count();
+                continue;
+            }
+            --position;
+        }
+        else if(position >= entry_index->get_count())
+        {
+            reference_t const next(entry_index->get_next());
+            if(next == NULL_FILE_ADDR)
+            {
+                break;
+            }
+            entry_index = std::static_pointer_cast<block_entry_index>(get_block(next));
+            position = 0;
+            continue;
+        }
+
+        buffer_t const key(entry_index->get_key(position));
+        oid_t const oid(entry_index->get_oid(position));
+        std::size_t pos(0);
+        std::uint64_t const date(read_be_uint64(key, pos));
+        if(reverse)
+        {
+            if(date < min_date)
+            {
+                break;
+            }
+        }
+        else
+        {
+            ++position;
+            if(date > max_date)
+            {
+                break;
+            }
+        }
+        scan.f_key = key;
+
+        if(scan.f_skipped < cond.get_offset())
+        {
+            ++scan.f_skipped;
+            continue;
+        }
+
+        add_row(data, get_indirect_row_view(oid));
+        ++scan.f_position;
+        ++read;
+        if(limit != CURSOR_NO_LIMIT
+        && scan.f_position >= limit)
+        {
+            scan.f_done = true;
+            return;
+        }
+        if(count != 0
+        && read >= count)
+        {
+            return;
+        }
+    }
+
+    scan.f_done = true;
+}
+
+
+/** \brief Read the next page of rows of a tree table.
+ *
+ * The path of the node to list is found in the minimum key of the
+ * conditions. Without a minimum key, the root gets listed.
+ *
+ * In TREE_MODE_CHILDREN, the direct children of the node are returned
+ * sorted by name. Since the keys of the tree index start with the OID of
+ * the parent, these children are one contiguous range of the index and
+ * the other nodes are never visited.
+ *
+ * In TREE_MODE_SUBTREE, all the descendants are returned depth first,
+ * each node before its own children. The scan keeps a stack with the
+ * last key read at each level so it can be resumed by the next call.
+ *
+ * In reverse, the children of each node are read in reverse order. The
+ * parents are still returned before their children.
+ *
+ * The rows which expired are not returned and neither are their
+ * descendants.
+ *
+ * \param[in] data  The cursor data where the rows get added.
+ */
+void table_impl::read_tree(cursor_data & data)
+{
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+    reference_t const root(header->get_tree_index_block());
+    if(root == NULL_FILE_ADDR)
+    {
+        return;
+    }
+
+    cursor_state::scan_state_t & scan(data.f_state->get_scan_state());
+    if(scan.f_position != data.f_cursor->get_position())
+    {
+        scan = cursor_state::scan_state_t();
+    }
+    if(scan.f_done)
+    {
+        return;
+    }
+
+    conditions const & cond(data.f_cursor->get_conditions());
+    if(scan.f_tree_stack.empty())
+    {
+        // first call, find the node to list
+        //
+        cursor_state::tree_frame_t frame;
+        std::string path;
+        if(cond.get_min_key() != nullptr)
+        {
+            path = cond.get_min_key()->get_cell(get_tree_path_column(), true)->get_string();
+        }
+        std::string parent;
+        std::string name;
+        if(split_tree_path(path, parent, name))
+        {
+            path.erase(path.find_last_not_of('/') + 1);
+            frame.f_parent = find_tree_oid(path);
+            if(frame.f_parent == NULL_OID)
+            {
+                scan.f_done = true;
+                return;
+            }
+        }
+        scan.f_tree_stack.push_back(frame);
+    }
+
+    bool const subtree(cond.get_tree_mode() == tree_mode_t::TREE_MODE_SUBTREE);
+    bool const reverse(cond.get_reverse());
+    count_t const count(cond.get_count());
+    count_t const limit(cond.get_limit());
+    count_t read(0);
+
+    index_tree::pointer_t tree(get_tree_index_tree());
+    while(!scan.f_tree_stack.empty())
+    {
+        // search the next child of the node at the top of the stack
+        //
+        cursor_state::tree_frame_t & frame(scan.f_tree_stack.back());
+        buffer_t search(frame.f_key);
+        if(search.empty())
+        {
+            search = reverse
+                        ? get_tree_index_key(frame.f_parent + 1, std::string(), NULL_OID)
+                        : get_tree_index_key(frame.f_parent, std::string(), NULL_OID);
+        }
+        std::uint32_t position(0);
+        block_entry_index::pointer_t entry_index(tree->lower_bound(root, search, position));
+        if(!reverse
+        && !frame.f_key.empty()
+        && position < entry_index->get_count()
+        && entry_index->get_key(position) == frame.f_key)
+        {
+            ++position;
+        }
+
+        bool found(false);
+        if(reverse)
+        {
+            while(position == 0)
+            {
+                reference_t const previous(entry_index->get_previous());
+                if(previous == NULL_FILE_ADDR)
+                {
+                    break;
+                }
+                entry_index = std::static_pointer_cast<block_entry_index>(get_block(previous));
+                position = entry_index->get_count();
+            }
+            if(position > 0)
+            {
+                --position;
+                found = true;
+            }
+        }
+        else
+        {
+            while(position >= entry_index->get_count())
+            {
+                reference_t const next(entry_index->get_next());
+                if(next == NULL_FILE_ADDR)
+                {
+                    break;
+                }
+                entry_index = std::static_pointer_cast<block_entry_index>(get_block(next));
+                position = 0;
+            }
+            found = position < entry_index->get_count();
+        }
+
+        buffer_t key;
+        if(found)
+        {
+            key = entry_index->get_key(position);
+            std::size_t pos(0);
+            found = read_be_uint64(key, pos) == frame.f_parent;
+        }
+        if(!found)
+        {
+            // no more children under this node
+            //
+            scan.f_tree_stack.pop_back();
+            continue;
+        }
+        frame.f_key = key;
+
+        oid_t const oid(entry_index->get_oid(position));
+        row_view::pointer_t view(get_indirect_row_view(oid));
+        if(is_expired(view, data.f_now))
+        {
+            continue;
+        }
+        if(subtree)
+        {
+            // the children of this row are read next (depth first)
+            //
+            cursor_state::tree_frame_t child;
+            child.f_parent = oid;
+            scan.f_tree_stack.push_back(child);
+        }
+
+        if(scan.f_skipped < cond.get_offset())
+        {
+            ++scan.f_skipped;
+            continue;
+        }
+
+        add_row(data, view);
+        ++scan.f_position;
+        ++read;
+        if(limit != CURSOR_NO_LIMIT
+        && scan.f_position >= limit)
+        {
+            scan.f_done = true;
+            return;
+        }
+        if(count != 0
+        && read >= count)
+        {
+            return;
+        }
+    }
+
+    scan.f_done = true;
+}
+
+
+/** \brief Delete the rows which expired.
+ *
+ * This function deletes up to \p max rows with an expiration date
+ * smaller or equal to \p now. The rows are found with the expiration
+ * index so there is no need to scan the table.
+ *
+ * The reaper calls this function each time the next expiration date
+ * of the table is reached.
+ *
+ * \param[in] now  The current time in microseconds.
+ * \param[in] max  The maximum number of rows to delete, 0 means no limit.
+ *
+ * \return The number of rows deleted.
+ */
+std::size_t table_impl::expire_rows(std::uint64_t now, std::size_t max)
+{
+    std::lock_guard<table_lock> lock(f_lock);
+
+    if(f_dbfile->get_size() == 0)
+    {
+        return 0;
+    }
+
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+    reference_t const root(header->get_expiration_index_block());
+    if(root == NULL_FILE_ADDR)
+    {
+        return 0;
+    }
 
-    case index_type_t::INDEX_TYPE_TREE:
-        read_tree(data);
-        break;
+    // the index changes as we delete rows so collect the OIDs first
+    //
+    std::vector<oid_t> expired;
+    std::uint32_t position(0);
+    block_entry_index::pointer_t entry_index(get_expiration_index_tree()->lower_bound(
+                  root
+                , get_expiration_index_key(0, NULL_OID)
+                , position));
+    while(max == 0 || expired.size() < max)
+    {
+        if(position >= entry_index->get_count())
+        {
+            reference_t const next(entry_index->get_next());
+            if(next == NULL_FILE_ADDR)
+            {
+                break;
+            }
+            entry_index = std::static_pointer_cast<block_entry_index>(get_block(next));
+            position = 0;
+            continue;
+        }
 
-    default:
-        throw logic_error("unexpected index type in read_rows().");
+        buffer_t const key(entry_index->get_key(position));
+        std::size_t pos(0);
+        if(read_be_uint64(key, pos) > now)
+        {
+            break;
+        }
+        expired.push_back(entry_index->get_oid(position));
+        ++position;
+    }
 
+    for(auto const oid : expired)
+    {
+        row_delete(oid);
     }
+
+    return expired.size();
 }
 
 
-void table_impl::read_secondary(cursor_data & data)
+/** \brief Get the date when the next row expires.
+ *
+ * \return The smallest expiration date in microseconds or 0 if no row
+ * expires.
+ */
+std::uint64_t table_impl::get_next_expiration()
 {
-snapdev::NOT_USED(data);
-std::cerr << "table: TODO implement read secondary...\n";
-throw not_yet_implemented("table: TODO implement read secondary");
-}
+    std::shared_lock<table_lock> lock(f_lock);
 
+    if(f_dbfile->get_size() == 0)
+    {
+        return 0;
+    }
 
-void table_impl::read_indirect(cursor_data & data)
-{
     file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
-    reference_t tref(header->get_indirect_index());
-    if(tref == NULL_FILE_ADDR)
+    reference_t const root(header->get_expiration_index_block());
+    if(root == NULL_FILE_ADDR)
     {
-        // we have nothing here
-        // (happens until we do some commit)
-        //
-        return;
+        return 0;
+    }
+
+    std::uint32_t position(0);
+    block_entry_index::pointer_t entry_index(get_expiration_index_tree()->lower_bound(
+                  root
+                , get_expiration_index_key(0, NULL_OID)
+                , position));
+    while(position >= entry_index->get_count())
+    {
+        reference_t const next(entry_index->get_next());
+        if(next == NULL_FILE_ADDR)
+        {
+            return 0;
+        }
+        entry_index = std::static_pointer_cast<block_entry_index>(get_block(next));
+        position = 0;
     }
 
-snapdev::NOT_USED(data);
-std::cerr << "table: TODO implement read indirect...\n";
-throw not_yet_implemented("table: TODO implement read indirect");
+    buffer_t const key(entry_index->get_key(position));
+    std::size_t pos(0);
+    return read_be_uint64(key, pos);
 }
 
 
-void table_impl::read_primary(cursor_data & data)
+/** \brief Compact the sparse `DATA` blocks of this table.
+ *
+ * Releasing and updating rows leaves holes in the `DATA` blocks. The
+ * free space gets reused by new rows of a similar size, but a table
+ * which shrinks or where rows keep growing ends up with many mostly
+ * empty blocks.
+ *
+ * Rows are always accessed through the indirect index (the `TIND` and
+ * `INDR` blocks). This means a row can be moved to another `DATA` block
+ * by changing its reference in its `INDR` block. Nothing else points
+ * to the row data. This function makes use of that feature:
+ *
+ * 1. the `DATA` blocks without any allocated space are returned to the
+ *    list of free blocks;
+ * 2. the indirect index is walked to compute the number of bytes used
+ *    by live rows in each `DATA` block; a reference to a row marked as
+ *    MOVED is replaced with the new location of the row and the old
+ *    space gets released;
+ * 3. the `DATA` blocks where less than \p threshold percent of the space
+ *    is in use are selected, the least used first; their free space is
+ *    removed from the `FSPC` lists so no row gets moved there;
+ * 4. the rows of the selected blocks are copied to new space and their
+ *    reference in the `INDR` blocks updated;
+ * 5. the selected blocks are returned to the list of free blocks.
+ *
+ * The \p budget parameter limits the amount of work done in one call
+ * to that many bytes of row data moved. The compactor calls this
+ * function at regular intervals, which limits the rate at which it
+ * writes to the file.
+ *
+ * \todo
+ * Step 2 reads the entire indirect index on each call. For large tables,
+ * we want to keep track of the used space of each `DATA` block instead.
+ *
+ * \param[in] threshold  Percent of use under which a block gets compacted.
+ * \param[in] budget  Maximum number of bytes to move, 0 means no limit.
+ *
+ * \return The statistics of this compaction pass.
+ */
+compaction_statistics_t table_impl::compact(std::uint32_t threshold, std::size_t budget)
 {
-    // the primary index has a single position at position 0
+    std::lock_guard<table_lock> lock(f_lock);
+
+    // the bits of deleted rows remain in the Bloom filter; once they
+    // represent too many of its keys, regenerate it
     //
-std::cerr << "the position is: " << data.f_cursor->get_position() << "\n";
-    if(data.f_cursor->get_position() > 0)
+    if(f_bloom_filter != nullptr
+    && f_bloom_filter->get_deleted_count() * 10 > f_bloom_filter->get_key_count())
     {
-        return;
+        rebuild_bloom_filter(f_bloom_filter->get_key_count() - f_bloom_filter->get_deleted_count());
     }
 
-    block_primary_index::pointer_t primary_index(get_primary_index_block(false));
-    if(primary_index == nullptr)
+    compaction_statistics_t result;
+    if(f_dbfile->get_size() == 0)
     {
-        // we have nothing here
-        // (happens until we do some commit)
+        return result;
+    }
+
+    file_table::pointer_t header(std::static_pointer_cast<file_table>(get_block(0)));
+    reference_t const fspc_offset(header->get_blobs_with_free_space());
+    if(fspc_offset == NULL_FILE_ADDR)
+    {
+        // no row was ever saved in this table
         //
-std::cerr << "read_primary: no primary index block!?\n";
-        return;
+        return result;
     }
+    block_free_space::pointer_t fspc(std::static_pointer_cast<block_free_space>(get_block(fspc_offset)));
 
-    // the primary key is "special" in that we get the content of the
-    // columns and then calculate the murmur value; the murmur is what's
-    // used as the key, not the content of the columns
-    //
-    conditions const & cond(data.f_cursor->get_conditions());
-    buffer_t const & key(cond.get_murmur_key());
-std::cerr << "read primary with \"set_top_index()\" -- " << static_cast<int>(key[14]) << " " << static_cast<int>(key[15]) << "\n";
+    std::size_t const page_size(get_page_size());
+    std::size_t const total_space(block_data::block_total_space(f_table->get_pointer()));
+    std::set<reference_t> pages_read;
+    std::set<reference_t> pages_written;
 
-    // we may have one `PIDX`
-    //
-    // TODO: consider making the primary index optional
+    // (1) empty blocks can be freed as is
     //
-    reference_t ref(primary_index->get_top_index(key));
-    if(ref == NULL_FILE_ADDR)
+    for(;;)
     {
-        // no such entry, "SELECT" returns an empty list
-        //
-std::cerr << "read_primary: no top index reference!?\n";
-        return;
+        reference_t const offset(fspc->get_empty_data_block());
+        if(offset == NULL_FILE_ADDR)
+        {
+            break;
+        }
+        fspc->remove_data_block(offset);
+        free_block(get_block(offset), true);
+
+        pages_written.insert(offset);
+        ++result.f_blocks_freed;
+        result.f_bytes_reclaimed += page_size;
     }
-    block::pointer_t block(get_block(ref));
 
-    // we can have any number of `TIDX` or directly an `EIDX`
+    // (2) determine the space used by live rows in each `DATA` block
     //
-std::cerr << "read_primary: loop through top indexex if any!?\n";
-    while(block->get_dbtype() == dbtype_t::BLOCK_TYPE_TOP_INDEX)
+    std::map<reference_t, std::vector<compaction_row_t>> rows;
+    oid_t const last_oid(header->get_indirect_index() == NULL_FILE_ADDR
+                                ? NULL_OID
+                                : header->get_last_oid());
+    for(oid_t oid(1); oid < last_oid; ++oid)
     {
-std::cerr << "read_primary: got at least one top indexex!\n";
-        // we have a top index
+        oid_t position(oid);
+        block_indirect_index::pointer_t indr(get_indirect_index(position));
+        pages_read.insert(indr->get_offset());
+
+        // free OIDs and MISSING_FILE_ADDR are all smaller than a page
+        // and the first page is the header, never a `DATA` block
         //
-        block_top_index::pointer_t top_index(std::static_pointer_cast<block_top_index>(block));
-        ref = top_index->find_index(key);
-        cursor_state::index_reference_t idx_ref = {
-              ref
-            , top_index->get_position()
-        };
-std::cerr << "read_primary: found a top index!?\n";
-        data.f_state->add_index_reference(idx_ref);
-        if(ref == NULL_FILE_ADDR)
+        reference_t reference(indr->get_reference(position, false));
+        if(reference < page_size)
         {
-            // no such entry, "SELECT" returns an empty list
-            //
-std::cerr << "read_primary: top index has null reference!?\n";
-            return;
+            continue;
         }
-        block = get_block(ref);
+        // rows in `SLOT` blocks are not compacted, the slot_allocator
+        // frees its blocks as soon as they are empty
+        //
+        block::pointer_t b(get_block(reference - reference % page_size));
+        if(b->get_dbtype() != dbtype_t::BLOCK_TYPE_DATA)
+        {
+            continue;
+        }
+        pages_read.insert(b->get_offset());
+
+        const_data_t ptr(b->data(reference));
+        if(block_free_space::get_flag(ptr, ALLOCATED_SPACE_FLAG_MOVED))
+        {
+            for(int hops(0);; ++hops)
+            {
+                if(hops >= MAX_MOVED_HOPS)
+                {
+                    throw corrupted_data(
+                              "row with OID "
+                            + std::to_string(oid)
+                            + " was moved too many times.");
+                }
+
+                // the new location of the row is saved in the old space
+                //
+                reference_t moved_to(NULL_FILE_ADDR);
+                memcpy(&moved_to, ptr, sizeof(moved_to));
+                fspc->release_space(reference);
+                pages_written.insert(b->get_offset());
+
+                reference = moved_to;
+                b = get_block(reference - reference % page_size);
+                if(b->get_dbtype() != dbtype_t::BLOCK_TYPE_DATA)
+                {
+                    throw corrupted_data(
+                              "row with OID "
+                            + std::to_string(oid)
+                            + " was moved to a block of type \""
+                            + std::string(to_name(b->get_dbtype()))
+                            + "\".");
+                }
+                pages_read.insert(b->get_offset());
+
+                ptr = b->data(reference);
+                if(!block_free_space::get_flag(ptr, ALLOCATED_SPACE_FLAG_MOVED))
+                {
+                    break;
+                }
+            }
+            indr->set_reference(position, reference);
+            pages_written.insert(indr->get_offset());
+        }
+
+        compaction_row_t row;
+        row.f_oid = oid;
+        row.f_reference = reference;
+        row.f_size = block_free_space::get_size(ptr);
+        rows[b->get_offset()].push_back(row);
     }
+    result.f_blocks_scanned = rows.size();
 
-    if(block->get_dbtype() != dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
+    // (3) select the sparse blocks, least used first
+    //
+    std::vector<std::pair<std::size_t, reference_t>> candidates;
+    for(auto const & r : rows)
     {
-        throw type_mismatch(
-                  "Found unexpected block of type \""
-                + std::string(to_name(block->get_dbtype()))
-                + "\". Expected an  \""
-                + to_name(dbtype_t::BLOCK_TYPE_ENTRY_INDEX)
-                + "\".");
+        std::size_t used(0);
+        for(auto const & row : r.second)
+        {
+            used += row.f_size;
+        }
+        if(used * 100 < total_space * threshold)
+        {
+            candidates.emplace_back(used, r.first);
+        }
     }
+    std::sort(candidates.begin(), candidates.end());
 
-    block_entry_index::pointer_t entry_index(std::static_pointer_cast<block_entry_index>(block));
-    data.f_state->set_entry_index(entry_index);
-
-    oid_t const oid(entry_index->find_entry(key));
-    data.f_state->set_entry_index_close_position(entry_index->get_position());
-    if(oid == NULL_FILE_ADDR)
+    std::size_t moving(0);
+    std::vector<std::pair<std::size_t, reference_t>> selected;
+    for(auto const & c : candidates)
     {
-std::cerr << "read_primary: indirect index has null reference!?\n";
-        return;
+        if(budget != 0
+        && moving + c.first > budget)
+        {
+            break;
+        }
+        moving += c.first;
+        fspc->remove_data_block(c.second);
+        selected.push_back(c);
     }
 
-std::cerr << "read_primary: reading row!?\n";
-    row::pointer_t r(get_indirect_row(oid));
-    data.f_rows.push_back(r);
+    // (4) move the rows and (5) free the blocks
+    //
+    for(auto const & s : selected)
+    {
+        block::pointer_t source(get_block(s.second));
+        for(auto const & row : rows[s.second])
+        {
+            const_data_t ptr(source->data(row.f_reference));
+            std::uint32_t const size(block_free_space::get_data_size(ptr));
+            free_space_t const space(fspc->get_free_space(size));
+            data_t destination(space.f_block->data(space.f_reference));
+            memcpy(destination, ptr, size);
+            if(block_free_space::get_flag(ptr, ALLOCATED_SPACE_FLAG_DELETED))
+            {
+                block_free_space::set_flag(destination, ALLOCATED_SPACE_FLAG_DELETED);
+            }
 
-//std::cerr << "table: TODO implement read primary...\n";
-//throw not_yet_implemented("table: TODO implement read primary");
-}
+            oid_t position(row.f_oid);
+            block_indirect_index::pointer_t indr(get_indirect_index(position));
+            indr->set_reference(position, space.f_reference);
+
+            pages_written.insert(space.f_block->get_offset());
+            pages_written.insert(indr->get_offset());
+            ++result.f_rows_moved;
+            result.f_bytes_moved += size;
+        }
 
+        free_block(source, true);
 
-void table_impl::read_expiration(cursor_data & data)
-{
-snapdev::NOT_USED(data);
-std::cerr << "table: TODO implement read expiration...\n";
-throw not_yet_implemented("table: TODO implement read expiration");
-}
+        pages_written.insert(s.second);
+        ++result.f_blocks_freed;
+        result.f_bytes_reclaimed += page_size - s.first;
+    }
+
+    if(!pages_written.empty())
+    {
+        // the header and the free space lists were updated too
+        //
+        pages_written.insert(0);
+        pages_written.insert(fspc_offset);
+    }
 
+    pages_read.insert(pages_written.begin(), pages_written.end());
+    result.f_pages_read = pages_read.size();
+    result.f_pages_written = pages_written.size();
 
-void table_impl::read_tree(cursor_data & data)
-{
-snapdev::NOT_USED(data);
-std::cerr << "table: TODO implement read tree...\n";
-throw not_yet_implemented("table: TODO implement read tree");
+    return result;
 }
 
 
@@ -1751,9 +4272,203 @@ bool table::row_update(row_pointer_t row)
 }
 
 
+/** \brief Commit many rows at once.
+ *
+ * This function is like calling row_commit() for each row, only faster.
+ * The rows get sorted by primary key first so the index blocks are
+ * updated one after the other. The table is locked once and the file
+ * gets flushed once at the end.
+ *
+ * Note that the rows get their OID in the order of their primary key,
+ * not the order in \p rows.
+ *
+ * \param[in] rows  The rows to commit.
+ *
+ * \return true if all the rows were committed.
+ */
+bool table::commit_batch(row_vector_t const & rows)
+{
+    return f_impl->commit_batch(rows);
+}
+
+
+/** \brief Delete a row.
+ *
+ * This function removes the row with the specified \p oid from the
+ * table and all of its indexes. The space used by the row is released
+ * and the OID cannot be used to read that row anymore.
+ *
+ * \param[in] oid  The OID of the row to delete.
+ *
+ * \return true if the row existed and was deleted.
+ */
+bool table::row_delete(oid_t oid)
+{
+    return f_impl->row_delete(oid);
+}
+
+
+/** \brief Compact the sparse `DATA` blocks of this table.
+ *
+ * This function moves the rows found in `DATA` blocks using less than
+ * \p threshold percent of their space to other blocks and returns the
+ * emptied blocks to the list of free blocks.
+ *
+ * The \p budget limits the number of bytes of row data moved by one
+ * call. Use 0 to compact the whole table at once.
+ *
+ * In most cases, you want to use a compactor object which calls this
+ * function in the background.
+ *
+ * \param[in] threshold  Percent of use under which a block gets compacted.
+ * \param[in] budget  Maximum number of bytes to move in this call.
+ *
+ * \return The statistics of this compaction pass.
+ */
+compaction_statistics_t table::compact(std::uint32_t threshold, std::size_t budget)
+{
+    return f_impl->compact(threshold, budget);
+}
+
+
+/** \brief Retrieve the fill factor used when splitting index blocks.
+ *
+ * \return The fill factor in percent.
+ *
+ * \sa set_index_fill_factor()
+ */
+std::uint32_t table::get_index_fill_factor() const
+{
+    return f_impl->get_index_fill_factor();
+}
+
+
+/** \brief Change the fill factor used when splitting index blocks.
+ *
+ * When a new key gets appended at the very end of the index (i.e. keys
+ * are inserted in increasing order), the full block is not split in
+ * half. Instead, the left block keeps \p fill_factor percent of the
+ * entries and the remaining entries go to the new block. With 100, the
+ * left block remains full, which is ideal for monotonic keys.
+ *
+ * The fill factor is also used to decide whether two sibling blocks
+ * can be merged after removals.
+ *
+ * \exception invalid_parameter
+ * The \p fill_factor must be between 50 and 100 inclusive.
+ *
+ * \param[in] fill_factor  The new fill factor in percent.
+ */
+void table::set_index_fill_factor(std::uint32_t fill_factor)
+{
+    f_impl->set_index_fill_factor(fill_factor);
+}
+
+
+/** \brief Create a builder to bulk load the primary index.
+ *
+ * The returned builder is setup to build one tree per `PIDX` slot with
+ * the fill factor of this table. Add the murmur key and OID of each row
+ * to the builder and then call build_primary_index().
+ *
+ * \return A builder for the primary index of this table.
+ */
+index_builder::pointer_t table::create_primary_index_builder()
+{
+    return f_impl->create_primary_index_builder();
+}
+
+
+/** \brief Build the primary index from \p builder.
+ *
+ * The trees get built bottom up and their roots get saved in the `PIDX`.
+ * This is much faster than inserting the keys one at a time, but it
+ * only works on an empty primary index (i.e. a new import or a rebuild).
+ *
+ * If the builder finds a key twice, its blocks get released and the
+ * primary index remains empty.
+ *
+ * \exception defined_twice
+ * The same key was added twice to the builder.
+ * \exception logic_error
+ * The primary index is not empty.
+ *
+ * \param[in] builder  The builder created by create_primary_index_builder().
+ */
+void table::build_primary_index(index_builder::pointer_t builder)
+{
+    f_impl->build_primary_index(builder);
+}
+
+
+/** \brief Build a secondary index from the rows of this table.
+ *
+ * When a secondary index gets added to a table which already has rows,
+ * this function reads all the rows and builds the index bottom up. It
+ * only works on an empty secondary index.
+ *
+ * \exception invalid_name
+ * The table has no secondary index named \p name.
+ * \exception logic_error
+ * The secondary index already has entries.
+ *
+ * \param[in] name  The name of the secondary index to build.
+ *
+ * \return The number of rows added to the index.
+ */
+std::uint64_t table::build_secondary_index(std::string const & name)
+{
+    return f_impl->build_secondary_index(name);
+}
+
+
+/** \brief Delete rows which expired.
+ *
+ * This function deletes up to \p max rows which have an expiration
+ * date smaller or equal to \p now (in microseconds). Use 0 as \p max
+ * to delete all the expired rows at once.
+ *
+ * In most cases, you want to use a reaper object which calls this
+ * function in the background.
+ *
+ * \param[in] now  The current time in microseconds.
+ * \param[in] max  The maximum number of rows to delete.
+ *
+ * \return The number of rows deleted.
+ */
+std::size_t table::expire_rows(std::uint64_t now, std::size_t max)
+{
+    return f_impl->expire_rows(now, max);
+}
+
+
+/** \brief Get the date when the next row of this table expires.
+ *
+ * \return The smallest expiration date in microseconds or 0 if no row
+ * of this table has an expiration date.
+ */
+std::uint64_t table::get_next_expiration()
+{
+    return f_impl->get_next_expiration();
+}
+
+
+/** \brief Save the Bloom filter of the primary keys.
+ *
+ * The filter is only saved when the table gets closed. The context
+ * calls this function for each one of its tables when it gets destroyed.
+ * On a crash, the file is missing and the filter gets rebuilt from
+ * the primary index on the next start.
+ */
+void table::save_bloom_filter()
+{
+    f_impl->save_bloom_filter();
+}
+
+
 void table::read_rows(cursor::pointer_t cursor)
 {
-    detail::cursor_data data(cursor, cursor->get_state(), cursor->get_rows());
+    detail::cursor_data data(cursor, cursor->get_state(), cursor->get_rows(), cursor->get_views());
     f_impl->read_rows(data);
 }
 
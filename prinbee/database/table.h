@@ -61,9 +61,31 @@ class dbfile;
 typedef std::shared_ptr<dbfile>                 dbfile_pointer_t;
 class block;
 typedef std::shared_ptr<block>                  block_pointer_t;
+class index_builder;
+typedef std::shared_ptr<index_builder>          index_builder_pointer_t;
 
 
 
+/** \brief Result of one compaction pass.
+ *
+ * The table::compact() function returns these counters. The
+ * f_pages_read and f_pages_written counters give an idea of the I/O
+ * cost of the pass. The f_bytes_reclaimed counter is the number of
+ * bytes returned to the list of free blocks minus the bytes that had
+ * to be allocated in other `DATA` blocks to hold the moved rows.
+ */
+struct compaction_statistics_t
+{
+    std::size_t                                 f_blocks_scanned = 0;
+    std::size_t                                 f_blocks_freed = 0;
+    std::size_t                                 f_rows_moved = 0;
+    std::size_t                                 f_bytes_moved = 0;
+    std::size_t                                 f_bytes_reclaimed = 0;
+    std::size_t                                 f_pages_read = 0;
+    std::size_t                                 f_pages_written = 0;
+};
+
+
 class table
     : public std::enable_shared_from_this<table>
 {
@@ -109,8 +131,22 @@ public:
     row_pointer_t                               row_new() const;
     cursor::pointer_t                           row_select(conditions const & cond);
     bool                                        row_commit(row_pointer_t row);
+    bool                                        commit_batch(row_vector_t const & rows);
     bool                                        row_insert(row_pointer_t row);
     bool                                        row_update(row_pointer_t row);
+    bool                                        row_delete(oid_t oid);
+
+    // maintenance
+    //
+    compaction_statistics_t                     compact(std::uint32_t threshold, std::size_t budget);
+    std::uint32_t                               get_index_fill_factor() const;
+    void                                        set_index_fill_factor(std::uint32_t fill_factor);
+    index_builder_pointer_t                     create_primary_index_builder();
+    void                                        build_primary_index(index_builder_pointer_t builder);
+    std::uint64_t                               build_secondary_index(std::string const & name);
+    std::size_t                                 expire_rows(std::uint64_t now, std::size_t max);
+    std::uint64_t                               get_next_expiration();
+    void                                        save_bloom_filter();
 
 private:
     friend cursor;
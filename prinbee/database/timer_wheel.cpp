@@ -0,0 +1,377 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+/** \file
+ * \brief Hierarchical timer wheel implementation.
+ *
+ * The wheel counts time in ticks. A deadline is rounded up to the next
+ * tick so a timer never fires early. The timers are saved in the slots
+ * of the level covering their distance to the current tick:
+ *
+ * \li level 0: less than TIMER_WHEEL_SLOTS ticks;
+ * \li level 1: less than TIMER_WHEEL_SLOTS^2 ticks;
+ * \li etc.
+ *
+ * The slot is selected with the bits of the deadline corresponding to
+ * that level. This means the slot of a higher level is visited exactly
+ * when the lower levels are done with the previous period; at that
+ * point its timers get cascaded to the lower levels. Timers further
+ * away than what the wheel covers are saved in the last slot of the
+ * last level and get moved again when that slot is visited.
+ *
+ * Removing a timer only removes its deadline from the map. The slots
+ * keep a copy of the deadline and entries which do not match the map
+ * anymore are ignored when their slot gets visited.
+ */
+
+// self
+//
+#include    "prinbee/database/timer_wheel.h"
+
+#include    "prinbee/exception.h"
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace prinbee
+{
+
+
+
+/** \brief Initialize a timer wheel.
+ *
+ * The wheel starts at time \p now. The times and deadlines are expressed
+ * in any unit as long as the same one is used everywhere; the reaper
+ * uses microseconds since the Unix epoch.
+ *
+ * \exception invalid_parameter
+ * The \p tick must be at least 1.
+ *
+ * \param[in] now  The current time.
+ * \param[in] tick  The duration of one tick.
+ */
+timer_wheel::timer_wheel(std::uint64_t now, std::uint64_t tick)
+    : f_tick(tick)
+{
+    if(f_tick == 0)
+    {
+        throw invalid_parameter("the timer wheel tick must be at least 1.");
+    }
+
+    f_current_tick = now / f_tick;
+}
+
+
+std::uint64_t timer_wheel::get_tick() const
+{
+    return f_tick;
+}
+
+
+/** \brief Get the time the wheel was last advanced to.
+ *
+ * The time is rounded down to the start of the current tick.
+ *
+ * \return The current time of the wheel.
+ */
+std::uint64_t timer_wheel::get_current_time() const
+{
+    return f_current_tick * f_tick;
+}
+
+
+std::size_t timer_wheel::size() const
+{
+    return f_deadlines.size();
+}
+
+
+bool timer_wheel::empty() const
+{
+    return f_deadlines.empty();
+}
+
+
+/** \brief Add or replace a timer.
+ *
+ * If a timer with the same \p id already exists, its deadline gets
+ * replaced.
+ *
+ * A \p deadline which is already in the past is returned by the next
+ * call to advance().
+ *
+ * \param[in] id  The identifier of the timer.
+ * \param[in] deadline  The time at which the timer expires.
+ */
+void timer_wheel::add(timer_id_t id, std::uint64_t deadline)
+{
+    timer_t timer;
+    timer.f_id = id;
+    timer.f_deadline = deadline / f_tick + (deadline % f_tick == 0 ? 0 : 1);
+
+    auto it(f_deadlines.find(id));
+    if(it != f_deadlines.end())
+    {
+        if(it->second == timer.f_deadline)
+        {
+            return;
+        }
+        it->second = timer.f_deadline;
+    }
+    else
+    {
+        f_deadlines[id] = timer.f_deadline;
+    }
+
+    insert(timer);
+}
+
+
+/** \brief Remove a timer.
+ *
+ * \param[in] id  The identifier of the timer to remove.
+ *
+ * \return true if the timer existed.
+ */
+bool timer_wheel::remove(timer_id_t id)
+{
+    return f_deadlines.erase(id) != 0;
+}
+
+
+/** \brief Get the deadline of a timer.
+ *
+ * The deadline is rounded up to the end of its tick.
+ *
+ * \param[in] id  The identifier of the timer.
+ *
+ * \return The deadline or TIMER_WHEEL_NO_TIMER if \p id is not defined.
+ */
+std::uint64_t timer_wheel::get_deadline(timer_id_t id) const
+{
+    auto it(f_deadlines.find(id));
+    if(it == f_deadlines.end())
+    {
+        return TIMER_WHEEL_NO_TIMER;
+    }
+
+    return it->second * f_tick;
+}
+
+
+/** \brief Get the time at which advance() needs to be called next.
+ *
+ * This is the time of the first non-empty slot. For a slot of a level
+ * other than 0, it is the time when its timers cascade, so the returned
+ * time can be earlier than the actual first deadline. The caller is
+ * expected to wait until then, call advance(), and ask again.
+ *
+ * \return The next time to advance the wheel or TIMER_WHEEL_NO_TIMER.
+ */
+std::uint64_t timer_wheel::get_next_wakeup() const
+{
+    if(f_deadlines.empty())
+    {
+        return TIMER_WHEEL_NO_TIMER;
+    }
+    if(!f_due.empty())
+    {
+        return f_current_tick * f_tick;
+    }
+
+    std::uint64_t const tick(next_tick());
+    if(tick == TIMER_WHEEL_NO_TIMER)
+    {
+        return TIMER_WHEEL_NO_TIMER;
+    }
+    return tick * f_tick;
+}
+
+
+/** \brief Advance the wheel up to \p now.
+ *
+ * The identifiers of the timers with a deadline smaller or equal to
+ * \p now get appended to \p expired and the timers are removed.
+ *
+ * \param[in] now  The current time.
+ * \param[out] expired  The vector receiving the expired timers.
+ */
+void timer_wheel::advance(std::uint64_t now, timer_id_vector_t & expired)
+{
+    expire(f_due, expired);
+
+    std::uint64_t const target(now / f_tick);
+    while(f_current_tick < target)
+    {
+        if(f_deadlines.empty())
+        {
+            // nothing to wait for, the slots are all stale
+            //
+            for(auto & level : f_levels)
+            {
+                for(auto & slot : level)
+                {
+                    slot.clear();
+                }
+            }
+            f_current_tick = target;
+            break;
+        }
+
+        // the slots between here and the next non-empty slot are all
+        // empty so we can jump directly to that slot
+        //
+        f_current_tick = std::min(target, next_tick());
+
+        // the timers cascading to this very tick are added to f_due
+        //
+        cascade(1);
+        expire(f_levels[0][f_current_tick & (TIMER_WHEEL_SLOTS - 1)], expired);
+        expire(f_due, expired);
+    }
+}
+
+
+/** \brief Search the next non-empty slot.
+ *
+ * The function checks the slots of each level following the current
+ * tick and returns the tick at which the first non-empty slot gets
+ * visited.
+ *
+ * \return The tick of the next non-empty slot or TIMER_WHEEL_NO_TIMER.
+ */
+std::uint64_t timer_wheel::next_tick() const
+{
+    std::uint64_t result(TIMER_WHEEL_NO_TIMER);
+    for(std::size_t level(0); level < TIMER_WHEEL_LEVELS; ++level)
+    {
+        std::size_t const shift(level * TIMER_WHEEL_SLOT_BITS);
+        std::uint64_t const current(f_current_tick >> shift);
+        for(std::uint64_t idx(1); idx <= TIMER_WHEEL_SLOTS; ++idx)
+        {
+            if(!f_levels[level][(current + idx) & (TIMER_WHEEL_SLOTS - 1)].empty())
+            {
+                result = std::min(result, (current + idx) << shift);
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+
+void timer_wheel::insert(timer_t const & timer)
+{
+    if(timer.f_deadline <= f_current_tick)
+    {
+        f_due.push_back(timer);
+        return;
+    }
+
+    std::uint64_t const delta(timer.f_deadline - f_current_tick);
+    for(std::size_t level(0); level < TIMER_WHEEL_LEVELS; ++level)
+    {
+        std::size_t const shift(level * TIMER_WHEEL_SLOT_BITS);
+        if(delta < (1ULL << (shift + TIMER_WHEEL_SLOT_BITS)))
+        {
+            f_levels[level][(timer.f_deadline >> shift) & (TIMER_WHEEL_SLOTS - 1)].push_back(timer);
+            return;
+        }
+    }
+
+    // too far away, park it in the furthest slot, it gets moved again
+    // once that slot is visited
+    //
+    std::size_t const shift((TIMER_WHEEL_LEVELS - 1) * TIMER_WHEEL_SLOT_BITS);
+    std::uint64_t const furthest(f_current_tick + (1ULL << (shift + TIMER_WHEEL_SLOT_BITS)) - 1);
+    f_levels[TIMER_WHEEL_LEVELS - 1][(furthest >> shift) & (TIMER_WHEEL_SLOTS - 1)].push_back(timer);
+}
+
+
+/** \brief Move the timers of the current slot of \p level down.
+ *
+ * This function is called each time the wheel turns. The slot of
+ * \p level is visited only when all the lower levels wrapped around,
+ * in which case the next level is checked first.
+ *
+ * \param[in] level  The level to cascade.
+ */
+void timer_wheel::cascade(std::size_t level)
+{
+    if(level >= TIMER_WHEEL_LEVELS)
+    {
+        return;
+    }
+
+    std::size_t const shift(level * TIMER_WHEEL_SLOT_BITS);
+    if((f_current_tick & ((1ULL << shift) - 1)) != 0)
+    {
+        return;
+    }
+
+    cascade(level + 1);
+
+    timer_t::vector_t slot;
+    slot.swap(f_levels[level][(f_current_tick >> shift) & (TIMER_WHEEL_SLOTS - 1)]);
+    for(auto const & timer : slot)
+    {
+        if(is_valid(timer))
+        {
+            insert(timer);
+        }
+    }
+}
+
+
+void timer_wheel::expire(timer_t::vector_t & timers, timer_id_vector_t & expired)
+{
+    timer_t::vector_t slot;
+    slot.swap(timers);
+    for(auto const & timer : slot)
+    {
+        if(is_valid(timer))
+        {
+            expired.push_back(timer.f_id);
+            f_deadlines.erase(timer.f_id);
+        }
+    }
+}
+
+
+bool timer_wheel::is_valid(timer_t const & timer) const
+{
+    auto it(f_deadlines.find(timer.f_id));
+    return it != f_deadlines.end()
+        && it->second == timer.f_deadline;
+}
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
@@ -0,0 +1,108 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#pragma once
+
+
+/** \file
+ * \brief Hierarchical timer wheel.
+ *
+ * The reaper has to wake up whenever a row expires in one of the tables
+ * it manages. The timer wheel keeps one deadline per timer identifier
+ * and returns the identifiers of the timers which expired each time it
+ * gets advanced. Adding and removing a timer are O(1) operations (the
+ * map of deadlines apart) whatever the number of timers.
+ *
+ * The wheel has TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots.
+ * Level 0 has one slot per tick, level 1 one slot per TIMER_WHEEL_SLOTS
+ * ticks, etc. A timer is saved in the level covering its distance to the
+ * current time. When the wheel turns, the timers of a higher level slot
+ * cascade to the lower levels.
+ */
+
+// C++
+//
+#include    <array>
+#include    <cstdint>
+#include    <limits>
+#include    <map>
+#include    <vector>
+
+
+
+namespace prinbee
+{
+
+
+
+constexpr std::size_t               TIMER_WHEEL_LEVELS = 4;
+constexpr std::size_t               TIMER_WHEEL_SLOT_BITS = 6;
+constexpr std::size_t               TIMER_WHEEL_SLOTS = 1ULL << TIMER_WHEEL_SLOT_BITS;
+constexpr std::uint64_t             DEFAULT_TIMER_WHEEL_TICK = 1'000'000;               // in microseconds
+constexpr std::uint64_t             TIMER_WHEEL_NO_TIMER = std::numeric_limits<std::uint64_t>::max();
+
+
+class timer_wheel
+{
+public:
+    typedef std::uint64_t           timer_id_t;
+    typedef std::vector<timer_id_t> timer_id_vector_t;
+
+                                    timer_wheel(std::uint64_t now, std::uint64_t tick = DEFAULT_TIMER_WHEEL_TICK);
+
+    std::uint64_t                   get_tick() const;
+    std::uint64_t                   get_current_time() const;
+    std::size_t                     size() const;
+    bool                            empty() const;
+
+    void                            add(timer_id_t id, std::uint64_t deadline);
+    bool                            remove(timer_id_t id);
+    std::uint64_t                   get_deadline(timer_id_t id) const;
+    std::uint64_t                   get_next_wakeup() const;
+    void                            advance(std::uint64_t now, timer_id_vector_t & expired);
+
+private:
+    struct timer_t
+    {
+        typedef std::vector<timer_t>    vector_t;
+
+        timer_id_t                  f_id = 0;
+        std::uint64_t               f_deadline = 0;         // in ticks
+    };
+
+    typedef std::array<timer_t::vector_t, TIMER_WHEEL_SLOTS>
+                                    level_t;
+
+    void                            insert(timer_t const & timer);
+    void                            cascade(std::size_t level);
+    void                            expire(timer_t::vector_t & timers, timer_id_vector_t & expired);
+    bool                            is_valid(timer_t const & timer) const;
+    std::uint64_t                   next_tick() const;
+
+    std::uint64_t                   f_tick = DEFAULT_TIMER_WHEEL_TICK;
+    std::uint64_t                   f_current_tick = 0;
+    std::map<timer_id_t, std::uint64_t>
+                                    f_deadlines = std::map<timer_id_t, std::uint64_t>();
+    timer_t::vector_t               f_due = timer_t::vector_t();
+    std::array<level_t, TIMER_WHEEL_LEVELS>
+                                    f_levels = std::array<level_t, TIMER_WHEEL_LEVELS>();
+};
+
+
+
+} // namespace prinbee
+// vim: ts=4 sw=4 et
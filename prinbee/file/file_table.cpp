@@ -68,7 +68,19 @@ constexpr struct_description_t g_description[] =
     define_description(
           FieldName(g_system_field_name_structure_version)
         , FieldType(struct_type_t::STRUCT_TYPE_STRUCTURE_VERSION)
-        , FieldVersion(0, 1)
+        , FieldVersion(0, 3)
+    ),
+    define_description( // version of the prinbee library which created the file
+          FieldName("file_version")
+        , FieldType(struct_type_t::STRUCT_TYPE_VERSION)
+    ),
+    define_description( // size of one block (a.k.a. page) in bytes
+          FieldName("block_size")
+        , FieldType(struct_type_t::STRUCT_TYPE_UINT32)
+    ),
+    define_description(
+          FieldName("table_definition")
+        , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
     ),
     define_description(
           FieldName("first_free_block")
@@ -143,6 +155,14 @@ constexpr struct_description_t g_description[] =
           FieldName("bloom_filter_flags=algorithm:4/renewing")
         , FieldType(struct_type_t::STRUCT_TYPE_BITS32)
     ),
+    define_description( // end of the pages in use, pages after that were preallocated (added in 0.2)
+          FieldName("high_water_mark")
+        , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
+    ),
+    define_description( // list of the SLOT blocks (added in 0.3)
+          FieldName("first_slot_block")
+        , FieldType(struct_type_t::STRUCT_TYPE_REFERENCE)
+    ),
     end_descriptions()
 };
 
@@ -381,6 +401,89 @@ void file_table::set_bloom_filter_flags(flags_t flags)
 }
 
 
+/** \brief Get the end of the pages in use.
+ *
+ * The high-water mark was added in version 0.2 of the file table
+ * structure. In a file created with version 0.1, the field is not
+ * defined (whatever bytes follow the older structure) so the function
+ * returns NULL_FILE_ADDR, meaning that the mark is not known.
+ *
+ * \return The high-water mark or NULL_FILE_ADDR.
+ */
+reference_t file_table::get_high_water_mark() const
+{
+    if(get_saved_structure_version() < version_t(0, 2))
+    {
+        return NULL_FILE_ADDR;
+    }
+
+    return static_cast<reference_t>(f_structure->get_uinteger("high_water_mark"));
+}
+
+
+/** \brief Save the end of the pages in use.
+ *
+ * Saving the high-water mark in a file created with an older version
+ * of the file table structure upgrades the header to the current
+ * version. The new field was appended so the other fields do not move.
+ *
+ * \param[in] reference  The new high-water mark.
+ */
+void file_table::set_high_water_mark(reference_t reference)
+{
+    upgrade();
+    f_structure->set_uinteger("high_water_mark", reference);
+}
+
+
+/** \brief Get the first `SLOT` block of the table.
+ *
+ * The `SLOT` blocks are linked together so the slot_allocator does not
+ * have to read every block of the file to find them. The list was added
+ * in version 0.3 of the file table structure. Older files do not have
+ * any `SLOT` blocks so the function returns NULL_FILE_ADDR.
+ *
+ * \return The offset of the first `SLOT` block or NULL_FILE_ADDR.
+ */
+reference_t file_table::get_first_slot_block() const
+{
+    if(get_saved_structure_version() < version_t(0, 3))
+    {
+        return NULL_FILE_ADDR;
+    }
+
+    return static_cast<reference_t>(f_structure->get_uinteger("first_slot_block"));
+}
+
+
+void file_table::set_first_slot_block(reference_t reference)
+{
+    upgrade();
+    f_structure->set_uinteger("first_slot_block", reference);
+}
+
+
+/** \brief Upgrade the header to the current version.
+ *
+ * The fields added since the version saved in the header get
+ * initialized since the bytes of an older header are not defined past
+ * its last field.
+ */
+void file_table::upgrade()
+{
+    version_t const version(get_saved_structure_version());
+    if(version < version_t(0, 2))
+    {
+        f_structure->set_uinteger("high_water_mark", NULL_FILE_ADDR);
+    }
+    if(version < version_t(0, 3))
+    {
+        f_structure->set_uinteger("first_slot_block", NULL_FILE_ADDR);
+        set_structure_version();
+    }
+}
+
+
 
 } // namespace prinbee
 // vim: ts=4 sw=4 et
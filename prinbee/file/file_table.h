@@ -89,6 +89,13 @@ namespace prinbee
  *     use 8 bits for each counter), you have a similar problem
  *     as with the Bits version above. You have to reference the
  *     entire filter with a large Bloom Filter.
+ *
+ * * Blocked Bits
+ *
+ *     Like One Bits, except that all the bits of one key are set in the
+ *     same 64 byte block so a check reads a single cache line. The
+ *     number of blocks is a power of two. This is the algorithm
+ *     implemented by the bloom_filter class.
  */
 enum class bloom_filter_algorithm_t : std::uint8_t
 {
@@ -97,6 +104,7 @@ enum class bloom_filter_algorithm_t : std::uint8_t
     BLOOM_FILTER_ALGORITHM_ONE_COUNTERS  = 2,
     BLOOM_FILTER_ALGORITHM_N_BITS        = 3,
     BLOOM_FILTER_ALGORITHM_N_COUNTERS    = 4,
+    BLOOM_FILTER_ALGORITHM_BLOCKED_BITS  = 5,
 };
 
 
@@ -145,8 +153,14 @@ public:
     void                        set_deleted_rows(reference_t reference);
     reference_t                 get_bloom_filter_flags() const;
     void                        set_bloom_filter_flags(flags_t flags);
+    reference_t                 get_high_water_mark() const;
+    void                        set_high_water_mark(reference_t reference);
+    reference_t                 get_first_slot_block() const;
+    void                        set_first_slot_block(reference_t reference);
 
 private:
+    void                        upgrade();
+
     //schema_table::pointer_t     f_schema = schema_table::pointer_t();
 };
 
@@ -0,0 +1,183 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// self
+//
+#include    "catch_main.h"
+
+
+// prinbee
+//
+#include    <prinbee/exception.h>
+#include    <prinbee/block/block_cache.h>
+#include    <prinbee/block/block_free_block.h>
+
+
+// C++
+//
+#include    <thread>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+constexpr std::size_t const     g_page_size = 4096;
+
+
+prinbee::block::pointer_t create_block(prinbee::reference_t offset)
+{
+    return std::make_shared<prinbee::block_free_block>(nullptr, offset);
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("block_cache", "[block_cache][valid]")
+{
+    CATCH_START_SECTION("block_cache: find, insert, erase")
+    {
+        prinbee::block_cache cache;
+        CATCH_REQUIRE(cache.get_shard_count() == prinbee::DEFAULT_BLOCK_CACHE_SHARDS);
+
+        CATCH_REQUIRE(cache.find(0) == nullptr);
+        prinbee::block::pointer_t const a(create_block(0));
+        CATCH_REQUIRE(cache.insert(0, a) == a);
+        CATCH_REQUIRE(cache.find(0) == a);
+
+        // a second insert at the same offset returns the first block
+        //
+        prinbee::block::pointer_t const b(create_block(0));
+        CATCH_REQUIRE(cache.insert(0, b) == a);
+
+        prinbee::block_cache_statistics_t stats(cache.get_statistics());
+        CATCH_REQUIRE(stats.f_hits == 1);
+        CATCH_REQUIRE(stats.f_misses == 1);
+        CATCH_REQUIRE(stats.f_block_count == 1);
+
+        cache.erase(0);
+        CATCH_REQUIRE(cache.find(0) == nullptr);
+        CATCH_REQUIRE(cache.get_statistics().f_block_count == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("block_cache: shard count is a power of two")
+    {
+        prinbee::block_cache one(1);
+        CATCH_REQUIRE(one.get_shard_count() == 1);
+        one.insert(g_page_size, create_block(g_page_size));
+        CATCH_REQUIRE(one.find(g_page_size) != nullptr);
+
+        prinbee::block_cache five(5);
+        CATCH_REQUIRE(five.get_shard_count() == 8);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("block_cache: release unused blocks")
+    {
+        prinbee::block_cache cache;
+        std::vector<prinbee::block::pointer_t> kept;
+        for(std::size_t idx(0); idx < 100; ++idx)
+        {
+            prinbee::reference_t const offset(idx * g_page_size);
+            prinbee::block::pointer_t b(cache.insert(offset, create_block(offset)));
+            if(idx % 10 == 0)
+            {
+                kept.push_back(b);
+            }
+        }
+        CATCH_REQUIRE(cache.get_statistics().f_block_count == 100);
+
+        CATCH_REQUIRE(cache.release_unused() == 90);
+        prinbee::block_cache_statistics_t const stats(cache.get_statistics());
+        CATCH_REQUIRE(stats.f_block_count == 10);
+        CATCH_REQUIRE(stats.f_released == 90);
+        for(auto const & b : kept)
+        {
+            CATCH_REQUIRE(cache.find(b->get_offset()) == b);
+        }
+
+        cache.clear();
+        CATCH_REQUIRE(cache.get_statistics().f_block_count == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("block_cache: concurrent access")
+    {
+        prinbee::block_cache cache;
+        std::vector<std::thread> workers;
+        for(int t(0); t < 4; ++t)
+        {
+            workers.emplace_back([&cache]()
+                {
+                    for(int repeat(0); repeat < 10; ++repeat)
+                    {
+                        for(std::size_t idx(0); idx < 200; ++idx)
+                        {
+                            prinbee::reference_t const offset(idx * g_page_size);
+                            prinbee::block::pointer_t b(cache.find(offset));
+                            if(b == nullptr)
+                            {
+                                b = cache.insert(offset, create_block(offset));
+                            }
+                            CATCH_REQUIRE(b->get_offset() == offset);
+                        }
+                    }
+                });
+        }
+        for(auto & w : workers)
+        {
+            w.join();
+        }
+
+        // all the threads ended up sharing the same blocks
+        //
+        CATCH_REQUIRE(cache.get_statistics().f_block_count == 200);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("block_cache_errors", "[block_cache][invalid]")
+{
+    CATCH_START_SECTION("block_cache_errors: invalid number of shards")
+    {
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  prinbee::block_cache(0)
+                , prinbee::invalid_parameter
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: the number of block cache shards (0) must be between 1 and 65536."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  prinbee::block_cache(65537)
+                , prinbee::invalid_parameter
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: the number of block cache shards (65537) must be between 1 and 65536."));
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
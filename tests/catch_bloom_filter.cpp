@@ -0,0 +1,242 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+
+// prinbee
+//
+#include    <prinbee/exception.h>
+#include    <prinbee/database/bloom_filter.h>
+
+
+// C++
+//
+#include    <random>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+prinbee::buffer_t random_key(std::mt19937_64 & rng)
+{
+    prinbee::buffer_t key(16);
+    std::uint64_t const h1(rng());
+    std::uint64_t const h2(rng());
+    for(int i(0); i < 8; ++i)
+    {
+        key[i] = h1 >> (56 - i * 8);
+        key[i + 8] = h2 >> (56 - i * 8);
+    }
+    return key;
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("bloom_filter", "[bloom_filter][valid]")
+{
+    CATCH_START_SECTION("bloom_filter: empty filter")
+    {
+        prinbee::bloom_filter filter;
+        CATCH_REQUIRE(filter.get_block_count() == prinbee::MIN_BLOOM_FILTER_BLOCK_COUNT);
+        CATCH_REQUIRE(filter.get_capacity() == prinbee::MIN_BLOOM_FILTER_BLOCK_COUNT * prinbee::BLOOM_FILTER_BLOCK_BITS / prinbee::DEFAULT_BLOOM_FILTER_BITS_PER_KEY);
+        CATCH_REQUIRE(filter.get_key_count() == 0);
+        CATCH_REQUIRE(filter.get_deleted_count() == 0);
+        CATCH_REQUIRE(filter.get_hash_count() == prinbee::DEFAULT_BLOOM_FILTER_HASH_COUNT);
+
+        std::mt19937_64 rng(1);
+        for(int i(0); i < 100; ++i)
+        {
+            CATCH_REQUIRE_FALSE(filter.may_contain(random_key(rng)));
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("bloom_filter: size is a power of two")
+    {
+        prinbee::bloom_filter filter(100'000);
+        std::size_t const count(filter.get_block_count());
+        CATCH_REQUIRE((count & (count - 1)) == 0);
+        CATCH_REQUIRE(filter.get_capacity() >= 100'000);
+        CATCH_REQUIRE(filter.get_capacity() / 2 < 100'000);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("bloom_filter: no false negatives and few false positives")
+    {
+        std::size_t const key_count(50'000);
+        prinbee::bloom_filter filter(key_count);
+
+        std::mt19937_64 rng(7);
+        std::vector<prinbee::buffer_t> keys;
+        for(std::size_t i(0); i < key_count; ++i)
+        {
+            keys.push_back(random_key(rng));
+            filter.add(keys.back());
+        }
+        CATCH_REQUIRE(filter.get_key_count() == key_count);
+
+        for(auto const & k : keys)
+        {
+            CATCH_REQUIRE(filter.may_contain(k));
+        }
+
+        // with 10 bits per key, we expect about 1% of false positives;
+        // a blocked filter is a little worse
+        //
+        std::size_t false_positives(0);
+        std::size_t const tries(100'000);
+        for(std::size_t i(0); i < tries; ++i)
+        {
+            if(filter.may_contain(random_key(rng)))
+            {
+                ++false_positives;
+            }
+        }
+        CATCH_REQUIRE(false_positives * 100 < tries * 2);
+
+        filter.mark_deleted();
+        filter.mark_deleted();
+        CATCH_REQUIRE(filter.get_deleted_count() == 2);
+
+        filter.reset(10);
+        CATCH_REQUIRE(filter.get_key_count() == 0);
+        CATCH_REQUIRE(filter.get_deleted_count() == 0);
+        CATCH_REQUIRE(filter.get_block_count() == prinbee::MIN_BLOOM_FILTER_BLOCK_COUNT);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("bloom_filter: save and load")
+    {
+        prinbee::bloom_filter filter(5'000);
+        std::mt19937_64 rng(11);
+        std::vector<prinbee::buffer_t> keys;
+        for(int i(0); i < 5'000; ++i)
+        {
+            keys.push_back(random_key(rng));
+            filter.add(keys.back());
+        }
+        filter.mark_deleted();
+
+        prinbee::virtual_buffer::pointer_t b(filter.to_binary());
+        CATCH_REQUIRE(b->size() == 40 + filter.get_block_count() * prinbee::BLOOM_FILTER_BLOCK_SIZE);
+
+        prinbee::bloom_filter loaded;
+        CATCH_REQUIRE(loaded.from_binary(b));
+        CATCH_REQUIRE(loaded.get_block_count() == filter.get_block_count());
+        CATCH_REQUIRE(loaded.get_key_count() == 5'000);
+        CATCH_REQUIRE(loaded.get_deleted_count() == 1);
+        CATCH_REQUIRE(loaded.get_hash_count() == filter.get_hash_count());
+        for(auto const & k : keys)
+        {
+            CATCH_REQUIRE(loaded.may_contain(k));
+        }
+        for(int i(0); i < 1'000; ++i)
+        {
+            prinbee::buffer_t const k(random_key(rng));
+            CATCH_REQUIRE(loaded.may_contain(k) == filter.may_contain(k));
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("bloom_filter_errors", "[bloom_filter][invalid]")
+{
+    CATCH_START_SECTION("bloom_filter_errors: key too small")
+    {
+        prinbee::bloom_filter filter;
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  filter.add(prinbee::buffer_t(15))
+                , prinbee::invalid_parameter
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: a bloom filter key must be a 128 bit murmur3 key, got 15 bytes."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("bloom_filter_errors: invalid data is not loaded")
+    {
+        prinbee::bloom_filter filter(1'000);
+        std::mt19937_64 rng(3);
+        prinbee::buffer_t const key(random_key(rng));
+        filter.add(key);
+
+        // empty buffer
+        //
+        prinbee::bloom_filter loaded;
+        CATCH_REQUIRE_FALSE(loaded.from_binary(std::make_shared<prinbee::virtual_buffer>()));
+
+        // bad magic
+        //
+        prinbee::virtual_buffer::pointer_t b(filter.to_binary());
+        std::uint8_t const bad('X');
+        b->pwrite(&bad, 1, 0);
+        CATCH_REQUIRE_FALSE(loaded.from_binary(b));
+
+        // bad version
+        //
+        b = filter.to_binary();
+        std::uint32_t const version(0x00000001);
+        b->pwrite(&version, sizeof(version), 4);
+        CATCH_REQUIRE_FALSE(loaded.from_binary(b));
+
+        // block count not a power of two
+        //
+        b = filter.to_binary();
+        std::uint64_t const block_count(filter.get_block_count() + 1);
+        b->pwrite(&block_count, sizeof(block_count), 16);
+        CATCH_REQUIRE_FALSE(loaded.from_binary(b));
+
+        // truncated
+        //
+        b = filter.to_binary();
+        prinbee::virtual_buffer::pointer_t truncated(std::make_shared<prinbee::virtual_buffer>());
+        prinbee::buffer_t data(b->size() - 8);
+        b->pread(data.data(), data.size(), 0);
+        truncated->pwrite(data.data(), data.size(), 0, true);
+        CATCH_REQUIRE_FALSE(loaded.from_binary(truncated));
+
+        // the failed loads left the filter untouched
+        //
+        CATCH_REQUIRE(loaded.get_key_count() == 0);
+        CATCH_REQUIRE_FALSE(loaded.may_contain(key));
+
+        CATCH_REQUIRE(loaded.from_binary(filter.to_binary()));
+        CATCH_REQUIRE(loaded.may_contain(key));
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
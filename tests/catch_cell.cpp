@@ -0,0 +1,188 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// prinbee
+//
+#include    <prinbee/database/cell.h>
+#include    <prinbee/exception.h>
+
+
+// C++
+//
+#include    <string>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+prinbee::cell::pointer_t create_cell(prinbee::struct_type_t type)
+{
+    prinbee::schema_table::pointer_t schema(std::make_shared<prinbee::schema_table>());
+    schema->set_name("cells");
+    return std::make_shared<prinbee::cell>(schema->add_column("value", type));
+}
+
+
+// save the cell and load it back in a new cell
+//
+prinbee::cell::pointer_t round_trip(prinbee::cell::pointer_t c)
+{
+    prinbee::buffer_t buffer;
+    c->value_to_binary(buffer);
+
+    prinbee::cell::pointer_t result(std::make_shared<prinbee::cell>(c->schema()));
+    std::size_t pos(0);
+    result->value_from_binary(buffer, pos);
+    CATCH_REQUIRE(pos == buffer.size());
+    return result;
+}
+
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("cell", "[cell][valid]")
+{
+    CATCH_START_SECTION("cell: the value of a cell is compact")
+    {
+        // a schema column pointer and a 16 byte inline value
+        //
+        CATCH_REQUIRE(sizeof(prinbee::cell) <= sizeof(prinbee::schema_column::pointer_t) + 24);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("cell: small integers")
+    {
+        prinbee::cell::pointer_t i8(create_cell(prinbee::struct_type_t::STRUCT_TYPE_INT8));
+        i8->set_int8(-5);
+        CATCH_REQUIRE(round_trip(i8)->get_int8() == -5);
+
+        prinbee::cell::pointer_t u16(create_cell(prinbee::struct_type_t::STRUCT_TYPE_UINT16));
+        u16->set_uint16(0xFEDC);
+        CATCH_REQUIRE(round_trip(u16)->get_uint16() == 0xFEDC);
+
+        prinbee::cell::pointer_t i64(create_cell(prinbee::struct_type_t::STRUCT_TYPE_INT64));
+        i64->set_int64(-1234567890123LL);
+        CATCH_REQUIRE(round_trip(i64)->get_int64() == -1234567890123LL);
+
+        prinbee::cell::pointer_t u64(create_cell(prinbee::struct_type_t::STRUCT_TYPE_UINT64));
+        u64->set_uint64(0xFFFFFFFFFFFFFFFFULL);
+        CATCH_REQUIRE(round_trip(u64)->get_uint64() == 0xFFFFFFFFFFFFFFFFULL);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("cell: big integers")
+    {
+        prinbee::cell::pointer_t i128(create_cell(prinbee::struct_type_t::STRUCT_TYPE_INT128));
+        prinbee::int512_t negative(-3);
+        i128->set_int128(negative);
+        CATCH_REQUIRE(round_trip(i128)->get_int128() == negative);
+
+        prinbee::cell::pointer_t u512(create_cell(prinbee::struct_type_t::STRUCT_TYPE_UINT512));
+        prinbee::uint512_t large({ 1, 2, 3, 4, 5, 6, 7, 8 });
+        u512->set_uint512(large);
+        prinbee::cell::pointer_t copy(round_trip(u512));
+        CATCH_REQUIRE(copy->get_uint512() == large);
+
+        // the copy owns its own integer
+        //
+        prinbee::cell other(*copy);
+        copy->set_uint512(prinbee::uint512_t(9));
+        CATCH_REQUIRE(other.get_uint512() == large);
+        other = *copy;
+        CATCH_REQUIRE(other.get_uint512() == prinbee::uint512_t(9));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("cell: floating points")
+    {
+        prinbee::cell::pointer_t f32(create_cell(prinbee::struct_type_t::STRUCT_TYPE_FLOAT32));
+        f32->set_float32(3.25f);
+        CATCH_REQUIRE(round_trip(f32)->get_float32() == 3.25f);
+
+        prinbee::cell::pointer_t f64(create_cell(prinbee::struct_type_t::STRUCT_TYPE_FLOAT64));
+        f64->set_float64(-1.0e100);
+        CATCH_REQUIRE(round_trip(f64)->get_float64() == -1.0e100);
+
+        prinbee::cell::pointer_t f128(create_cell(prinbee::struct_type_t::STRUCT_TYPE_FLOAT128));
+        f128->set_float128(1.0L / 3.0L);
+        CATCH_REQUIRE(round_trip(f128)->get_float128() == 1.0L / 3.0L);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("cell: short and long strings")
+    {
+        for(auto const type : {
+                      prinbee::struct_type_t::STRUCT_TYPE_P8STRING
+                    , prinbee::struct_type_t::STRUCT_TYPE_P16STRING
+                    , prinbee::struct_type_t::STRUCT_TYPE_P32STRING })
+        {
+            prinbee::cell::pointer_t c(create_cell(type));
+            CATCH_REQUIRE(c->get_string().empty());
+
+            for(std::string const & value : {
+                          std::string()
+                        , std::string("short")
+                        , std::string(16, 'i')
+                        , std::string(17, 'l')
+                        , std::string("with a \0 in the middle of a long string", 40)
+                        , std::string("tiny") })
+            {
+                c->set_string(value);
+                CATCH_REQUIRE(c->get_string() == value);
+                CATCH_REQUIRE(round_trip(c)->get_string() == value);
+
+                prinbee::cell copy(*c);
+                CATCH_REQUIRE(copy.get_string() == value);
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("cell: copy a cell of the same type")
+    {
+        prinbee::cell::pointer_t source(create_cell(prinbee::struct_type_t::STRUCT_TYPE_P16STRING));
+        prinbee::cell::pointer_t destination(std::make_shared<prinbee::cell>(source->schema()));
+        source->set_string("a string long enough to be allocated");
+        destination->set_string("short");
+        destination->copy_from(*source);
+        source->set_string("changed");
+        CATCH_REQUIRE(destination->get_string() == "a string long enough to be allocated");
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
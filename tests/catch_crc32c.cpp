@@ -0,0 +1,139 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+// self
+//
+#include    "catch_main.h"
+
+
+// prinbee
+//
+#include    <prinbee/data/crc32c.h>
+
+
+// C++
+//
+#include    <cstring>
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+// this is the reference implementation, one bit at a time
+//
+prinbee::crc32c_t crc32c_bitwise(std::uint8_t const * data, std::size_t size)
+{
+    prinbee::crc32c_t crc(0xFFFFFFFF);
+    for(; size > 0; --size, ++data)
+    {
+        crc ^= *data;
+        for(int k(0); k < 8; ++k)
+        {
+            crc = (crc & 1) != 0 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("crc32c", "[crc32c][valid]")
+{
+    CATCH_START_SECTION("crc32c: check values")
+    {
+        char const * check("123456789");
+        CATCH_REQUIRE(prinbee::crc32c_compute(reinterpret_cast<std::uint8_t const *>(check), strlen(check)) == 0xE3069283);
+
+        CATCH_REQUIRE(prinbee::crc32c_compute(nullptr, 0) == 0);
+
+        // values from RFC 3720, section B.4
+        //
+        std::uint8_t buffer[32];
+        memset(buffer, 0, sizeof(buffer));
+        CATCH_REQUIRE(prinbee::crc32c_compute(buffer, sizeof(buffer)) == 0x8A9136AA);
+
+        memset(buffer, 0xFF, sizeof(buffer));
+        CATCH_REQUIRE(prinbee::crc32c_compute(buffer, sizeof(buffer)) == 0x62A8AB43);
+
+        for(std::size_t idx(0); idx < sizeof(buffer); ++idx)
+        {
+            buffer[idx] = idx;
+        }
+        CATCH_REQUIRE(prinbee::crc32c_compute(buffer, sizeof(buffer)) == 0x46DD794E);
+
+        for(std::size_t idx(0); idx < sizeof(buffer); ++idx)
+        {
+            buffer[idx] = 31 - idx;
+        }
+        CATCH_REQUIRE(prinbee::crc32c_compute(buffer, sizeof(buffer)) == 0x113FDB5C);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("crc32c: compare with bitwise implementation")
+    {
+        std::vector<std::uint8_t> buffer(4096 * 3 + 17);
+        for(auto & b : buffer)
+        {
+            b = rand();
+        }
+
+        // various sizes and alignments to go through all the loops
+        //
+        for(std::size_t start(0); start < 9; ++start)
+        {
+            for(std::size_t size : { 0UL, 1UL, 7UL, 8UL, 255UL, 767UL, 768UL, 769UL, 4096UL, 4096UL * 3 })
+            {
+                CATCH_REQUIRE(prinbee::crc32c_compute(buffer.data() + start, size)
+                                == crc32c_bitwise(buffer.data() + start, size));
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("crc32c: compute in several calls")
+    {
+        std::vector<std::uint8_t> buffer(4096);
+        for(auto & b : buffer)
+        {
+            b = rand();
+        }
+        prinbee::crc32c_t const expected(prinbee::crc32c_compute(buffer.data(), buffer.size()));
+
+        for(std::size_t split(0); split <= buffer.size(); split += 97)
+        {
+            prinbee::crc32c_t const crc(prinbee::crc32c_compute(buffer.data(), split));
+            CATCH_REQUIRE(prinbee::crc32c_compute(buffer.data() + split, buffer.size() - split, crc) == expected);
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
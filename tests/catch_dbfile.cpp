@@ -24,6 +24,7 @@
 // prinbee
 //
 #include    <prinbee/exception.h>
+#include    <prinbee/data/dbfile.h>
 #include    <prinbee/data/dbtype.h>
 
 
@@ -40,10 +41,17 @@
 //#include    <iomanip>
 
 
-//// C
-////
-//#include    <sys/stat.h>
-//#include    <sys/types.h>
+// C++
+//
+#include    <chrono>
+#include    <thread>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <sys/stat.h>
+#include    <unistd.h>
 
 
 // last include
@@ -78,6 +86,7 @@ bool is_valid_type(prinbee::dbtype_t type)
     case prinbee::dbtype_t::BLOCK_TYPE_INDIRECT_INDEX:
     case prinbee::dbtype_t::BLOCK_TYPE_SECONDARY_INDEX:
     case prinbee::dbtype_t::BLOCK_TYPE_SCHEMA_LIST:
+    case prinbee::dbtype_t::BLOCK_TYPE_SLOT_DATA:
     case prinbee::dbtype_t::BLOCK_TYPE_TOP_INDEX:
     case prinbee::dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX:
         return true;
@@ -88,6 +97,64 @@ bool is_valid_type(prinbee::dbtype_t type)
 }
 
 
+constexpr std::size_t const     g_page_count = 4;
+
+
+/** \brief Create a database file with a few pages.
+ *
+ * The dbfile only creates the header block when it creates the file
+ * itself, which requires a table. Creating the file beforehand lets the
+ * tests use a dbfile on its own.
+ */
+void create_dbfile(std::string const & table_name, std::string const & filename)
+{
+    std::string const dirname(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/" + table_name);
+    mkdir(dirname.c_str(), 0700);
+
+    std::string const fullname(dirname + "/" + filename + ".snapdb");
+    int const fd(open(fullname.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0600));
+    CATCH_REQUIRE(fd != -1);
+
+    std::size_t const page_size(prinbee::dbfile::get_system_page_size());
+    std::vector<std::uint8_t> page(page_size);
+    for(std::size_t idx(0); idx < g_page_count; ++idx)
+    {
+        std::fill(page.begin(), page.end(), static_cast<std::uint8_t>(idx + 1));
+        CATCH_REQUIRE(write(fd, page.data(), page.size()) == static_cast<ssize_t>(page.size()));
+    }
+    close(fd);
+
+    // remove checksums of a previous run
+    //
+    unlink((dirname + "/" + filename + ".crc").c_str());
+}
+
+
+prinbee::crc32c_t read_checksum(std::string const & table_name, std::string const & filename, std::size_t idx)
+{
+    std::string const crcname(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/" + table_name + "/" + filename + ".crc");
+    int const fd(open(crcname.c_str(), O_RDONLY | O_CLOEXEC));
+    if(fd == -1)
+    {
+        return 0;
+    }
+    prinbee::crc32c_t crc(0);
+    if(pread(fd, &crc, sizeof(crc), idx * sizeof(crc)) != sizeof(crc))
+    {
+        crc = 0;
+    }
+    close(fd);
+    return crc;
+}
+
+
+prinbee::crc32c_t expected_checksum(prinbee::const_data_t data, std::size_t size)
+{
+    prinbee::crc32c_t const crc(prinbee::crc32c_compute(data, size));
+    return crc == 0 ? ~crc : crc;
+}
+
+
 
 } // no name namespace
 
@@ -113,6 +180,7 @@ CATCH_TEST_CASE("dbfile_dbtype", "[dbfile] [valid]")
         CATCH_REQUIRE(std::string(prinbee::to_name(prinbee::dbtype_t::BLOCK_TYPE_INDIRECT_INDEX)) == "Indirect Index (INDR)");
         CATCH_REQUIRE(std::string(prinbee::to_name(prinbee::dbtype_t::BLOCK_TYPE_SECONDARY_INDEX)) == "Secondary Index (SIDX)");
         CATCH_REQUIRE(std::string(prinbee::to_name(prinbee::dbtype_t::BLOCK_TYPE_SCHEMA_LIST)) == "Schema List (SCHL)");
+        CATCH_REQUIRE(std::string(prinbee::to_name(prinbee::dbtype_t::BLOCK_TYPE_SLOT_DATA)) == "Slot Data (SLOT)");
         CATCH_REQUIRE(std::string(prinbee::to_name(prinbee::dbtype_t::BLOCK_TYPE_TOP_INDEX)) == "Top Index (TIDX)");
         CATCH_REQUIRE(std::string(prinbee::to_name(prinbee::dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX)) == "Top Indirect Index (TIND)");
     }
@@ -136,6 +204,7 @@ CATCH_TEST_CASE("dbfile_dbtype", "[dbfile] [valid]")
         CATCH_REQUIRE(std::string(prinbee::to_string(prinbee::dbtype_t::BLOCK_TYPE_INDIRECT_INDEX)) == "INDR");
         CATCH_REQUIRE(std::string(prinbee::to_string(prinbee::dbtype_t::BLOCK_TYPE_SECONDARY_INDEX)) == "SIDX");
         CATCH_REQUIRE(std::string(prinbee::to_string(prinbee::dbtype_t::BLOCK_TYPE_SCHEMA_LIST)) == "SCHL");
+        CATCH_REQUIRE(std::string(prinbee::to_string(prinbee::dbtype_t::BLOCK_TYPE_SLOT_DATA)) == "SLOT");
         CATCH_REQUIRE(std::string(prinbee::to_string(prinbee::dbtype_t::BLOCK_TYPE_TOP_INDEX)) == "TIDX");
         CATCH_REQUIRE(std::string(prinbee::to_string(prinbee::dbtype_t::BLOCK_TYPE_TOP_INDIRECT_INDEX)) == "TIND");
     }
@@ -162,6 +231,91 @@ CATCH_TEST_CASE("dbfile_dbtype", "[dbfile] [valid]")
 }
 
 
+CATCH_TEST_CASE("dbfile_checksums", "[dbfile] [valid]")
+{
+    CATCH_START_SECTION("dbfile_checksums: the background flusher refreshes the checksums")
+    {
+        create_dbfile("checksums", "flusher");
+
+        prinbee::dbfile f(SNAP_CATCH2_NAMESPACE::g_tmp_dir(), "checksums", "flusher");
+        f.set_page_size(prinbee::dbfile::get_system_page_size());
+        f.set_flush_interval(10);
+        std::size_t const page_size(f.get_page_size());
+
+        {
+            prinbee::page_ref page(f.get_page(page_size));
+            std::fill(page.data(), page.data() + page_size, 0x33);
+            f.sync(page, false);
+            prinbee::crc32c_t const expected(expected_checksum(page.data(), page_size));
+
+            // the page remains pinned so only the flusher can save its
+            // checksum; give it up to 10 seconds
+            //
+            for(int count(0); count < 1000 && read_checksum("checksums", "flusher", 1) != expected; ++count)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            CATCH_REQUIRE(read_checksum("checksums", "flusher", 1) == expected);
+            CATCH_REQUIRE(f.get_dirty_count() == 0);
+        }
+
+        f.close();
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("dbfile_checksums: blocks written by the storage backend get their checksum refreshed")
+    {
+        create_dbfile("checksums", "backend");
+
+        std::vector<std::uint8_t> expected_page;
+        {
+            prinbee::dbfile f(SNAP_CATCH2_NAMESPACE::g_tmp_dir(), "checksums", "backend");
+            f.set_page_size(prinbee::dbfile::get_system_page_size());
+            f.set_flush_interval(0);
+            f.set_backend(prinbee::backend_t::BACKEND_SYNC);
+            std::size_t const page_size(f.get_page_size());
+
+            // get the page in the cache and release it so it has a checksum
+            //
+            CATCH_REQUIRE(f.get_page(2 * page_size).data()[0] == 3);
+            f.close();
+            expected_page.resize(page_size, 3);
+            CATCH_REQUIRE(read_checksum("checksums", "backend", 2) == expected_checksum(expected_page.data(), page_size));
+
+            prinbee::storage_backend::pointer_t backend(f.get_backend());
+            prinbee::data_t buffer(backend->get_buffer_pool()->acquire());
+            std::fill(buffer, buffer + page_size, 0x5A);
+            int written(0);
+            backend->write_block(
+                      2 * page_size
+                    , buffer
+                    , [&written](int result, prinbee::data_t)
+                    {
+                        written = result;
+                    });
+            backend->wait_all();
+            backend->release_buffer(buffer);
+            CATCH_REQUIRE(written == static_cast<int>(page_size));
+
+            f.flush_all(true);
+            std::fill(expected_page.begin(), expected_page.end(), 0x5A);
+            CATCH_REQUIRE(read_checksum("checksums", "backend", 2) == expected_checksum(expected_page.data(), page_size));
+        }
+
+        // the checksum gets verified when the page enters the cache
+        //
+        prinbee::dbfile f(SNAP_CATCH2_NAMESPACE::g_tmp_dir(), "checksums", "backend");
+        f.set_page_size(prinbee::dbfile::get_system_page_size());
+        f.set_flush_interval(0);
+        prinbee::page_ref page(f.get_page(2 * f.get_page_size()));
+        CATCH_REQUIRE(page.data()[0] == 0x5A);
+        page.reset();
+        f.close();
+    }
+    CATCH_END_SECTION()
+}
+
+
 
 
 // vim: ts=4 sw=4 et
@@ -0,0 +1,657 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// prinbee
+//
+#include    <prinbee/exception.h>
+#include    <prinbee/block/block_free_block.h>
+#include    <prinbee/database/context.h>
+#include    <prinbee/database/index_builder.h>
+#include    <prinbee/database/index_tree.h>
+#include    <prinbee/database/row.h>
+#include    <prinbee/database/table.h>
+#include    <prinbee/file/file_table.h>
+
+
+// snapdev
+//
+#include    <snapdev/chownnm.h>
+#include    <snapdev/mkdir_p.h>
+#include    <snapdev/not_used.h>
+#include    <snapdev/pathinfo.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <map>
+#include    <cstring>
+#include    <random>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+// large keys so a few hundred of them are enough to get three levels
+//
+constexpr std::uint32_t     KEY_SIZE = 200;
+
+
+prinbee::table::pointer_t create_table(std::string const & context_name, prinbee::context::pointer_t & c)
+{
+    std::string const table_dir(snapdev::pathinfo::canonicalize(
+              prinbee::get_contexts_root_path()
+            , context_name + "/tables/keys"));
+    CATCH_REQUIRE(snapdev::mkdir_p(table_dir) == 0);
+
+    prinbee::schema_table::pointer_t schema(std::make_shared<prinbee::schema_table>());
+    schema->set_name("keys");
+    schema->set_schema_version(1);
+    schema->add_column("_oid", prinbee::struct_type_t::STRUCT_TYPE_OID);
+    schema->add_column("_created_on", prinbee::struct_type_t::STRUCT_TYPE_USTIME);
+    prinbee::schema_column::pointer_t key(schema->add_column("key", prinbee::struct_type_t::STRUCT_TYPE_P8STRING));
+    schema->set_primary_key({ key->get_column_id() });
+    schema->to_binary()->save_file(table_dir + "/table-1.pb");
+
+    prinbee::context_setup setup(context_name);
+    setup.set_user(snapdev::get_user_name());
+    setup.set_group(snapdev::get_group_name());
+    c = prinbee::context::create_context(setup);
+    c->initialize();
+
+    prinbee::table::pointer_t t(c->get_table("keys"));
+    CATCH_REQUIRE(t != nullptr);
+
+    // the file gets created with the first row
+    //
+    prinbee::row::pointer_t r(t->row_new());
+    r->get_cell("key", true)->set_string("first");
+    CATCH_REQUIRE(t->row_insert(r));
+
+    return t;
+}
+
+
+prinbee::buffer_t make_key(std::uint32_t value)
+{
+    prinbee::buffer_t key(KEY_SIZE, 0);
+    key[0] = value >> 24;
+    key[1] = value >> 16;
+    key[2] = value >> 8;
+    key[3] = value;
+    key[KEY_SIZE - 1] = 0x55;
+    return key;
+}
+
+
+std::size_t get_depth(prinbee::table::pointer_t t, prinbee::reference_t root)
+{
+    std::size_t depth(1);
+    prinbee::block::pointer_t b(t->get_block(root));
+    while(b->get_dbtype() == prinbee::dbtype_t::BLOCK_TYPE_TOP_INDEX)
+    {
+        ++depth;
+        b = t->get_block(std::static_pointer_cast<prinbee::block_top_index>(b)->get_reference(0));
+    }
+    return depth;
+}
+
+
+/** \brief Walk the `EIDX` blocks from the first one.
+ *
+ * The values are extracted from the keys and returned in the order
+ * found, after verifying that each key has the expected OID.
+ */
+std::vector<std::uint32_t> scan(prinbee::table::pointer_t t, prinbee::index_tree::pointer_t tree, prinbee::reference_t root)
+{
+    std::vector<std::uint32_t> values;
+    std::uint32_t position(0);
+    prinbee::block_entry_index::pointer_t entry_index(tree->lower_bound(root, prinbee::buffer_t(KEY_SIZE, 0), position));
+    CATCH_REQUIRE(position == 0);
+    while(entry_index != nullptr)
+    {
+        CATCH_REQUIRE(entry_index->get_count() > 0);
+        for(std::uint32_t idx(0); idx < entry_index->get_count(); ++idx)
+        {
+            prinbee::buffer_t const key(entry_index->get_key(idx));
+            std::uint32_t const value((key[0] << 24) | (key[1] << 16) | (key[2] << 8) | key[3]);
+            CATCH_REQUIRE(key == make_key(value));
+            CATCH_REQUIRE(entry_index->get_oid(idx) == value + 1);
+            values.push_back(value);
+        }
+        prinbee::reference_t const next(entry_index->get_next());
+        if(next == prinbee::NULL_FILE_ADDR)
+        {
+            break;
+        }
+        entry_index = std::static_pointer_cast<prinbee::block_entry_index>(t->get_block(next));
+    }
+    return values;
+}
+
+
+std::size_t count_free_blocks(prinbee::table::pointer_t t)
+{
+    std::size_t count(0);
+    prinbee::file_table::pointer_t header(std::static_pointer_cast<prinbee::file_table>(t->get_block(0)));
+    for(prinbee::reference_t offset(header->get_first_free_block()); offset != prinbee::NULL_FILE_ADDR;)
+    {
+        ++count;
+        offset = std::static_pointer_cast<prinbee::block_free_block>(t->get_block(offset))->get_next_free_block();
+    }
+    return count;
+}
+
+
+void collect_blocks(prinbee::table::pointer_t t, prinbee::reference_t offset, std::vector<prinbee::reference_t> & blocks)
+{
+    blocks.push_back(offset);
+    prinbee::block::pointer_t b(t->get_block(offset));
+    if(b->get_dbtype() == prinbee::dbtype_t::BLOCK_TYPE_TOP_INDEX)
+    {
+        prinbee::block_top_index::pointer_t top_index(std::static_pointer_cast<prinbee::block_top_index>(b));
+        for(std::uint32_t idx(0); idx < top_index->get_count(); ++idx)
+        {
+            collect_blocks(t, top_index->get_reference(idx), blocks);
+        }
+    }
+}
+
+
+std::vector<std::uint32_t> shuffled(std::uint32_t count, std::uint32_t seed)
+{
+    std::vector<std::uint32_t> values(count);
+    for(std::uint32_t idx(0); idx < count; ++idx)
+    {
+        values[idx] = idx * 3;
+    }
+    std::mt19937 g(seed);
+    std::shuffle(values.begin(), values.end(), g);
+    return values;
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("index_tree", "[index][tree]")
+{
+    CATCH_START_SECTION("index_tree: random inserts split the blocks at every level")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("index_tree_split_context", c));
+
+        for(auto const layout : { prinbee::index_layout_t::INDEX_LAYOUT_SORTED, prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER })
+        {
+            prinbee::index_tree::pointer_t tree(std::make_shared<prinbee::index_tree>(t, KEY_SIZE));
+            tree->set_layout(layout);
+
+            std::vector<std::uint32_t> const values(shuffled(1500, 123));
+            prinbee::reference_t root(prinbee::NULL_FILE_ADDR);
+            for(auto const v : values)
+            {
+                CATCH_REQUIRE(tree->insert(root, make_key(v), v + 1));
+            }
+
+            // a duplicate is refused and the root does not change
+            //
+            prinbee::reference_t const saved_root(root);
+            CATCH_REQUIRE_FALSE(tree->insert(root, make_key(values[0]), 1));
+            CATCH_REQUIRE(root == saved_root);
+
+            prinbee::index_tree_statistics_t const stats(tree->get_statistics());
+            CATCH_REQUIRE(stats.f_inserts == values.size());
+            CATCH_REQUIRE(stats.f_entry_index_splits > 0);
+            CATCH_REQUIRE(stats.f_top_index_splits > 0);
+            CATCH_REQUIRE(stats.f_new_roots >= 2);
+            CATCH_REQUIRE(get_depth(t, root) == stats.f_new_roots + 1);
+
+            for(auto const v : values)
+            {
+                CATCH_REQUIRE(tree->find(root, make_key(v)) == v + 1);
+                CATCH_REQUIRE(tree->find(root, make_key(v + 1)) == prinbee::NULL_FILE_ADDR);
+            }
+
+            std::vector<std::uint32_t> expected(values);
+            std::sort(expected.begin(), expected.end());
+            CATCH_REQUIRE(scan(t, tree, root) == expected);
+
+            // a lower bound between two keys points to the larger one
+            //
+            std::uint32_t position(0);
+            prinbee::block_entry_index::pointer_t entry_index(tree->lower_bound(root, make_key(301), position));
+            CATCH_REQUIRE(entry_index != nullptr);
+            if(position == entry_index->get_count())
+            {
+                entry_index = std::static_pointer_cast<prinbee::block_entry_index>(t->get_block(entry_index->get_next()));
+                position = 0;
+            }
+            CATCH_REQUIRE(entry_index->get_key(position) == make_key(303));
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("index_tree: ordered inserts keep the blocks filled to the fill factor")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("index_tree_fill_context", c));
+
+        prinbee::index_tree::pointer_t tree(std::make_shared<prinbee::index_tree>(t, KEY_SIZE));
+        CATCH_REQUIRE(tree->get_fill_factor() == prinbee::DEFAULT_INDEX_FILL_FACTOR);
+        CATCH_REQUIRE_THROWS_AS(tree->set_fill_factor(prinbee::MIN_INDEX_FILL_FACTOR - 1), prinbee::invalid_parameter);
+        CATCH_REQUIRE_THROWS_AS(tree->set_fill_factor(prinbee::MAX_INDEX_FILL_FACTOR + 1), prinbee::invalid_parameter);
+
+        std::uint32_t const count(1000);
+        prinbee::reference_t root(prinbee::NULL_FILE_ADDR);
+        for(std::uint32_t v(0); v < count; ++v)
+        {
+            CATCH_REQUIRE(tree->insert(root, make_key(v), v + 1));
+        }
+
+        // all the blocks but the last one keep 90% of the entries
+        //
+        std::uint32_t position(0);
+        prinbee::block_entry_index::pointer_t entry_index(tree->lower_bound(root, make_key(0), position));
+        std::uint32_t const keep(entry_index->get_max_count() * prinbee::DEFAULT_INDEX_FILL_FACTOR / 100);
+        std::size_t blocks(0);
+        for(;;)
+        {
+            ++blocks;
+            prinbee::reference_t const next(entry_index->get_next());
+            if(next == prinbee::NULL_FILE_ADDR)
+            {
+                CATCH_REQUIRE(entry_index->get_count() <= keep + 1);
+                break;
+            }
+            CATCH_REQUIRE(entry_index->get_count() == keep);
+            entry_index = std::static_pointer_cast<prinbee::block_entry_index>(t->get_block(next));
+        }
+        CATCH_REQUIRE(blocks == tree->get_statistics().f_entry_index_splits + 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("index_tree: removals merge the blocks and collapse the root")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("index_tree_merge_context", c));
+
+        for(auto const layout : { prinbee::index_layout_t::INDEX_LAYOUT_SORTED, prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER })
+        {
+            prinbee::index_tree::pointer_t tree(std::make_shared<prinbee::index_tree>(t, KEY_SIZE));
+            tree->set_layout(layout);
+
+            std::vector<std::uint32_t> const values(shuffled(1500, 456));
+            prinbee::reference_t root(prinbee::NULL_FILE_ADDR);
+            for(auto const v : values)
+            {
+                CATCH_REQUIRE(tree->insert(root, make_key(v), v + 1));
+            }
+            CATCH_REQUIRE(get_depth(t, root) >= 3);
+
+            // remove all the keys but one out of 150, in another order
+            //
+            std::vector<std::uint32_t> kept;
+            for(auto const v : shuffled(1500, 789))
+            {
+                if(v % 450 == 0)
+                {
+                    kept.push_back(v);
+                }
+                else
+                {
+                    CATCH_REQUIRE(tree->remove(root, make_key(v)));
+                }
+            }
+            CATCH_REQUIRE_FALSE(tree->remove(root, make_key(3)));
+
+            prinbee::index_tree_statistics_t const stats(tree->get_statistics());
+            CATCH_REQUIRE(stats.f_removals == values.size() - kept.size());
+            CATCH_REQUIRE(stats.f_merges > 0);
+            CATCH_REQUIRE(stats.f_collapsed_roots > 0);
+
+            // 10 keys fit in a single `EIDX` again
+            //
+            CATCH_REQUIRE(get_depth(t, root) == 1);
+
+            std::sort(kept.begin(), kept.end());
+            CATCH_REQUIRE(scan(t, tree, root) == kept);
+            for(auto const v : kept)
+            {
+                CATCH_REQUIRE(tree->find(root, make_key(v)) == v + 1);
+            }
+            CATCH_REQUIRE(tree->find(root, make_key(3)) == prinbee::NULL_FILE_ADDR);
+
+            // removing the last keys empties the tree
+            //
+            for(auto const v : kept)
+            {
+                CATCH_REQUIRE(tree->remove(root, make_key(v)));
+            }
+            CATCH_REQUIRE(root == prinbee::NULL_FILE_ADDR);
+            CATCH_REQUIRE(tree->find(root, make_key(0)) == prinbee::NULL_FILE_ADDR);
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("index_builder", "[index][builder]")
+{
+    CATCH_START_SECTION("index_builder: the tree built from sorted runs holds all the keys")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("index_builder_context", c));
+
+        // the small memory budget forces the use of several runs
+        //
+        prinbee::index_builder::pointer_t builder(std::make_shared<prinbee::index_builder>(t, KEY_SIZE));
+        builder->set_memory_budget(prinbee::MIN_INDEX_BUILDER_MEMORY_BUDGET);
+        std::vector<std::uint32_t> const values(shuffled(10000, 321));
+        for(auto const v : values)
+        {
+            builder->add(make_key(v), v + 1);
+        }
+        CATCH_REQUIRE(builder->get_count() == values.size());
+        CATCH_REQUIRE(builder->get_run_count() > 1);
+
+        prinbee::reference_t root(prinbee::NULL_FILE_ADDR);
+        std::size_t installs(0);
+        builder->build([&root, &installs](prinbee::buffer_t const & first_key, prinbee::reference_t r)
+            {
+                CATCH_REQUIRE(first_key == make_key(0));
+                root = r;
+                ++installs;
+            });
+        CATCH_REQUIRE(installs == 1);
+        CATCH_REQUIRE(builder->get_count() == 0);
+        CATCH_REQUIRE(builder->get_run_count() == 0);
+        CATCH_REQUIRE(get_depth(t, root) >= 3);
+
+        prinbee::index_tree::pointer_t tree(std::make_shared<prinbee::index_tree>(t, KEY_SIZE));
+        std::vector<std::uint32_t> expected(values);
+        std::sort(expected.begin(), expected.end());
+        CATCH_REQUIRE(scan(t, tree, root) == expected);
+        for(std::size_t idx(0); idx < values.size(); idx += 13)
+        {
+            CATCH_REQUIRE(tree->find(root, make_key(values[idx])) == values[idx] + 1);
+        }
+
+        // the blocks get filled to the fill factor, except the last one
+        //
+        std::uint32_t position(0);
+        prinbee::block_entry_index::pointer_t entry_index(tree->lower_bound(root, make_key(0), position));
+        std::uint32_t const keep(entry_index->get_max_count() * prinbee::DEFAULT_INDEX_FILL_FACTOR / 100);
+        while(entry_index->get_next() != prinbee::NULL_FILE_ADDR)
+        {
+            CATCH_REQUIRE(entry_index->get_count() == keep);
+            entry_index = std::static_pointer_cast<prinbee::block_entry_index>(t->get_block(entry_index->get_next()));
+        }
+
+        // the tree can then be updated as usual
+        //
+        CATCH_REQUIRE(tree->insert(root, make_key(1), 2));
+        CATCH_REQUIRE(tree->remove(root, make_key(0)));
+        CATCH_REQUIRE(tree->find(root, make_key(1)) == 2);
+        CATCH_REQUIRE(tree->find(root, make_key(0)) == prinbee::NULL_FILE_ADDR);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("index_builder: one tree gets installed per partition")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("index_builder_partition_context", c));
+
+        prinbee::index_builder::pointer_t builder(std::make_shared<prinbee::index_builder>(t, KEY_SIZE));
+        builder->set_partition([](prinbee::buffer_t const & key)
+            {
+                return key[3] % 4;
+            });
+        std::vector<std::uint32_t> const values(shuffled(2000, 654));
+        for(auto const v : values)
+        {
+            builder->add(make_key(v), v + 1);
+        }
+        CATCH_REQUIRE_THROWS_AS(builder->set_partition(prinbee::index_builder::partition_t()), prinbee::logic_error);
+
+        std::map<std::uint32_t, prinbee::reference_t> roots;
+        builder->build([&roots](prinbee::buffer_t const & first_key, prinbee::reference_t root)
+            {
+                std::uint32_t const partition(first_key[3] % 4);
+                CATCH_REQUIRE(roots.count(partition) == 0);
+                roots[partition] = root;
+            });
+        CATCH_REQUIRE(roots.size() == 4);
+
+        prinbee::index_tree::pointer_t tree(std::make_shared<prinbee::index_tree>(t, KEY_SIZE));
+        std::size_t total(0);
+        for(auto const & r : roots)
+        {
+            std::vector<std::uint32_t> const found(scan(t, tree, r.second));
+            CATCH_REQUIRE(std::is_sorted(found.begin(), found.end()));
+            for(auto const v : found)
+            {
+                CATCH_REQUIRE((v & 255) % 4 == r.first);
+            }
+            total += found.size();
+        }
+        CATCH_REQUIRE(total == values.size());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("index_builder: a duplicate key frees the blocks and installs nothing")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("index_builder_duplicate_context", c));
+
+        prinbee::index_builder::pointer_t builder(std::make_shared<prinbee::index_builder>(t, KEY_SIZE));
+        std::vector<std::uint32_t> const values(shuffled(1500, 987));
+        for(auto const v : values)
+        {
+            builder->add(make_key(v), v + 1);
+        }
+
+        // the largest key is found twice only once all the blocks
+        // were allocated
+        //
+        builder->add(make_key(1499 * 3), 1);
+        std::size_t installs(0);
+        auto install([&installs](prinbee::buffer_t const & first_key, prinbee::reference_t root)
+            {
+                snapdev::NOT_USED(first_key, root);
+                ++installs;
+            });
+        std::size_t const free_blocks(count_free_blocks(t));
+        CATCH_REQUIRE_THROWS_AS(builder->build(install), prinbee::defined_twice);
+        CATCH_REQUIRE(installs == 0);
+        CATCH_REQUIRE(builder->get_count() == 0);
+        std::size_t const released(count_free_blocks(t) - free_blocks);
+        CATCH_REQUIRE(released > 0);
+
+        // the same keys without the duplicate reuse the freed blocks
+        //
+        for(auto const v : values)
+        {
+            builder->add(make_key(v), v + 1);
+        }
+        builder->build(install);
+        CATCH_REQUIRE(installs == 1);
+        CATCH_REQUIRE(count_free_blocks(t) == free_blocks);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("index_block_version", "[index][tree][version]")
+{
+    CATCH_START_SECTION("index_block_version: version 0.1 blocks are searched and upgraded on a layout change")
+    {
+        std::string const filename(snapdev::pathinfo::canonicalize(
+                  prinbee::get_contexts_root_path()
+                , "index_version_context/tables/keys/main.snapdb"));
+        std::string const crc_filename(snapdev::pathinfo::canonicalize(
+                  prinbee::get_contexts_root_path()
+                , "index_version_context/tables/keys/main.crc"));
+        std::vector<std::uint32_t> const values(shuffled(300, 55));
+        std::vector<std::uint32_t> expected(values);
+        std::sort(expected.begin(), expected.end());
+        prinbee::reference_t root(prinbee::NULL_FILE_ADDR);
+        std::vector<prinbee::reference_t> blocks;
+        std::size_t page_size(0);
+        {
+            prinbee::context::pointer_t c;
+            prinbee::table::pointer_t t(create_table("index_version_context", c));
+            prinbee::index_tree::pointer_t tree(std::make_shared<prinbee::index_tree>(t, KEY_SIZE));
+            for(auto const v : values)
+            {
+                CATCH_REQUIRE(tree->insert(root, make_key(v), v + 1));
+            }
+            CATCH_REQUIRE(get_depth(t, root) >= 2);
+            collect_blocks(t, root, blocks);
+            page_size = t->get_page_size();
+        }
+
+        // make the blocks look like version 0.1 blocks, which had no
+        // "flags" field after "size":
+        //   magic, version, count, size, [flags,] next, previous (EIDX only)
+        //
+        constexpr off_t const version_offset(4);
+        constexpr off_t const flags_offset(4 * 4);
+        int fd(open(filename.c_str(), O_RDWR | O_CLOEXEC));
+        CATCH_REQUIRE(fd != -1);
+        for(auto const offset : blocks)
+        {
+            std::vector<std::uint8_t> page(page_size);
+            CATCH_REQUIRE(pread(fd, page.data(), page_size, offset) == static_cast<ssize_t>(page_size));
+            std::uint32_t version(0);
+            memcpy(&version, page.data() + version_offset, sizeof(version));
+            CATCH_REQUIRE(version == prinbee::version_t(0, 2).to_binary());
+            std::uint32_t flags(1);
+            memcpy(&flags, page.data() + flags_offset, sizeof(flags));
+            CATCH_REQUIRE(flags == 0);
+
+            memmove(page.data() + flags_offset, page.data() + flags_offset + sizeof(flags), page_size - flags_offset - sizeof(flags));
+            memset(page.data() + page_size - sizeof(flags), 0, sizeof(flags));
+            version = prinbee::version_t(0, 1).to_binary();
+            memcpy(page.data() + version_offset, &version, sizeof(version));
+            CATCH_REQUIRE(pwrite(fd, page.data(), page_size, offset) == static_cast<ssize_t>(page_size));
+        }
+        close(fd);
+
+        // the pages were edited by hand, a zero checksum is not verified
+        //
+        fd = open(crc_filename.c_str(), O_RDWR | O_CLOEXEC);
+        CATCH_REQUIRE(fd != -1);
+        for(auto const offset : blocks)
+        {
+            prinbee::crc32c_t const crc(0);
+            off_t const crc_offset(offset / page_size * sizeof(crc));
+            CATCH_REQUIRE(pwrite(fd, &crc, sizeof(crc), crc_offset) == sizeof(crc));
+        }
+        close(fd);
+
+        {
+            prinbee::context_setup setup("index_version_context");
+            setup.set_user(snapdev::get_user_name());
+            setup.set_group(snapdev::get_group_name());
+            prinbee::context::pointer_t c(prinbee::context::create_context(setup));
+            c->initialize();
+            prinbee::table::pointer_t t(c->get_table("keys"));
+            CATCH_REQUIRE(t != nullptr);
+            prinbee::index_tree::pointer_t tree(std::make_shared<prinbee::index_tree>(t, KEY_SIZE));
+
+            // the file gets opened with its header
+            //
+            CATCH_REQUIRE(t->get_block(0) != nullptr);
+
+            for(auto const offset : blocks)
+            {
+                prinbee::block::pointer_t b(t->get_block(offset));
+                CATCH_REQUIRE(b->get_saved_structure_version() == prinbee::version_t(0, 1));
+            }
+            for(auto const v : values)
+            {
+                CATCH_REQUIRE(tree->find(root, make_key(v)) == v + 1);
+                CATCH_REQUIRE(tree->find(root, make_key(v + 1)) == prinbee::NULL_FILE_ADDR);
+            }
+            CATCH_REQUIRE(scan(t, tree, root) == expected);
+
+            // the old blocks can still be updated as is
+            //
+            CATCH_REQUIRE(tree->insert(root, make_key(1), 2));
+            CATCH_REQUIRE(tree->find(root, make_key(1)) == 2);
+            CATCH_REQUIRE(tree->remove(root, make_key(1)));
+
+            // a new layout upgrades the block to version 0.2
+            //
+            blocks.clear();
+            collect_blocks(t, root, blocks);
+            for(auto const offset : blocks)
+            {
+                prinbee::block::pointer_t b(t->get_block(offset));
+                if(b->get_dbtype() == prinbee::dbtype_t::BLOCK_TYPE_TOP_INDEX)
+                {
+                    prinbee::block_top_index::pointer_t top_index(std::static_pointer_cast<prinbee::block_top_index>(b));
+                    CATCH_REQUIRE(top_index->get_layout() == prinbee::index_layout_t::INDEX_LAYOUT_SORTED);
+                    top_index->set_layout(prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER);
+                    CATCH_REQUIRE(top_index->get_layout() == prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER);
+                }
+                else
+                {
+                    prinbee::block_entry_index::pointer_t entry_index(std::static_pointer_cast<prinbee::block_entry_index>(b));
+                    CATCH_REQUIRE(entry_index->get_layout() == prinbee::index_layout_t::INDEX_LAYOUT_SORTED);
+                    entry_index->set_layout(prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER);
+                    CATCH_REQUIRE(entry_index->get_layout() == prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER);
+                }
+                CATCH_REQUIRE(b->get_saved_structure_version() == prinbee::version_t(0, 2));
+            }
+            for(auto const v : values)
+            {
+                CATCH_REQUIRE(tree->find(root, make_key(v)) == v + 1);
+            }
+            CATCH_REQUIRE(scan(t, tree, root) == expected);
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,439 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// prinbee
+//
+#include    <prinbee/data/key_search.h>
+#include    <prinbee/exception.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+// same layout as an EIDX entry: flags, OID, key
+//
+constexpr std::uint32_t const   ENTRY_HEADER = 1 + 8;
+constexpr std::uint32_t const   BLOCK_HEADER = 40;
+
+
+struct block_t
+{
+    std::vector<std::uint8_t>   f_data = std::vector<std::uint8_t>();
+    std::uint32_t               f_stride = 0;
+    std::uint32_t               f_count = 0;
+
+    std::uint8_t const * keys() const
+    {
+        return f_data.data() + BLOCK_HEADER + ENTRY_HEADER;
+    }
+
+    std::uint8_t const * end() const
+    {
+        return f_data.data() + f_data.size();
+    }
+
+    std::uint8_t const * key(std::uint32_t idx) const
+    {
+        return keys() + idx * f_stride;
+    }
+};
+
+
+// create a full block of sorted random keys; a small alphabet generates
+// keys which share long prefixes
+//
+block_t create_block(std::size_t block_size, std::uint32_t length, int alphabet)
+{
+    block_t b;
+    b.f_data.resize(block_size);
+    b.f_stride = ENTRY_HEADER + length;
+    b.f_count = (block_size - BLOCK_HEADER) / b.f_stride;
+
+    std::vector<std::vector<std::uint8_t>> keys(b.f_count);
+    for(auto & k : keys)
+    {
+        k.resize(length);
+        for(auto & c : k)
+        {
+            c = rand() % alphabet * (256 / alphabet);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+
+    for(auto & c : b.f_data)
+    {
+        c = rand();
+    }
+    for(std::uint32_t idx(0); idx < b.f_count; ++idx)
+    {
+        memcpy(const_cast<std::uint8_t *>(b.key(idx)), keys[idx].data(), length);
+    }
+
+    return b;
+}
+
+
+std::uint32_t reference_lower_bound(block_t const & b, std::uint8_t const * key, std::uint32_t length)
+{
+    std::uint32_t idx(0);
+    while(idx < b.f_count && memcmp(b.key(idx), key, length) < 0)
+    {
+        ++idx;
+    }
+    return idx;
+}
+
+
+// this is the loop find_entry() used before key_lower_bound()
+//
+std::uint32_t memcmp_binary_search(block_t const & b, std::uint8_t const * key, std::uint32_t length)
+{
+    std::uint32_t position(0);
+    std::uint32_t i(0);
+    std::uint32_t j(b.f_count);
+    while(i < j)
+    {
+        position = (j - i) / 2 + i;
+        int const r(memcmp(b.key(position), key, length));
+        if(r < 0)
+        {
+            ++position;
+            i = position;
+        }
+        else if(r > 0)
+        {
+            j = position;
+        }
+        else
+        {
+            break;
+        }
+    }
+    return position;
+}
+
+
+std::vector<prinbee::key_search_t> get_implementations(std::uint32_t length)
+{
+    std::vector<prinbee::key_search_t> result;
+    for(auto const impl : {
+                  prinbee::key_search_t::KEY_SEARCH_DEFAULT
+                , prinbee::key_search_t::KEY_SEARCH_SCALAR
+                , prinbee::key_search_t::KEY_SEARCH_SSE2
+                , prinbee::key_search_t::KEY_SEARCH_AVX2 })
+    {
+        if(prinbee::key_search_is_supported(impl, length))
+        {
+            result.push_back(impl);
+        }
+    }
+    return result;
+}
+
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("key_search", "[key_search][valid]")
+{
+    CATCH_START_SECTION("key_search: empty array")
+    {
+        std::uint8_t const key[16] = {};
+        for(auto const impl : get_implementations(sizeof(key)))
+        {
+            CATCH_REQUIRE(prinbee::key_lower_bound(key, 0, 25, key + sizeof(key), key, sizeof(key), impl) == 0);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("key_search: compare with linear search")
+    {
+        for(std::size_t const block_size : { 4096UL, 65536UL })
+        {
+            for(std::uint32_t const length : { 1U, 3U, 8U, 15U, 16U, 17U, 24U, 31U, 32U, 40U })
+            {
+                for(int const alphabet : { 2, 256 })
+                {
+                    block_t const b(create_block(block_size, length, alphabet));
+                    std::vector<prinbee::key_search_t> const implementations(get_implementations(length));
+                    CATCH_REQUIRE(implementations.size() >= 2);
+
+                    auto check = [&](std::uint8_t const * key)
+                    {
+                        std::uint32_t const expected(reference_lower_bound(b, key, length));
+                        for(auto const impl : implementations)
+                        {
+                            CATCH_REQUIRE(prinbee::key_lower_bound(b.keys(), b.f_count, b.f_stride, b.end(), key, length, impl) == expected);
+                        }
+                    };
+
+                    // existing keys, including the first and the last
+                    //
+                    for(std::uint32_t idx(0); idx < b.f_count; idx += 7)
+                    {
+                        check(b.key(idx));
+                    }
+                    check(b.key(b.f_count - 1));
+
+                    // keys smaller, larger, and in between
+                    //
+                    std::vector<std::uint8_t> key(length, 0x00);
+                    check(key.data());
+                    std::fill(key.begin(), key.end(), 0xFF);
+                    check(key.data());
+                    for(int repeat(0); repeat < 100; ++repeat)
+                    {
+                        for(auto & c : key)
+                        {
+                            c = rand() % alphabet * (256 / alphabet) + (rand() & 1);
+                        }
+                        check(key.data());
+                    }
+                }
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("key_search: last key at the very end of the buffer")
+    {
+        // the SIMD loads would read past the end of the buffer so the
+        // last few entries must be compared with memcmp()
+        //
+        std::uint32_t const length(5);
+        std::uint32_t const stride(ENTRY_HEADER + length);
+        std::uint32_t const count(20);
+        std::vector<std::uint8_t> buffer(count * stride);
+        for(std::uint32_t idx(0); idx < count; ++idx)
+        {
+            buffer[idx * stride + ENTRY_HEADER + length - 1] = idx * 2;
+        }
+        std::uint8_t const * keys(buffer.data() + ENTRY_HEADER);
+        std::uint8_t const * end(buffer.data() + buffer.size());
+
+        for(auto const impl : get_implementations(length))
+        {
+            for(std::uint32_t idx(0); idx < count * 2 + 1; ++idx)
+            {
+                std::uint8_t const key[length] = { 0, 0, 0, 0, static_cast<std::uint8_t>(idx) };
+                CATCH_REQUIRE(prinbee::key_lower_bound(keys, count, stride, end, key, length, impl) == (idx + 1) / 2);
+            }
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("key_search_eytzinger", "[key_search][valid]")
+{
+    CATCH_START_SECTION("key_search_eytzinger: reorder entries back and forth")
+    {
+        for(std::uint32_t count(0); count < 300; ++count)
+        {
+            std::uint32_t const stride(3);
+            std::vector<std::uint8_t> sorted(count * stride);
+            for(std::uint32_t idx(0); idx < count; ++idx)
+            {
+                sorted[idx * stride + 0] = idx >> 8;
+                sorted[idx * stride + 1] = idx;
+                sorted[idx * stride + 2] = rand();
+            }
+
+            std::vector<std::uint8_t> entries(sorted);
+            prinbee::eytzinger_from_sorted(entries.data(), count, stride);
+            for(std::uint32_t idx(0); idx < count; ++idx)
+            {
+                // the first two bytes are the sorted position
+                //
+                std::uint32_t const position(prinbee::eytzinger_to_position(idx, count));
+                CATCH_REQUIRE(position == (entries[idx * stride] * 256U + entries[idx * stride + 1]));
+                CATCH_REQUIRE(prinbee::eytzinger_from_position(position, count) == idx);
+
+                // the children are properly ordered
+                //
+                if(idx * 2 + 1 < count)
+                {
+                    CATCH_REQUIRE(prinbee::eytzinger_to_position(idx * 2 + 1, count) < position);
+                }
+                if(idx * 2 + 2 < count)
+                {
+                    CATCH_REQUIRE(prinbee::eytzinger_to_position(idx * 2 + 2, count) > position);
+                }
+            }
+            CATCH_REQUIRE(prinbee::eytzinger_to_position(count, count) == count);
+            CATCH_REQUIRE(prinbee::eytzinger_from_position(count, count) == count);
+
+            prinbee::eytzinger_to_sorted(entries.data(), count, stride);
+            CATCH_REQUIRE(entries == sorted);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("key_search_eytzinger: compare with linear search")
+    {
+        for(std::size_t const block_size : { 4096UL, 65536UL })
+        {
+            for(std::uint32_t const length : { 1U, 8U, 16U, 24U, 40U })
+            {
+                block_t const b(create_block(block_size, length, 256));
+                block_t tree(b);
+                prinbee::eytzinger_from_sorted(tree.f_data.data() + BLOCK_HEADER, tree.f_count, tree.f_stride);
+
+                auto check = [&](std::uint8_t const * key)
+                {
+                    std::uint32_t const expected(reference_lower_bound(b, key, length));
+                    for(auto const impl : get_implementations(length))
+                    {
+                        std::uint32_t const index(prinbee::key_eytzinger_lower_bound(tree.keys(), tree.f_count, tree.f_stride, tree.end(), key, length, impl));
+                        CATCH_REQUIRE(prinbee::eytzinger_to_position(index, tree.f_count) == expected);
+                        if(index < tree.f_count)
+                        {
+                            CATCH_REQUIRE(memcmp(tree.key(index), b.key(expected), length) == 0);
+                        }
+                    }
+                };
+
+                for(std::uint32_t idx(0); idx < b.f_count; idx += 5)
+                {
+                    check(b.key(idx));
+                }
+                std::vector<std::uint8_t> key(length, 0x00);
+                check(key.data());
+                std::fill(key.begin(), key.end(), 0xFF);
+                check(key.data());
+                for(int repeat(0); repeat < 100; ++repeat)
+                {
+                    for(auto & c : key)
+                    {
+                        c = rand();
+                    }
+                    check(key.data());
+                }
+            }
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("key_search_errors", "[key_search][invalid]")
+{
+    CATCH_START_SECTION("key_search_errors: key too long for the implementation")
+    {
+        std::uint8_t const key[33] = {};
+        CATCH_REQUIRE_FALSE(prinbee::key_search_is_supported(prinbee::key_search_t::KEY_SEARCH_SSE2, 17));
+        CATCH_REQUIRE_FALSE(prinbee::key_search_is_supported(prinbee::key_search_t::KEY_SEARCH_AVX2, 33));
+        CATCH_REQUIRE_FALSE(prinbee::key_search_is_supported(static_cast<prinbee::key_search_t>(-1), 1));
+        CATCH_REQUIRE(prinbee::key_search_get_default(33) == prinbee::key_search_t::KEY_SEARCH_SCALAR);
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  prinbee::key_lower_bound(key, 1, 41, key + sizeof(key), key, 17, prinbee::key_search_t::KEY_SEARCH_SSE2)
+                , prinbee::invalid_parameter
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: key search implementation 2 does not support keys of 17 bytes on this computer."));
+    }
+    CATCH_END_SECTION()
+}
+
+
+// the benchmark is hidden, run it with:
+//
+//     unittest '[benchmark]'
+//
+CATCH_TEST_CASE("key_search_benchmark", "[key_search][benchmark][.]")
+{
+    for(std::size_t const block_size : { 4096UL, 65536UL })
+    {
+        std::uint32_t const length(16);
+        block_t const b(create_block(block_size, length, 256));
+
+        std::vector<std::vector<std::uint8_t>> searched(1024);
+        for(auto & k : searched)
+        {
+            std::uint8_t const * key(b.key(rand() % b.f_count));
+            k.assign(key, key + length);
+        }
+
+        std::string const name(std::to_string(block_size / 1024) + " KiB EIDX, ");
+
+        CATCH_BENCHMARK((name + "memcmp() binary search").c_str())
+        {
+            std::uint32_t sum(0);
+            for(auto const & k : searched)
+            {
+                sum += memcmp_binary_search(b, k.data(), length);
+            }
+            return sum;
+        };
+
+        for(auto const impl : get_implementations(length))
+        {
+            CATCH_BENCHMARK((name + "key_lower_bound() #" + std::to_string(static_cast<int>(impl))).c_str())
+            {
+                std::uint32_t sum(0);
+                for(auto const & k : searched)
+                {
+                    sum += prinbee::key_lower_bound(b.keys(), b.f_count, b.f_stride, b.end(), k.data(), length, impl);
+                }
+                return sum;
+            };
+        }
+
+        block_t tree(b);
+        prinbee::eytzinger_from_sorted(tree.f_data.data() + BLOCK_HEADER, tree.f_count, tree.f_stride);
+        for(auto const impl : get_implementations(length))
+        {
+            CATCH_BENCHMARK((name + "key_eytzinger_lower_bound() #" + std::to_string(static_cast<int>(impl))).c_str())
+            {
+                std::uint32_t sum(0);
+                for(auto const & k : searched)
+                {
+                    sum += prinbee::key_eytzinger_lower_bound(tree.keys(), tree.f_count, tree.f_stride, tree.end(), k.data(), length, impl);
+                }
+                return sum;
+            };
+        }
+    }
+}
+
+
+
+// vim: ts=4 sw=4 et
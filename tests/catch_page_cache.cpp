@@ -0,0 +1,387 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// prinbee
+//
+#include    <prinbee/exception.h>
+#include    <prinbee/data/page_cache.h>
+
+
+// C++
+//
+#include    <atomic>
+#include    <mutex>
+#include    <set>
+#include    <thread>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+constexpr std::size_t const     g_page_size = 4096;
+
+
+class fake_pages
+{
+public:
+    fake_pages(std::size_t count)
+        : f_memory(count * g_page_size)
+    {
+    }
+
+    prinbee::data_t page(std::size_t idx)
+    {
+        return f_memory.data() + idx * g_page_size;
+    }
+
+    void release(prinbee::reference_t offset, prinbee::data_t data)
+    {
+        CATCH_REQUIRE(data == page(offset / g_page_size));
+        f_released.insert(offset);
+    }
+
+    std::set<prinbee::reference_t> const & released() const
+    {
+        return f_released;
+    }
+
+private:
+    std::vector<std::uint8_t>           f_memory = std::vector<std::uint8_t>();
+    std::set<prinbee::reference_t>      f_released = std::set<prinbee::reference_t>();
+};
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("page_cache", "[page_cache][valid]")
+{
+    CATCH_START_SECTION("page_cache: hits and misses")
+    {
+        fake_pages pages(10);
+        prinbee::page_cache cache([&pages](prinbee::reference_t offset, prinbee::data_t data) { pages.release(offset, data); });
+        cache.set_page_size(g_page_size);
+        CATCH_REQUIRE(cache.get_page_size() == g_page_size);
+        CATCH_REQUIRE(cache.get_budget() == prinbee::DEFAULT_PAGE_CACHE_BUDGET);
+
+        CATCH_REQUIRE_FALSE(cache.pin(0));
+        {
+            prinbee::page_ref const added(cache.add(0, pages.page(0)));
+            CATCH_REQUIRE(added.data() == pages.page(0));
+            CATCH_REQUIRE(added.get_offset() == 0);
+            CATCH_REQUIRE(added.get_pin_count() == 1);
+
+            prinbee::page_ref const pinned(cache.pin(0));
+            CATCH_REQUIRE(pinned.data() == pages.page(0));
+            CATCH_REQUIRE(pinned == added);
+            CATCH_REQUIRE(pinned.get_pin_count() == 2);
+            CATCH_REQUIRE(cache.find(0) == pages.page(0));
+            CATCH_REQUIRE(cache.find(g_page_size) == nullptr);
+
+            prinbee::page_cache_statistics_t const stats(cache.get_statistics());
+            CATCH_REQUIRE(stats.f_hits == 1);
+            CATCH_REQUIRE(stats.f_misses == 1);
+            CATCH_REQUIRE(stats.f_evictions == 0);
+            CATCH_REQUIRE(stats.f_page_count == 1);
+            CATCH_REQUIRE(stats.f_pinned_count == 1);
+        }
+
+        prinbee::page_cache_statistics_t const stats(cache.get_statistics());
+        CATCH_REQUIRE(stats.f_page_count == 1);
+        CATCH_REQUIRE(stats.f_pinned_count == 0);
+        CATCH_REQUIRE(pages.released().empty());
+
+        cache.clear();
+        CATCH_REQUIRE(pages.released().size() == 1);
+        CATCH_REQUIRE(cache.get_statistics().f_page_count == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("page_cache: copy and move page references")
+    {
+        fake_pages pages(10);
+        prinbee::page_cache cache([&pages](prinbee::reference_t offset, prinbee::data_t data) { pages.release(offset, data); });
+        cache.set_page_size(g_page_size);
+
+        prinbee::page_ref a(cache.add(0, pages.page(0)));
+        prinbee::page_ref b(a);
+        CATCH_REQUIRE(a.get_pin_count() == 2);
+
+        prinbee::page_ref c(std::move(b));
+        CATCH_REQUIRE_FALSE(b);
+        CATCH_REQUIRE(b.get_pin_count() == 0);
+        CATCH_REQUIRE(c.get_pin_count() == 2);
+
+        prinbee::page_ref d;
+        CATCH_REQUIRE_FALSE(d);
+        d = c;
+        CATCH_REQUIRE(a.get_pin_count() == 3);
+        d = std::move(c);
+        CATCH_REQUIRE_FALSE(c);
+        CATCH_REQUIRE(a.get_pin_count() == 2);
+
+        d.reset();
+        CATCH_REQUIRE(a.get_pin_count() == 1);
+        CATCH_REQUIRE(cache.get_statistics().f_pinned_count == 1);
+        a.reset();
+        CATCH_REQUIRE(cache.get_statistics().f_pinned_count == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("page_cache: eviction respects the budget")
+    {
+        fake_pages pages(10);
+        prinbee::page_cache cache([&pages](prinbee::reference_t offset, prinbee::data_t data) { pages.release(offset, data); });
+        cache.set_page_size(g_page_size);
+        cache.set_budget(g_page_size * 4);
+
+        for(std::size_t idx(0); idx < 10; ++idx)
+        {
+            prinbee::reference_t const offset(idx * g_page_size);
+            CATCH_REQUIRE_FALSE(cache.pin(offset));
+            cache.add(offset, pages.page(idx));
+            CATCH_REQUIRE(cache.get_statistics().f_page_count <= 4);
+        }
+
+        prinbee::page_cache_statistics_t const stats(cache.get_statistics());
+        CATCH_REQUIRE(stats.f_page_count == 4);
+        CATCH_REQUIRE(stats.f_evictions == 6);
+        CATCH_REQUIRE(pages.released().size() == 6);
+        CATCH_REQUIRE_FALSE(cache.is_over_budget());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("page_cache: pinned pages are never evicted")
+    {
+        fake_pages pages(10);
+        prinbee::page_cache cache([&pages](prinbee::reference_t offset, prinbee::data_t data) { pages.release(offset, data); });
+        cache.set_page_size(g_page_size);
+        cache.set_budget(g_page_size * 2);
+
+        std::vector<prinbee::page_ref> refs;
+        for(std::size_t idx(0); idx < 3; ++idx)
+        {
+            refs.push_back(cache.add(idx * g_page_size, pages.page(idx)));
+        }
+
+        // all 3 pages are pinned, we're over budget
+        //
+        CATCH_REQUIRE(cache.is_over_budget());
+        CATCH_REQUIRE(pages.released().empty());
+        CATCH_REQUIRE(cache.get_statistics().f_over_budget > 0);
+
+        // unpinning one page lets the cache evict it
+        //
+        refs[1].reset();
+        CATCH_REQUIRE_FALSE(cache.is_over_budget());
+        CATCH_REQUIRE(pages.released().size() == 1);
+        CATCH_REQUIRE(pages.released().count(g_page_size) == 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("page_cache: referenced pages get a second chance")
+    {
+        fake_pages pages(10);
+        prinbee::page_cache cache([&pages](prinbee::reference_t offset, prinbee::data_t data) { pages.release(offset, data); });
+        cache.set_page_size(g_page_size);
+        cache.set_budget(g_page_size * 3);
+
+        for(std::size_t idx(0); idx < 3; ++idx)
+        {
+            cache.add(idx * g_page_size, pages.page(idx));
+        }
+
+        // a first eviction clears all the referenced flags
+        //
+        cache.add(3 * g_page_size, pages.page(3));
+        CATCH_REQUIRE(pages.released().size() == 1);
+
+        // access page 2 again so it gets referenced
+        //
+        CATCH_REQUIRE(cache.pin(2 * g_page_size).data() == pages.page(2));
+
+        cache.add(4 * g_page_size, pages.page(4));
+        CATCH_REQUIRE(pages.released().size() == 2);
+        CATCH_REQUIRE(pages.released().count(2 * g_page_size) == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("page_cache: references survive a clear()")
+    {
+        fake_pages pages(10);
+        prinbee::page_cache cache([&pages](prinbee::reference_t offset, prinbee::data_t data) { pages.release(offset, data); });
+        cache.set_page_size(g_page_size);
+
+        prinbee::page_ref ref(cache.add(0, pages.page(0)));
+        cache.add(g_page_size, pages.page(1));
+        cache.clear();
+        CATCH_REQUIRE(pages.released().size() == 2);
+        CATCH_REQUIRE(cache.get_statistics().f_page_count == 0);
+        CATCH_REQUIRE(ref.get_pin_count() == 1);
+
+        // the detached slot gets reused once released
+        //
+        ref.reset();
+        cache.add(0, pages.page(0));
+        cache.add(g_page_size, pages.page(1));
+        CATCH_REQUIRE(cache.get_statistics().f_page_count == 2);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("page_cache: pin and unpin while other threads evict")
+    {
+        constexpr std::size_t const page_count(16);
+        constexpr std::size_t const thread_count(4);
+        constexpr std::size_t const loop_count(20000);
+
+        fake_pages pages(page_count);
+        std::atomic<std::size_t> errors(0);
+        std::atomic<std::size_t> released(0);
+        prinbee::page_cache cache([&pages, &errors, &released](prinbee::reference_t offset, prinbee::data_t data)
+            {
+                if(data != pages.page(offset / g_page_size))
+                {
+                    ++errors;
+                }
+                ++released;
+            });
+        cache.set_page_size(g_page_size);
+        cache.set_budget(g_page_size * 3);
+
+        // pin() + add() must be atomic for the test, otherwise two threads
+        // may add the same page; the unpinning happens outside of that lock
+        //
+        std::mutex add_mutex;
+        auto worker([&](std::size_t id)
+            {
+                std::uint32_t seed(static_cast<std::uint32_t>(id * 7919 + 1));
+                for(std::size_t count(0); count < loop_count; ++count)
+                {
+                    seed = seed * 1103515245 + 12345;
+                    std::size_t const idx((seed >> 16) % page_count);
+                    prinbee::reference_t const offset(idx * g_page_size);
+
+                    prinbee::page_ref ref;
+                    {
+                        std::lock_guard<std::mutex> lock(add_mutex);
+                        ref = cache.pin(offset);
+                        if(!ref)
+                        {
+                            ref = cache.add(offset, pages.page(idx));
+                        }
+                    }
+
+                    prinbee::page_ref copy(ref);
+                    if(copy.get_offset() != offset
+                    || copy.data() != pages.page(idx))
+                    {
+                        ++errors;
+                    }
+                    ref.reset();
+                    if(copy.get_offset() != offset
+                    || copy.data() != pages.page(idx))
+                    {
+                        ++errors;
+                    }
+                }
+            });
+
+        std::vector<std::thread> threads;
+        for(std::size_t idx(0); idx < thread_count; ++idx)
+        {
+            threads.emplace_back(worker, idx);
+        }
+        for(auto & t : threads)
+        {
+            t.join();
+        }
+
+        CATCH_REQUIRE(errors == 0);
+        CATCH_REQUIRE(released > 0);
+
+        prinbee::page_cache_statistics_t const stats(cache.get_statistics());
+        CATCH_REQUIRE(stats.f_pinned_count == 0);
+        CATCH_REQUIRE(stats.f_page_count <= 3);
+        CATCH_REQUIRE(stats.f_hits + stats.f_misses == thread_count * loop_count);
+        CATCH_REQUIRE(stats.f_evictions == released);
+
+        // each page still present must be found in its own slot
+        //
+        for(std::size_t idx(0); idx < page_count; ++idx)
+        {
+            prinbee::page_ref ref(cache.pin(idx * g_page_size));
+            if(ref)
+            {
+                CATCH_REQUIRE(ref.data() == pages.page(idx));
+                CATCH_REQUIRE(ref.get_pin_count() == 1);
+            }
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("page_cache_errors", "[page_cache][invalid]")
+{
+    CATCH_START_SECTION("page_cache_errors: add the same page twice")
+    {
+        fake_pages pages(2);
+        prinbee::page_cache cache(nullptr);
+        cache.set_page_size(g_page_size);
+        prinbee::page_ref const ref(cache.add(0, pages.page(0)));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cache.add(0, pages.page(1))
+                , prinbee::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: page at offset 0 is already defined in the page cache."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("page_cache_errors: empty page reference")
+    {
+        prinbee::page_ref const ref;
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  ref.data()
+                , prinbee::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: page_ref::data() called on an empty page reference."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  ref.get_offset()
+                , prinbee::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: page_ref::get_offset() called on an empty page reference."));
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
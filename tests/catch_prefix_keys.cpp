@@ -0,0 +1,311 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// prinbee
+//
+#include    <prinbee/data/prefix_keys.h>
+#include    <prinbee/exception.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <cstring>
+#include    <string>
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+// same layout as an EIDX entry: flags, OID, key
+//
+constexpr std::uint32_t const   ENTRY_HEADER = 1 + 8;
+
+
+// create sorted unique entries with keys sharing long prefixes and
+// ending with zeroes like strings saved in a fixed size key
+//
+std::vector<std::uint8_t> create_entries(std::uint32_t count, std::uint32_t length)
+{
+    std::vector<std::vector<std::uint8_t>> keys;
+    while(keys.size() < count)
+    {
+        std::vector<std::uint8_t> k(length);
+        std::uint32_t const used(rand() % length + 1);
+        for(std::uint32_t idx(0); idx < used; ++idx)
+        {
+            k[idx] = 'a' + rand() % 3;
+        }
+        keys.push_back(k);
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    }
+
+    std::uint32_t const stride(ENTRY_HEADER + length);
+    std::vector<std::uint8_t> entries(count * stride);
+    for(std::uint32_t idx(0); idx < count; ++idx)
+    {
+        std::uint8_t * e(entries.data() + idx * stride);
+        for(std::uint32_t j(0); j < ENTRY_HEADER; ++j)
+        {
+            e[j] = rand();
+        }
+        memcpy(e + ENTRY_HEADER, keys[idx].data(), length);
+    }
+    return entries;
+}
+
+
+std::uint32_t reference_lower_bound(
+      std::vector<std::uint8_t> const & entries
+    , std::uint32_t stride
+    , std::uint8_t const * key
+    , std::uint32_t length)
+{
+    std::uint32_t const count(entries.size() / stride);
+    std::uint32_t idx(0);
+    while(idx < count && memcmp(entries.data() + idx * stride + ENTRY_HEADER, key, length) < 0)
+    {
+        ++idx;
+    }
+    return idx;
+}
+
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("prefix_keys", "[prefix_keys][valid]")
+{
+    CATCH_START_SECTION("prefix_keys: a zeroed buffer is empty")
+    {
+        prinbee::prefix_keys const keys(ENTRY_HEADER + 32, ENTRY_HEADER);
+        CATCH_REQUIRE(keys.get_stride() == ENTRY_HEADER + 32);
+        CATCH_REQUIRE(keys.get_header_size() == ENTRY_HEADER);
+        CATCH_REQUIRE(keys.get_key_size() == 32);
+
+        std::vector<std::uint8_t> buffer(1024);
+        CATCH_REQUIRE(keys.get_used_size(buffer.data(), buffer.size(), 0) == 4);
+        CATCH_REQUIRE(keys.lower_bound(buffer.data(), buffer.size(), 0, buffer.data(), 32, nullptr) == 0);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("prefix_keys: encode and decode back")
+    {
+        for(std::uint32_t const length : { 1U, 8U, 16U, 64U, 255U })
+        {
+            for(std::uint32_t const count : { 1U, 15U, 16U, 17U, 100U })
+            {
+                std::uint32_t const stride(ENTRY_HEADER + length);
+                std::vector<std::uint8_t> const entries(create_entries(std::min(count, length == 1 ? 3U : count), length));
+                std::uint32_t const n(entries.size() / stride);
+                prinbee::prefix_keys const keys(stride, ENTRY_HEADER);
+
+                std::uint32_t const encoded_size(keys.get_encoded_size(entries.data(), n));
+                std::vector<std::uint8_t> buffer(encoded_size);
+                CATCH_REQUIRE(keys.encode(entries.data(), n, buffer.data(), buffer.size()));
+                CATCH_REQUIRE(keys.get_used_size(buffer.data(), buffer.size(), n) == encoded_size);
+
+                std::vector<std::uint8_t> decoded(entries.size());
+                keys.decode(buffer.data(), buffer.size(), n, decoded.data());
+                CATCH_REQUIRE(decoded == entries);
+
+                std::vector<std::uint8_t> entry(stride);
+                for(std::uint32_t idx(0); idx < n; ++idx)
+                {
+                    std::uint32_t const header(keys.get_entry(buffer.data(), buffer.size(), n, idx, entry.data()));
+                    CATCH_REQUIRE(memcmp(entry.data(), entries.data() + idx * stride, stride) == 0);
+                    CATCH_REQUIRE(memcmp(buffer.data() + header, entries.data() + idx * stride, ENTRY_HEADER) == 0);
+                    CATCH_REQUIRE(keys.get_entry(buffer.data(), buffer.size(), n, idx, nullptr) == header);
+                }
+
+                // one byte less and it does not fit; the buffer is unchanged
+                //
+                std::vector<std::uint8_t> small(encoded_size - 1, 0xA5);
+                CATCH_REQUIRE_FALSE(keys.encode(entries.data(), n, small.data(), small.size()));
+                CATCH_REQUIRE(std::all_of(small.begin(), small.end(), [](std::uint8_t c) { return c == 0xA5; }));
+            }
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("prefix_keys: long shared prefixes take less space")
+    {
+        std::uint32_t const length(200);
+        std::uint32_t const stride(ENTRY_HEADER + length);
+        std::uint32_t const count(100);
+        std::vector<std::uint8_t> entries(count * stride);
+        for(std::uint32_t idx(0); idx < count; ++idx)
+        {
+            std::string const key("/usr/share/prinbee/tables/users/" + std::to_string(1000 + idx));
+            memcpy(entries.data() + idx * stride + ENTRY_HEADER, key.c_str(), key.length());
+        }
+        prinbee::prefix_keys const keys(stride, ENTRY_HEADER);
+        CATCH_REQUIRE(keys.get_encoded_size(entries.data(), count) * 10 < entries.size());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("prefix_keys: compare lower_bound() with linear search")
+    {
+        for(std::uint32_t const length : { 8U, 24U, 100U })
+        {
+            std::uint32_t const stride(ENTRY_HEADER + length);
+            std::vector<std::uint8_t> const entries(create_entries(150, length));
+            std::uint32_t const count(entries.size() / stride);
+            prinbee::prefix_keys const keys(stride, ENTRY_HEADER);
+            std::vector<std::uint8_t> buffer(keys.get_encoded_size(entries.data(), count) + 100);
+            CATCH_REQUIRE(keys.encode(entries.data(), count, buffer.data(), buffer.size()));
+
+            std::vector<std::uint8_t> entry(stride);
+            auto check = [&](std::uint8_t const * key)
+            {
+                std::uint32_t const expected(reference_lower_bound(entries, stride, key, length));
+                CATCH_REQUIRE(keys.lower_bound(buffer.data(), buffer.size(), count, key, length, entry.data()) == expected);
+                if(expected < count)
+                {
+                    CATCH_REQUIRE(memcmp(entry.data(), entries.data() + expected * stride, stride) == 0);
+                }
+            };
+
+            for(std::uint32_t idx(0); idx < count; ++idx)
+            {
+                check(entries.data() + idx * stride + ENTRY_HEADER);
+            }
+            for(int r(0); r < 200; ++r)
+            {
+                std::vector<std::uint8_t> key(length);
+                for(auto & c : key)
+                {
+                    c = 'a' + rand() % 4 - 1;
+                }
+                check(key.data());
+            }
+            std::vector<std::uint8_t> const smallest(length, 0);
+            check(smallest.data());
+            std::vector<std::uint8_t> const largest(length, 0xFF);
+            check(largest.data());
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("prefix_keys: removing entries never needs more space")
+    {
+        std::uint32_t const length(40);
+        std::uint32_t const stride(ENTRY_HEADER + length);
+        std::vector<std::uint8_t> entries(create_entries(120, length));
+        std::uint32_t count(entries.size() / stride);
+        prinbee::prefix_keys const keys(stride, ENTRY_HEADER);
+
+        // exactly the size of the encoded entries, so a removal which
+        // required more space would throw
+        //
+        std::vector<std::uint8_t> buffer(keys.get_encoded_size(entries.data(), count));
+        CATCH_REQUIRE(keys.encode(entries.data(), count, buffer.data(), buffer.size()));
+
+        while(count > 0)
+        {
+            std::uint32_t const used(keys.get_used_size(buffer.data(), buffer.size(), count));
+            std::uint32_t const position(rand() % count);
+            keys.remove(buffer.data(), buffer.size(), count, position);
+            entries.erase(entries.begin() + position * stride, entries.begin() + (position + 1) * stride);
+            --count;
+
+            CATCH_REQUIRE(keys.get_used_size(buffer.data(), buffer.size(), count) <= used);
+            std::vector<std::uint8_t> decoded(entries.size());
+            keys.decode(buffer.data(), buffer.size(), count, decoded.data());
+            CATCH_REQUIRE(decoded == entries);
+            for(std::uint32_t idx(0); idx < count; ++idx)
+            {
+                std::uint8_t const * key(entries.data() + idx * stride + ENTRY_HEADER);
+                CATCH_REQUIRE(keys.lower_bound(buffer.data(), buffer.size(), count, key, length, nullptr) == idx);
+            }
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("prefix_keys_errors", "[prefix_keys][invalid]")
+{
+    CATCH_START_SECTION("prefix_keys_errors: invalid key size")
+    {
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  prinbee::prefix_keys(ENTRY_HEADER, ENTRY_HEADER)
+                , prinbee::invalid_parameter
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: the key of a front coded entry must be between 1 and 65535 bytes, got 0."));
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  prinbee::prefix_keys(ENTRY_HEADER + 65536, ENTRY_HEADER)
+                , prinbee::invalid_parameter
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: the key of a front coded entry must be between 1 and 65535 bytes, got 65536."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("prefix_keys_errors: position out of range")
+    {
+        prinbee::prefix_keys const keys(ENTRY_HEADER + 8, ENTRY_HEADER);
+        std::vector<std::uint8_t> buffer(256);
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  keys.get_entry(buffer.data(), buffer.size(), 0, 0, nullptr)
+                , prinbee::out_of_range
+                , Catch::Matchers::ExceptionMessage(
+                          "out_of_range: front coded entry position 0 is out of range (count: 0)."));
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  keys.remove(buffer.data(), buffer.size(), 0, 3)
+                , prinbee::out_of_range
+                , Catch::Matchers::ExceptionMessage(
+                          "out_of_range: front coded entry position 3 is out of range (count: 0)."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("prefix_keys_errors: corrupted restart count")
+    {
+        prinbee::prefix_keys const keys(ENTRY_HEADER + 8, ENTRY_HEADER);
+        std::vector<std::uint8_t> buffer(256, 0xFF);
+
+        CATCH_REQUIRE_THROWS_AS(
+                  keys.get_entry(buffer.data(), buffer.size(), 1, 0, nullptr)
+                , prinbee::corrupted_data);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,363 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// prinbee
+//
+#include    <prinbee/exception.h>
+#include    <prinbee/block/block_slot_data.h>
+#include    <prinbee/database/context.h>
+#include    <prinbee/database/row.h>
+#include    <prinbee/database/slot_allocator.h>
+#include    <prinbee/database/table.h>
+#include    <prinbee/file/file_table.h>
+
+
+// snapdev
+//
+#include    <snapdev/chownnm.h>
+#include    <snapdev/mkdir_p.h>
+#include    <snapdev/pathinfo.h>
+
+
+// C++
+//
+#include    <set>
+#include    <vector>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+
+prinbee::table::pointer_t create_table(std::string const & context_name, prinbee::context::pointer_t & c)
+{
+    std::string const table_dir(snapdev::pathinfo::canonicalize(
+              prinbee::get_contexts_root_path()
+            , context_name + "/tables/slots"));
+    CATCH_REQUIRE(snapdev::mkdir_p(table_dir) == 0);
+
+    prinbee::schema_table::pointer_t schema(std::make_shared<prinbee::schema_table>());
+    schema->set_name("slots");
+    schema->set_schema_version(1);
+    schema->add_column("_oid", prinbee::struct_type_t::STRUCT_TYPE_OID);
+    schema->add_column("_created_on", prinbee::struct_type_t::STRUCT_TYPE_USTIME);
+    prinbee::schema_column::pointer_t key(schema->add_column("key", prinbee::struct_type_t::STRUCT_TYPE_P8STRING));
+    schema->set_primary_key({ key->get_column_id() });
+    schema->to_binary()->save_file(table_dir + "/table-1.pb");
+
+    prinbee::context_setup setup(context_name);
+    setup.set_user(snapdev::get_user_name());
+    setup.set_group(snapdev::get_group_name());
+    c = prinbee::context::create_context(setup);
+    c->initialize();
+
+    prinbee::table::pointer_t t(c->get_table("slots"));
+    CATCH_REQUIRE(t != nullptr);
+
+    // the file gets created with the first row
+    //
+    prinbee::row::pointer_t r(t->row_new());
+    r->get_cell("key", true)->set_string("first");
+    CATCH_REQUIRE(t->row_insert(r));
+
+    return t;
+}
+
+
+/** \brief Walk the list of `SLOT` blocks saved in the file.
+ *
+ * \return The offsets of the `SLOT` blocks in the order found.
+ */
+std::vector<prinbee::reference_t> get_slot_blocks(prinbee::table::pointer_t t)
+{
+    std::vector<prinbee::reference_t> blocks;
+    prinbee::file_table::pointer_t header(std::static_pointer_cast<prinbee::file_table>(t->get_block(0)));
+    for(prinbee::reference_t offset(header->get_first_slot_block()); offset != prinbee::NULL_FILE_ADDR;)
+    {
+        prinbee::block::pointer_t b(t->get_block(offset));
+        CATCH_REQUIRE(b->get_dbtype() == prinbee::dbtype_t::BLOCK_TYPE_SLOT_DATA);
+        blocks.push_back(offset);
+        offset = std::static_pointer_cast<prinbee::block_slot_data>(b)->get_next_slot_block();
+    }
+    return blocks;
+}
+
+
+std::uint32_t get_size(std::size_t idx)
+{
+    return 1 + idx * 37 % 500;
+}
+
+
+void verify_statistics(prinbee::slot_allocator_statistics_t const & expected, prinbee::slot_allocator_statistics_t const & stats)
+{
+    CATCH_REQUIRE(stats.f_block_count == expected.f_block_count);
+    CATCH_REQUIRE(stats.f_slots_in_use == expected.f_slots_in_use);
+    CATCH_REQUIRE(stats.f_bytes_in_use == expected.f_bytes_in_use);
+}
+
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("slot_allocator", "[slot][allocator]")
+{
+    CATCH_START_SECTION("slot_allocator: each size uses the smallest size class large enough")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("slot_classes_context", c));
+        prinbee::slot_allocator::pointer_t allocator(std::make_shared<prinbee::slot_allocator>(t));
+
+        CATCH_REQUIRE(allocator->get_size_class_count() > 0);
+        std::uint32_t const max_size(allocator->get_max_size());
+        CATCH_REQUIRE(max_size > 0);
+        CATCH_REQUIRE(max_size < t->get_page_size() / 4);
+
+        std::uint32_t previous_class(0);
+        for(std::uint32_t size(0); size <= max_size; ++size)
+        {
+            std::uint32_t const size_class(allocator->get_size_class(size));
+            CATCH_REQUIRE(size_class != prinbee::NO_SIZE_CLASS);
+            CATCH_REQUIRE(size_class >= previous_class);
+            previous_class = size_class;
+
+            // the slot includes a 32 bit meta data
+            //
+            std::uint32_t const slot_size(allocator->get_slot_size(size_class));
+            CATCH_REQUIRE(slot_size % sizeof(prinbee::reference_t) == 0);
+            CATCH_REQUIRE(slot_size >= size + sizeof(std::uint32_t));
+            CATCH_REQUIRE((size_class == 0 || allocator->get_slot_size(size_class - 1) < size + sizeof(std::uint32_t)));
+        }
+        CATCH_REQUIRE(previous_class == allocator->get_size_class_count() - 1);
+        CATCH_REQUIRE(allocator->get_size_class(max_size + 1) == prinbee::NO_SIZE_CLASS);
+
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  allocator->allocate(max_size + 1)
+                , prinbee::invalid_parameter
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: slot_allocator::allocate() called with a size ("
+                        + std::to_string(max_size + 1)
+                        + ") larger than the largest slot ("
+                        + std::to_string(max_size)
+                        + ")."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  allocator->get_slot_size(allocator->get_size_class_count())
+                , prinbee::invalid_parameter
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: size class "
+                        + std::to_string(allocator->get_size_class_count())
+                        + " is out of range."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("slot_allocator: released slots get reused")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("slot_reuse_context", c));
+        prinbee::slot_allocator::pointer_t allocator(std::make_shared<prinbee::slot_allocator>(t));
+        allocator->load();
+        prinbee::slot_allocator_statistics_t const initial(allocator->get_statistics());
+
+        std::size_t const count(1000);
+        std::set<prinbee::reference_t> references;
+        std::vector<prinbee::reference_t> slots;
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            std::uint32_t const size(get_size(idx));
+            prinbee::free_space_t const space(allocator->allocate(size));
+            CATCH_REQUIRE(space.f_block->get_dbtype() == prinbee::dbtype_t::BLOCK_TYPE_SLOT_DATA);
+            CATCH_REQUIRE(space.f_size == allocator->get_slot_size(allocator->get_size_class(size)));
+            CATCH_REQUIRE(references.insert(space.f_reference).second);
+            slots.push_back(space.f_reference);
+        }
+        prinbee::slot_allocator_statistics_t stats(allocator->get_statistics());
+        CATCH_REQUIRE(stats.f_allocations == count);
+        CATCH_REQUIRE(stats.f_slots_in_use == initial.f_slots_in_use + count);
+        CATCH_REQUIRE(stats.f_block_count == get_slot_blocks(t).size());
+        std::size_t const block_count(stats.f_block_count);
+
+        // release one slot out of two and allocate the same sizes again,
+        // no new blocks are necessary
+        //
+        for(std::size_t idx(0); idx < count; idx += 2)
+        {
+            allocator->release(slots[idx]);
+        }
+        for(std::size_t idx(0); idx < count; idx += 2)
+        {
+            prinbee::free_space_t const space(allocator->allocate(get_size(idx)));
+            CATCH_REQUIRE(references.count(space.f_reference) == 1);
+            slots[idx] = space.f_reference;
+        }
+        stats = allocator->get_statistics();
+        CATCH_REQUIRE(stats.f_releases == count / 2);
+        CATCH_REQUIRE(stats.f_block_count == block_count);
+        CATCH_REQUIRE(stats.f_slots_in_use == initial.f_slots_in_use + count);
+
+        allocator->release(slots[0]);
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  allocator->release(slots[0])
+                , prinbee::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: slot_allocator::release() called with reference "
+                        + std::to_string(slots[0])
+                        + " which is not allocated."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  allocator->release(slots[1] + 1)
+                , prinbee::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: slot_allocator::release() called with reference "
+                        + std::to_string(slots[1] + 1)
+                        + " which is not the start of a slot."));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  allocator->release(100)
+                , prinbee::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: slot_allocator::release() called with reference 100 which is not in a SLOT block."));
+
+        // releasing everything frees the blocks, except the last one
+        // of each size class
+        //
+        for(std::size_t idx(1); idx < count; ++idx)
+        {
+            allocator->release(slots[idx]);
+        }
+        stats = allocator->get_statistics();
+        CATCH_REQUIRE(stats.f_slots_in_use == initial.f_slots_in_use);
+        CATCH_REQUIRE(stats.f_blocks_released > 0);
+        CATCH_REQUIRE(stats.f_block_count == initial.f_block_count + stats.f_blocks_allocated - stats.f_blocks_released);
+        CATCH_REQUIRE(stats.f_block_count <= allocator->get_size_class_count());
+        CATCH_REQUIRE(stats.f_block_count == get_slot_blocks(t).size());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("slot_allocator: load() finds the SLOT blocks from the file header")
+    {
+        std::size_t const count(3000);
+        prinbee::slot_allocator_statistics_t saved;
+        {
+            prinbee::context::pointer_t c;
+            prinbee::table::pointer_t t(create_table("slot_load_context", c));
+            prinbee::slot_allocator::pointer_t allocator(std::make_shared<prinbee::slot_allocator>(t));
+            allocator->load();
+
+            std::vector<prinbee::reference_t> slots;
+            for(std::size_t idx(0); idx < count; ++idx)
+            {
+                slots.push_back(allocator->allocate(get_size(idx)).f_reference);
+            }
+
+            // free a few blocks so they get removed from the list
+            //
+            for(std::size_t idx(0); idx < count / 2; ++idx)
+            {
+                allocator->release(slots[idx]);
+            }
+            saved = allocator->get_statistics();
+            CATCH_REQUIRE(saved.f_blocks_released > 0);
+            CATCH_REQUIRE(saved.f_block_count == get_slot_blocks(t).size());
+
+            // a second allocator sees the same blocks and slots
+            //
+            prinbee::slot_allocator::pointer_t second(std::make_shared<prinbee::slot_allocator>(t));
+            second->load();
+            verify_statistics(saved, second->get_statistics());
+
+            // and it can release the slots allocated by the first one
+            //
+            for(std::size_t idx(count / 2); idx < count * 3 / 4; ++idx)
+            {
+                second->release(slots[idx]);
+            }
+            saved = second->get_statistics();
+            CATCH_REQUIRE(saved.f_block_count == get_slot_blocks(t).size());
+        }
+
+        prinbee::context_setup setup("slot_load_context");
+        setup.set_user(snapdev::get_user_name());
+        setup.set_group(snapdev::get_group_name());
+        prinbee::context::pointer_t c(prinbee::context::create_context(setup));
+        c->initialize();
+        prinbee::table::pointer_t t(c->get_table("slots"));
+        CATCH_REQUIRE(t != nullptr);
+
+        prinbee::slot_allocator::pointer_t allocator(std::make_shared<prinbee::slot_allocator>(t));
+        allocator->load();
+        verify_statistics(saved, allocator->get_statistics());
+        CATCH_REQUIRE(saved.f_block_count == get_slot_blocks(t).size());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("slot_allocator: load() detects an invalid list of SLOT blocks")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("slot_corrupted_context", c));
+        prinbee::file_table::pointer_t header(std::static_pointer_cast<prinbee::file_table>(t->get_block(0)));
+        std::vector<prinbee::reference_t> const blocks(get_slot_blocks(t));
+        CATCH_REQUIRE(blocks.size() == 1);
+        prinbee::block_slot_data::pointer_t first(std::static_pointer_cast<prinbee::block_slot_data>(t->get_block(blocks[0])));
+        CATCH_REQUIRE(first->get_next_slot_block() == prinbee::NULL_FILE_ADDR);
+
+        prinbee::slot_allocator::pointer_t allocator(std::make_shared<prinbee::slot_allocator>(t));
+        first->set_next_slot_block(blocks[0]);
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  allocator->load()
+                , prinbee::corrupted_data
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: the list of SLOT blocks loops back to offset "
+                        + std::to_string(blocks[0])
+                        + "."));
+        first->set_next_slot_block(prinbee::NULL_FILE_ADDR);
+
+        prinbee::block::pointer_t data(t->allocate_new_block(prinbee::dbtype_t::BLOCK_TYPE_DATA));
+        header->set_first_slot_block(data->get_offset());
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  allocator->load()
+                , prinbee::corrupted_data
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: block at offset "
+                        + std::to_string(data->get_offset())
+                        + " in the list of SLOT blocks is a Data (DATA) block."));
+        header->set_first_slot_block(blocks[0]);
+        t->free_block(data);
+
+        allocator->load();
+        CATCH_REQUIRE(allocator->get_statistics().f_block_count == 1);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,192 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+// prinbee
+//
+#include    <prinbee/exception.h>
+#include    <prinbee/data/io_uring_backend.h>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+constexpr std::size_t const     g_block_size = 4096;
+constexpr std::size_t const     g_block_count = 32;
+
+
+int create_file(std::string const & filename)
+{
+    int const fd(open(filename.c_str(), O_CREAT | O_TRUNC | O_RDWR | O_CLOEXEC, 0600));
+    CATCH_REQUIRE(fd != -1);
+
+    std::vector<std::uint8_t> block(g_block_size);
+    for(std::size_t idx(0); idx < g_block_count; ++idx)
+    {
+        std::fill(block.begin(), block.end(), static_cast<std::uint8_t>(idx));
+        CATCH_REQUIRE(write(fd, block.data(), block.size()) == static_cast<ssize_t>(block.size()));
+    }
+
+    return fd;
+}
+
+
+void verify_backend(prinbee::storage_backend::pointer_t backend)
+{
+    // read all the blocks at once
+    //
+    std::vector<int> found(g_block_count, -1);
+    for(std::size_t idx(0); idx < g_block_count; ++idx)
+    {
+        backend->read_block(
+                  idx * g_block_size
+                , [idx, &found, backend](int result, prinbee::data_t buffer)
+                {
+                    CATCH_REQUIRE(result == static_cast<int>(g_block_size));
+                    found[idx] = buffer[0];
+                    CATCH_REQUIRE(buffer[g_block_size - 1] == buffer[0]);
+                    backend->release_buffer(buffer);
+                });
+    }
+    CATCH_REQUIRE(backend->get_pending() == g_block_count);
+    backend->wait_all();
+    CATCH_REQUIRE(backend->get_pending() == 0);
+    CATCH_REQUIRE(backend->get_buffer_pool()->get_available() == backend->get_buffer_pool()->get_count());
+    for(std::size_t idx(0); idx < g_block_count; ++idx)
+    {
+        CATCH_REQUIRE(found[idx] == static_cast<int>(idx));
+    }
+
+    // overwrite block 5 from a pool buffer and read it back
+    //
+    prinbee::data_t buffer(backend->get_buffer_pool()->acquire());
+    std::fill(buffer, buffer + g_block_size, 0xA5);
+    int written(0);
+    backend->write_block(
+              5 * g_block_size
+            , buffer
+            , [&written](int result, prinbee::data_t)
+            {
+                written = result;
+            });
+    backend->wait_all();
+    CATCH_REQUIRE(written == static_cast<int>(g_block_size));
+    backend->release_buffer(buffer);
+
+    int value(0);
+    backend->read_block(
+              5 * g_block_size
+            , [&value, backend](int, prinbee::data_t b)
+            {
+                value = b[100];
+                backend->release_buffer(b);
+            });
+    CATCH_REQUIRE(backend->submit() == 1);
+    CATCH_REQUIRE(backend->wait() == 1);
+    CATCH_REQUIRE(value == 0xA5);
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("buffer_pool", "[storage_backend][valid]")
+{
+    CATCH_START_SECTION("buffer_pool: acquire and release buffers")
+    {
+        prinbee::buffer_pool pool(g_block_size, 3);
+        CATCH_REQUIRE(pool.get_buffer_size() == g_block_size);
+        CATCH_REQUIRE(pool.get_count() == 3);
+        CATCH_REQUIRE(pool.get_memory_size() == g_block_size * 3);
+
+        prinbee::data_t a(pool.acquire());
+        prinbee::data_t b(pool.acquire());
+        prinbee::data_t c(pool.acquire());
+        CATCH_REQUIRE(a == pool.get_memory());
+        CATCH_REQUIRE(b == a + g_block_size);
+        CATCH_REQUIRE(c == b + g_block_size);
+        CATCH_REQUIRE(pool.get_available() == 0);
+        CATCH_REQUIRE_THROWS_AS(pool.acquire(), prinbee::full);
+
+        pool.release(b);
+        CATCH_REQUIRE(pool.get_available() == 1);
+        CATCH_REQUIRE(pool.acquire() == b);
+
+        CATCH_REQUIRE_THROWS_AS(pool.release(a + 1), prinbee::logic_error);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("storage_backend", "[storage_backend][valid]")
+{
+    CATCH_START_SECTION("storage_backend: synchronous backend")
+    {
+        std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/sync_backend.data");
+        int const fd(create_file(filename));
+        {
+            prinbee::storage_backend::pointer_t backend(std::make_shared<prinbee::sync_backend>(fd, g_block_size, g_block_count));
+            CATCH_REQUIRE(backend->get_type() == prinbee::backend_t::BACKEND_SYNC);
+            verify_backend(backend);
+        }
+        close(fd);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("storage_backend: io_uring backend")
+    {
+        if(prinbee::io_uring_backend::is_available())
+        {
+            std::string const filename(SNAP_CATCH2_NAMESPACE::g_tmp_dir() + "/io_uring_backend.data");
+            int const fd(create_file(filename));
+            {
+                prinbee::storage_backend::pointer_t backend(std::make_shared<prinbee::io_uring_backend>(fd, g_block_size, g_block_count));
+                CATCH_REQUIRE(backend->get_type() == prinbee::backend_t::BACKEND_IO_URING);
+                verify_backend(backend);
+            }
+            close(fd);
+        }
+        else
+        {
+            std::cerr << "warning: io_uring is not available on this system, test skipped.\n";
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+// vim: ts=4 sw=4 et
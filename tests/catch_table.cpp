@@ -0,0 +1,1411 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// self
+//
+#include    "catch_main.h"
+
+
+// prinbee
+//
+#include    <prinbee/exception.h>
+#include    <prinbee/block/block_entry_index.h>
+#include    <prinbee/block/block_free_space.h>
+#include    <prinbee/block/block_top_index.h>
+#include    <prinbee/database/context.h>
+#include    <prinbee/database/cursor.h>
+#include    <prinbee/database/reaper.h>
+#include    <prinbee/database/row.h>
+#include    <prinbee/database/table.h>
+#include    <prinbee/file/file_table.h>
+
+
+// snapdev
+//
+#include    <snapdev/chownnm.h>
+#include    <snapdev/mkdir_p.h>
+#include    <snapdev/pathinfo.h>
+#include    <snapdev/timespec_ex.h>
+
+
+// C++
+//
+#include    <algorithm>
+#include    <atomic>
+#include    <cstring>
+#include    <functional>
+#include    <map>
+#include    <set>
+#include    <thread>
+
+
+// C
+//
+#include    <fcntl.h>
+#include    <unistd.h>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+typedef std::function<void(prinbee::schema_table::pointer_t schema)>    define_columns_t;
+
+
+/** \brief Create a context with one table.
+ *
+ * The table gets a "_oid", a "_created_on" and a "key" column. The
+ * "key" column is the primary key. The \p define callback can add
+ * more columns.
+ *
+ * The context is returned in \p c since the table does not keep it
+ * alive.
+ */
+prinbee::table::pointer_t create_table(
+      std::string const & context_name
+    , std::string const & table_name
+    , prinbee::context::pointer_t & c
+    , define_columns_t define = define_columns_t())
+{
+    std::string const table_dir(snapdev::pathinfo::canonicalize(
+              prinbee::get_contexts_root_path()
+            , context_name + "/tables/" + table_name));
+    CATCH_REQUIRE(snapdev::mkdir_p(table_dir) == 0);
+
+    prinbee::schema_table::pointer_t schema(std::make_shared<prinbee::schema_table>());
+    schema->set_name(table_name);
+    schema->set_schema_version(1);
+    schema->add_column("_oid", prinbee::struct_type_t::STRUCT_TYPE_OID);
+    schema->add_column("_created_on", prinbee::struct_type_t::STRUCT_TYPE_USTIME);
+    prinbee::schema_column::pointer_t key(schema->add_column("key", prinbee::struct_type_t::STRUCT_TYPE_P8STRING));
+    schema->set_primary_key({ key->get_column_id() });
+    if(define)
+    {
+        define(schema);
+    }
+    schema->to_binary()->save_file(table_dir + "/table-1.pb");
+
+    prinbee::context_setup setup(context_name);
+    setup.set_user(snapdev::get_user_name());
+    setup.set_group(snapdev::get_group_name());
+    c = prinbee::context::create_context(setup);
+    c->initialize();
+
+    prinbee::table::pointer_t t(c->get_table(table_name));
+    CATCH_REQUIRE(t != nullptr);
+    return t;
+}
+
+
+prinbee::row::pointer_t insert_row(prinbee::table::pointer_t t, std::string const & key, std::uint32_t score)
+{
+    prinbee::row::pointer_t r(t->row_new());
+    r->get_cell("key", true)->set_string(key);
+    r->get_cell("score", true)->set_uint32(score);
+    CATCH_REQUIRE(t->row_insert(r));
+    return r;
+}
+
+
+void add_score_column(prinbee::schema_table::pointer_t schema)
+{
+    schema->add_column("score", prinbee::struct_type_t::STRUCT_TYPE_UINT32);
+}
+
+
+void add_score_index(prinbee::table::pointer_t t)
+{
+    prinbee::schema_table::pointer_t schema(t->get_schema());
+    prinbee::schema_secondary_index::pointer_t index(std::make_shared<prinbee::schema_secondary_index>(schema));
+    index->set_name("by_score");
+    index->set_id(1);
+    prinbee::schema_sort_column::pointer_t sc(std::make_shared<prinbee::schema_sort_column>(schema));
+    sc->set_column_id(schema->get_column("score")->get_column_id());
+    index->add_sort_column(sc);
+    schema->add_secondary_index(index);
+}
+
+
+void add_expiration_column(prinbee::schema_table::pointer_t schema)
+{
+    schema->add_column("expiration_date", prinbee::struct_type_t::STRUCT_TYPE_USTIME);
+}
+
+
+prinbee::row::pointer_t insert_expiring_row(prinbee::table::pointer_t t, std::string const & key, std::uint64_t expiration_date)
+{
+    prinbee::row::pointer_t r(t->row_new());
+    r->get_cell("key", true)->set_string(key);
+    if(expiration_date != 0)
+    {
+        r->get_cell("expiration_date", true)->set_time_us(expiration_date);
+    }
+    CATCH_REQUIRE(t->row_insert(r));
+    return r;
+}
+
+
+prinbee::row::pointer_t get_row(prinbee::table::pointer_t t, std::string const & key)
+{
+    prinbee::row::pointer_t k(t->row_new());
+    k->get_cell("key", true)->set_string(key);
+    prinbee::conditions cond;
+    cond.set_key("_primary", k, prinbee::row::pointer_t());
+    return t->row_select(cond)->next_row();
+}
+
+
+std::vector<std::string> scan_keys(prinbee::table::pointer_t t, std::string const & index_name, bool reverse = false)
+{
+    prinbee::conditions cond;
+    cond.set_key(index_name, prinbee::row::pointer_t(), prinbee::row::pointer_t());
+    cond.set_count(2);
+    cond.set_reverse(reverse);
+    prinbee::cursor::pointer_t cur(t->row_select(cond));
+
+    std::vector<std::string> keys;
+    for(;;)
+    {
+        prinbee::row::pointer_t r(cur->next_row());
+        if(r == nullptr)
+        {
+            return keys;
+        }
+        keys.push_back(r->get_cell("key", false)->get_string());
+    }
+}
+
+
+/** \brief Read the OIDs of the rows in OID order.
+ *
+ * The cursor reads \p count rows at a time so the scan has to resume
+ * where it stopped each time the cursor needs more rows.
+ */
+std::vector<prinbee::oid_t> scan_oids(
+      prinbee::table::pointer_t t
+    , bool reverse
+    , prinbee::count_t count
+    , prinbee::count_t offset = 0
+    , prinbee::count_t limit = prinbee::CURSOR_NO_LIMIT)
+{
+    prinbee::conditions cond;
+    cond.set_key("_indirect", prinbee::row::pointer_t(), prinbee::row::pointer_t());
+    cond.set_count(count);
+    cond.set_offset(offset);
+    cond.set_limit(limit);
+    cond.set_reverse(reverse);
+    prinbee::cursor::pointer_t cur(t->row_select(cond));
+
+    std::vector<prinbee::oid_t> oids;
+    for(;;)
+    {
+        prinbee::row::pointer_t r(cur->next_row());
+        if(r == nullptr)
+        {
+            return oids;
+        }
+        oids.push_back(r->get_cell("_oid", false)->get_oid());
+    }
+}
+
+
+void add_payload_column(prinbee::schema_table::pointer_t schema)
+{
+    schema->add_column("payload", prinbee::struct_type_t::STRUCT_TYPE_P16STRING);
+}
+
+
+/** \brief Insert a row too large for the `SLOT` blocks.
+ *
+ * The payload is large enough for the row to be saved in a `DATA`
+ * block, which is what the compactor works on.
+ */
+prinbee::row::pointer_t insert_large_row(prinbee::table::pointer_t t, std::string const & key)
+{
+    prinbee::row::pointer_t r(t->row_new());
+    r->get_cell("key", true)->set_string(key);
+    r->get_cell("payload", true)->set_string(std::string(1500, key.back()));
+    CATCH_REQUIRE(t->row_insert(r));
+    return r;
+}
+
+
+void set_tree_model(prinbee::schema_table::pointer_t schema)
+{
+    schema->set_model(prinbee::model_t::TABLE_MODEL_TREE);
+}
+
+
+prinbee::row::pointer_t insert_path(prinbee::table::pointer_t t, std::string const & path)
+{
+    prinbee::row::pointer_t r(t->row_new());
+    r->get_cell("key", true)->set_string(path);
+    CATCH_REQUIRE(t->row_insert(r));
+    return r;
+}
+
+
+std::vector<std::string> scan_tree(
+      prinbee::table::pointer_t t
+    , std::string const & path
+    , prinbee::tree_mode_t mode = prinbee::tree_mode_t::TREE_MODE_CHILDREN
+    , bool reverse = false)
+{
+    prinbee::row::pointer_t k;
+    if(!path.empty())
+    {
+        k = t->row_new();
+        k->get_cell("key", true)->set_string(path);
+    }
+    prinbee::conditions cond;
+    cond.set_key("_tree", k, prinbee::row::pointer_t());
+    cond.set_tree_mode(mode);
+    cond.set_reverse(reverse);
+    cond.set_count(2);
+    prinbee::cursor::pointer_t cur(t->row_select(cond));
+
+    std::vector<std::string> paths;
+    for(;;)
+    {
+        prinbee::row::pointer_t r(cur->next_row());
+        if(r == nullptr)
+        {
+            return paths;
+        }
+        paths.push_back(r->get_cell("key", false)->get_string());
+    }
+}
+
+
+std::uint64_t now_us()
+{
+    snapdev::timespec_ex const now(snapdev::now());
+    return now.tv_sec * 1'000'000 + now.tv_nsec / 1'000;
+}
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("table_row", "[table][row]")
+{
+    CATCH_START_SECTION("table_row: cells are saved in the row")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table(
+                  "row_context"
+                , "wide"
+                , c
+                , [](prinbee::schema_table::pointer_t schema)
+                {
+                    for(int idx(0); idx < 70; ++idx)
+                    {
+                        schema->add_column("c" + std::to_string(idx), prinbee::struct_type_t::STRUCT_TYPE_UINT32);
+                    }
+                }));
+
+        prinbee::cell::pointer_t kept;
+        prinbee::buffer_t blob;
+        std::size_t base(0);
+        {
+            prinbee::row::pointer_t r(t->row_new());
+            base = r->cells().size();
+            r->get_cell("key", true)->set_string("wide row");
+            for(int idx(0); idx < 70; idx += 3)
+            {
+                r->get_cell("c" + std::to_string(idx), true)->set_uint32(idx * 100);
+            }
+            CATCH_REQUIRE(r->get_cell("c1", false) == nullptr);
+            CATCH_REQUIRE(r->get_cell("c3", false) == r->get_cell("c3", true));
+            CATCH_REQUIRE(r->cells().size() == base + 1 + 24);
+
+            r->delete_cell("c3");
+            CATCH_REQUIRE(r->get_cell("c3", false) == nullptr);
+            CATCH_REQUIRE(r->cells().size() == base + 1 + 23);
+
+            // a column added once the row exists is supported too
+            //
+            t->get_schema()->add_column("late", prinbee::struct_type_t::STRUCT_TYPE_P8STRING);
+            r->get_cell("late", true)->set_string("added later");
+
+            // the cell keeps the row alive
+            //
+            kept = r->get_cell("c69", false);
+            blob = r->to_binary();
+        }
+        CATCH_REQUIRE(kept->get_uint32() == 6900);
+
+        prinbee::row::pointer_t copy(t->row_new());
+        copy->from_binary(blob);
+        CATCH_REQUIRE(copy->get_cell("key", false)->get_string() == "wide row");
+        CATCH_REQUIRE(copy->get_cell("c3", false) == nullptr);
+        CATCH_REQUIRE(copy->get_cell("c66", false)->get_uint32() == 6600);
+        CATCH_REQUIRE(copy->get_cell("late", false)->get_string() == "added later");
+
+        prinbee::cell::map_t const cells(copy->cells());
+        CATCH_REQUIRE(cells.size() == base + 1 + 23 + 1);
+        prinbee::column_id_t previous(0);
+        for(auto const & it : cells)
+        {
+            CATCH_REQUIRE(it.first > previous);
+            CATCH_REQUIRE(it.second->schema()->get_column_id() == it.first);
+            previous = it.first;
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("table_row: the column directory lets a projection skip the other cells")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table(
+                  "projection_context"
+                , "wide"
+                , c
+                , [](prinbee::schema_table::pointer_t schema)
+                {
+                    for(int idx(0); idx < 30; ++idx)
+                    {
+                        schema->add_column("c" + std::to_string(idx), prinbee::struct_type_t::STRUCT_TYPE_P16STRING);
+                    }
+                }));
+        prinbee::column_id_t const c7(t->get_column("c7")->get_column_id());
+        prinbee::column_id_t const c21(t->get_column("c21")->get_column_id());
+
+        prinbee::row::pointer_t r(t->row_new());
+        r->get_cell("key", true)->set_string("wide");
+        for(int idx(0); idx < 30; ++idx)
+        {
+            r->get_cell("c" + std::to_string(idx), true)->set_string(std::string(idx * 3, 'a' + idx % 26));
+        }
+        prinbee::buffer_t const blob(r->to_binary());
+        std::size_t pos(0);
+        CATCH_REQUIRE(prinbee::read_be_uint32(blob, pos) == (t->get_schema_version() | 0x80000000));
+        CATCH_REQUIRE(prinbee::read_be_uint16(blob, pos) == r->cells().size());
+
+        prinbee::row::pointer_t full(t->row_new());
+        full->from_binary(blob);
+        CATCH_REQUIRE(full->to_binary() == blob);
+
+        prinbee::row::pointer_t partial(std::make_shared<prinbee::row>(t));
+        partial->from_binary(blob, { c7, c21 });
+        prinbee::cell::map_t const cells(partial->cells());
+        CATCH_REQUIRE(cells.size() == 2);
+        CATCH_REQUIRE(cells.at(c7)->get_string() == std::string(21, 'h'));
+        CATCH_REQUIRE(cells.at(c21)->get_string() == std::string(63, 'v'));
+
+        // rows saved before the directory existed are still supported
+        //
+        prinbee::buffer_t legacy;
+        prinbee::push_be_uint32(legacy, t->get_schema_version());
+        r->get_cell("key", false)->column_id_to_binary(legacy);
+        r->get_cell("key", false)->value_to_binary(legacy);
+        r->get_cell("c21", false)->column_id_to_binary(legacy);
+        r->get_cell("c21", false)->value_to_binary(legacy);
+        r->get_cell("c7", false)->column_id_to_binary(legacy);
+        r->get_cell("c7", false)->value_to_binary(legacy);
+        legacy.resize(legacy.size() + 5);   // padding
+        partial = std::make_shared<prinbee::row>(t);
+        partial->from_binary(legacy, { c7 });
+        CATCH_REQUIRE(partial->cells().size() == 1);
+        CATCH_REQUIRE(partial->get_cell(c7, false)->get_string() == std::string(21, 'h'));
+        partial = std::make_shared<prinbee::row>(t);
+        partial->from_binary(legacy);
+        CATCH_REQUIRE(partial->cells().size() == 3);
+        CATCH_REQUIRE(partial->get_cell("key", false)->get_string() == "wide");
+
+        // the cursor decodes only the columns named in the conditions
+        //
+        CATCH_REQUIRE(t->row_insert(r));
+        prinbee::conditions cond;
+        cond.set_key("_indirect", prinbee::row::pointer_t(), prinbee::row::pointer_t());
+        cond.set_columns({ "c21", "key" });
+        prinbee::cursor::pointer_t cur(t->row_select(cond));
+        prinbee::row::pointer_t found(cur->next_row());
+        CATCH_REQUIRE(found != nullptr);
+        CATCH_REQUIRE(found->cells().size() == 2);
+        CATCH_REQUIRE(found->get_cell("key", false)->get_string() == "wide");
+        CATCH_REQUIRE(found->get_cell("c21", false)->get_string() == std::string(63, 'v'));
+        CATCH_REQUIRE(found->get_cell("c7", false) == nullptr);
+        CATCH_REQUIRE(cur->next_row() == nullptr);
+
+        cond.set_columns({ "unknown" });
+        cur = t->row_select(cond);
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cur->next_row()
+                , prinbee::column_not_found
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: column \"unknown\" selected in the conditions does not exist in table \"wide\"."));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("table_row: read-only cursors return views of the rows")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("row_view_context", "scores", c, add_score_column));
+        add_score_index(t);
+
+        std::size_t const count(20);
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            insert_row(t, "key" + std::to_string(idx), static_cast<std::uint32_t>(count - idx));
+        }
+
+        prinbee::conditions cond;
+        cond.set_key("_indirect", prinbee::row::pointer_t(), prinbee::row::pointer_t());
+        cond.set_count(3);
+        cond.set_read_only();
+        prinbee::cursor::pointer_t cur(t->row_select(cond));
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cur->next_row()
+                , prinbee::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: cursor::next_row() and cursor::previous_row() are not available on read-only cursors."));
+
+        std::size_t idx(0);
+        for(;; ++idx)
+        {
+            prinbee::row_view::pointer_t view(cur->next_view());
+            if(view == nullptr)
+            {
+                break;
+            }
+            CATCH_REQUIRE(view->get_schema_version() == t->get_schema_version());
+
+            // only access the score first, then the key
+            //
+            CATCH_REQUIRE(view->get_cell("score")->get_uint32() == count - idx);
+            CATCH_REQUIRE(view->get_cell("key")->get_string() == "key" + std::to_string(idx));
+            CATCH_REQUIRE(view->get_cell("score") == view->get_cell("score"));
+
+            // the blob in the block may be followed by padding
+            //
+            prinbee::row::pointer_t r(view->to_row());
+            prinbee::buffer_t const blob(r->to_binary());
+            CATCH_REQUIRE(blob.size() <= view->size());
+            CATCH_REQUIRE(memcmp(blob.data(), view->data(), blob.size()) == 0);
+            prinbee::cell::map_t const cells(view->cells());
+            CATCH_REQUIRE(cells.size() == r->cells().size());
+            for(auto const & it : cells)
+            {
+                CATCH_REQUIRE(it.second->schema()->get_column_id() == it.first);
+            }
+        }
+        CATCH_REQUIRE(idx == count);
+
+        // a secondary index can also return views
+        //
+        prinbee::conditions secondary;
+        secondary.set_key("by_score", prinbee::row::pointer_t(), prinbee::row::pointer_t());
+        secondary.set_count(6);
+        secondary.set_read_only();
+        cur = t->row_select(secondary);
+        for(std::uint32_t score(1); score <= count; ++score)
+        {
+            prinbee::row_view::pointer_t view(cur->next_view());
+            CATCH_REQUIRE(view != nullptr);
+            CATCH_REQUIRE(view->get_cell("score")->get_uint32() == score);
+        }
+        CATCH_REQUIRE(cur->next_view() == nullptr);
+
+        // a cursor which is not read-only does not return views
+        //
+        prinbee::conditions full;
+        full.set_key("_indirect", prinbee::row::pointer_t(), prinbee::row::pointer_t());
+        cur = t->row_select(full);
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  cur->next_view()
+                , prinbee::logic_error
+                , Catch::Matchers::ExceptionMessage(
+                          "logic_error: cursor::next_view() and cursor::previous_view() are only available on read-only cursors."));
+        CATCH_REQUIRE(cur->next_row()->get_cell("key", false)->get_string() == "key0");
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("table_secondary_index", "[table][index]")
+{
+    CATCH_START_SECTION("table_secondary_index: every insert path updates the secondary index")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("secondary_context", "scores", c, add_score_column));
+        add_score_index(t);
+
+        // the first rows go through the index tree, the following ones
+        // through the EIDX fast path of row_insert()
+        //
+        std::size_t const count(50);
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            insert_row(t, "key" + std::to_string(idx), static_cast<std::uint32_t>((idx * 37) % count));
+        }
+
+        prinbee::conditions cond;
+        cond.set_key("by_score", prinbee::row::pointer_t(), prinbee::row::pointer_t());
+        cond.set_count(7);
+        prinbee::cursor::pointer_t cur(t->row_select(cond));
+
+        std::set<std::string> keys;
+        std::uint32_t expected_score(0);
+        for(;;)
+        {
+            prinbee::row::pointer_t r(cur->next_row());
+            if(r == nullptr)
+            {
+                break;
+            }
+            CATCH_REQUIRE(r->get_cell("score", false)->get_uint32() == expected_score);
+            ++expected_score;
+            keys.insert(r->get_cell("key", false)->get_string());
+        }
+        CATCH_REQUIRE(keys.size() == count);
+        CATCH_REQUIRE(expected_score == count);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("table_secondary_index: an index added to an existing table gets bulk loaded")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("late_index_context", "scores", c, add_score_column));
+
+        std::size_t const count(400);
+        std::vector<std::string> expected(count);
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            std::uint32_t const score((idx * 37) % count);
+            insert_row(t, "key" + std::to_string(idx), score);
+            expected[score] = "key" + std::to_string(idx);
+        }
+
+        // the primary index is not empty so it can't be bulk loaded
+        //
+        CATCH_REQUIRE_THROWS_AS(t->build_primary_index(t->create_primary_index_builder()), prinbee::logic_error);
+        CATCH_REQUIRE(get_row(t, "key7") != nullptr);
+
+        add_score_index(t);
+        CATCH_REQUIRE_THROWS_AS(t->build_secondary_index("unknown"), prinbee::invalid_name);
+        CATCH_REQUIRE(t->build_secondary_index("by_score") == count);
+        CATCH_REQUIRE(scan_keys(t, "by_score") == expected);
+        CATCH_REQUIRE_THROWS_AS(t->build_secondary_index("by_score"), prinbee::logic_error);
+
+        // new rows get added to the bulk loaded index
+        //
+        insert_row(t, "late", count);
+        expected.push_back("late");
+        CATCH_REQUIRE(scan_keys(t, "by_score") == expected);
+        std::vector<std::string> const reversed(expected.rbegin(), expected.rend());
+        CATCH_REQUIRE(scan_keys(t, "by_score", true) == reversed);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("table_indirect", "[table][index]")
+{
+    CATCH_START_SECTION("table_indirect: rows are scanned by OID in both directions")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("indirect_context", "rows", c, add_score_column));
+
+        // enough rows for several batches and `INDR` blocks
+        //
+        std::size_t const count(1200);
+        std::vector<prinbee::oid_t> expected;
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            prinbee::row::pointer_t r(insert_row(t, "row" + std::to_string(idx), idx));
+            expected.push_back(r->get_cell("_oid", false)->get_oid());
+        }
+        CATCH_REQUIRE(std::is_sorted(expected.begin(), expected.end()));
+
+        // the OIDs of deleted rows are skipped
+        //
+        std::vector<prinbee::oid_t> kept;
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            if(idx % 5 == 2)
+            {
+                CATCH_REQUIRE(t->row_delete(expected[idx]));
+            }
+            else
+            {
+                kept.push_back(expected[idx]);
+            }
+        }
+        std::vector<prinbee::oid_t> const reversed(kept.rbegin(), kept.rend());
+
+        // one row at a time, a few rows at a time, or a whole batch
+        //
+        for(prinbee::count_t const n : { 1, 7, 256, 1000 })
+        {
+            CATCH_REQUIRE(scan_oids(t, false, n) == kept);
+            CATCH_REQUIRE(scan_oids(t, true, n) == reversed);
+        }
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("table_indirect: the offset and limit are applied across resumed reads")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("indirect_offset_context", "rows", c, add_score_column));
+
+        std::size_t const count(800);
+        std::vector<prinbee::oid_t> kept;
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            prinbee::row::pointer_t r(insert_row(t, "row" + std::to_string(idx), idx));
+            prinbee::oid_t const oid(r->get_cell("_oid", false)->get_oid());
+            if(idx % 3 == 0)
+            {
+                CATCH_REQUIRE(t->row_delete(oid));
+            }
+            else
+            {
+                kept.push_back(oid);
+            }
+        }
+        std::vector<prinbee::oid_t> const reversed(kept.rbegin(), kept.rend());
+
+        for(prinbee::count_t const n : { 1, 13, 300 })
+        {
+            // the offset alone
+            //
+            CATCH_REQUIRE(scan_oids(t, false, n, 100) == std::vector<prinbee::oid_t>(kept.begin() + 100, kept.end()));
+            CATCH_REQUIRE(scan_oids(t, true, n, 100) == std::vector<prinbee::oid_t>(reversed.begin() + 100, reversed.end()));
+
+            // the limit alone
+            //
+            CATCH_REQUIRE(scan_oids(t, false, n, 0, 270) == std::vector<prinbee::oid_t>(kept.begin(), kept.begin() + 270));
+            CATCH_REQUIRE(scan_oids(t, true, n, 0, 270) == std::vector<prinbee::oid_t>(reversed.begin(), reversed.begin() + 270));
+
+            // both, the limit counts the rows returned, not the skipped ones
+            //
+            CATCH_REQUIRE(scan_oids(t, false, n, 250, 270) == std::vector<prinbee::oid_t>(kept.begin() + 250, kept.begin() + 520));
+            CATCH_REQUIRE(scan_oids(t, true, n, 250, 270) == std::vector<prinbee::oid_t>(reversed.begin() + 250, reversed.begin() + 520));
+
+            // an offset past the end returns nothing
+            //
+            CATCH_REQUIRE(scan_oids(t, false, n, kept.size()).empty());
+            CATCH_REQUIRE(scan_oids(t, true, n, kept.size()).empty());
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("table_batch", "[table][batch]")
+{
+    CATCH_START_SECTION("table_batch: commit many rows at once")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("batch_context", "scores", c, add_score_column));
+        add_score_index(t);
+
+        // enough rows to fill more than one `INDR` block
+        //
+        std::size_t const count(1200);
+        prinbee::row::vector_t rows;
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            prinbee::row::pointer_t r(t->row_new());
+            r->get_cell("key", true)->set_string("batch" + std::to_string(idx));
+            r->get_cell("score", true)->set_uint32(idx);
+            rows.push_back(r);
+        }
+        CATCH_REQUIRE(t->commit_batch(rows));
+
+        // the rows got consecutive OIDs in the order of their murmur3 key
+        //
+        std::vector<prinbee::buffer_t> keys(count);
+        for(auto const & r : rows)
+        {
+            prinbee::oid_t const oid(r->get_cell("_oid", false)->get_oid());
+            CATCH_REQUIRE(oid >= 1);
+            CATCH_REQUIRE(oid <= count);
+            CATCH_REQUIRE(keys[oid - 1].empty());
+            r->generate_mumur3(keys[oid - 1]);
+        }
+        CATCH_REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+
+        for(std::size_t idx(0); idx < count; idx += 7)
+        {
+            prinbee::row::pointer_t r(get_row(t, "batch" + std::to_string(idx)));
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE(r->get_cell("score", false)->get_uint32() == idx);
+            CATCH_REQUIRE(r->get_cell("_oid", false)->get_oid() == rows[idx]->get_cell("_oid", false)->get_oid());
+        }
+        CATCH_REQUIRE(scan_keys(t, "_indirect").size() == count);
+        CATCH_REQUIRE(scan_keys(t, "by_score").size() == count);
+
+        // a second batch adds more rows after the existing ones
+        //
+        prinbee::row::vector_t more;
+        for(std::size_t idx(count); idx < count + 10; ++idx)
+        {
+            prinbee::row::pointer_t r(t->row_new());
+            r->get_cell("key", true)->set_string("batch" + std::to_string(idx));
+            r->get_cell("score", true)->set_uint32(idx);
+            more.push_back(r);
+        }
+        CATCH_REQUIRE(t->commit_batch(more));
+        for(auto const & r : more)
+        {
+            CATCH_REQUIRE(r->get_cell("_oid", false)->get_oid() > count);
+        }
+        CATCH_REQUIRE(get_row(t, "batch" + std::to_string(count + 9)) != nullptr);
+        CATCH_REQUIRE(scan_keys(t, "_indirect").size() == count + 10);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("table_compaction", "[table][compaction]")
+{
+    CATCH_START_SECTION("table_compaction: every surviving row can be read after a compaction")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("compaction_context", "blobs", c, add_payload_column));
+
+        std::size_t const count(90);
+        std::map<prinbee::oid_t, std::string> expected;
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            std::string const key("blob" + std::to_string(idx));
+            prinbee::row::pointer_t r(insert_large_row(t, key));
+            if(idx % 3 == 0)
+            {
+                expected[r->get_cell("_oid", false)->get_oid()] = key;
+            }
+        }
+
+        // delete two rows out of three so most `DATA` blocks end up
+        // below the threshold and get their rows moved
+        //
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            if(idx % 3 != 0)
+            {
+                prinbee::row::pointer_t r(get_row(t, "blob" + std::to_string(idx)));
+                CATCH_REQUIRE(r != nullptr);
+                CATCH_REQUIRE(t->row_delete(r->get_cell("_oid", false)->get_oid()));
+            }
+        }
+
+        prinbee::compaction_statistics_t const stats(t->compact(50, 0));
+        CATCH_REQUIRE(stats.f_blocks_scanned > 0);
+        CATCH_REQUIRE(stats.f_rows_moved > 0);
+        CATCH_REQUIRE(stats.f_blocks_freed > 0);
+
+        for(auto const & e : expected)
+        {
+            prinbee::row::pointer_t r(get_row(t, e.second));
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE(r->get_cell("_oid", false)->get_oid() == e.first);
+            CATCH_REQUIRE(r->get_cell("payload", false)->get_string() == std::string(1500, e.second.back()));
+        }
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            if(idx % 3 != 0)
+            {
+                CATCH_REQUIRE(get_row(t, "blob" + std::to_string(idx)) == nullptr);
+            }
+        }
+
+        // the indirect index returns the rows in OID order
+        //
+        std::vector<std::string> keys;
+        for(auto const & e : expected)
+        {
+            keys.push_back(e.second);
+        }
+        CATCH_REQUIRE(scan_keys(t, "_indirect") == keys);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("table_compaction: released spaces merge with their free neighbors")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("free_space_context", "spaces", c));
+
+        // make sure the file exists
+        //
+        prinbee::row::pointer_t first(t->row_new());
+        first->get_cell("key", true)->set_string("first");
+        CATCH_REQUIRE(t->row_insert(first));
+
+        prinbee::block_free_space::pointer_t fspc(std::static_pointer_cast<prinbee::block_free_space>(
+                        t->allocate_new_block(prinbee::dbtype_t::BLOCK_TYPE_FREE_SPACE)));
+
+        // three spaces one after the other in a new `DATA` block
+        //
+        prinbee::free_space_t const a(fspc->get_free_space(1000));
+        prinbee::free_space_t const b(fspc->get_free_space(1000));
+        prinbee::free_space_t const d(fspc->get_free_space(1000));
+        prinbee::reference_t const data_block(a.f_block->get_offset());
+        CATCH_REQUIRE(data_block % t->get_page_size() == 0);
+        CATCH_REQUIRE(a.f_reference - data_block < t->get_page_size());
+        CATCH_REQUIRE(b.f_reference == a.f_reference + a.f_size);
+        CATCH_REQUIRE(d.f_reference == b.f_reference + b.f_size);
+        CATCH_REQUIRE(fspc->get_empty_data_block() == prinbee::NULL_FILE_ADDR);
+
+        // the middle one has no free neighbor
+        //
+        fspc->release_space(b.f_reference);
+        CATCH_REQUIRE(fspc->get_empty_data_block() == prinbee::NULL_FILE_ADDR);
+
+        // the first one merges with the middle one
+        //
+        fspc->release_space(a.f_reference);
+        CATCH_REQUIRE(fspc->get_empty_data_block() == prinbee::NULL_FILE_ADDR);
+
+        // the last one merges with both, the one before and the free
+        // space at the end of the block, so the block is empty again
+        //
+        fspc->release_space(d.f_reference);
+        CATCH_REQUIRE(fspc->get_empty_data_block() == data_block);
+
+        // and the merged space is large enough for all three at once
+        //
+        prinbee::free_space_t const all(fspc->get_free_space(a.f_size + b.f_size + d.f_size));
+        CATCH_REQUIRE(all.f_reference == a.f_reference);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("table_compaction: readers run while rows get added and compacted")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("readers_context", "shared", c, add_payload_column));
+
+        std::size_t const count(30);
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            insert_large_row(t, "shared" + std::to_string(idx));
+        }
+
+        std::atomic<bool> done(false);
+        std::atomic<std::size_t> errors(0);
+        std::vector<std::thread> readers;
+        for(int id(0); id < 4; ++id)
+        {
+            readers.emplace_back([&t, &done, &errors, count]()
+                {
+                    while(!done)
+                    {
+                        for(std::size_t idx(0); idx < count; idx += 2)
+                        {
+                            std::string const key("shared" + std::to_string(idx));
+                            prinbee::row::pointer_t r(get_row(t, key));
+                            if(r == nullptr
+                            || r->get_cell("payload", false)->get_string() != std::string(1500, key.back()))
+                            {
+                                ++errors;
+                            }
+                        }
+                    }
+                });
+        }
+
+        // the odd rows get replaced while the readers look at the
+        // even rows
+        //
+        for(int repeat(0); repeat < 3; ++repeat)
+        {
+            for(std::size_t idx(1); idx < count; idx += 2)
+            {
+                std::string const key("shared" + std::to_string(idx));
+                prinbee::row::pointer_t r(get_row(t, key));
+                if(r != nullptr)
+                {
+                    CATCH_REQUIRE(t->row_delete(r->get_cell("_oid", false)->get_oid()));
+                }
+                if(repeat != 2)
+                {
+                    insert_large_row(t, key);
+                }
+            }
+            t->compact(50, 0);
+        }
+
+        done = true;
+        for(auto & r : readers)
+        {
+            r.join();
+        }
+        CATCH_REQUIRE(errors == 0);
+        CATCH_REQUIRE(scan_keys(t, "_indirect").size() == count / 2);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("table_file", "[table][file]")
+{
+    CATCH_START_SECTION("table_file: the high-water mark of a version 0.1 header is ignored")
+    {
+        std::string const filename(snapdev::pathinfo::canonicalize(
+                  prinbee::get_contexts_root_path()
+                , "hwm_context/tables/words/main.snapdb"));
+        std::size_t const count(50);
+        {
+            prinbee::context::pointer_t c;
+            prinbee::table::pointer_t t(create_table("hwm_context", "words", c));
+            for(std::size_t idx(0); idx < count; ++idx)
+            {
+                insert_path(t, "old" + std::to_string(idx));
+            }
+        }
+
+        // the high-water mark was the last field of version 0.2 of the
+        // 'PTBL' structure:
+        //   magic, version, file_version, block_size, 17 references/OIDs,
+        //   bloom_filter_flags, high_water_mark
+        //
+        constexpr off_t const version_offset(4);
+        constexpr off_t const high_water_mark_offset(4 * 4 + 17 * 8 + 4);
+        int fd(open(filename.c_str(), O_RDWR | O_CLOEXEC));
+        CATCH_REQUIRE(fd != -1);
+        std::uint32_t version(0);
+        CATCH_REQUIRE(pread(fd, &version, sizeof(version), version_offset) == sizeof(version));
+        CATCH_REQUIRE(version == prinbee::version_t(0, 3).to_binary());
+        prinbee::reference_t high_water_mark(0);
+        CATCH_REQUIRE(pread(fd, &high_water_mark, sizeof(high_water_mark), high_water_mark_offset) == sizeof(high_water_mark));
+        std::size_t const page_size(prinbee::dbfile::get_system_page_size());
+        CATCH_REQUIRE(high_water_mark > page_size);
+        CATCH_REQUIRE(high_water_mark % page_size == 0);
+
+        // make it look like a file created by version 0.1 with garbage
+        // where the high-water mark now lives; that garbage points to
+        // pages in use and must not be used to preallocate pages
+        //
+        version = prinbee::version_t(0, 1).to_binary();
+        CATCH_REQUIRE(pwrite(fd, &version, sizeof(version), version_offset) == sizeof(version));
+        high_water_mark = page_size;
+        CATCH_REQUIRE(pwrite(fd, &high_water_mark, sizeof(high_water_mark), high_water_mark_offset) == sizeof(high_water_mark));
+        close(fd);
+
+        std::size_t const more(1000);
+        {
+            prinbee::context_setup setup("hwm_context");
+            setup.set_user(snapdev::get_user_name());
+            setup.set_group(snapdev::get_group_name());
+            prinbee::context::pointer_t c(prinbee::context::create_context(setup));
+            c->initialize();
+            prinbee::table::pointer_t t(c->get_table("words"));
+            CATCH_REQUIRE(t != nullptr);
+
+            // enough rows to use all the free blocks and grow the file
+            //
+            for(std::size_t idx(0); idx < more; ++idx)
+            {
+                insert_path(t, "new" + std::to_string(idx) + std::string(100, 'x'));
+            }
+            for(std::size_t idx(0); idx < count; ++idx)
+            {
+                CATCH_REQUIRE(get_row(t, "old" + std::to_string(idx)) != nullptr);
+            }
+            for(std::size_t idx(0); idx < more; idx += 10)
+            {
+                CATCH_REQUIRE(get_row(t, "new" + std::to_string(idx) + std::string(100, 'x')) != nullptr);
+            }
+        }
+
+        // saving the high-water mark upgraded the header
+        //
+        fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        CATCH_REQUIRE(fd != -1);
+        CATCH_REQUIRE(pread(fd, &version, sizeof(version), version_offset) == sizeof(version));
+        CATCH_REQUIRE(version == prinbee::version_t(0, 3).to_binary());
+        CATCH_REQUIRE(pread(fd, &high_water_mark, sizeof(high_water_mark), high_water_mark_offset) == sizeof(high_water_mark));
+        CATCH_REQUIRE(high_water_mark > page_size);
+        close(fd);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("table_file: the index blocks use the layout defined in the schema")
+    {
+        std::size_t const count(300);
+        {
+            prinbee::context::pointer_t c;
+            prinbee::table::pointer_t t(create_table("layout_context", "words", c, [](prinbee::schema_table::pointer_t schema)
+                {
+                    schema->set_index_layout(prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER);
+                }));
+            CATCH_REQUIRE(t->get_schema()->get_index_layout() == prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER);
+            for(std::size_t idx(0); idx < count; ++idx)
+            {
+                insert_path(t, "word" + std::to_string(idx) + std::string(100, 'x'));
+            }
+        }
+
+        prinbee::context_setup setup("layout_context");
+        setup.set_user(snapdev::get_user_name());
+        setup.set_group(snapdev::get_group_name());
+        prinbee::context::pointer_t c(prinbee::context::create_context(setup));
+        c->initialize();
+        prinbee::table::pointer_t t(c->get_table("words"));
+        CATCH_REQUIRE(t != nullptr);
+        CATCH_REQUIRE(t->get_schema()->get_index_layout() == prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER);
+        for(std::size_t idx(0); idx < count; ++idx)
+        {
+            CATCH_REQUIRE(get_row(t, "word" + std::to_string(idx) + std::string(100, 'x')) != nullptr);
+        }
+
+        std::size_t entry_indexes(0);
+        std::size_t const page_size(t->get_page_size());
+        prinbee::file_table::pointer_t header(std::static_pointer_cast<prinbee::file_table>(t->get_block(0)));
+        for(prinbee::reference_t offset(page_size); offset < header->get_high_water_mark(); offset += page_size)
+        {
+            prinbee::block::pointer_t b(t->get_block(offset));
+            switch(b->get_dbtype())
+            {
+            case prinbee::dbtype_t::BLOCK_TYPE_ENTRY_INDEX:
+                ++entry_indexes;
+                CATCH_REQUIRE(std::static_pointer_cast<prinbee::block_entry_index>(b)->get_layout() == prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER);
+                break;
+
+            case prinbee::dbtype_t::BLOCK_TYPE_TOP_INDEX:
+                CATCH_REQUIRE(std::static_pointer_cast<prinbee::block_top_index>(b)->get_layout() == prinbee::index_layout_t::INDEX_LAYOUT_EYTZINGER);
+                break;
+
+            default:
+                break;
+
+            }
+        }
+        CATCH_REQUIRE(entry_indexes > 0);
+    }
+    CATCH_END_SECTION()
+}
+
+
+CATCH_TEST_CASE("table_expiration", "[table][index][expiration]")
+{
+    CATCH_START_SECTION("table_expiration: expired rows are hidden, scanned in order and reaped")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("expiration_context", "sessions", c, add_expiration_column));
+
+        // insert rows which expire in the future in reverse order and
+        // interleave rows which already expired and rows which never expire
+        //
+        std::uint64_t const now(now_us());
+        std::uint64_t const hour(3'600'000'000ULL);
+        std::vector<prinbee::oid_t> future_oids;
+        for(std::size_t idx(0); idx < 5; ++idx)
+        {
+            insert_expiring_row(t, "past" + std::to_string(idx), now - (idx + 1) * 1'000'000);
+            prinbee::row::pointer_t r(insert_expiring_row(t, "future" + std::to_string(4 - idx), now + (5 - idx) * hour));
+            future_oids.push_back(r->get_cell("_oid", false)->get_oid());
+            if(idx < 2)
+            {
+                insert_expiring_row(t, "forever" + std::to_string(idx), 0);
+            }
+        }
+
+        // a GET of an expired row does not find it
+        //
+        CATCH_REQUIRE(get_row(t, "past0") == nullptr);
+        CATCH_REQUIRE(get_row(t, "future0") != nullptr);
+        CATCH_REQUIRE(get_row(t, "forever1") != nullptr);
+
+        // the expiration index returns the live rows sorted by date
+        //
+        std::vector<std::string> const expected({ "future0", "future1", "future2", "future3", "future4" });
+        CATCH_REQUIRE(scan_keys(t, "_expiration") == expected);
+        std::vector<std::string> const reversed(expected.rbegin(), expected.rend());
+        CATCH_REQUIRE(scan_keys(t, "_expiration", true) == reversed);
+        CATCH_REQUIRE(scan_keys(t, "_indirect").size() == 7);
+
+        // the rows which expired are deleted by batch
+        //
+        CATCH_REQUIRE(t->get_next_expiration() == now - 5'000'000);
+        CATCH_REQUIRE(t->expire_rows(now, 2) == 2);
+        CATCH_REQUIRE(t->expire_rows(now, 0) == 3);
+        CATCH_REQUIRE(t->expire_rows(now, 0) == 0);
+        CATCH_REQUIRE(t->get_next_expiration() == now + hour);
+        CATCH_REQUIRE(scan_keys(t, "_indirect").size() == 7);
+
+        // an explicit delete also removes the row from the expiration index
+        //
+        CATCH_REQUIRE(t->row_delete(future_oids[0]));
+        CATCH_REQUIRE_FALSE(t->row_delete(future_oids[0]));
+        CATCH_REQUIRE(get_row(t, "future4") == nullptr);
+        CATCH_REQUIRE(scan_keys(t, "_expiration") == std::vector<std::string>({ "future0", "future1", "future2", "future3" }));
+
+        // the reaper deletes the rows once their date is reached
+        //
+        prinbee::reaper r;
+        r.add_table(t);
+        r.add_table(t);
+        CATCH_REQUIRE(r.get_table_count() == 1);
+        r.set_batch_size(3);
+        r.run_once(now);
+        CATCH_REQUIRE(r.get_statistics().f_rows_deleted == 0);
+
+        std::uint64_t const later(now + 10 * hour);
+        CATCH_REQUIRE(r.run_once(later) <= later + prinbee::DEFAULT_TIMER_WHEEL_TICK);
+        CATCH_REQUIRE(r.get_statistics().f_rows_deleted == 3);
+        r.run_once(later + prinbee::DEFAULT_TIMER_WHEEL_TICK);
+        CATCH_REQUIRE(r.get_statistics().f_rows_deleted == 4);
+        CATCH_REQUIRE(t->get_next_expiration() == 0);
+        CATCH_REQUIRE(scan_keys(t, "_expiration").empty());
+        CATCH_REQUIRE(scan_keys(t, "_indirect") == std::vector<std::string>({ "forever0", "forever1" }));
+
+        CATCH_REQUIRE(r.remove_table(t));
+        CATCH_REQUIRE_FALSE(r.remove_table(t));
+        CATCH_REQUIRE(r.get_table_count() == 0);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("table_tree", "[table][index][tree]")
+{
+    CATCH_START_SECTION("table_tree: list the children and the subtree of a path")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("tree_context", "pages", c, set_tree_model));
+
+        // insert in an order different from the expected order
+        //
+        for(auto const & path : {
+                      "/b"
+                    , "/a"
+                    , "/a-b"
+                    , "/a/z"
+                    , "/a/x"
+                    , "/a/x/2"
+                    , "/a/y"
+                    , "/a/x/1"
+                    , "/b/q"
+                    , "/a-b/w" })
+        {
+            insert_path(t, path);
+        }
+
+        // the tree must be perfect
+        //
+        prinbee::row::pointer_t orphan(t->row_new());
+        orphan->get_cell("key", true)->set_string("/missing/child");
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  t->row_insert(orphan)
+                , prinbee::row_not_found
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: the parent \"/missing\" of \"/missing/child\" does not exist in tree table \"pages\"."));
+
+        CATCH_REQUIRE(scan_tree(t, std::string()) == std::vector<std::string>({ "/a", "/a-b", "/b" }));
+        CATCH_REQUIRE(scan_tree(t, "/") == std::vector<std::string>({ "/a", "/a-b", "/b" }));
+        CATCH_REQUIRE(scan_tree(t, "/a") == std::vector<std::string>({ "/a/x", "/a/y", "/a/z" }));
+        CATCH_REQUIRE(scan_tree(t, "/a/") == std::vector<std::string>({ "/a/x", "/a/y", "/a/z" }));
+        CATCH_REQUIRE(scan_tree(t, "/a", prinbee::tree_mode_t::TREE_MODE_CHILDREN, true) == std::vector<std::string>({ "/a/z", "/a/y", "/a/x" }));
+        CATCH_REQUIRE(scan_tree(t, "/a/y").empty());
+        CATCH_REQUIRE(scan_tree(t, "/nothing").empty());
+
+        CATCH_REQUIRE(scan_tree(t, "/a", prinbee::tree_mode_t::TREE_MODE_SUBTREE)
+                    == std::vector<std::string>({ "/a/x", "/a/x/1", "/a/x/2", "/a/y", "/a/z" }));
+        CATCH_REQUIRE(scan_tree(t, "/", prinbee::tree_mode_t::TREE_MODE_SUBTREE)
+                    == std::vector<std::string>({ "/a", "/a/x", "/a/x/1", "/a/x/2", "/a/y", "/a/z", "/a-b", "/a-b/w", "/b", "/b/q" }));
+        CATCH_REQUIRE(scan_tree(t, "/a", prinbee::tree_mode_t::TREE_MODE_SUBTREE, true)
+                    == std::vector<std::string>({ "/a/z", "/a/y", "/a/x", "/a/x/2", "/a/x/1" }));
+
+        // a deleted node is not listed anymore
+        //
+        CATCH_REQUIRE(t->row_delete(get_row(t, "/a/y")->get_cell("_oid", false)->get_oid()));
+        CATCH_REQUIRE(scan_tree(t, "/a") == std::vector<std::string>({ "/a/x", "/a/z" }));
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("table_tree: children spanning many index blocks")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("tree_context", "directories", c, set_tree_model));
+
+        insert_path(t, "/big");
+        insert_path(t, "/small");
+        std::vector<std::string> expected;
+        for(int idx(0); idx < 300; ++idx)
+        {
+            // interleave the children of both directories
+            //
+            std::string const name(std::to_string(1000 + idx));
+            insert_path(t, "/big/" + name);
+            insert_path(t, "/small/" + name);
+            expected.push_back("/big/" + name);
+        }
+
+        CATCH_REQUIRE(scan_tree(t, "/big") == expected);
+
+        std::vector<std::string> const reversed(expected.rbegin(), expected.rend());
+        CATCH_REQUIRE(scan_tree(t, "/big", prinbee::tree_mode_t::TREE_MODE_CHILDREN, true) == reversed);
+
+        prinbee::conditions cond;
+        prinbee::row::pointer_t k(t->row_new());
+        k->get_cell("key", true)->set_string("/small");
+        cond.set_key("_tree", k, prinbee::row::pointer_t());
+        cond.set_offset(10);
+        cond.set_limit(25);
+        prinbee::cursor::pointer_t cur(t->row_select(cond));
+        for(int idx(0); idx < 25; ++idx)
+        {
+            prinbee::row::pointer_t r(cur->next_row());
+            CATCH_REQUIRE(r != nullptr);
+            CATCH_REQUIRE(r->get_cell("key", false)->get_string() == "/small/" + std::to_string(1010 + idx));
+        }
+        CATCH_REQUIRE(cur->next_row() == nullptr);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("table_tree: removing most children merges the index blocks")
+    {
+        prinbee::context::pointer_t c;
+        prinbee::table::pointer_t t(create_table("tree_context", "folders", c, set_tree_model));
+
+        insert_path(t, "/docs");
+        for(int idx(0); idx < 400; ++idx)
+        {
+            insert_path(t, "/docs/long-shared-document-name-" + std::to_string(1000 + idx));
+        }
+
+        std::vector<std::string> expected;
+        for(int idx(0); idx < 400; ++idx)
+        {
+            std::string const path("/docs/long-shared-document-name-" + std::to_string(1000 + idx));
+            if(idx % 7 == 0)
+            {
+                expected.push_back(path);
+            }
+            else
+            {
+                CATCH_REQUIRE(t->row_delete(get_row(t, path)->get_cell("_oid", false)->get_oid()));
+            }
+        }
+
+        CATCH_REQUIRE(scan_tree(t, "/docs") == expected);
+
+        std::vector<std::string> const reversed(expected.rbegin(), expected.rend());
+        CATCH_REQUIRE(scan_tree(t, "/docs", prinbee::tree_mode_t::TREE_MODE_CHILDREN, true) == reversed);
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("table_bloom_filter", "[table][bloom_filter]")
+{
+    CATCH_START_SECTION("table_bloom_filter: missing keys are not found and the filter survives a restart")
+    {
+        std::string const bloom_filename(snapdev::pathinfo::canonicalize(
+                  prinbee::get_contexts_root_path()
+                , "bloom_context/tables/words/bloom.pbf"));
+        std::size_t const count(300);
+        {
+            prinbee::context::pointer_t c;
+            prinbee::table::pointer_t t(create_table("bloom_context", "words", c));
+            for(std::size_t idx(0); idx < count; ++idx)
+            {
+                prinbee::row::pointer_t r(t->row_new());
+                r->get_cell("key", true)->set_string("word" + std::to_string(idx));
+                CATCH_REQUIRE(t->row_insert(r));
+            }
+            for(std::size_t idx(0); idx < count; ++idx)
+            {
+                CATCH_REQUIRE(get_row(t, "word" + std::to_string(idx)) != nullptr);
+                CATCH_REQUIRE(get_row(t, "missing" + std::to_string(idx)) == nullptr);
+            }
+
+            // delete one row out of three, enough for compact() to
+            // regenerate the filter
+            //
+            for(std::size_t idx(0); idx < count; idx += 3)
+            {
+                prinbee::row::pointer_t r(get_row(t, "word" + std::to_string(idx)));
+                CATCH_REQUIRE(r != nullptr);
+                CATCH_REQUIRE(t->row_delete(r->get_cell("_oid", false)->get_oid()));
+            }
+            t->compact(50, 0);
+            for(std::size_t idx(0); idx < count; ++idx)
+            {
+                CATCH_REQUIRE((get_row(t, "word" + std::to_string(idx)) != nullptr) == (idx % 3 != 0));
+            }
+            CATCH_REQUIRE(access(bloom_filename.c_str(), F_OK) != 0);
+        }
+
+        // the filter was saved on exit
+        //
+        CATCH_REQUIRE(access(bloom_filename.c_str(), F_OK) == 0);
+
+        {
+            prinbee::context_setup setup("bloom_context");
+            setup.set_user(snapdev::get_user_name());
+            setup.set_group(snapdev::get_group_name());
+            prinbee::context::pointer_t c(prinbee::context::create_context(setup));
+            c->initialize();
+            prinbee::table::pointer_t t(c->get_table("words"));
+            CATCH_REQUIRE(t != nullptr);
+
+            for(std::size_t idx(0); idx < count; ++idx)
+            {
+                CATCH_REQUIRE((get_row(t, "word" + std::to_string(idx)) != nullptr) == (idx % 3 != 0));
+                CATCH_REQUIRE(get_row(t, "missing" + std::to_string(idx)) == nullptr);
+            }
+
+            // once loaded, the file is removed until the next exit
+            //
+            CATCH_REQUIRE(access(bloom_filename.c_str(), F_OK) != 0);
+        }
+
+        // an invalid file gets ignored and the filter rebuilt
+        //
+        CATCH_REQUIRE(access(bloom_filename.c_str(), F_OK) == 0);
+        prinbee::virtual_buffer::pointer_t b(std::make_shared<prinbee::virtual_buffer>());
+        b->pwrite("garbage", 7, 0, true);
+        b->save_file(bloom_filename);
+        {
+            prinbee::context_setup setup("bloom_context");
+            setup.set_user(snapdev::get_user_name());
+            setup.set_group(snapdev::get_group_name());
+            prinbee::context::pointer_t c(prinbee::context::create_context(setup));
+            c->initialize();
+            prinbee::table::pointer_t t(c->get_table("words"));
+            CATCH_REQUIRE(t != nullptr);
+
+            for(std::size_t idx(0); idx < count; ++idx)
+            {
+                CATCH_REQUIRE((get_row(t, "word" + std::to_string(idx)) != nullptr) == (idx % 3 != 0));
+            }
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,221 @@
+// Copyright (c) 2019-2025  Made to Order Software Corp.  All Rights Reserved
+//
+// https://snapwebsites.org/project/prinbee
+// contact@m2osw.com
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// self
+//
+#include    "catch_main.h"
+
+
+
+// prinbee
+//
+#include    <prinbee/exception.h>
+#include    <prinbee/database/timer_wheel.h>
+
+
+// C++
+//
+#include    <algorithm>
+
+
+// last include
+//
+#include    <snapdev/poison.h>
+
+
+
+namespace
+{
+
+
+constexpr std::uint64_t const   g_tick = 1'000;
+constexpr std::uint64_t const   g_start = 1'000'000'000;
+
+
+}
+// no name namespace
+
+
+
+CATCH_TEST_CASE("timer_wheel", "[timer_wheel][valid]")
+{
+    CATCH_START_SECTION("timer_wheel: empty wheel")
+    {
+        prinbee::timer_wheel wheel(g_start, g_tick);
+        CATCH_REQUIRE(wheel.get_tick() == g_tick);
+        CATCH_REQUIRE(wheel.get_current_time() == g_start);
+        CATCH_REQUIRE(wheel.empty());
+        CATCH_REQUIRE(wheel.size() == 0);
+        CATCH_REQUIRE(wheel.get_next_wakeup() == prinbee::TIMER_WHEEL_NO_TIMER);
+        CATCH_REQUIRE(wheel.get_deadline(1) == prinbee::TIMER_WHEEL_NO_TIMER);
+        CATCH_REQUIRE_FALSE(wheel.remove(1));
+
+        prinbee::timer_wheel::timer_id_vector_t expired;
+        wheel.advance(g_start + g_tick * 1'000'000, expired);
+        CATCH_REQUIRE(expired.empty());
+        CATCH_REQUIRE(wheel.get_current_time() == g_start + g_tick * 1'000'000);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("timer_wheel: timers expire in order on every level")
+    {
+        prinbee::timer_wheel wheel(g_start, g_tick);
+
+        // one timer per level, plus one beyond the last level
+        //
+        std::vector<std::uint64_t> const distances = {
+            3,
+            prinbee::TIMER_WHEEL_SLOTS + 5,
+            prinbee::TIMER_WHEEL_SLOTS * prinbee::TIMER_WHEEL_SLOTS + 7,
+            prinbee::TIMER_WHEEL_SLOTS * prinbee::TIMER_WHEEL_SLOTS * prinbee::TIMER_WHEEL_SLOTS + 11,
+            prinbee::TIMER_WHEEL_SLOTS * prinbee::TIMER_WHEEL_SLOTS * prinbee::TIMER_WHEEL_SLOTS * prinbee::TIMER_WHEEL_SLOTS + 13,
+        };
+        for(std::size_t idx(0); idx < distances.size(); ++idx)
+        {
+            wheel.add(idx + 1, g_start + distances[idx] * g_tick);
+            CATCH_REQUIRE(wheel.get_deadline(idx + 1) == g_start + distances[idx] * g_tick);
+        }
+        CATCH_REQUIRE(wheel.size() == distances.size());
+
+        for(std::size_t idx(0); idx < distances.size(); ++idx)
+        {
+            std::uint64_t const deadline(g_start + distances[idx] * g_tick);
+            prinbee::timer_wheel::timer_id_vector_t expired;
+
+            // one tick early, nothing happens
+            //
+            wheel.advance(deadline - g_tick, expired);
+            CATCH_REQUIRE(expired.empty());
+            CATCH_REQUIRE(wheel.get_next_wakeup() <= deadline);
+
+            // following the wakeup times never skips a deadline
+            //
+            while(expired.empty())
+            {
+                std::uint64_t const wakeup(wheel.get_next_wakeup());
+                CATCH_REQUIRE(wakeup != prinbee::TIMER_WHEEL_NO_TIMER);
+                CATCH_REQUIRE(wakeup <= deadline);
+                wheel.advance(wakeup, expired);
+            }
+            CATCH_REQUIRE(expired.size() == 1);
+            CATCH_REQUIRE(expired[0] == idx + 1);
+            CATCH_REQUIRE(wheel.get_deadline(idx + 1) == prinbee::TIMER_WHEEL_NO_TIMER);
+            CATCH_REQUIRE(wheel.size() == distances.size() - idx - 1);
+        }
+        CATCH_REQUIRE(wheel.empty());
+        CATCH_REQUIRE(wheel.get_next_wakeup() == prinbee::TIMER_WHEEL_NO_TIMER);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("timer_wheel: deadlines round up to the next tick")
+    {
+        prinbee::timer_wheel wheel(g_start, g_tick);
+        wheel.add(1, g_start + g_tick + 1);
+        CATCH_REQUIRE(wheel.get_deadline(1) == g_start + g_tick * 2);
+
+        prinbee::timer_wheel::timer_id_vector_t expired;
+        wheel.advance(g_start + g_tick + 1, expired);
+        CATCH_REQUIRE(expired.empty());
+        wheel.advance(g_start + g_tick * 2, expired);
+        CATCH_REQUIRE(expired.size() == 1);
+        CATCH_REQUIRE(expired[0] == 1);
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("timer_wheel: past deadlines expire on the next advance")
+    {
+        prinbee::timer_wheel wheel(g_start, g_tick);
+        wheel.add(1, 0);
+        wheel.add(2, g_start);
+        CATCH_REQUIRE(wheel.get_next_wakeup() == g_start);
+
+        prinbee::timer_wheel::timer_id_vector_t expired;
+        wheel.advance(g_start, expired);
+        std::sort(expired.begin(), expired.end());
+        CATCH_REQUIRE(expired == prinbee::timer_wheel::timer_id_vector_t({ 1, 2 }));
+        CATCH_REQUIRE(wheel.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("timer_wheel: replace and remove timers")
+    {
+        prinbee::timer_wheel wheel(g_start, g_tick);
+        wheel.add(1, g_start + g_tick * 10);
+        wheel.add(2, g_start + g_tick * 20);
+        wheel.add(3, g_start + g_tick * 30);
+
+        // move timer 1 after timer 3 and remove timer 2
+        //
+        wheel.add(1, g_start + g_tick * 40);
+        CATCH_REQUIRE(wheel.size() == 3);
+        CATCH_REQUIRE(wheel.get_deadline(1) == g_start + g_tick * 40);
+        CATCH_REQUIRE(wheel.remove(2));
+        CATCH_REQUIRE_FALSE(wheel.remove(2));
+        CATCH_REQUIRE(wheel.size() == 2);
+
+        prinbee::timer_wheel::timer_id_vector_t expired;
+        wheel.advance(g_start + g_tick * 35, expired);
+        CATCH_REQUIRE(expired == prinbee::timer_wheel::timer_id_vector_t({ 3 }));
+
+        expired.clear();
+        wheel.advance(g_start + g_tick * 45, expired);
+        CATCH_REQUIRE(expired == prinbee::timer_wheel::timer_id_vector_t({ 1 }));
+        CATCH_REQUIRE(wheel.empty());
+    }
+    CATCH_END_SECTION()
+
+    CATCH_START_SECTION("timer_wheel: many timers in one slot")
+    {
+        prinbee::timer_wheel wheel(g_start, g_tick);
+        for(prinbee::timer_wheel::timer_id_t id(1); id <= 100; ++id)
+        {
+            wheel.add(id, g_start + g_tick * 1'000);
+        }
+
+        prinbee::timer_wheel::timer_id_vector_t expired;
+        wheel.advance(g_start + g_tick * 999, expired);
+        CATCH_REQUIRE(expired.empty());
+        wheel.advance(g_start + g_tick * 1'000, expired);
+        CATCH_REQUIRE(expired.size() == 100);
+        std::sort(expired.begin(), expired.end());
+        for(prinbee::timer_wheel::timer_id_t id(1); id <= 100; ++id)
+        {
+            CATCH_REQUIRE(expired[id - 1] == id);
+        }
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+CATCH_TEST_CASE("timer_wheel_errors", "[timer_wheel][invalid]")
+{
+    CATCH_START_SECTION("timer_wheel_errors: tick of 0")
+    {
+        CATCH_REQUIRE_THROWS_MATCHES(
+                  prinbee::timer_wheel(g_start, 0)
+                , prinbee::invalid_parameter
+                , Catch::Matchers::ExceptionMessage(
+                          "prinbee_exception: the timer wheel tick must be at least 1."));
+    }
+    CATCH_END_SECTION()
+}
+
+
+
+// vim: ts=4 sw=4 et
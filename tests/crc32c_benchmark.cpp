@@ -0,0 +1,104 @@
+#include    <prinbee/data/crc32c.h>
+#include    <chrono>
+#include    <cstdint>
+#include    <cstdlib>
+#include    <iostream>
+#include    <vector>
+
+// g++ -O3 -I. -I../../BUILD/Debug/dist/include -std=gnu++23 -o a tests/crc32c_benchmark.cpp prinbee/data/crc32c.cpp
+//
+// ./a [<block size> [<repeat>]]
+//
+// measures the time it takes to compute the CRC32C of one block, which
+// is what the dbfile adds each time a page enters or leaves its cache
+
+
+// the simplest table based version, used as a reference
+//
+std::uint32_t crc32c_bytewise(std::uint8_t const * data, std::size_t size)
+{
+    static std::uint32_t table[256];
+    if(table[1] == 0)
+    {
+        for(std::uint32_t n(0); n < 256; ++n)
+        {
+            std::uint32_t crc(n);
+            for(int k(0); k < 8; ++k)
+            {
+                crc = (crc & 1) != 0 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+            }
+            table[n] = crc;
+        }
+    }
+
+    std::uint32_t crc(0xFFFFFFFF);
+    for(; size > 0; --size, ++data)
+    {
+        crc = (crc >> 8) ^ table[(crc ^ *data) & 0xFF];
+    }
+    return ~crc;
+}
+
+
+template<typename F>
+double benchmark(std::vector<std::uint8_t> const & buffer, int repeat, F f)
+{
+    std::uint32_t sum(0);
+    auto const start(std::chrono::steady_clock::now());
+    for(int i(0); i < repeat; ++i)
+    {
+        sum += f(buffer.data(), buffer.size());
+    }
+    auto const end(std::chrono::steady_clock::now());
+
+    // use the sum so the compiler can't optimize the loop away
+    //
+    if(sum == 0x12345678)
+    {
+        std::cout << "(lucky sum)\n";
+    }
+
+    return std::chrono::duration<double, std::nano>(end - start).count() / repeat;
+}
+
+
+int main(int argc, char * argv[])
+{
+    std::size_t const max(argc >= 2 ? atoi(argv[1]) : 4096);
+    int const repeat(argc >= 3 ? atoi(argv[2]) : 1000000);
+
+    // create a buffer
+    //
+    srand(time(nullptr));
+    std::vector<std::uint8_t> buffer(max);
+    for(std::size_t i(0); i < max; ++i)
+    {
+        buffer[i] = rand();
+    }
+
+    if(crc32c_bytewise(buffer.data(), max) != prinbee::crc32c_compute(buffer.data(), max))
+    {
+        std::cerr << "error: the two implementations do not agree!?\n";
+        return 1;
+    }
+
+    double const a(benchmark(buffer, repeat / 10 + 1, crc32c_bytewise));
+    double const b(benchmark(buffer, repeat, [](std::uint8_t const * data, std::size_t size)
+        {
+            return prinbee::crc32c_compute(data, size);
+        }));
+
+    std::cout
+        << "block size: " << max << " bytes\n"
+        << "hardware accelerated: " << std::boolalpha << prinbee::crc32c_is_hardware_accelerated() << "\n"
+        << "byte-wise table: " << a << " ns per block ("
+            << max / a << " GB/s)\n"
+        << "crc32c_compute(): " << b << " ns per block ("
+            << max / b << " GB/s)\n";
+
+    return 0;
+}
+
+
+
+// vim: ts=4 sw=4 et
@@ -0,0 +1,178 @@
+#include    <prinbee/block/block_free_space.h>
+#include    <prinbee/database/context.h>
+#include    <prinbee/database/slot_allocator.h>
+#include    <chrono>
+#include    <cstdint>
+#include    <cstdlib>
+#include    <iostream>
+#include    <random>
+#include    <vector>
+
+// g++ -O3 -I. -I../../BUILD/Debug/dist/include -std=gnu++23 -o a tests/slot_allocator_benchmark.cpp -L../../BUILD/Debug/contrib/prinbee/prinbee -lprinbee
+//
+// ./a <context> <table> [<operations> [<live rows>]]
+//
+// runs the same random sequence of allocations and releases against the
+// block_free_space (FSPC) and the slot_allocator of a scratch table and
+// shows the throughput and the fraction of the blocks used by live data
+//
+// WARNING: the benchmark writes to the table, only use a test table
+
+
+struct result_t
+{
+    double                  f_ns_per_operation = 0.0;
+    std::size_t             f_live_bytes = 0;
+    std::size_t             f_blocks = 0;
+};
+
+
+struct operation_t
+{
+    bool                    f_allocate = false;
+    std::uint32_t           f_size = 0;         // when allocating
+    std::size_t             f_index = 0;        // when releasing
+};
+
+
+// the sequence is generated once so both allocators get the exact same
+// workload; the index of a release is a position in the list of live
+// allocations at that time
+//
+std::vector<operation_t> generate(std::size_t count, std::size_t live, std::uint32_t max_size)
+{
+    std::mt19937 rng(1);
+    std::vector<operation_t> result;
+    std::size_t current(0);
+    for(std::size_t i(0); i < count; ++i)
+    {
+        operation_t op;
+        op.f_allocate = current == 0 || (current < live && rng() % 3 != 0) || (current >= live && rng() % 2 == 0);
+        if(op.f_allocate)
+        {
+            // most rows are small, a few are large
+            //
+            op.f_size = rng() % 8 == 0 ? 1 + rng() % max_size : 8 + rng() % 120;
+            if(op.f_size > max_size)
+            {
+                op.f_size = max_size;
+            }
+            ++current;
+        }
+        else
+        {
+            op.f_index = rng() % current;
+            --current;
+        }
+        result.push_back(op);
+    }
+    return result;
+}
+
+
+template<typename A, typename R>
+result_t benchmark(std::vector<operation_t> const & operations, A allocate, R release)
+{
+    std::vector<std::pair<prinbee::reference_t, std::uint32_t>> live;
+
+    auto const start(std::chrono::steady_clock::now());
+    for(auto const & op : operations)
+    {
+        if(op.f_allocate)
+        {
+            live.emplace_back(allocate(op.f_size), op.f_size);
+        }
+        else
+        {
+            release(live[op.f_index].first);
+            live[op.f_index] = live.back();
+            live.pop_back();
+        }
+    }
+    auto const end(std::chrono::steady_clock::now());
+
+    result_t result;
+    result.f_ns_per_operation = std::chrono::duration<double, std::nano>(end - start).count() / operations.size();
+    for(auto const & l : live)
+    {
+        result.f_live_bytes += l.second;
+    }
+    return result;
+}
+
+
+int main(int argc, char * argv[])
+{
+    if(argc < 3)
+    {
+        std::cerr << "usage: " << argv[0] << " <context> <table> [<operations> [<live rows>]]\n";
+        return 1;
+    }
+    std::size_t const count(argc >= 4 ? atoi(argv[3]) : 1000000);
+    std::size_t const live(argc >= 5 ? atoi(argv[4]) : 100000);
+
+    prinbee::context_setup setup(argv[1]);
+    prinbee::context::pointer_t c(prinbee::context::create_context(setup));
+    c->initialize();
+    prinbee::table::pointer_t t(c->get_table(argv[2]));
+    if(t == nullptr)
+    {
+        std::cerr << "error: table \"" << argv[2] << "\" not found.\n";
+        return 1;
+    }
+    std::size_t const page_size(t->get_page_size());
+
+    prinbee::slot_allocator slots(t);
+    slots.load();
+    std::vector<operation_t> const operations(generate(count, live, slots.get_max_size()));
+
+    // FSPC
+    //
+    prinbee::block_free_space::pointer_t fspc(std::static_pointer_cast<prinbee::block_free_space>(
+                t->allocate_new_block(prinbee::dbtype_t::BLOCK_TYPE_FREE_SPACE)));
+    std::size_t const fspc_start(t->get_size());
+    result_t a(benchmark(
+          operations
+        , [&fspc](std::uint32_t size)
+            {
+                return fspc->get_free_space(size).f_reference;
+            }
+        , [&fspc](prinbee::reference_t reference)
+            {
+                fspc->release_space(reference);
+            }));
+
+    // the FSPC never releases a DATA block
+    //
+    a.f_blocks = (t->get_size() - fspc_start) / page_size;
+
+    // slot allocator
+    //
+    std::size_t const slot_start(slots.get_statistics().f_block_count);
+    result_t b(benchmark(
+          operations
+        , [&slots](std::uint32_t size)
+            {
+                return slots.allocate(size).f_reference;
+            }
+        , [&slots](prinbee::reference_t reference)
+            {
+                slots.release(reference);
+            }));
+    b.f_blocks = slots.get_statistics().f_block_count - slot_start;
+
+    std::cout
+        << "operations: " << count << " (up to " << live << " live rows of 1 to " << slots.get_max_size() << " bytes)\n"
+        << "FSPC: " << a.f_ns_per_operation << " ns per operation, "
+            << a.f_blocks << " blocks, "
+            << a.f_live_bytes * 100.0 / (a.f_blocks * page_size) << "% used by live rows\n"
+        << "slot_allocator: " << b.f_ns_per_operation << " ns per operation, "
+            << b.f_blocks << " blocks, "
+            << b.f_live_bytes * 100.0 / (b.f_blocks * page_size) << "% used by live rows\n";
+
+    return 0;
+}
+
+
+
+// vim: ts=4 sw=4 et